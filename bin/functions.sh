@@ -215,79 +215,107 @@ excitations()
 }
 
 
+###############################################################################
+# Tracks the modes with the largest loss through all available frequencies.
+# Eigenpairs at each frequency are warm-started from the previous one, and
+# modes are matched by eigenvector overlap, so that a given mode keeps its
+# label along the sweep.
+#
+# Variables:
+# * BIN           -- location of the binaries.
+# * TYPE          -- type of elements of Epsilon.
+# * EPS_BASE      -- base name of the dielectric function files.
+# * MODES_COUNT   -- [optional] number of modes to track.
+# * SPECTRUM      -- file name where to save the trajectories
+#
+# Result:
+#   freq    mode    eps_r    eps_i    loss    overlap
+#   Reordered eigenpairs are saved to "reordered-${EPS_BASE}.<freq>.*.bin".
+###############################################################################
 reorder_all()
 {
-    declare freq
-
-    echo -n "[*] Reordering: " 1>&2
-    tput sc 1>&2 # save cursor position
-    for f in ${EPS_BASE}.*.eigenvalues.bin; do
-        freq=$(echo "$f" | sed -E "s/$EPS_BASE\.($NBR)\.eigenvalues.bin/\1/")
-
-        tput rc 1>&2 # restore cursor position
-        echo -n " freq = $freq ..." 1>&2
-        
-        $BIN/reorder --type $TYPE \
-                     --in.eigenvalues "${EPS_BASE}.${freq}.eigenvalues.bin" \
-                     --in.eigenstates "${EPS_BASE}.${freq}.eigenstates.bin" \
-                     --out.eigenvalues "reordered-${EPS_BASE}.${freq}.eigenvalues.bin" \
-                     --out.eigenstates "reordered-${EPS_BASE}.${freq}.eigenstates.bin"
-    done 
-    echo 1>&2
+    declare -r trajectories="${SPECTRUM/%.dat/.modes.dat}"
+
+    echo "[*] Tracking modes ..." 1>&2
+    echo -e "# Mode trajectories for EPS_BASE = '$EPS_BASE'" > "$trajectories"
+    echo -e "freq\tmode\teps_r\teps_i\tloss\toverlap" >> "$trajectories"
+    $BIN/track_modes \
+            --type "$TYPE" \
+            --epsilon "${EPS_BASE}.*.matrix.bin" \
+            --count "${MODES_COUNT:-2}" \
+            --save "reordered-${EPS_BASE}" >> "$trajectories"
+    echo "[+] Successfully tracked the modes." 1>&2
 }
 
 
+###############################################################################
+# Computes the loss spectrum along DIRECTION for all available frequencies
+# in a single call to loss_function.
+#
+# Variables:
+# * NBR           -- regex for a real number (defined in this file).
+# * BIN           -- location of the binaries.
+# * TYPE          -- type of elements of Epsilon.
+# * EPS_BASE      -- base name of the dielectric function files.
+# * COORDINATES   -- file name where tipsi stores {(x,y,z)}_i
+# * DIRECTION     -- direction of q as (x,y,z).
+# * Q_MIN, Q_MAX, Q_STEP -- grid of |q|s.
+# * JOBS          -- [optional] number of frequencies processed in parallel.
+# * INVERSE       -- [optional] if non-empty, loss = -Im<q|eps^-1|q> rather
+#                    than -Im[1/<q|eps|q>].
+# * SPECTRUM      -- file name where to save the spectrum
+#
+# Result:
+#   freq    qx    qy    qz    eps_r    eps_i    loss
+###############################################################################
 loss_spectrum()
 {
     declare -r direction=$( echo "$DIRECTION" \
                           | sed -E 's/\(\s*('$NBR')\s*,\s*('$NBR')\s*,\s*('$NBR')\s*\)/(\1,\3,\5)/g' )
-    declare -r qs=$( \
-python3 <<-EOF
-begin = $Q_MIN
-end   = $Q_MAX
-step  = $Q_STEP
-acc   = []
-while begin <= end:
-    acc.append("%.5E" % begin)
-    begin += step
-print(','.join(acc))
-EOF
-)
-    echo "$qs" | tr ',' '\n' | wc -l >  ".temp.loss_spectrum.qs.dat"
-    echo "$qs" | tr ',' '\n'         >> ".temp.loss_spectrum.qs.dat"
-
-    declare freq
-    declare spectrum
+    declare -r spectrum="${SPECTRUM/%.dat/.${direction}.dat}"
+
+    echo "[*] Calculating loss spectrum along $direction ..." 1>&2
+    echo -e "# Loss spectrum for EPS_BASE = '$EPS_BASE'" > "$spectrum"
+    echo -e "freq\tqx\tqy\tqz\teps_r\teps_i\tloss" >> "$spectrum"
+    $BIN/loss_function \
+            --type "$TYPE" \
+            --epsilon "${EPS_BASE}.*.matrix.bin" \
+            --positions "$COORDINATES" \
+            --direction "$direction" \
+            --q "${Q_MIN}:${Q_MAX}:${Q_STEP}" \
+            --jobs "${JOBS:-1}" \
+            ${INVERSE:+--inverse} >> "$spectrum"
+    echo "[+] Successfully calculated the loss spectrum." 1>&2
+}
 
-    tput sc 1>&2 # save cursor position
-    for f in ${EPS_BASE}.*.matrix.bin; do
-        freq=$(echo "$f" | sed -E "s/$EPS_BASE\.($NBR)\.matrix.bin/\1/")
-        tput rc 1>&2 # restore cursor position
-        echo -n "[*] frequency = $freq ..." 1>&2
-
-        spectrum="${SPECTRUM/%.dat/.${freq}.${direction}.dat}"
-        echo -e "# epsilon(q) for EPS_BASE = '$EPS_BASE'" > "$spectrum"
-        echo -e "# freq = $freq" >> "$spectrum"
-        echo -e "q\teps_r\teps_i" >> "$spectrum"
-        $BIN/loss_function \
-                --type "$TYPE" \
-                --epsilon "$f" \
-                --positions "$COORDINATES" \
-                --direction "$direction" \
-                --q "$qs" >> "$spectrum"
-        cat  "$spectrum" \
-            | tail -n +4 \
-            | awk -F'\t' '{ printf("%.20E\n", $3 / ($2**2 + $3**2)); }' \
-            | cat <(echo "$freq") - \
-            > ".temp.loss_spectrum.spectrum.${freq}.dat"
-    done
-    echo 1>&2 # add a trailing newline
 
-    echo "[*] Combining..." 1>&2
-    paste .temp.loss_spectrum.qs.dat .temp.loss_spectrum.spectrum.*.dat \
-        > "${SPECTRUM/%.dat/.${direction}.dat}"
-    
-    rm -f .temp.loss_spectrum.*.dat
+###############################################################################
+# Estimates the total loss spectrum -Im Tr[eps^-1] for all available
+# frequencies using random probe vectors and Krylov solves, i.e. without
+# diagonalising Epsilon.
+#
+# Variables:
+# * BIN           -- location of the binaries.
+# * TYPE          -- type of elements of Epsilon.
+# * EPS_BASE      -- base name of the dielectric function files.
+# * PROBES_ERROR  -- [optional] target relative error of the estimate.
+# * SPECTRUM      -- file name where to save the spectrum
+#
+# Result:
+#   freq    loss    error    loss_per_site    probes    iterations
+###############################################################################
+total_loss_spectrum()
+{
+    declare -r spectrum="${SPECTRUM/%.dat/.total.dat}"
+
+    echo "[*] Estimating total loss spectrum ..." 1>&2
+    echo -e "# Total loss spectrum for EPS_BASE = '$EPS_BASE'" > "$spectrum"
+    echo -e "freq\tloss\terror\tloss_per_site\tprobes\titerations" >> "$spectrum"
+    $BIN/loss_trace \
+            --type "$TYPE" \
+            --epsilon "${EPS_BASE}.*.matrix.bin" \
+            --probes.error "${PROBES_ERROR:-0.01}" >> "$spectrum"
+    echo "[+] Successfully estimated the total loss spectrum." 1>&2
 }
 
 
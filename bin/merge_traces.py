@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+
+"""Merges the per-rank traces written by `hello --out.file.trace` (see
+tcm::timing::write_trace) into one Chrome trace-event file.
+
+Every input has timestamps relative to the moment its process started
+tracing and stores the wall-clock time of that moment as
+`otherData.origin_us`. The merged trace uses the earliest origin as zero,
+so regions of different ranks line up on a common timeline (up to the
+synchronisation of the clocks of the nodes).
+
+Usage: merge_traces.py -o merged.json Trace.*.json
+"""
+
+import sys
+import json
+import argparse
+
+
+def parse_options(argv):
+    parser = argparse.ArgumentParser('Merge traces')
+    parser.add_argument( '-o', '--output'
+                       , dest='output'
+                       , required=True
+                       , help='Name of the merged trace.' )
+    parser.add_argument( 'inputs'
+                       , nargs='+'
+                       , help='Traces of the individual processes.' )
+    return parser.parse_args(argv)
+
+
+def load(file_name):
+    with open(file_name, 'r') as f:
+        trace = json.load(f)
+    origin = trace.get('otherData', {}).get('origin_us', 0)
+    return trace, origin
+
+
+def merge(traces):
+    start = min(origin for (_, origin) in traces)
+    events = []
+    dropped = 0
+    for (trace, origin) in traces:
+        shift = origin - start
+        for event in trace['traceEvents']:
+            if 'ts' in event:
+                event['ts'] += shift
+            events.append(event)
+        dropped += trace.get('otherData', {}).get('dropped', 0)
+    return { 'traceEvents': events
+           , 'displayTimeUnit': 'ms'
+           , 'otherData': {'origin_us': start, 'dropped': dropped} }
+
+
+def main():
+    options = parse_options(sys.argv[1:])
+    traces = [load(name) for name in options.inputs]
+    merged = merge(traces)
+    with open(options.output, 'w') as f:
+        json.dump(merged, f)
+    sys.stderr.write( 'Merged {} traces with {} events into {}.\n'.format(
+        len(traces), len(merged['traceEvents']), options.output ) )
+    if merged['otherData']['dropped'] != 0:
+        sys.stderr.write( 'Warning: {} regions were dropped while tracing.\n'
+            .format(merged['otherData']['dropped']) )
+
+
+if __name__ == '__main__':
+    main()
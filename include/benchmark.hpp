@@ -1,16 +1,26 @@
 #ifndef TCM_BENCHMARK_HPP
 #define TCM_BENCHMARK_HPP
 
-#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
-#include <unordered_map>
-#include <thread>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
 #include <mutex>
-
-#include <boost/range/adaptors.hpp>
-#include <boost/range/algorithm.hpp>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <detail/config.hpp>
+#include <detail/perf_counters.hpp>
+#include <memory.hpp>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -19,14 +29,47 @@
 ///
 /// \detail To get an idea how long a certain part of a simulation took, we
 /// measure the execution time of some functions. This can be turned on/off
-/// by defining/undefining the #CONFIG_DO_MEASURE flag in detail/config.hpp 
-/// file. Obtained measurements are saved in a global static table 
-/// `tcm::timing::_global_impl_stats`. Please, __do not use__ this directly.
-/// There is also an global static #std::mutex 
-/// `tcm::timing::_global_impl_stats_mutex` protecting `_global_impl_stats`.
-/// Please, __do not__ temper with it either.
-///
-/// There are two functions that should be used to manipulate this table.
+/// by defining/undefining the #CONFIG_DO_MEASURE flag in detail/config.hpp
+/// file.
+///
+/// Timers nest: every thread keeps track of which timers are currently
+/// running, and a call is recorded under the path of timers that enclose
+/// it. E.g. `chi_function::at` called from `chi_function::make` called from
+/// `dielectric_function::make` is a different entry than a direct call to
+/// `chi_function::at`. For every entry we keep the number of calls and the
+/// total (inclusive), minimal and maximal time of a call. Exclusive time is
+/// inclusive time minus that of the children.
+///
+/// Timers are cheap enough to be used in tight loops:
+/// * Every #TCM_MEASURE call site registers its name once, on first use,
+///   and from then on only uses the integer id it got (names only depend on
+///   template parameters, so every instantiation gets its own id).
+/// * Every thread records into its own call tree: no locks, no shared
+///   cache lines and, once a path has been seen, no allocations on the hot
+///   path. Trees of all threads (also the ones that have already finished)
+///   are merged by #snapshot() and #report().
+///
+/// Timers started by a thread do not nest into timers running in the
+/// thread that spawned it; they show up at the top level.
+///
+/// Additionally, a timeline of all timed regions can be recorded with
+/// #start_trace() and written with #write_trace() in the Chrome
+/// trace-event format, which chrome://tracing and https://ui.perfetto.dev
+/// open. Every region becomes one event with its thread and process (MPI
+/// rank). `bin/merge_traces.py` merges the traces of several processes.
+///
+/// Kernels with a known operation count (BLAS and LAPACK wrappers, the G
+/// and chi builds) additionally report their model FLOPs and bytes moved
+/// with #TCM_ACCOUNT; see detail/cost_model.hpp and roofline.hpp.
+///
+/// With #CONFIG_TRACK_MEMORY every entry also records the largest amount of
+/// memory held by matrices and LAPACK buffers while it ran (see memory.hpp).
+///
+/// If hardware counters are switched on (see detail/perf_counters.hpp),
+/// every entry also accumulates cycles, instructions, LLC misses and FP
+/// operations, and #report() shows IPC, GFLOP/s and bytes per flop.
+///
+/// There are two functions that should be used to manipulate the counters.
 /// * #update() is used to record benchmarks;
 /// * #report() is used to report the results.
 ///
@@ -38,10 +81,13 @@
 /// \include src/timing_example.cpp
 /// __Possible output__:
 /// \code{.unparsed}
-/// [-------------------------------------------------------]
-/// [ obscure_namespace::foobarfoo() |              7.5e-08 ]
-/// [                          foo() |           0.00513702 ]
-/// [-------------------------------------------------------]
+/// [---------------------------------------------------------------------------------------------------------------]
+/// [ name                             |      calls |     incl [s] |     excl [s] | % parent |      min [s] |      max [s] ]
+/// [---------------------------------------------------------------------------------------------------------------]
+/// [ foo()                            |          1 |   0.00514891 |   0.00514826 |    100.0 |   0.00514891 |   0.00514891 ]
+/// [   obscure_namespace::foobarfoo() |          3 |     6.52e-07 |     6.52e-07 |      0.0 |      1.5e-07 |     3.47e-07 ]
+/// [ obscure_namespace::foobarfoo()   |          1 |      1.1e-07 |      1.1e-07 |      0.0 |      1.1e-07 |      1.1e-07 ]
+/// [---------------------------------------------------------------------------------------------------------------]
 /// \endcode
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -51,36 +97,574 @@ namespace tcm {
 namespace timing {
 
 
-static std::unordered_map< std::string
-                         , std::chrono::duration<double> > _global_impl_stats;
-static std::mutex _global_impl_stats_mutex;
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Work done by a kernel according to its cost model: floating point
+/// operations and bytes moved between memory and the CPU.
+///////////////////////////////////////////////////////////////////////////////
+struct Work {
+	double flops = 0;
+	double bytes = 0;
+};
+
+
+namespace detail {
+
+using clock = std::chrono::steady_clock;
+
+
+/// \brief Counters of one node of a call tree. They are only written by
+/// the owning thread, hence relaxed loads and stores instead of
+/// read-modify-write operations suffice. Atomics are only needed so that
+/// #report() may read them concurrently.
+struct Stats {
+	std::atomic<std::uint64_t> count{0};
+	std::atomic<std::uint64_t> total{0};
+	std::atomic<std::uint64_t> min{std::numeric_limits<std::uint64_t>::max()};
+	std::atomic<std::uint64_t> max{0};
+	/// Hardware counters, inclusive, indexed by perf::Kind.
+	std::array<std::atomic<std::uint64_t>, perf::KindCount> counters{};
+	/// Model work, exclusive, see #account().
+	std::atomic<double>        flops{0};
+	std::atomic<double>        bytes{0};
+	/// Memory high-water mark over all calls, see memory::Watermark.
+	std::atomic<std::uint64_t> memory{0};
+
+	auto add(std::uint64_t const t) noexcept -> void
+	{
+		auto constexpr relaxed = std::memory_order_relaxed;
+		count.store(count.load(relaxed) + 1, relaxed);
+		total.store(total.load(relaxed) + t, relaxed);
+		if (t < min.load(relaxed)) min.store(t, relaxed);
+		if (t > max.load(relaxed)) max.store(t, relaxed);
+	}
+
+	auto add(perf::Counts const& delta) noexcept -> void
+	{
+		auto constexpr relaxed = std::memory_order_relaxed;
+		for (std::size_t k = 0; k < delta.size(); ++k)
+			counters[k].store(counters[k].load(relaxed) + delta[k], relaxed);
+	}
+
+	auto add(Work const& work) noexcept -> void
+	{
+		auto constexpr relaxed = std::memory_order_relaxed;
+		flops.store(flops.load(relaxed) + work.flops, relaxed);
+		bytes.store(bytes.load(relaxed) + work.bytes, relaxed);
+	}
+
+	auto add_memory(std::uint64_t const peak) noexcept -> void
+	{
+		auto constexpr relaxed = std::memory_order_relaxed;
+		if (peak > memory.load(relaxed)) memory.store(peak, relaxed);
+	}
+};
+
+
+/// \brief Call tree of one thread.
+///
+/// Node 0 is the root. Every other node is a timer id together with the
+/// node it was started in. Nodes are stored in fixed-size chunks that are
+/// allocated on first use and never move, and a node is only published
+/// (by incrementing #size()) once its parent and id are set. Hence other
+/// threads can read the tree without locking.
+class ThreadTree {
+
+public:
+	static constexpr std::size_t chunk_size = 256;
+	static constexpr std::size_t max_chunks = 256;
+	static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+	struct Node {
+		std::size_t parent = npos;
+		std::size_t id     = npos;
+		Stats       stats;
+		// (timer id, node) pairs. Only used by the owning thread.
+		std::vector<std::pair<std::size_t, std::size_t>> children;
+	};
+
+private:
+	struct Chunk { std::array<Node, chunk_size> nodes; };
+
+	std::array<std::atomic<Chunk*>, max_chunks> _chunks;
+	std::atomic<std::size_t>                    _size;
+	std::size_t                                 _current = 0;
+
+public:
+	/// \brief A region for the trace, see #start_trace().
+	struct Event {
+		std::size_t   id;
+		std::int64_t  start;    ///< Nanoseconds since the start of the trace.
+		std::uint64_t duration; ///< Nanoseconds.
+	};
+
+private:
+	// Only locked by the owning thread and by #write_trace(), i.e. hardly
+	// ever contended.
+	std::mutex         _events_mutex;
+	std::vector<Event> _events;
+	std::size_t        _dropped = 0;
+
+	auto node(std::size_t const i) noexcept -> Node&
+	{
+		return _chunks[i / chunk_size].load(std::memory_order_relaxed)
+			->nodes[i % chunk_size];
+	}
+
+	/// \brief Returns the node of timer \p id started in node \p parent,
+	/// creating it if needed.
+	auto child(std::size_t const parent, std::size_t const id) -> std::size_t
+	{
+		for (auto const& x : node(parent).children)
+			if (x.first == id) return x.second;
+
+		auto const i = _size.load(std::memory_order_relaxed);
+		if (i == chunk_size * max_chunks) {
+			throw std::length_error{"Too many nested timers."};
+		}
+		auto& slot = _chunks[i / chunk_size];
+		if (slot.load(std::memory_order_relaxed) == nullptr) {
+			slot.store(new Chunk, std::memory_order_release);
+		}
+		node(i).parent = parent;
+		node(i).id     = id;
+		node(parent).children.emplace_back(id, i);
+		_size.store(i + 1, std::memory_order_release);
+		return i;
+	}
+
+public:
+	ThreadTree()
+	{
+		for (auto& chunk : _chunks) chunk.store(nullptr, std::memory_order_relaxed);
+		_chunks[0].store(new Chunk, std::memory_order_release);
+		_size.store(1, std::memory_order_release);
+	}
+
+	ThreadTree(ThreadTree const&) = delete;
+	auto operator=(ThreadTree const&) -> ThreadTree& = delete;
+
+	~ThreadTree()
+	{ for (auto& chunk : _chunks) delete chunk.load(std::memory_order_relaxed); }
+
+	/// \brief Starts timer \p id in the current node. Returns the node that
+	/// has to be passed to #leave(). Must only be called by the owning
+	/// thread.
+	auto enter(std::size_t const id) -> std::size_t
+	{
+		_current = child(_current, id);
+		return _current;
+	}
+
+	/// \brief Stops the timer started by #enter() that returned \p i.
+	auto leave(std::size_t const i, std::uint64_t const t) noexcept -> void
+	{
+		auto& x = node(i);
+		x.stats.add(t);
+		_current = x.parent;
+	}
+
+	/// \brief Adds hardware counter differences \p delta to node \p i.
+	auto count(std::size_t const i, perf::Counts const& delta) noexcept -> void
+	{ node(i).stats.add(delta); }
+
+	/// \brief Records that memory use reached \p peak in node \p i.
+	auto remember(std::size_t const i, std::uint64_t const peak) noexcept -> void
+	{ node(i).stats.add_memory(peak); }
+
+	/// \brief Adds \p work to the innermost running timer. Ignored if no
+	/// timer is running.
+	auto account(Work const& work) noexcept -> void
+	{ if (_current != 0) node(_current).stats.add(work); }
+
+	/// \brief Records a call of timer \p id in the current node without
+	/// entering it.
+	auto record(std::size_t const id, std::uint64_t const t) -> void
+	{ node(child(_current, id)).stats.add(t); }
+
+	/// \brief Number of published nodes. May be called by any thread.
+	auto size() const noexcept -> std::size_t
+	{ return _size.load(std::memory_order_acquire); }
+
+	/// \brief Node \p i < #size(). May be called by any thread, but only
+	/// `parent`, `id` and `stats` may be accessed.
+	auto find(std::size_t const i) const noexcept -> Node const&
+	{
+		return _chunks[i / chunk_size].load(std::memory_order_acquire)
+			->nodes[i % chunk_size];
+	}
+
+	/// \brief Appends \p event to the trace unless there are already
+	/// \p max_events.
+	auto trace(Event const& event, std::size_t const max_events) -> void
+	{
+		std::lock_guard<std::mutex> lock{_events_mutex};
+		if (_events.size() < max_events) _events.push_back(event);
+		else ++_dropped;
+	}
+
+	/// \brief Calls \p f(events, dropped) with the recorded trace.
+	template <class _F>
+	auto events(_F&& f) -> void
+	{
+		std::lock_guard<std::mutex> lock{_events_mutex};
+		f(_events, _dropped);
+	}
+
+	auto clear_events() -> void
+	{
+		std::lock_guard<std::mutex> lock{_events_mutex};
+		_events.clear();
+		_dropped = 0;
+	}
+};
+
+
+/// \brief Settings of the trace. All fields but `enabled` are only written
+/// by #start_trace() before `enabled` is set.
+struct TraceConfig {
+	std::atomic<bool> enabled{false};
+	clock::time_point origin;
+	std::int64_t      origin_us    = 0; ///< `origin` in system_clock time.
+	int               process      = 0;
+	std::uint64_t     min_duration = 0;
+	std::size_t       max_events   = 0;
+};
+
+
+inline auto trace_config() -> TraceConfig&
+{
+	static TraceConfig x;
+	return x;
+}
+
+
+/// \brief Names of the timers and the call trees of all threads.
+class Registry {
+	std::mutex                                   _mutex;
+	std::vector<std::string>                     _names;
+	std::unordered_map<std::string, std::size_t> _ids;
+	std::vector<std::unique_ptr<ThreadTree>>     _threads;
+
+public:
+	/// \brief Returns the id of the timer called \p name, creating it if
+	/// needed.
+	auto id(std::string name) -> std::size_t
+	{
+		std::lock_guard<std::mutex> lock{_mutex};
+		auto const i = _ids.find(name);
+		if (i != std::end(_ids)) return i->second;
+		_names.push_back(name);
+		_ids.emplace(std::move(name), _names.size() - 1);
+		return _names.size() - 1;
+	}
+
+	/// \brief Creates the call tree of a new thread.
+	auto attach() -> ThreadTree*
+	{
+		std::lock_guard<std::mutex> lock{_mutex};
+		_threads.push_back(std::make_unique<ThreadTree>());
+		return _threads.back().get();
+	}
+
+	/// \brief Calls \p f(i, tree) for the call tree of every thread, where
+	/// \p i numbers threads in order of their first timer.
+	template <class _F>
+	auto for_each_thread(_F&& f) -> void
+	{
+		std::lock_guard<std::mutex> lock{_mutex};
+		for (std::size_t i = 0; i < _threads.size(); ++i) f(i, *_threads[i]);
+	}
+
+	/// \brief Names of all timers, indexed by id.
+	auto names() -> std::vector<std::string>
+	{
+		std::lock_guard<std::mutex> lock{_mutex};
+		return _names;
+	}
+
+	/// \brief Node of the call tree merged over threads.
+	struct Merged {
+		std::size_t   id;
+		std::uint64_t count = 0;
+		std::uint64_t total = 0;
+		std::uint64_t min   = std::numeric_limits<std::uint64_t>::max();
+		std::uint64_t max   = 0;
+		perf::Counts  counters{};
+		Work          work;
+		std::uint64_t memory = 0;
+		std::map<std::size_t, std::size_t> children;
+
+		explicit Merged(std::size_t const timer) : id{timer} {}
+	};
+
+	/// \brief Merges the call trees of all threads: nodes with the same
+	/// path of timer ids are added up. Element 0 is the root. Calls \p f
+	/// with the merged tree and the names of the timers.
+	template <class _F>
+	auto merge(_F&& f) -> void
+	{
+		std::lock_guard<std::mutex> lock{_mutex};
+		std::vector<Merged> merged(1, Merged{ThreadTree::npos});
+		for (auto const& thread : _threads) {
+			auto const n = thread->size();
+			std::vector<std::size_t> where(n, 0);
+			// Parents are always created before their children.
+			for (std::size_t i = 1; i < n; ++i) {
+				auto const& node   = thread->find(i);
+				auto const  parent = where[node.parent];
+				auto const  found  = merged[parent].children.find(node.id);
+				if (found == std::end(merged[parent].children)) {
+					where[i] = merged.size();
+					merged[parent].children.emplace(node.id, merged.size());
+					merged.push_back(Merged{node.id});
+				}
+				else {
+					where[i] = found->second;
+				}
+
+				auto constexpr relaxed = std::memory_order_relaxed;
+				auto& x = merged[where[i]];
+				x.count += node.stats.count.load(relaxed);
+				x.total += node.stats.total.load(relaxed);
+				x.min = std::min(x.min, node.stats.min.load(relaxed));
+				x.max = std::max(x.max, node.stats.max.load(relaxed));
+				for (std::size_t k = 0; k < x.counters.size(); ++k)
+					x.counters[k] += node.stats.counters[k].load(relaxed);
+				x.work.flops += node.stats.flops.load(relaxed);
+				x.work.bytes += node.stats.bytes.load(relaxed);
+				x.memory = std::max(x.memory, node.stats.memory.load(relaxed));
+			}
+		}
+		f(merged, _names);
+	}
+};
+
+
+/// \brief The registry is intentionally leaked: threads that are still
+/// running during static destruction may use it.
+inline auto registry() -> Registry&
+{
+	static auto* x = new Registry;
+	return *x;
+}
+
+
+/// \brief Call tree of the calling thread.
+inline auto this_thread() -> ThreadTree&
+{
+	thread_local auto* const self = registry().attach();
+	return *self;
+}
+
+
+inline auto to_ticks(std::chrono::nanoseconds const t) noexcept -> std::uint64_t
+{ return static_cast<std::uint64_t>(std::max<std::int64_t>(0, t.count())); }
+
+} // namespace detail
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Updates the global stats table in a thread-safe way.
+/// \brief Returns the id of the timer called \p func_name. Ids are stable
+/// for the lifetime of the program, so the result may be cached.
+///////////////////////////////////////////////////////////////////////////////
+inline auto register_timer(std::string func_name) -> std::size_t
+{
+	return detail::registry().id(std::move(func_name));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Records one call of timer \p id that took \p delta_t, nested in
+/// the timers currently running in this thread. Lock-free.
+///////////////////////////////////////////////////////////////////////////////
+inline auto update( std::size_t const id
+                  , std::chrono::nanoseconds const delta_t ) -> void
+{
+	detail::this_thread().record(id, detail::to_ticks(delta_t));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Records one call of \p func_name that took \p delta_t.
 
 /// \param func_name Name of the function how it will appear in the table.
-/// \param delta_t   Extra seconds spent in \p func_name since the last call
-///                  to #update(). \p delta_t is added to the old time. If this
-///                  is the first call to #update() old time is taken to be 0.
-/// 
-/// This function has the following behavior:
-/// \snippet include/benchmark.hpp Updating global table
+/// \param delta_t   Seconds spent in \p func_name.
+///
+/// Looks the name up on every call. Prefer #TCM_MEASURE.
 ///////////////////////////////////////////////////////////////////////////////
-auto update( std::string func_name
-           , std::chrono::duration<double> const delta_t ) -> void
+inline auto update( std::string func_name
+                  , std::chrono::duration<double> const delta_t ) -> void
 {
-	//! [Updating global table]
-	std::lock_guard<std::mutex> lock{ _global_impl_stats_mutex };
-	auto i = _global_impl_stats.emplace(std::move(func_name), 0.0).first;
-	i->second += delta_t;
-	//! [Updating global table]
+	update( register_timer(std::move(func_name))
+	      , std::chrono::duration_cast<std::chrono::nanoseconds>(delta_t) );
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Pretty-prints the global stats table to \p out.
+/// \brief Attributes \p work to the innermost timer running in this thread.
+/// Lock-free. Prefer #TCM_ACCOUNT.
+///////////////////////////////////////////////////////////////////////////////
+inline auto account(Work const& work) noexcept -> void
+{
+	detail::this_thread().account(work);
+}
+
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief One entry of the timing tree. Times are in seconds.
+///////////////////////////////////////////////////////////////////////////////
+struct Record {
+	std::string         name;
+	std::uint64_t       calls;
+	double              inclusive;
+	double              exclusive;
+	double              min;
+	double              max;
+	std::vector<Record> children; ///< Most expensive first.
+	perf::Counts        counters; ///< Inclusive, zero if not counted.
+	Work                work;     ///< Inclusive model work.
+	std::uint64_t       memory;   ///< Memory high-water mark in bytes.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Returns the timing tree merged over all threads. The result
+/// contains the top-level entries, most expensive first.
+///
+/// Timers that are still running have no calls yet; their inclusive time
+/// is taken to be that of their children.
+///////////////////////////////////////////////////////////////////////////////
+inline auto snapshot() -> std::vector<Record>
+{
+	using Merged = detail::Registry::Merged;
+	std::vector<Record> result;
+	detail::registry().merge(
+		[&result](std::vector<Merged> const& merged
+		         , std::vector<std::string> const& names) {
+			auto const build = [&merged, &names](auto const& self
+			                                    , Merged const& x)
+				-> std::vector<Record> {
+				std::vector<Record> records;
+				for (auto const& child : x.children) {
+					auto const& y = merged[child.second];
+					Record r{ names[y.id], y.count, 1E-9 * y.total, 0
+					        , y.count != 0 ? 1E-9 * y.min : 0
+					        , 1E-9 * y.max
+					        , self(self, y), y.counters, y.work, y.memory };
+					if (r.calls == 0 and r.children.empty()) continue;
+					double children = 0;
+					for (auto const& z : r.children) {
+						children     += z.inclusive;
+						r.work.flops += z.work.flops;
+						r.work.bytes += z.work.bytes;
+					}
+					if (r.calls == 0) r.inclusive = children;
+					r.exclusive = std::max(0.0, r.inclusive - children);
+					records.push_back(std::move(r));
+				}
+				std::stable_sort( std::begin(records), std::end(records)
+				                , [](auto const& a, auto const& b)
+				                  { return a.inclusive > b.inclusive; } );
+				return records;
+			};
+			result = build(build, merged.front());
+		});
+	return result;
+}
+
+
+namespace detail {
+
+inline auto name_width( std::vector<Record> const& records
+                      , std::size_t const depth ) -> std::size_t
+{
+	std::size_t width = 0;
+	for (auto const& r : records) {
+		width = std::max(width, 2 * depth + r.name.size());
+		width = std::max(width, name_width(r.children, depth + 1));
+	}
+	return width;
+}
+
+
+/// \brief Prints \p scale * \p x / \p y, or "-" if a counter is missing.
+template <class _Stream>
+auto print_ratio( _Stream& out, int const width
+                , perf::Kind const x_kind, perf::Kind const y_kind
+                , Record const& r, double const scale, double const y = 0 )
+	-> void
+{
+	auto const denominator = y > 0 ? y : static_cast<double>(r.counters[y_kind]);
+	if (not perf::available(x_kind) or not perf::available(y_kind)
+	    or denominator <= 0) {
+		out << std::setw(width) << "-";
+		return;
+	}
+	auto const precision = out.precision();
+	out << std::setw(width) << std::fixed << std::setprecision(2)
+	    << scale * static_cast<double>(r.counters[x_kind]) / denominator
+	    << std::defaultfloat << std::setprecision(precision);
+}
+
+
+/// \brief Bytes moved from memory per LLC miss.
+constexpr double cache_line = 64;
+
+
+template <class _Stream>
+auto print( _Stream& out, std::vector<Record> const& records
+          , double const parent, std::size_t const depth
+          , std::size_t const width, bool const counters ) -> void
+{
+	auto constexpr memory_width = 10;
+	auto constexpr count_width = 10;
+	auto constexpr time_width  = 12;
+	auto const     precision   = out.precision();
+	for (auto const& r : records) {
+		auto const percent = parent > 0 ? 100 * r.inclusive / parent : 0.0;
+		out << "[ " << std::left << std::setw(width)
+		    << (std::string(2 * depth, ' ') + r.name) << std::right
+		    << " | " << std::setw(count_width) << r.calls
+		    << " | " << std::setw(time_width) << r.inclusive
+		    << " | " << std::setw(time_width) << r.exclusive
+		    << " | " << std::setw(8) << std::fixed << std::setprecision(1)
+		    << percent << std::defaultfloat << std::setprecision(precision)
+		    << " | " << std::setw(time_width) << r.min
+		    << " | " << std::setw(time_width) << r.max;
+		if (counters) {
+			using namespace perf;
+			out << " | ";
+			print_ratio(out, 6, Instructions, Cycles, r, 1);
+			out << " | ";
+			print_ratio(out, 9, Flops, Flops, r, 1E-9, r.inclusive);
+			out << " | ";
+			print_ratio(out, 8, LLCMisses, Flops, r, cache_line);
+		}
+		if (memory::enabled) {
+			out << " | " << std::setw(memory_width)
+			    << memory::format_bytes(r.memory);
+		}
+		out << " ]\n";
+		print(out, r.children, r.inclusive, depth + 1, width, counters);
+	}
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Pretty-prints the timing tree to \p out.
+
+/// Every entry shows the number of calls, the inclusive and exclusive time,
+/// the inclusive time as a percentage of its parent's (top-level entries:
+/// of all top-level entries) and the minimal and maximal time of a call.
+/// With hardware counters it also shows instructions per cycle, GFLOP/s and
+/// bytes per flop, where bytes are estimated as LLC misses times the cache
+/// line size. All three are inclusive; "-" marks missing counters. They
+/// cover the calling thread only, not BLAS worker threads (see
+/// detail/perf_counters.hpp).
+/// With #CONFIG_TRACK_MEMORY the last column is the memory high-water mark.
+///
 /// \param out Output stream where to write to.
 /// \warning #std::setw is used in the implementation which places some
 ///          constraints on _Stream.
@@ -88,31 +672,168 @@ auto update( std::string func_name
 template <class _Stream>
 auto report(_Stream& out) -> void
 {
-	std::lock_guard<std::mutex> lock{ _global_impl_stats_mutex };
+	auto const records = snapshot();
+	double total = 0;
+	for (auto const& r : records) total += r.inclusive;
 
-	auto const get_length = [](auto const& s) noexcept { return s.size(); };
-	auto const max_name_width = *boost::max_element( _global_impl_stats
-		| boost::adaptors::map_keys
-		| boost::adaptors::transformed(std::cref(get_length)) );
-	auto constexpr max_time_width = 20;
-	auto const hline = std::string(max_name_width + max_time_width + 5, '-');
+	auto const counters = perf::available(perf::Cycles)
+	                      or perf::available(perf::Flops);
+	auto const width = std::max<std::size_t>(4, detail::name_width(records, 0));
+	auto const hline = std::string( width + 10 + 4 * 12 + 8 + 20
+	                              + (counters ? 6 + 9 + 8 + 9 : 0)
+	                              + (memory::enabled ? 10 + 3 : 0), '-' );
 
 	out << "[" << hline << "]\n";
-	for (const auto& _element : _global_impl_stats) {
-		out << "[ " << std::setw(max_name_width) << _element.first 
-		    << " | " 
-		    << std::setw(max_time_width) << _element.second.count() 
-			<< " ]\n";
+	out << "[ " << std::left << std::setw(width) << "name" << std::right
+	    << " | " << std::setw(10) << "calls"
+	    << " | " << std::setw(12) << "incl [s]"
+	    << " | " << std::setw(12) << "excl [s]"
+	    << " | " << std::setw(8)  << "% parent"
+	    << " | " << std::setw(12) << "min [s]"
+	    << " | " << std::setw(12) << "max [s]";
+	if (counters) {
+		out << " | " << std::setw(6) << "IPC"
+		    << " | " << std::setw(9) << "GFLOP/s"
+		    << " | " << std::setw(8) << "B/flop";
 	}
+	if (memory::enabled) out << " | " << std::setw(10) << "peak mem";
+	out << " ]\n";
+	out << "[" << hline << "]\n";
+	detail::print(out, records, total, 0, width, counters);
 	out << "[" << hline << "]\n";
+	auto const status = perf::status();
+	if (status != "not enabled" and status != "ok") {
+		out << "Hardware counters " << status << ".\n";
+	}
+	if (counters) {
+		out << "Hardware counters cover the calling thread only, not BLAS "
+		       "worker threads.\n";
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Starts recording a trace of all timed regions, discarding any
+/// previous one.
+
+/// \param process      Process id in the trace, e.g. the MPI rank.
+/// \param min_duration Shorter regions are not recorded. This keeps traces
+///                     of tight loops manageable.
+/// \param max_events   At most that many regions are recorded per thread;
+///                     the number of dropped ones is saved in the trace.
+///
+/// Must not be called while other threads are in timed regions.
+///////////////////////////////////////////////////////////////////////////////
+inline auto start_trace( int const process
+                       , std::chrono::nanoseconds const min_duration =
+                             std::chrono::microseconds{10}
+                       , std::size_t const max_events = std::size_t{1} << 22 )
+	-> void
+{
+	auto& config = detail::trace_config();
+	config.enabled.store(false, std::memory_order_release);
+	detail::registry().for_each_thread(
+		[](auto, auto& tree) { tree.clear_events(); } );
+	config.process      = process;
+	config.min_duration = detail::to_ticks(min_duration);
+	config.max_events   = max_events;
+	config.origin       = detail::clock::now();
+	config.origin_us    = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	config.enabled.store(true, std::memory_order_release);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Stops recording the trace. Recorded regions are kept.
+///////////////////////////////////////////////////////////////////////////////
+inline auto stop_trace() -> void
+{
+	detail::trace_config().enabled.store(false, std::memory_order_release);
+}
+
+
+namespace detail {
+
+inline auto json_escape(std::string const& x) -> std::string
+{
+	std::string result;
+	for (auto const c : x) {
+		if (c == '"' or c == '\\') {
+			result += '\\';
+			result += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) result += ' ';
+		else result += c;
+	}
+	return result;
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Writes the trace as Chrome trace-event JSON to \p out.
+
+/// Timestamps are in microseconds since #start_trace(). Its wall-clock time
+/// is saved as `otherData.origin_us`, so that `bin/merge_traces.py` can
+/// align traces of different processes.
+///
+/// Regions that are still running are not included.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Stream>
+auto write_trace(_Stream& out) -> void
+{
+	auto const& config   = detail::trace_config();
+	auto&       registry = detail::registry();
+	auto const  pid      = std::to_string(config.process);
+
+	auto const  names    = registry.names();
+	std::size_t dropped  = 0;
+	auto const flags     = out.flags();
+	auto const precision = out.precision();
+	out << std::fixed << std::setprecision(3);
+	out << "{\"traceEvents\":[\n"
+	    << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+	    << ",\"tid\":0,\"args\":{\"name\":\"rank " << pid << "\"}}";
+	registry.for_each_thread([&](auto const i, auto& tree) {
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+		    << ",\"tid\":" << i << ",\"args\":{\"name\":\"thread " << i
+		    << "\"}}";
+		tree.events([&](auto const& events, auto const n) {
+			dropped += n;
+			for (auto const& e : events) {
+				// Timers registered after we took the names.
+				if (e.id >= names.size()) continue;
+				out << ",\n{\"name\":\"" << detail::json_escape(names[e.id])
+				    << "\",\"ph\":\"X\",\"ts\":" << 1E-3 * e.start
+				    << ",\"dur\":" << 1E-3 * e.duration
+				    << ",\"pid\":" << pid << ",\"tid\":" << i << "}";
+			}
+		});
+	});
+	out << "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{"
+	    << "\"origin_us\":" << config.origin_us
+	    << ",\"process\":" << pid
+	    << ",\"dropped\":" << dropped << "}}\n";
+	out.flags(flags);
+	out.precision(precision);
 }
 
 
 struct Timer {
-	Timer(std::string name)
-	    : _name{ std::move(name) }
-		, _start{ std::chrono::high_resolution_clock::now() }
-		, _stop{}
+	explicit Timer(std::size_t const id)
+	    : _tree{ &detail::this_thread() }
+		, _id{ id }
+		, _node{ _tree->enter(id) }
+		, _counting{ perf::enabled() }
+		, _counters{ _counting ? perf::read() : perf::Counts{} }
+		, _memory{ memory::enabled ? memory::detail::push_mark() : 0 }
+		, _start{ detail::clock::now() }
+	{}
+
+	explicit Timer(std::string name)
+	    : Timer{ register_timer(std::move(name)) }
 	{}
 
 	Timer(Timer const&) = delete;
@@ -120,16 +841,41 @@ struct Timer {
 
 	~Timer()
 	{
-		_stop = std::chrono::high_resolution_clock::now();
-		update(std::move(_name), _stop - _start);
+		auto const t = detail::to_ticks(detail::clock::now() - _start);
+		if (_counting) {
+			// Does not throw, the constructor already opened the counters
+			// of this thread.
+			auto delta = perf::read();
+			for (std::size_t k = 0; k < delta.size(); ++k) {
+				// Scaling for multiplexing may make counters go backwards.
+				delta[k] = delta[k] > _counters[k] ? delta[k] - _counters[k] : 0;
+			}
+			_tree->count(_node, delta);
+		}
+		if (memory::enabled) {
+			_tree->remember(_node, memory::detail::pop_mark(_memory));
+		}
+		_tree->leave(_node, t);
+
+		auto const& trace = detail::trace_config();
+		if ( trace.enabled.load(std::memory_order_acquire)
+		     and t >= trace.min_duration ) {
+			_tree->trace( { _id
+			              , std::chrono::duration_cast<std::chrono::nanoseconds>(
+			                    _start - trace.origin).count()
+			              , t }
+			            , trace.max_events );
+		}
 	}
 
 private:
-	using time_point = std::chrono::high_resolution_clock::time_point;
-	
-	std::string  _name;
-	time_point   _start;
-	time_point   _stop;
+	detail::ThreadTree*           _tree;
+	std::size_t                   _id;
+	std::size_t                   _node;
+	bool                          _counting;
+	perf::Counts                  _counters;
+	std::uint64_t                 _memory;
+	detail::clock::time_point     _start;
 };
 
 
@@ -139,16 +885,38 @@ private:
 /// If #CONFIG_DO_MEASURE is defined, creates a #Timer object, otherwise does
 /// nothing. This allows to turn benchmarking on/off without changing source
 /// files.
+///
+/// \p function_name is only evaluated the first time the enclosing function
+/// (or, for templates, instantiation) runs. The timer runs until the end of
+/// the enclosing scope, so a loop body may be measured too.
 ///////////////////////////////////////////////////////////////////////////////
 #ifdef CONFIG_DO_MEASURE
 #	define TCM_MEASURE(function_name) \
-		tcm::timing::Timer _timer_temp_object_{function_name}
+		static auto const _timer_temp_id_ = \
+			::tcm::timing::register_timer(function_name); \
+		::tcm::timing::Timer _timer_temp_object_{_timer_temp_id_}
 #else
 #	define TCM_MEASURE(function_name) \
 		do {} while(false)
 #endif
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Attributes model work (a #Work) to the timer of the enclosing
+/// #TCM_MEASURE.
+
+/// Does nothing, and does not evaluate \p work, unless #CONFIG_DO_MEASURE
+/// is defined.
+///////////////////////////////////////////////////////////////////////////////
+#ifdef CONFIG_DO_MEASURE
+#	define TCM_ACCOUNT(work) \
+		::tcm::timing::account(work)
+#else
+#	define TCM_ACCOUNT(work) \
+		do {} while(false)
+#endif
+
+
 
 } // namespace timing
 
@@ -0,0 +1,326 @@
+#ifndef TCM_BENCHMARK_MPI_HPP
+#define TCM_BENCHMARK_MPI_HPP
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <boost/mpi/collectives.hpp>
+#include <boost/mpi/communicator.hpp>
+#include <boost/serialization/array.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <benchmark.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file benchmark_mpi.hpp
+/// \brief Timing report over all ranks of an MPI job.
+///
+/// Every rank passes its timing tree (see benchmark.hpp) and a #Workload
+/// (how many work items, e.g. frequencies, it processed in how much time)
+/// to #gather_profile(). The root merges the trees by path and gets, for
+/// every region, its inclusive time on every rank. From these #report()
+/// prints min, mean and max over ranks and the imbalance factor max/mean,
+/// and per rank the throughput and idle time, i.e. how long the rank waited
+/// for the slowest one. #write_json() saves the same as JSON.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace boost {
+namespace serialization {
+
+template <class _Archive>
+auto serialize( _Archive & ar, tcm::timing::Record & x
+              , unsigned int const /*version*/ ) -> void
+{
+	ar & x.name & x.calls & x.inclusive & x.exclusive & x.min & x.max
+	   & x.children & x.counters & x.work.flops & x.work.bytes & x.memory;
+}
+
+} // namespace serialization
+} // namespace boost
+
+
+namespace tcm {
+
+namespace timing {
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief What a rank has done: \p items work items in \p wall seconds.
+///////////////////////////////////////////////////////////////////////////////
+struct Workload {
+	double      wall  = 0;
+	std::size_t items = 0;
+
+	template <class _Archive>
+	auto serialize(_Archive & ar, unsigned int const /*version*/) -> void
+	{ ar & wall & items; }
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A region of the timing tree merged over ranks.
+///////////////////////////////////////////////////////////////////////////////
+struct RegionSummary {
+	std::string                name;
+	std::uint64_t              calls = 0;  ///< Summed over ranks.
+	std::vector<double>        inclusive;  ///< Per rank, 0 if not entered.
+	std::vector<RegionSummary> children;   ///< Largest mean first.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Timing summary of all ranks. Only meaningful on the root.
+///////////////////////////////////////////////////////////////////////////////
+struct ProfileSummary {
+	std::vector<Workload>      ranks;
+	std::vector<RegionSummary> regions;
+};
+
+
+namespace detail {
+
+inline auto minimum(std::vector<double> const& x) -> double
+{ return x.empty() ? 0 : *std::min_element(std::begin(x), std::end(x)); }
+
+inline auto maximum(std::vector<double> const& x) -> double
+{ return x.empty() ? 0 : *std::max_element(std::begin(x), std::end(x)); }
+
+inline auto mean(std::vector<double> const& x) -> double
+{
+	return x.empty() ? 0
+		: std::accumulate(std::begin(x), std::end(x), 0.0) / x.size();
+}
+
+/// \brief max/mean: 1 is perfectly balanced, P means that one of P ranks
+/// does all the work.
+inline auto imbalance(std::vector<double> const& x) -> double
+{
+	auto const m = mean(x);
+	return m > 0 ? maximum(x) / m : 1;
+}
+
+
+/// \brief Adds \p records of rank \p rank out of \p size to \p regions.
+inline auto merge_into( std::vector<RegionSummary>& regions
+                      , std::vector<Record> const& records
+                      , std::size_t const rank, std::size_t const size )
+	-> void
+{
+	for (auto const& r : records) {
+		auto i = std::find_if( std::begin(regions), std::end(regions)
+		                     , [&r](auto const& x) { return x.name == r.name; } );
+		if (i == std::end(regions)) {
+			regions.push_back(RegionSummary{r.name, 0, std::vector<double>(size), {}});
+			i = std::prev(std::end(regions));
+		}
+		i->calls += r.calls;
+		i->inclusive[rank] += r.inclusive;
+		merge_into(i->children, r.children, rank, size);
+	}
+}
+
+
+inline auto sort_regions(std::vector<RegionSummary>& regions) -> void
+{
+	std::stable_sort( std::begin(regions), std::end(regions)
+	                , [](auto const& a, auto const& b)
+	                  { return mean(a.inclusive) > mean(b.inclusive); } );
+	for (auto& r : regions) sort_regions(r.children);
+}
+
+
+inline auto name_width( std::vector<RegionSummary> const& regions
+                      , std::size_t const depth ) -> std::size_t
+{
+	std::size_t width = 0;
+	for (auto const& r : regions) {
+		width = std::max(width, 2 * depth + r.name.size());
+		width = std::max(width, name_width(r.children, depth + 1));
+	}
+	return width;
+}
+
+
+template <class _Stream>
+auto print_regions( _Stream& out, std::vector<RegionSummary> const& regions
+                  , std::size_t const depth, std::size_t const width ) -> void
+{
+	auto const precision = out.precision();
+	for (auto const& r : regions) {
+		out << "[ " << std::left << std::setw(width)
+		    << (std::string(2 * depth, ' ') + r.name) << std::right
+		    << " | " << std::setw(10) << r.calls
+		    << " | " << std::setw(12) << minimum(r.inclusive)
+		    << " | " << std::setw(12) << mean(r.inclusive)
+		    << " | " << std::setw(12) << maximum(r.inclusive)
+		    << " | " << std::setw(9) << std::fixed << std::setprecision(2)
+		    << imbalance(r.inclusive) << std::defaultfloat
+		    << std::setprecision(precision)
+		    << " ]\n";
+		print_regions(out, r.children, depth + 1, width);
+	}
+}
+
+
+template <class _Stream>
+auto json_regions( _Stream& out, std::vector<RegionSummary> const& regions
+                 , std::string const& prefix, bool& first ) -> void
+{
+	for (auto const& r : regions) {
+		auto const path = prefix.empty() ? r.name : prefix + "/" + r.name;
+		out << (first ? "\n" : ",\n")
+		    << "    {\"path\":\"" << json_escape(path) << "\""
+		    << ",\"calls\":" << r.calls
+		    << ",\"min\":" << minimum(r.inclusive)
+		    << ",\"mean\":" << mean(r.inclusive)
+		    << ",\"max\":" << maximum(r.inclusive)
+		    << ",\"imbalance\":" << imbalance(r.inclusive)
+		    << ",\"per_rank\":[";
+		for (std::size_t i = 0; i < r.inclusive.size(); ++i)
+			out << (i == 0 ? "" : ",") << r.inclusive[i];
+		out << "]}";
+		first = false;
+		json_regions(out, r.children, path, first);
+	}
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Collects the timing trees and workloads of all ranks of \p comm
+/// on \p root. Collective.
+///////////////////////////////////////////////////////////////////////////////
+inline auto gather_profile( boost::mpi::communicator const& comm
+                          , Workload const& workload
+                          , int const root = 0 ) -> ProfileSummary
+{
+	auto const records = snapshot();
+	ProfileSummary summary;
+	if (comm.rank() != root) {
+		boost::mpi::gather(comm, workload, root);
+		boost::mpi::gather(comm, records, root);
+		return summary;
+	}
+
+	std::vector<std::vector<Record>> all_records;
+	boost::mpi::gather(comm, workload, summary.ranks, root);
+	boost::mpi::gather(comm, records, all_records, root);
+	auto const size = static_cast<std::size_t>(comm.size());
+	for (std::size_t rank = 0; rank < size; ++rank)
+		detail::merge_into(summary.regions, all_records[rank], rank, size);
+	detail::sort_regions(summary.regions);
+	return summary;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Time rank \p i spent waiting for the slowest rank.
+///////////////////////////////////////////////////////////////////////////////
+inline auto idle(ProfileSummary const& summary, std::size_t const i) -> double
+{
+	double slowest = 0;
+	for (auto const& w : summary.ranks) slowest = std::max(slowest, w.wall);
+	return slowest - summary.ranks.at(i).wall;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Pretty-prints \p summary to \p out.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Stream>
+auto report(_Stream& out, ProfileSummary const& summary) -> void
+{
+	auto const precision = out.precision();
+	double total_idle = 0;
+	double busy       = 0;
+	double slowest    = 0;
+	for (std::size_t i = 0; i < summary.ranks.size(); ++i) {
+		total_idle += idle(summary, i);
+		busy       += summary.ranks[i].wall;
+		slowest     = std::max(slowest, summary.ranks[i].wall);
+	}
+
+	auto const rank_hline = std::string(4 + 10 + 3 * 12 + 14 + 3, '-');
+	out << "[" << rank_hline << "]\n";
+	out << "[ " << std::setw(4)  << "rank"
+	    << " | " << std::setw(10) << "items"
+	    << " | " << std::setw(12) << "wall [s]"
+	    << " | " << std::setw(12) << "items/s"
+	    << " | " << std::setw(12) << "idle [s]"
+	    << " ]\n";
+	out << "[" << rank_hline << "]\n";
+	for (std::size_t i = 0; i < summary.ranks.size(); ++i) {
+		auto const& w = summary.ranks[i];
+		out << "[ " << std::setw(4)  << i
+		    << " | " << std::setw(10) << w.items
+		    << " | " << std::setw(12) << w.wall
+		    << " | " << std::setw(12) << (w.wall > 0 ? w.items / w.wall : 0.0)
+		    << " | " << std::setw(12) << idle(summary, i)
+		    << " ]\n";
+	}
+	out << "[" << rank_hline << "]\n";
+	out << "Total idle time: " << total_idle << " s. Parallel efficiency: "
+	    << std::fixed << std::setprecision(1)
+	    << (slowest > 0 ? 100 * busy / (slowest * summary.ranks.size()) : 100.0)
+	    << "%.\n" << std::defaultfloat << std::setprecision(precision);
+
+	auto const width = std::max<std::size_t>(6, detail::name_width(summary.regions, 0));
+	auto const hline = std::string(width + 10 + 3 * 12 + 9 + 17, '-');
+	out << "[" << hline << "]\n";
+	out << "[ " << std::left << std::setw(width) << "region" << std::right
+	    << " | " << std::setw(10) << "calls"
+	    << " | " << std::setw(12) << "min [s]"
+	    << " | " << std::setw(12) << "mean [s]"
+	    << " | " << std::setw(12) << "max [s]"
+	    << " | " << std::setw(9)  << "max/mean"
+	    << " ]\n";
+	out << "[" << hline << "]\n";
+	detail::print_regions(out, summary.regions, 0, width);
+	out << "[" << hline << "]\n";
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Writes \p summary as JSON to \p out. Regions are flattened to
+/// paths like "frequency/chi_function::make<...>()"; times are inclusive
+/// and in seconds.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Stream>
+auto write_json(_Stream& out, ProfileSummary const& summary) -> void
+{
+	auto const precision = out.precision();
+	out << std::setprecision(9);
+	out << "{\n  \"ranks\": [";
+	double total_idle = 0;
+	for (std::size_t i = 0; i < summary.ranks.size(); ++i) {
+		auto const& w = summary.ranks[i];
+		total_idle += idle(summary, i);
+		out << (i == 0 ? "\n" : ",\n")
+		    << "    {\"rank\":" << i
+		    << ",\"items\":" << w.items
+		    << ",\"wall\":" << w.wall
+		    << ",\"throughput\":" << (w.wall > 0 ? w.items / w.wall : 0.0)
+		    << ",\"idle\":" << idle(summary, i) << "}";
+	}
+	out << "\n  ],\n  \"total_idle\": " << total_idle
+	    << ",\n  \"regions\": [";
+	bool first = true;
+	detail::json_regions(out, summary.regions, "", first);
+	out << "\n  ]\n}\n";
+	out << std::setprecision(precision);
+}
+
+
+} // namespace timing
+
+} // namespace tcm
+
+
+#endif // TCM_BENCHMARK_MPI_HPP
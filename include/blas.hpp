@@ -3,6 +3,7 @@
 
 #include <matrix.hpp>
 #include <benchmark.hpp>
+#include <detail/cost_model.hpp>
 #include <detail/blas_wrapper.hpp>
 
 
@@ -97,10 +98,12 @@ using blas_int = import::blas_int;
 template<class _Vector1, class _Vector2>
 inline
 auto dot( _Vector1 const& X
-        , _Vector2 const& Y ) noexcept -> typename _Vector1::value_type
+        , _Vector2 const& Y ) -> typename _Vector1::value_type
 {
 	TCM_MEASURE( "dot<" + boost::core::demangle(typeid(typename 
 		_Vector1::value_type).name()) + ">()" );
+	TCM_ACCOUNT(cost::dot<typename _Vector1::value_type>(
+		is_row(X) ? X.width() : X.height()));
 	static_assert( std::is_same< typename _Vector1::value_type
 	                           , typename _Vector2::value_type >::value
 				 , "Element types of vectors must match!" );
@@ -168,9 +171,10 @@ template<class _F, class _Matrix, class _Vector1, class _Vector2>
 inline
 auto gemv( Operator const op_A
          , _F const alpha, _Matrix const& A, _Vector1 const& X
-	     , _F const beta,  _Vector2 & Y ) noexcept -> void
+	     , _F const beta,  _Vector2 & Y ) -> void
 {
 	TCM_MEASURE("gemv<" + boost::core::demangle(typeid(_F).name()) + ">()");
+	TCM_ACCOUNT(cost::gemv<_F>(A.height(), A.width()));
 	static_assert( std::is_same<typename _Matrix::value_type, _F>::value
 				 , "Element type of _Matrix must match _F!" );
 	static_assert( std::is_same<typename _Vector1::value_type, _F>::value
@@ -241,9 +245,11 @@ template<class _F, class _Matrix1, class _Matrix2, class _Matrix3>
 inline
 auto gemm( Operator const op_A, Operator const op_B
          , _F const alpha, _Matrix1 const& A, _Matrix2 const& B
-         , _F const beta, _Matrix3 & C ) noexcept -> void
+         , _F const beta, _Matrix3 & C ) -> void
 {
 	TCM_MEASURE("gemm<" + boost::core::demangle(typeid(_F).name()) + ">()");
+	TCM_ACCOUNT(cost::gemm<_F>( C.height(), C.width()
+	                          , op_A == Operator::None ? A.width() : A.height() ));
 	static_assert( std::is_same<typename _Matrix1::value_type, _F>::value
 	             , "Element type of _Matrix1 must match _F." );
 	static_assert( std::is_same<typename _Matrix2::value_type, _F>::value
@@ -0,0 +1,699 @@
+#ifndef TCM_COMPLEX_SYMMETRIC_HPP
+#define TCM_COMPLEX_SYMMETRIC_HPP
+
+#include <cmath>
+#include <cassert>
+
+#include <complex>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+#include <boost/core/demangle.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <benchmark.hpp>
+#include <logging.hpp>
+
+#include <matrix.hpp>
+#include <blas.hpp>
+#include <lapack.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file complex_symmetric.hpp
+/// \brief Eigensolver for complex symmetric (\f$ A^T = A \f$, not Hermitian)
+///        matrices and its application to \f$ \epsilon(\omega) \f$.
+///
+/// \detail When the eigenstates \f$ \Psi \f$ are real (the ASSUME_REAL
+/// build), \f$ \chi(\omega) \f$ is complex symmetric and \f$ V \f$ is real
+/// symmetric positive definite. With the Cholesky factorisation
+/// \f$ V = LL^T \f$,
+/// \f[
+///     L^{-1} \epsilon L = 1 - L^T \chi L =: S,
+/// \f]
+/// i.e. \f$ \epsilon \f$ is similar to the complex symmetric \f$ S \f$, and
+/// if \f$ Sy = \lambda y \f$ then \f$ \epsilon (Ly) = \lambda (Ly) \f$.
+///
+/// LAPACK has no eigensolver for complex symmetric matrices, so one is
+/// implemented here. The lower triangle of \f$ S \f$ is kept in packed
+/// storage (half the memory of a full matrix), reduced to tridiagonal form
+/// by complex orthogonal Householder reflectors (\f$ H^T H = 1 \f$) and the
+/// tridiagonal matrix is diagonalised by the implicit QL algorithm with
+/// complex orthogonal plane rotations.
+///
+/// Packed storage rules out a blocked reduction, so the tridiagonalization
+/// runs at the speed of ?SPMV, i.e. it is memory bound. Only the
+/// back-transformation of the eigenvectors uses ?GEMM. Both this and ?GEEV
+/// are \f$ \mathcal{O}(N^3) \f$ and the difference in run time is a
+/// small factor; the point is memory: besides
+/// \f$ V \f$ and the eigenvectors, only the packed \f$ S \f$ is stored,
+/// \f$ N^2/2 \f$ complex numbers, whereas ?GEEV needs \f$ \epsilon \f$
+/// (\f$ N^2 \f$). \f$ S \f$ is built in the buffer of \f$ \chi \f$,
+/// which is released before the eigenvectors are allocated.
+///
+/// Complex orthogonal transformations are not unitary, and the reduction
+/// breaks down if it hits a (nearly) isotropic vector, \f$ x^T x \approx 0\f$
+/// with \f$ x \neq 0 \f$. std::runtime_error is thrown in that case and
+/// the caller falls back to ?GEEV.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace complex_symmetric {
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Index of \f$ A_{i,j} \f$, \f$ i \geq j \f$, in the column-major
+/// packed lower triangle of an \f$ n\times n \f$ matrix (LAPACK's UPLO='L'
+/// packed format).
+///////////////////////////////////////////////////////////////////////////////
+constexpr
+auto packed_index( std::size_t const n
+                 , std::size_t const i, std::size_t const j ) noexcept
+	-> std::size_t
+{ return i + j * (2 * n - j - 1) / 2; }
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Copies the lower triangle of a square matrix into packed storage.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Matrix>
+auto pack_lower(_Matrix const& A) -> std::vector<typename _Matrix::value_type>
+{
+	assert(is_square(A));
+	auto const n = A.height();
+	std::vector<typename _Matrix::value_type> AP(n * (n + 1) / 2);
+	for (std::size_t j = 0; j < n; ++j)
+		std::copy( A.cbegin_column(j) + j, A.cend_column(j)
+		         , AP.begin() + packed_index(n, j, j) );
+	return AP;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Reduces a complex symmetric matrix to tridiagonal form
+/// \f$ A = Q T Q^T \f$ with \f$ Q^T Q = 1 \f$.
+
+/// \param n   Order of the matrix.
+/// \param AP  Lower triangle of \f$ A \f$ in packed storage, see
+///            packed_index(). On exit, the Householder vectors of
+///            \f$ Q = H_0 H_1 \cdots H_{n-3} \f$ are stored below the
+///            subdiagonal (their first element is an implicit 1).
+/// \param d   Diagonal of \f$ T \f$, \f$ n \f$ elements.
+/// \param e   Subdiagonal of \f$ T \f$, \f$ n - 1 \f$ elements.
+/// \param tau Scalar factors of the reflectors
+///            \f$ H_k = 1 - \tau_k v_k v_k^T \f$, \f$ n - 2 \f$ elements.
+///
+/// \exception std::runtime_error if the reduction breaks down.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C>
+auto tridiagonalize( std::size_t const n
+                   , _C* AP, _C* d, _C* e, _C* tau ) -> void
+{
+	TCM_MEASURE( "complex_symmetric::tridiagonalize<"
+	           + boost::core::demangle(typeid(_C).name()) + ">()" );
+	using _R = utils::Base<_C>;
+	auto const threshold = std::sqrt(std::numeric_limits<_R>::epsilon());
+	auto const at = [n, AP](auto const i, auto const j) -> _C&
+		{ return AP[packed_index(n, i, j)]; };
+
+	std::vector<_C> p(n);
+	for (std::size_t k = 0; k + 2 < n; ++k) {
+		// x = A(k+1:n, k)
+		auto* const x = &at(k + 1, k);
+		auto const  m = n - k - 1;
+
+		_R norm_tail = 0;
+		for (std::size_t i = 1; i < m; ++i) norm_tail += std::norm(x[i]);
+		d[k] = at(k, k);
+		if (norm_tail == 0) {
+			e[k] = x[0];
+			tau[k] = 0;
+			continue;
+		}
+
+		_C xx = 0;
+		for (std::size_t i = 0; i < m; ++i) xx += x[i] * x[i];
+		auto alpha = std::sqrt(xx);
+		if (std::abs(x[0] + alpha) > std::abs(x[0] - alpha)) alpha = -alpha;
+
+		// v = (x - alpha e_1) / (x_0 - alpha), so that v_0 = 1.
+		auto const v0 = x[0] - alpha;
+		_C vv = 1;
+		_R norm_v = 1;
+		x[0] = 1;
+		for (std::size_t i = 1; i < m; ++i) {
+			x[i] /= v0;
+			vv += x[i] * x[i];
+			norm_v += std::norm(x[i]);
+		}
+		if (std::abs(vv) < threshold * norm_v) {
+			throw std::runtime_error{ "Complex symmetric tridiagonalization "
+			                          "broke down: isotropic Householder "
+			                          "vector." };
+		}
+		tau[k] = _C{2} / vv;
+		e[k]   = alpha;
+
+		// Trailing submatrix B = A(k+1:n, k+1:n) becomes H B H:
+		// p = tau B v, w = p - (tau v^T p / 2) v, B -= v w^T + w v^T.
+		// The lower triangle of B is itself packed, starting at column k+1.
+		auto* const B = AP + packed_index(n, k + 1, k + 1);
+		{
+			auto const UPLO  = 'L';
+			auto const M     = boost::numeric_cast<import::lapack_int>(m);
+			auto const ONE   = import::lapack_int{1};
+			auto const ZERO  = _C{0};
+			import::spmv<_C>( &UPLO, &M, &tau[k], B, x, &ONE
+			                , &ZERO, p.data(), &ONE );
+		}
+		_C vp = 0;
+		for (std::size_t i = 0; i < m; ++i) vp += x[i] * p[i];
+		auto const K = tau[k] * vp / _R{2};
+		import::axpy(m, -K, x, 1, p.data(), 1);
+		// Column j of the lower triangle of B holds rows j..m-1.
+		for (std::size_t j = 0, offset = 0; j < m; offset += m - j, ++j) {
+			import::axpy(m - j, -p[j], x + j, 1, B + offset, 1);
+			import::axpy(m - j, -x[j], p.data() + j, 1, B + offset, 1);
+		}
+	}
+	if (n >= 2) {
+		d[n - 2] = at(n - 2, n - 2);
+		e[n - 2] = at(n - 1, n - 2);
+	}
+	if (n >= 1) d[n - 1] = at(n - 1, n - 1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Overwrites \p Z with \f$ Q Z \f$, where \f$ Q \f$ is given by the
+/// output of tridiagonalize().
+
+/// Reflectors are applied in blocks of 32 using the compact WY form
+/// \f$ H_k H_{k+1} \cdots = 1 - V T V^T \f$ (as in ?LARFT/?LARFB, but
+/// with transposes instead of conjugate transposes), so that the work is
+/// done by ?GEMM.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C, class _Matrix>
+auto apply_reflectors( std::size_t const n
+                     , _C const* AP, _C const* tau
+                     , _Matrix& Z ) -> void
+{
+	TCM_MEASURE( "complex_symmetric::apply_reflectors<"
+	           + boost::core::demangle(typeid(_C).name()) + ">()" );
+	using blas::Operator;
+	constexpr std::size_t block = 32;
+	assert(Z.height() == n);
+	auto const count = n < 3 ? std::size_t{0} : n - 2;
+	auto const width = Z.width();
+	auto const ldz   = boost::numeric_cast<blas::blas_int>(Z.ldim());
+
+	std::vector<_C> V, G, T, W1, W2;
+	for (auto end = count; end > 0;) {
+		auto const begin = end > block ? end - block : std::size_t{0};
+		auto const nb    = end - begin;
+		auto const rows  = n - begin - 1;
+		auto const ldv   = boost::numeric_cast<blas::blas_int>(rows);
+		auto const ldt   = boost::numeric_cast<blas::blas_int>(nb);
+
+		// V(:, c) is reflector begin + c, which starts in row begin + c + 1.
+		V.assign(rows * nb, _C{0});
+		for (std::size_t c = 0; c < nb; ++c) {
+			auto const k = begin + c;
+			std::copy( AP + packed_index(n, k + 1, k)
+			         , AP + packed_index(n, k + 1, k) + (n - k - 1)
+			         , V.data() + c * rows + c );
+			V[c * rows + c] = 1;
+		}
+
+		// T(0:c, c) = -tau_c T(0:c, 0:c) V(:, 0:c)^T V(:, c).
+		G.resize(nb * nb);
+		T.assign(nb * nb, _C{0});
+		import::gemm( Operator::T, Operator::None, nb, nb, rows
+		            , _C{1}, V.data(), ldv, V.data(), ldv
+		            , _C{0}, G.data(), ldt );
+		for (std::size_t c = 0; c < nb; ++c) {
+			auto const t = tau[begin + c];
+			T[c * nb + c] = t;
+			for (std::size_t r = 0; r < c; ++r) {
+				_C x = 0;
+				for (auto l = r; l < c; ++l) x += T[l * nb + r] * G[c * nb + l];
+				T[c * nb + r] = -t * x;
+			}
+		}
+
+		// Z(begin+1:n, :) -= V T V^T Z(begin+1:n, :)
+		auto* const z = Z.data() + begin + 1;
+		W1.resize(nb * width);
+		W2.resize(nb * width);
+		import::gemm( Operator::T, Operator::None, nb, width, rows
+		            , _C{1}, V.data(), ldv, z, ldz
+		            , _C{0}, W1.data(), ldt );
+		import::gemm( Operator::None, Operator::None, nb, width, nb
+		            , _C{1}, T.data(), ldt, W1.data(), ldt
+		            , _C{0}, W2.data(), ldt );
+		import::gemm( Operator::None, Operator::None, rows, width, nb
+		            , _C{-1}, V.data(), ldv, W2.data(), ldt
+		            , _C{1}, z, ldz );
+		end = begin;
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the eigenvalues of a complex symmetric tridiagonal matrix
+/// by the implicit QL algorithm.
+
+/// \param d  On entry, the diagonal; on exit, the eigenvalues (unordered).
+/// \param e  The \f$ n - 1 \f$ subdiagonal elements.
+///
+/// \exception std::runtime_error if a rotation breaks down or an eigenvalue
+///            does not converge in 30 iterations.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C>
+auto tridiagonal_ql( std::size_t const n
+                   , _C* d, _C const* e ) -> void
+{
+	TCM_MEASURE( "complex_symmetric::tridiagonal_ql<"
+	           + boost::core::demangle(typeid(_C).name()) + ">()" );
+	using _R = utils::Base<_C>;
+	constexpr auto max_iterations = 30;
+	auto const eps       = std::numeric_limits<_R>::epsilon();
+	auto const threshold = std::sqrt(eps);
+	auto const breakdown = []() {
+		throw std::runtime_error{ "Complex symmetric QL iteration broke "
+		                          "down." };
+	};
+
+	if (n < 2) return;
+	// _e[n - 1] is used as a sentinel.
+	std::vector<_C> _e(n);
+	std::copy(e, e + n - 1, std::begin(_e));
+
+	for (std::size_t l = 0; l < n; ++l) {
+		auto iteration = 0;
+		std::size_t m;
+		do {
+			for (m = l; m + 1 < n; ++m) {
+				auto const dd = std::abs(d[m]) + std::abs(d[m + 1]);
+				if (std::abs(_e[m]) <= eps * dd) break;
+			}
+			if (m == l) break;
+			if (iteration++ == max_iterations) {
+				throw std::runtime_error{ "Complex symmetric QL iteration "
+				                          "did not converge." };
+			}
+
+			// Wilkinson-like shift. Of the two roots of g^2 + 1 we take the
+			// one that maximises |g + r|.
+			auto g = (d[l + 1] - d[l]) / (_R{2} * _e[l]);
+			auto r = std::sqrt(g * g + _R{1});
+			if (std::abs(g - r) > std::abs(g + r)) r = -r;
+			if (std::abs(g + r) <= threshold * (std::abs(g) + _R{1}))
+				breakdown();
+			g = d[m] - d[l] + _e[l] / (g + r);
+
+			_C s = 1;
+			_C c = 1;
+			_C p = 0;
+			bool deflated = false;
+			for (auto i = m; i-- > l;) {
+				auto const f = s * _e[i];
+				auto const b = c * _e[i];
+				r = std::sqrt(f * f + g * g);
+				_e[i + 1] = r;
+				if (std::abs(r) <= threshold * (std::abs(f) + std::abs(g))) {
+					if (f != _C{0} or g != _C{0}) breakdown();
+					// Exact underflow: split the matrix.
+					d[i + 1] -= p;
+					_e[m] = 0;
+					deflated = true;
+					break;
+				}
+				s = f / r;
+				c = g / r;
+				g = d[i + 1] - p;
+				r = (d[i] - g) * s + _R{2} * c * b;
+				p = s * r;
+				d[i + 1] = g + p;
+				g = c * r - b;
+			}
+			if (deflated) continue;
+			d[l] -= p;
+			_e[l] = g;
+			_e[m] = 0;
+		} while (m != l);
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes eigenvectors of a complex symmetric tridiagonal matrix
+/// by inverse iteration (the analogue of ?STEIN).
+
+/// Accumulating the QL rotations costs \f$ \mathcal{O}(N^3) \f$ scalar
+/// updates, whereas every inverse iteration step is a tridiagonal solve,
+/// i.e. \f$ \mathcal{O}(N) \f$. Vectors belonging to close eigenvalues are
+/// orthogonalised against each other w.r.t. \f$ x^T y \f$.
+///
+/// \param d  Diagonal, \f$ n \f$ elements.
+/// \param e  Subdiagonal, \f$ n - 1 \f$ elements.
+/// \param w  Eigenvalues as computed by tridiagonal_ql().
+/// \param Z  \f$ n\times n \f$, eigenvectors on exit, normalised so that
+///           \f$ z^T z = 1 \f$ (or \f$ \|z\|_2 = 1 \f$ if \f$ z \f$ is
+///           nearly isotropic).
+///////////////////////////////////////////////////////////////////////////////
+template <class _C, class _Matrix>
+auto tridiagonal_eigenvectors( std::size_t const n
+                             , _C const* d, _C const* e, _C const* w
+                             , _Matrix& Z ) -> void
+{
+	TCM_MEASURE( "complex_symmetric::tridiagonal_eigenvectors<"
+	           + boost::core::demangle(typeid(_C).name()) + ">()" );
+	using _R = utils::Base<_C>;
+	constexpr auto iterations = 3;
+	auto const eps       = std::numeric_limits<_R>::epsilon();
+	auto const threshold = std::sqrt(eps);
+	assert(Z.height() == n and Z.width() == n);
+	if (n == 0) return;
+
+	_R norm = 0;
+	for (std::size_t i = 0; i < n; ++i)
+		norm = std::max( norm, std::abs(d[i])
+		                     + (i > 0     ? std::abs(e[i - 1]) : _R{0})
+		                     + (i + 1 < n ? std::abs(e[i])     : _R{0}) );
+	if (norm == 0) norm = 1;
+	auto const tiny    = eps * norm;
+	auto const cluster = _R{1E-3} * norm;
+
+	// LU factorisation of T - lambda with partial pivoting, as in ?GTTRF.
+	std::vector<_C> dl(n), dd(n), du(n), du2(n);
+	std::vector<char> swapped(n);
+	auto const factorise = [&](_C const lambda) {
+		for (std::size_t i = 0; i < n; ++i) {
+			dd[i] = d[i] - lambda;
+			if (i + 1 < n) dl[i] = du[i] = e[i];
+			du2[i] = 0;
+		}
+		for (std::size_t i = 0; i + 1 < n; ++i) {
+			if (std::abs(dd[i]) >= std::abs(dl[i])) {
+				swapped[i] = false;
+				if (dd[i] == _C{0}) dd[i] = tiny;
+				dl[i]      = dl[i] / dd[i];
+				dd[i + 1] -= dl[i] * du[i];
+			}
+			else {
+				swapped[i] = true;
+				auto const fact = dd[i] / dl[i];
+				dd[i] = dl[i];
+				dl[i] = fact;
+				auto const temp = du[i];
+				du[i]     = dd[i + 1];
+				dd[i + 1] = temp - fact * dd[i + 1];
+				if (i + 2 < n) {
+					du2[i]    = du[i + 1];
+					du[i + 1] = -fact * du[i + 1];
+				}
+			}
+		}
+		if (std::abs(dd[n - 1]) < tiny) dd[n - 1] = tiny;
+		for (std::size_t i = 0; i < n; ++i)
+			if (std::abs(dd[i]) < tiny) dd[i] = tiny;
+	};
+	auto const solve = [&](_C* b) {
+		for (std::size_t i = 0; i + 1 < n; ++i) {
+			if (swapped[i]) std::swap(b[i], b[i + 1]);
+			b[i + 1] -= dl[i] * b[i];
+		}
+		for (auto i = n; i-- > 0;) {
+			auto x = b[i];
+			if (i + 1 < n) x -= du[i] * b[i + 1];
+			if (i + 2 < n) x -= du2[i] * b[i + 2];
+			b[i] = x / dd[i];
+		}
+	};
+
+	std::size_t first = 0; // First vector of the current cluster.
+	for (std::size_t j = 0; j < n; ++j) {
+		if (j > 0 and std::abs(w[j] - w[j - 1]) > cluster) first = j;
+		auto* const z = Z.data() + j * Z.ldim();
+		// Deterministic, but different for every j.
+		for (std::size_t i = 0; i < n; ++i)
+			z[i] = _R{1} + _R{0.1} * static_cast<_R>((i * 7 + j * 13) % 17);
+
+		factorise(w[j]);
+		for (auto iteration = 0; iteration < iterations; ++iteration) {
+			solve(z);
+			for (auto k = first; k < j; ++k) {
+				auto const* const y = Z.data() + k * Z.ldim();
+				_C yz = 0;
+				for (std::size_t i = 0; i < n; ++i) yz += y[i] * z[i];
+				for (std::size_t i = 0; i < n; ++i) z[i] -= yz * y[i];
+			}
+			_R scale = 0;
+			for (std::size_t i = 0; i < n; ++i)
+				scale = std::max(scale, std::abs(z[i]));
+			for (std::size_t i = 0; i < n; ++i) z[i] /= scale;
+		}
+
+		_C zz = 0;
+		_R norm_z = 0;
+		for (std::size_t i = 0; i < n; ++i) {
+			zz     += z[i] * z[i];
+			norm_z += std::norm(z[i]);
+		}
+		auto const scale = std::abs(zz) > threshold * norm_z
+			? _C{1} / std::sqrt(zz)
+			: _C{_R{1} / std::sqrt(norm_z)};
+		for (std::size_t i = 0; i < n; ++i) z[i] *= scale;
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes all eigenpairs of a complex symmetric matrix given in
+/// packed storage.
+
+/// \param AP  Lower triangle of the \f$ n\times n \f$ matrix, see
+///            pack_lower(). Destroyed.
+/// \param W   \f$ n\times 1 \f$, eigenvalues on exit.
+/// \param Z   \f$ n\times n \f$, eigenvectors on exit, normalised so that
+///            \f$ z^T z = 1 \f$.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C, class _Vector, class _Matrix>
+auto eigen( std::size_t const n, std::vector<_C>& AP
+          , _Vector& W, _Matrix& Z ) -> void
+{
+	TCM_MEASURE( "complex_symmetric::eigen<"
+	           + boost::core::demangle(typeid(_C).name()) + ">()" );
+	assert(AP.size() == n * (n + 1) / 2);
+	assert(W.height() == n and Z.height() == n and Z.width() == n);
+
+	std::vector<_C> d(n);
+	std::vector<_C> e(n);
+	std::vector<_C> tau(n);
+	tridiagonalize(n, AP.data(), d.data(), e.data(), tau.data());
+
+	std::copy(std::begin(d), std::end(d), W.data());
+	tridiagonal_ql(n, W.data(), e.data());
+	// Sorting makes close eigenvalues adjacent for the cluster detection.
+	std::sort( W.data(), W.data() + n
+	         , [](auto const& x, auto const& y) {
+	               return std::real(x) < std::real(y)
+	                   or (std::real(x) == std::real(y)
+	                       and std::imag(x) < std::imag(y));
+	           } );
+	tridiagonal_eigenvectors(n, d.data(), e.data(), W.data(), Z);
+	apply_reflectors(n, AP.data(), tau.data(), Z);
+}
+
+
+namespace detail {
+
+// A complex matrix viewed as a real one with twice the rows, so that
+// products with real matrices from the right are real ?GEMMs/?TRMMs.
+template <class _C>
+auto as_real(_C* x) noexcept { return reinterpret_cast<utils::Base<_C>*>(x); }
+
+template <class _C>
+auto as_real(_C const* x) noexcept
+{ return reinterpret_cast<utils::Base<_C> const*>(x); }
+
+
+// L := lower Cholesky factor of Re V, n x n with leading dimension n. The
+// strictly upper triangle is zeroed.
+template <class _R, class _C>
+auto cholesky_real(Matrix<_C> const& V, _R* L) -> void
+{
+	auto const n = V.height();
+	for (std::size_t j = 0; j < n; ++j)
+		for (std::size_t i = 0; i < n; ++i)
+			L[i + j * n] = i >= j ? std::real(V(i, j)) : _R{0};
+	lapack::potrf(n, L, n);
+}
+
+
+template <class _C>
+auto transpose_in_place(std::size_t const n, _C* A, std::size_t const ld) -> void
+{
+	for (std::size_t j = 0; j < n; ++j)
+		for (std::size_t i = j + 1; i < n; ++i)
+			std::swap(A[i + j * ld], A[j + i * ld]);
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes all eigenpairs of \f$ \epsilon = 1 - V\chi \f$ for a
+/// complex symmetric \f$ \chi \f$ and a real symmetric positive definite
+/// \f$ V \f$.
+
+/// Uses the symmetrisation described in the file documentation.
+/// \f$ S \f$ is formed in the buffer of \p Chi (two ?TRMMs with the real
+/// \f$ L \f$) and packed, then \p Chi is released and only then are \p W
+/// and \p Z allocated. Apart from \f$ V \f$, at most \f$ 3N^2/2 \f$
+/// complex numbers are alive at any time, \f$ 2N^2 \f$ with the residual
+/// check.
+///
+/// Complex orthogonal transformations are not backward stable, so the
+/// relative residual \f$ \max_j \|\epsilon z_j - w_j z_j\| / \max_j |w_j| \f$
+/// is checked on \p samples eigenpairs spread over the spectrum. As
+/// \f$ \epsilon L y = L S y \f$, this needs a packed copy of \f$ S \f$
+/// rather than \f$ \chi \f$, and costs \f$ \mathcal{O}(N^2\cdot
+/// \text{samples}) \f$.
+///
+/// \param Chi  \f$ \chi(\omega) \f$, \f$ N\times N \f$, complex symmetric.
+///             Consumed.
+/// \param V    Coulomb matrix. Only the real part is used.
+/// \param W    Eigenvalues on exit, \f$ N\times 1 \f$.
+/// \param Z    Right eigenvectors of \f$ \epsilon \f$ on exit,
+///             \f$ N\times N \f$, normalised to unit 2-norm like the ones
+///             from ?GEEV.
+/// \param tolerance Largest acceptable relative residual.
+/// \param samples   Number of eigenpairs to check, 0 disables the check.
+///
+/// \exception std::runtime_error if \f$ V \f$ is not positive definite,
+///            the solver breaks down or the residual exceeds
+///            \p tolerance. \f$ \chi \f$ is lost by then, so the caller has
+///            to recompute \f$ \epsilon \f$ to fall back to ?GEEV.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C, class _Logger>
+auto epsilon_eigenpairs( Matrix<_C> Chi
+                       , Matrix<_C> const& V
+                       , Matrix<_C>& W
+                       , Matrix<_C>& Z
+                       , _Logger & lg
+                       , utils::Base<_C> const tolerance = 1E-6
+                       , std::size_t const samples = 8 ) -> void
+{
+	TCM_MEASURE( "complex_symmetric::epsilon_eigenpairs<"
+	           + boost::core::demangle(typeid(_C).name()) + ">()" );
+	using _R = utils::Base<_C>;
+	using blas::Operator;
+	auto const N = Chi.height();
+	assert(is_square(Chi) and is_square(V) and V.height() == N);
+	auto const n = boost::numeric_cast<blas::blas_int>(N);
+
+	// Chi := 1 - L^T Chi L as (Chi L)^T L, using that Chi is symmetric.
+	{
+		std::vector<_R> L(N * N);
+		detail::cholesky_real(V, L.data());
+		auto* const S  = detail::as_real(Chi.data());
+		auto const lds = boost::numeric_cast<blas::blas_int>(2 * Chi.ldim());
+		import::trmm('R', 'L', Operator::None, 2 * N, N, _R{1}, L.data(), n, S, lds);
+		detail::transpose_in_place(N, Chi.data(), Chi.ldim());
+		import::trmm('R', 'L', Operator::None, 2 * N, N, _R{1}, L.data(), n, S, lds);
+	}
+	std::vector<_C> SP(N * (N + 1) / 2);
+	for (std::size_t j = 0; j < N; ++j)
+		for (auto i = j; i < N; ++i)
+			SP[packed_index(N, i, j)] = (i == j ? _C{1} : _C{0}) - Chi(i, j);
+	Chi = Matrix<_C>{};
+
+	auto const count = std::min(samples, N);
+	std::vector<_C> S_copy;
+	if (count != 0) S_copy = SP;
+	W = Matrix<_C>{N, 1};
+	Z = Matrix<_C>{N, N};
+	eigen(N, SP, W, Z);
+
+	// R(:, s) = S y - w y for the sampled eigenvectors y of S.
+	std::vector<std::size_t> picked(count);
+	for (std::size_t s = 0; s < count; ++s)
+		picked[s] = count == 1 ? 0 : s * (N - 1) / (count - 1);
+	Matrix<_C> R{count, N};
+	{
+		std::vector<_C> r(N);
+		auto const UPLO = 'L';
+		auto const ONE  = import::lapack_int{1};
+		auto const ZERO = _C{0};
+		auto const ALPHA = _C{1};
+		for (std::size_t s = 0; s < count; ++s) {
+			auto const* const y = Z.data(0, picked[s]);
+			import::spmv<_C>( &UPLO, &n, &ALPHA, S_copy.data(), y, &ONE
+			                , &ZERO, r.data(), &ONE );
+			import::axpy(N, -W(picked[s], 0), y, 1, r.data(), 1);
+			for (std::size_t i = 0; i < N; ++i) R(s, i) = r[i];
+		}
+	}
+	S_copy = std::vector<_C>{};
+
+	// Z := L Z as (Z^T L^T)^T, and R^T := L R^T, so that the products are
+	// real ?TRMMs. SP holds N (N + 1) >= N^2 real numbers.
+	{
+		auto* const L = detail::as_real(SP.data());
+		detail::cholesky_real(V, L);
+		detail::transpose_in_place(N, Z.data(), Z.ldim());
+		import::trmm( 'R', 'L', Operator::T, 2 * N, N, _R{1}, L, n
+		            , detail::as_real(Z.data())
+		            , boost::numeric_cast<blas::blas_int>(2 * Z.ldim()) );
+		detail::transpose_in_place(N, Z.data(), Z.ldim());
+		import::trmm( 'R', 'L', Operator::T, 2 * count, N, _R{1}, L, n
+		            , detail::as_real(R.data())
+		            , boost::numeric_cast<blas::blas_int>(2 * R.ldim()) );
+	}
+	SP = std::vector<_C>{};
+
+	std::vector<_R> norms(N);
+	for (std::size_t j = 0; j < N; ++j) {
+		_R norm = 0;
+		for (auto i = Z.cbegin_column(j); i != Z.cend_column(j); ++i)
+			norm += std::norm(*i);
+		norm = norms[j] = std::sqrt(norm);
+		std::for_each( Z.begin_column(j), Z.end_column(j)
+		             , [norm](auto& x) { x /= norm; } );
+	}
+	if (count == 0) return;
+
+	// epsilon z - w z = L (S y - w y) / |L y| for z = L y / |L y|.
+	_R residual = 0;
+	_R scale    = 0;
+	for (std::size_t s = 0; s < count; ++s) {
+		_R r = 0;
+		for (std::size_t i = 0; i < N; ++i) r += std::norm(R(s, i));
+		residual = std::max(residual, std::sqrt(r) / norms[picked[s]]);
+	}
+	for (std::size_t j = 0; j < N; ++j)
+		scale = std::max(scale, std::abs(W(j, 0)));
+	residual /= scale;
+	LOG(lg, debug) << "Complex symmetric eigensolver: relative residual "
+	               << residual << " on " << count << " eigenpairs.";
+	if (not (residual <= tolerance)) {
+		std::ostringstream msg;
+		msg << "relative residual " << residual << " exceeds " << tolerance;
+		throw std::runtime_error{msg.str()};
+	}
+}
+
+
+} // namespace complex_symmetric
+
+} // namespace tcm
+
+
+#endif // TCM_COMPLEX_SYMMETRIC_HPP
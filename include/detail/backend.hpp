@@ -0,0 +1,257 @@
+#ifndef TCM_BACKEND_HPP
+#define TCM_BACKEND_HPP
+
+#include <cstdlib>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <detail/config.hpp>
+
+#ifdef USING_RUNTIME_BACKEND
+#	include <dlfcn.h>
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file backend.hpp
+/// \brief Selection of the BLAS/LAPACK implementation.
+///
+/// By default the implementation is fixed at link time by one of
+/// USING_ATLAS, USING_OPENBLAS or USING_INTEL_MKL. With
+/// USING_RUNTIME_BACKEND nothing is linked (apart from `-ldl`). Instead,
+/// every routine is looked up with `dlsym` in a library that is chosen at
+/// startup:
+/// 1) by calling tcm::backend::load() (the tools expose it as `--backend`);
+/// 2) otherwise by the environment variable TCM_BLAS_BACKEND;
+/// 3) otherwise by trying OpenBLAS, then reference LAPACK.
+///
+/// Known names are "openblas", "reference", "mkl", "atlas" and "flexiblas".
+/// Anything else is passed to `dlopen` as is, so a full path to a shared
+/// library works too.
+///
+/// Routines are resolved on first use and then cached, so the backend must
+/// be chosen before the first BLAS/LAPACK call. A routine missing in the
+/// chosen library makes that call throw std::runtime_error naming it.
+///
+/// With CONFIG_ILP64 only the 64-bit integer builds are considered: loading
+/// an LP64 library would silently truncate every integer argument.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace backend {
+
+
+#ifdef USING_RUNTIME_BACKEND
+
+namespace detail {
+
+struct Library {
+	std::string name;
+	void*       handle = nullptr;
+	// Appended to every symbol, e.g. "64_" for the ILP64 builds of OpenBLAS
+	// and reference LAPACK (zgeev_64_, cblas_zdotc_sub64_).
+	std::string suffix;
+	bool        used   = false;
+};
+
+
+inline auto library() -> Library&
+{
+	static Library x;
+	return x;
+}
+
+
+inline auto mutex() -> std::mutex&
+{
+	static std::mutex x;
+	return x;
+}
+
+
+struct Candidate {
+	char const* file;
+	char const* suffix;
+};
+
+
+inline auto candidates(std::string const& name) -> std::vector<Candidate>
+{
+	if (name == "openblas") {
+#ifdef CONFIG_ILP64
+		return { {"libopenblas64_.so.0", "64_"}, {"libopenblas64_.so", "64_"} };
+#else
+		return { {"libopenblas.so.0", ""}, {"libopenblas.so", ""} };
+#endif
+	}
+	if (name == "reference") {
+#ifdef CONFIG_ILP64
+		return { {"liblapack64.so.3", "64_"}, {"liblapack64.so", "64_"} };
+#else
+		return { {"liblapack.so.3", ""}, {"liblapack.so", ""} };
+#endif
+	}
+	if (name == "mkl")
+		return { {"libmkl_rt.so.2", ""}, {"libmkl_rt.so", ""} };
+	if (name == "atlas")
+		return { {"libtatlas.so.3", ""}, {"libsatlas.so.3", ""} };
+	if (name == "flexiblas")
+		return { {"libflexiblas.so.3", ""}, {"libflexiblas.so", ""} };
+	return { {name.c_str(), ""} };
+}
+
+
+// Assumes that the mutex is held.
+inline auto open(std::string const& name) -> void
+{
+	auto& lib = library();
+	std::string errors;
+	for (auto const& candidate : candidates(name)) {
+		auto* handle = ::dlopen(candidate.file, RTLD_NOW | RTLD_LOCAL);
+		if (handle == nullptr) {
+			errors += std::string{"\n  "} + ::dlerror();
+			continue;
+		}
+		if (lib.handle != nullptr) ::dlclose(lib.handle);
+		lib.name   = name;
+		lib.handle = handle;
+		lib.suffix = candidate.suffix;
+
+		// mkl_rt picks LP64 or ILP64 at runtime.
+		using _Layer = int (*)(int);
+		if (auto* set_layer = reinterpret_cast<_Layer>(
+				::dlsym(handle, "MKL_Set_Interface_Layer"))) {
+#ifdef CONFIG_ILP64
+			set_layer(1); // MKL_INTERFACE_ILP64
+#else
+			set_layer(0); // MKL_INTERFACE_LP64
+#endif
+		}
+		return;
+	}
+	throw std::runtime_error{ "Failed to load BLAS/LAPACK backend `" + name
+	                        + "`:" + errors };
+}
+
+
+// Assumes that the mutex is held.
+inline auto open_default() -> void
+{
+	if (auto const* name = std::getenv("TCM_BLAS_BACKEND")) {
+		open(name);
+		return;
+	}
+	try {
+		open("openblas");
+	} catch (std::runtime_error&) {
+		open("reference");
+	}
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Selects the BLAS/LAPACK library.
+
+/// Throws std::runtime_error if the library cannot be loaded, or if
+/// another library has already been used.
+///////////////////////////////////////////////////////////////////////////////
+inline auto load(std::string const& name) -> void
+{
+	std::lock_guard<std::mutex> lock{detail::mutex()};
+	auto& lib = detail::library();
+	if (lib.used and lib.name != name) {
+		throw std::runtime_error{ "BLAS/LAPACK backend `" + lib.name
+		                        + "` is already in use." };
+	}
+	if (lib.handle == nullptr or lib.name != name) detail::open(name);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Returns the name of the BLAS/LAPACK library in use. Loads the
+/// default one if none has been chosen yet.
+///////////////////////////////////////////////////////////////////////////////
+inline auto name() -> std::string
+{
+	std::lock_guard<std::mutex> lock{detail::mutex()};
+	if (detail::library().handle == nullptr) detail::open_default();
+	return detail::library().name;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Looks up the routine \p symbol (e.g. "zgeev_" or
+/// "cblas_zdotc_sub") in the current library and casts it to `_F`.
+
+/// \exception std::runtime_error if the library does not provide it.
+///////////////////////////////////////////////////////////////////////////////
+template <class _F>
+auto symbol(char const* symbol) -> _F
+{
+	std::lock_guard<std::mutex> lock{detail::mutex()};
+	auto& lib = detail::library();
+	if (lib.handle == nullptr) detail::open_default();
+	lib.used = true;
+
+	auto const full = std::string{symbol} + lib.suffix;
+	auto* p = ::dlsym(lib.handle, full.c_str());
+	if (p == nullptr) {
+		throw std::runtime_error{ "BLAS/LAPACK backend `" + lib.name
+		                        + "` does not provide " + full + "." };
+	}
+	return reinterpret_cast<_F>(p);
+}
+
+
+/// \brief Resolves \p f in the current backend once and caches the pointer.
+#	define TCM_IMPORT(f)                                                   \
+		([]() {                                                             \
+			static auto const _f =                                          \
+				::tcm::backend::symbol<decltype(&f)>(#f);                   \
+			return _f;                                                      \
+		}())
+
+#else // USING_RUNTIME_BACKEND
+
+
+inline auto name() -> std::string
+{
+#if defined(USING_INTEL_MKL)
+	return "mkl";
+#elif defined(USING_OPENBLAS)
+	return "openblas";
+#elif defined(USING_ATLAS)
+	return "atlas";
+#else
+	return "unknown";
+#endif
+}
+
+
+inline auto load(std::string const& x) -> void
+{
+	if (x != name()) {
+		throw std::invalid_argument{ "This build is linked against `" + name()
+		                           + "`. Rebuild with USING_RUNTIME_BACKEND "
+		                             "to choose the backend at runtime." };
+	}
+}
+
+
+#	define TCM_IMPORT(f) f
+
+#endif // USING_RUNTIME_BACKEND
+
+
+} // namespace backend
+
+} // namespace tcm
+
+
+#endif // TCM_BACKEND_HPP
@@ -8,6 +8,8 @@
 #include <boost/numeric/conversion/cast.hpp>
 
 #include <detail/config.hpp>
+#include <detail/lapack_int.hpp>
+#include <detail/backend.hpp>
 #include <detail/utils.hpp>
 #include <detail/iterator.hpp>
 
@@ -19,51 +21,6 @@
 
 
 
-#define REGISTER_BLAS(general_f, s_f, d_f, c_f, z_f)                           \
-	namespace {                                                                \
-		template<class... Args>                                                \
-        __attribute__((always_inline))                                         \
-		inline                                                                 \
-		auto general_f##_impl( utils::Type2Type<float>                         \
-		                     , Args&&... args) noexcept                        \
-		{ return s_f(std::forward<Args>(args)...); }                           \
-		                                                                       \
-		template<class... Args>                                                \
-        __attribute__((always_inline))                                         \
-		inline                                                                 \
-		auto general_f##_impl( utils::Type2Type<double>                        \
-		                     , Args&&... args) noexcept                        \
-		{ return d_f(std::forward<Args>(args)...); }                           \
-		                                                                       \
-		template<class... Args>                                                \
-        __attribute__((always_inline))                                         \
-		inline                                                                 \
-		auto general_f##_impl( utils::Type2Type<std::complex<float>>           \
-		                     , Args&&... args) noexcept                        \
-		{ return c_f(std::forward<Args>(args)...); }                           \
-		                                                                       \
-		template<class... Args>                                                \
-        __attribute__((always_inline))                                         \
-		inline                                                                 \
-		auto general_f##_impl( utils::Type2Type<std::complex<double>>          \
-		                     , Args&&... args) noexcept                        \
-		{ return z_f(std::forward<Args>(args)...); }                           \
-	}                                                                          \
-                                                                               \
-	template<class T, class... Args>                                           \
-	__attribute__((always_inline))                                             \
-	inline                                                                     \
-	auto general_f(Args&&... args) noexcept                                    \
-	{ return general_f##_impl( utils::Type2Type<T>{}                           \
-	                         , std::forward<Args>(args)...);                   \
-	}   
-
-
-
-
-
-
-
 namespace tcm {
 
 namespace import {
@@ -73,14 +30,9 @@ enum class Operator : char {None = 'N', T = 'T', H = 'C'};
 
 
 
-#ifdef USING_INTEL_MKL
-	using blas_int = long long int;
-#else
-#	ifdef USING_ATLAS
-		using blas_int = int;
-#	else
-#		error "Need BLAS"
-#	endif
+#if not defined(USING_INTEL_MKL) and not defined(USING_ATLAS) \
+	and not defined(USING_OPENBLAS) and not defined(USING_RUNTIME_BACKEND)
+#	error "Need BLAS"
 #endif
 
 
@@ -102,19 +54,58 @@ double ddot_
 , double const* X, blas_int const* INCX
 , double const* Y, blas_int const* INCY );
 
-std::complex<float> cdotc_
-( blas_int const* N
-, std::complex<float> const* X, blas_int const* INCX
-, std::complex<float> const* Y, blas_int const* INCY );
-
-std::complex<double> zdotc_
-( blas_int const* N
-, std::complex<double> const* X, blas_int const* inc_X
-, std::complex<double> const* Y, blas_int const* inc_Y );
+// Fortran functions returning complex numbers have no portable ABI: MKL
+// passes the result as a hidden first argument, gfortran-built libraries
+// return it in registers. The CBLAS subroutines avoid the question.
+void cblas_cdotc_sub
+( blas_int const N
+, std::complex<float> const* X, blas_int const INCX
+, std::complex<float> const* Y, blas_int const INCY
+, std::complex<float>* DOTC );
+
+void cblas_zdotc_sub
+( blas_int const N
+, std::complex<double> const* X, blas_int const INCX
+, std::complex<double> const* Y, blas_int const INCY
+, std::complex<double>* DOTC );
 
 } // extern "C"
 
-REGISTER_BLAS(dotc, sdot_, ddot_, cdotc_, zdotc_)
+namespace {
+	inline
+	auto dotc( blas_int const* N
+	         , float const* X, blas_int const* INCX
+	         , float const* Y, blas_int const* INCY ) -> float
+	{ return TCM_IMPORT(sdot_)(N, X, INCX, Y, INCY); }
+
+	inline
+	auto dotc( blas_int const* N
+	         , double const* X, blas_int const* INCX
+	         , double const* Y, blas_int const* INCY ) -> double
+	{ return TCM_IMPORT(ddot_)(N, X, INCX, Y, INCY); }
+
+	inline
+	auto dotc( blas_int const* N
+	         , std::complex<float> const* X, blas_int const* INCX
+	         , std::complex<float> const* Y, blas_int const* INCY )
+		-> std::complex<float>
+	{
+		std::complex<float> result;
+		TCM_IMPORT(cblas_cdotc_sub)(*N, X, *INCX, Y, *INCY, &result);
+		return result;
+	}
+
+	inline
+	auto dotc( blas_int const* N
+	         , std::complex<double> const* X, blas_int const* INCX
+	         , std::complex<double> const* Y, blas_int const* INCY )
+		-> std::complex<double>
+	{
+		std::complex<double> result;
+		TCM_IMPORT(cblas_zdotc_sub)(*N, X, *INCX, Y, *INCY, &result);
+		return result;
+	}
+}
 
 
 template< class _T
@@ -143,7 +134,7 @@ auto dot( std::size_t const n
 	*/
 
 	auto const N = boost::numeric_cast<blas_int>(n);	
-	auto const result = dotc<_T>(&N, X, &INCX, Y, &INCY);
+	auto const result = dotc(&N, X, &INCX, Y, &INCY);
 
 	utils::assert_valid(result);
 	return result;
@@ -179,7 +170,7 @@ void zaxpy_
 
 } // extern "C"
 
-REGISTER_BLAS(axpy, saxpy_, daxpy_, caxpy_, zaxpy_)
+TCM_REGISTER(axpy, saxpy_, daxpy_, caxpy_, zaxpy_)
 
 template< class _T
         , class = std::enable_if_t
@@ -216,9 +207,6 @@ auto axpy( std::size_t const n, _T const a
 
 
 
-
-
-
 // ============================================================================
 //                         MATRIX-VECTOR MULTIPLICATION                        
 // ============================================================================
@@ -259,7 +247,7 @@ void zgemv_
 
 } // extern "C"
 
-REGISTER_BLAS(gemv, sgemv_, dgemv_, cgemv_, zgemv_)
+TCM_REGISTER(gemv, sgemv_, dgemv_, cgemv_, zgemv_)
 
 
 template< class _T
@@ -316,7 +304,6 @@ auto gemv( Operator const op_A
 
 
 
-
 // ============================================================================
 //                           MATRIX-MATRIX MULTIPLICATION                      
 // ============================================================================
@@ -361,7 +348,7 @@ void zgemm_
 
 } // extern "C"
 
-REGISTER_BLAS(gemm, sgemm_, dgemm_, cgemm_, zgemm_)
+TCM_REGISTER(gemm, sgemm_, dgemm_, cgemm_, zgemm_)
 
 template< class _T
         , class = std::enable_if_t
@@ -410,14 +397,85 @@ auto gemm( Operator const op_A, Operator const op_B
 
 
 
-} // namespace import
+// ============================================================================
+//                      TRIANGULAR MATRIX-MATRIX MULTIPLICATION                
+// ============================================================================
 
-} // namespace tcm
+extern "C" {
+
+void strmm_
+( char const* SIDE, char const* UPLO, char const* TRANSA, char const* DIAG
+, blas_int const* M, blas_int const* N
+, float const* ALPHA
+, float const* A, blas_int const* LDA
+, float* B, blas_int const* LDB );
+
+void dtrmm_
+( char const* SIDE, char const* UPLO, char const* TRANSA, char const* DIAG
+, blas_int const* M, blas_int const* N
+, double const* ALPHA
+, double const* A, blas_int const* LDA
+, double* B, blas_int const* LDB );
+
+void ctrmm_
+( char const* SIDE, char const* UPLO, char const* TRANSA, char const* DIAG
+, blas_int const* M, blas_int const* N
+, std::complex<float> const* ALPHA
+, std::complex<float> const* A, blas_int const* LDA
+, std::complex<float>* B, blas_int const* LDB );
+
+void ztrmm_
+( char const* SIDE, char const* UPLO, char const* TRANSA, char const* DIAG
+, blas_int const* M, blas_int const* N
+, std::complex<double> const* ALPHA
+, std::complex<double> const* A, blas_int const* LDA
+, std::complex<double>* B, blas_int const* LDB );
+
+} // extern "C"
+
+TCM_REGISTER(trmm, strmm_, dtrmm_, ctrmm_, ztrmm_)
+
+/// B := alpha op(A) B (side 'L') or B := alpha B op(A) (side 'R'), where
+/// A is triangular (uplo 'L' or 'U') and B is m x n. Only the given
+/// triangle of A is referenced.
+template< class _T
+        , class = std::enable_if_t
+                  <   std::is_same<_T, float>() 
+                   or std::is_same<_T, double>()
+                   or std::is_same<_T, std::complex<float>>()
+                   or std::is_same<_T, std::complex<double>>()
+                  >
+        >
+inline
+auto trmm( char const side, char const uplo, Operator const op_A
+         , std::size_t const m, std::size_t const n
+         , _T const ALPHA, _T const* A, blas_int const LDA
+         , _T* B, blas_int const LDB ) -> void
+{
+	if(m == 0 or n == 0) return;
+
+	assert(side == 'L' or side == 'R');
+	assert(uplo == 'L' or uplo == 'U');
+	assert(A != nullptr and LDA != 0);
+	assert(B != nullptr and LDB != 0);
 
+	auto const M      = boost::numeric_cast<blas_int>(m);
+	auto const N      = boost::numeric_cast<blas_int>(n);
+	auto const TRANSA = static_cast<char>(op_A);
+	auto const DIAG   = 'N';
+
+	assert( LDA >= (side == 'L' ? M : N) );
+	assert( LDB >= M );
+
+	trmm<_T>( &side, &uplo, &TRANSA, &DIAG, &M, &N
+	        , &ALPHA, A, &LDA, B, &LDB );
+}
 
 
 
+} // namespace import
 
+} // namespace tcm
 
 
 
@@ -0,0 +1,134 @@
+#ifndef TCM_COST_MODEL_HPP
+#define TCM_COST_MODEL_HPP
+
+#include <complex>
+#include <cstddef>
+#include <type_traits>
+
+#include <benchmark.hpp>
+#include <detail/utils.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file cost_model.hpp
+/// \brief Closed-form operation and memory traffic counts of our kernels.
+///
+/// FLOPs count real operations: a complex multiply-add is 8 of them.
+/// Bytes are the compulsory traffic, i.e. every operand is read (and every
+/// result written) once; caches can only make the real traffic larger for
+/// BLAS 1 and 2, but BLAS 3 and LAPACK re-read blocks, so for them this is
+/// a lower bound. LAPACK counts are the leading terms from Golub & Van Loan.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace cost {
+
+namespace detail {
+
+template <class _T>
+constexpr auto is_complex() noexcept -> bool
+{ return not std::is_same<_T, utils::Base<_T>>::value; }
+
+/// \brief Real FLOPs per multiply-add.
+template <class _T>
+constexpr auto fma() noexcept -> double
+{ return is_complex<_T>() ? 8 : 2; }
+
+/// \brief Real FLOPs per multiplication.
+template <class _T>
+constexpr auto mul() noexcept -> double
+{ return is_complex<_T>() ? 6 : 1; }
+
+/// \brief How much more expensive LAPACK is for complex matrices.
+template <class _T>
+constexpr auto lapack_factor() noexcept -> double
+{ return is_complex<_T>() ? 4 : 1; }
+
+inline auto d(std::size_t const n) noexcept -> double
+{ return static_cast<double>(n); }
+
+} // namespace detail
+
+
+/// \brief ?DOT(C) of vectors of length \p n.
+template <class _T>
+auto dot(std::size_t const n) noexcept -> timing::Work
+{
+	using namespace detail;
+	return {fma<_T>() * d(n), 2 * d(n) * sizeof(_T)};
+}
+
+
+/// \brief ?GEMV with an \p m x \p n matrix.
+template <class _T>
+auto gemv(std::size_t const m, std::size_t const n) noexcept -> timing::Work
+{
+	using namespace detail;
+	return {fma<_T>() * d(m) * d(n), (d(m) * d(n) + d(n) + 2 * d(m)) * sizeof(_T)};
+}
+
+
+/// \brief ?GEMM computing an \p m x \p n matrix with inner dimension \p k.
+template <class _T>
+auto gemm(std::size_t const m, std::size_t const n, std::size_t const k) noexcept
+	-> timing::Work
+{
+	using namespace detail;
+	return { fma<_T>() * d(m) * d(n) * d(k)
+	       , (d(m) * d(k) + d(k) * d(n) + 2 * d(m) * d(n)) * sizeof(_T) };
+}
+
+
+/// \brief ?GEEV of an \p n x \p n matrix: about \f$ 10n^3 \f$ for the
+/// eigenvalues and \f$ 26n^3 \f$ with eigenvectors (real arithmetic).
+template <class _T>
+auto geev(std::size_t const n, bool const vectors) noexcept -> timing::Work
+{
+	using namespace detail;
+	auto const n3 = d(n) * d(n) * d(n);
+	return { lapack_factor<_T>() * (vectors ? 26.33 : 10.0) * n3
+	       , (vectors ? 2 : 1) * d(n) * d(n) * sizeof(_T) };
+}
+
+
+/// \brief Hermitian eigensolvers (?HEEVR, ?HEEVD, ...) computing \p m
+/// eigenpairs of an \p n x \p n matrix: tridiagonal reduction
+/// \f$ \frac43 n^3 \f$ and back-transformation \f$ 2n^2 m \f$.
+template <class _T>
+auto heev(std::size_t const n, std::size_t const m) noexcept -> timing::Work
+{
+	using namespace detail;
+	return { lapack_factor<_T>() * (4.0 / 3.0 * d(n) + 2 * d(m)) * d(n) * d(n)
+	       , (d(n) * d(n) + d(n) * d(m)) * sizeof(_T) };
+}
+
+
+/// \brief Building \p n columns of the \p m x \p m matrix \f$ G(\omega) \f$
+/// of type \p _C: two subtractions and a division by
+/// \f$ E_i - E_j - \omega \f$ per element.
+template <class _C>
+auto g_build(std::size_t const m, std::size_t const n) noexcept -> timing::Work
+{
+	using namespace detail;
+	return {(is_complex<_C>() ? 9 : 4) * d(m) * d(n), d(m) * d(n) * sizeof(_C)};
+}
+
+
+/// \brief The Hadamard product \f$ \psi_a \circ \psi_b^* \f$ of length
+/// \p m in one element of \f$ \chi \f$. The rest is ?GEMV and ?DOT.
+template <class _T>
+auto hadamard(std::size_t const m) noexcept -> timing::Work
+{
+	using namespace detail;
+	return {mul<_T>() * d(m), 3 * d(m) * sizeof(_T)};
+}
+
+
+} // namespace cost
+
+} // namespace tcm
+
+
+#endif // TCM_COST_MODEL_HPP
@@ -6,8 +6,10 @@
 #include <algorithm>
 
 #include <benchmark.hpp>
+#include <detail/cost_model.hpp>
 #include <detail/utils.hpp>
 #include <detail/lapack_wrapper.hpp>
+#include <detail/workspace.hpp>
 
 
 
@@ -109,11 +111,12 @@ template< class _Alloc
                    or std::is_same<_T, double>()
                   >
         >
-auto geev_impl( int const N
-              , std::complex<_T>* A, int const LDA
+auto geev_impl( lapack_int const N
+              , std::complex<_T>* A, lapack_int const LDA
               , std::complex<_T>* W
-              , std::complex<_T>* VL, int const LDVL
-              , std::complex<_T>* VR, int const LDVR
+              , std::complex<_T>* VL, lapack_int const LDVL
+              , std::complex<_T>* VR, lapack_int const LDVR
+              , Workspace<_Alloc>& ws
 	          , utils::Type2Type<std::complex<_T>> ) -> void
 {
 	if (N == 0) return;
@@ -124,17 +127,21 @@ auto geev_impl( int const N
 	assert(LDVL >= (VL == nullptr ? 1 : N));
 	assert(LDVR >= (VR == nullptr ? 1 : N));
 
-	using size_type = std::make_unsigned_t<int>;
+	using size_type = std::make_unsigned_t<lapack_int>;
+	using _Slot     = typename Workspace<_Alloc>::Slot;
 
-	char const JOBVL = VL == nullptr ? 'N' : 'V';
-	char const JOBVR = VR == nullptr ? 'N' : 'V';
-	auto       RWORK = 
-		utils::_Storage<_T, _Alloc>{2 * static_cast<size_type>(N)};
-		// std::make_unique<_T[]>(2 * N);
-	int        LWORK = -1;
-	int        INFO  = 0;
+	char const JOBVL   = VL == nullptr ? 'N' : 'V';
+	char const JOBVR   = VR == nullptr ? 'N' : 'V';
+	auto const routine = std::string{"?GEEV/"} + JOBVL + JOBVR;
+	auto const RWORK   = 
+		ws.template get<_T>(_Slot::RWork, 2 * static_cast<size_type>(N));
+	lapack_int LWORK   = -1;
+	lapack_int INFO    = 0;
 
-	{
+	if (auto const* sizes = ws.template find<std::complex<_T>>(routine, N)) {
+		LWORK = sizes->lwork;
+	}
+	else {
 		std::complex<_T> _work_dummy;
 
 		tcm::import::geev<std::complex<_T>>
@@ -144,17 +151,20 @@ auto geev_impl( int const N
 			, VL, &LDVL
 			, VR, &LDVR
 			, &_work_dummy, &LWORK
-			, RWORK.data() // RWORK.get()
+			, RWORK
 			, &INFO
 		    );
 
-		LWORK = static_cast<int>(std::real(_work_dummy));
+		if (INFO < 0) {
+			throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+			                           + " had an illegal value." };
+		} 
+		LWORK = workspace_size(_work_dummy);
+		ws.template insert<std::complex<_T>>(routine, N, {LWORK, 0, 0});
 	}
 
-	auto       WORK  =
-		utils::_Storage<std::complex<_T>, _Alloc>{
-			static_cast<size_type>(LWORK) };
-	    // std::make_unique<std::complex<_T>[]>(LWORK);
+	auto const WORK    = ws.template get<std::complex<_T>>
+		(_Slot::Work, static_cast<size_type>(LWORK));
 
 	tcm::import::geev<std::complex<_T>>
 		( &JOBVL, &JOBVR, &N
@@ -162,8 +172,8 @@ auto geev_impl( int const N
 		, W
 		, VL, &LDVL
 		, VR, &LDVR
-		, WORK.data(), &LWORK // WORK.get(), &LWORK
-		, RWORK.data() // RWORK.get()
+		, WORK, &LWORK
+		, RWORK
 	    , &INFO
 	    );
 
@@ -176,11 +186,275 @@ auto geev_impl( int const N
 	}
 }
 
+
+template<class _T>
+auto getrf_impl( lapack_int const M, lapack_int const N
+               , _T* A, lapack_int const LDA
+               , lapack_int* IPIV ) -> void
+{
+	if (M == 0 or N == 0) return;
+
+	assert(M > 0 and N > 0);
+	assert(A != nullptr and LDA >= std::max<lapack_int>(1, M));
+	assert(IPIV != nullptr);
+
+	lapack_int INFO = 0;
+	tcm::import::getrf<_T>(&M, &N, A, &LDA, IPIV, &INFO);
+
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+	else if (INFO > 0) {
+		throw std::runtime_error{ "Call to ?GETRF failed: U("
+		                        + std::to_string(INFO) + ", "
+		                        + std::to_string(INFO) + ") is exactly "
+		                          "zero, i.e. the matrix is singular." };
+	}
+}
+
+
+template<class _T>
+auto getrs_impl( char const TRANS, lapack_int const N, lapack_int const NRHS
+               , _T const* A, lapack_int const LDA
+               , lapack_int const* IPIV
+               , _T* B, lapack_int const LDB ) -> void
+{
+	if (N == 0 or NRHS == 0) return;
+
+	assert(TRANS == 'N' or TRANS == 'T' or TRANS == 'C');
+	assert(N > 0 and NRHS > 0);
+	assert(A != nullptr and LDA >= N);
+	assert(IPIV != nullptr);
+	assert(B != nullptr and LDB >= N);
+
+	lapack_int INFO = 0;
+	tcm::import::getrs<_T>(&TRANS, &N, &NRHS, A, &LDA, IPIV, B, &LDB, &INFO);
+
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+}
+
+
+template< class _Alloc
+        , class _T
+        >
+auto gehrd_impl( lapack_int const N
+               , _T* A, lapack_int const LDA
+               , _T* TAU ) -> void
+{
+	if (N == 0) return;
+
+	assert(N > 0);
+	assert(A != nullptr and LDA >= N);
+	assert(TAU != nullptr);
+
+	using size_type = std::make_unsigned_t<lapack_int>;
+
+	lapack_int const ILO   = 1;
+	lapack_int const IHI   = N;
+	lapack_int       LWORK = -1;
+	lapack_int       INFO  = 0;
+
+	{
+		_T _work_dummy;
+		tcm::import::gehrd<_T>
+			(&N, &ILO, &IHI, A, &LDA, TAU, &_work_dummy, &LWORK, &INFO);
+		LWORK = workspace_size(_work_dummy);
+	}
+
+	auto WORK = utils::_Storage<_T, _Alloc>{static_cast<size_type>(LWORK)};
+	tcm::import::gehrd<_T>
+		(&N, &ILO, &IHI, A, &LDA, TAU, WORK.data(), &LWORK, &INFO);
+
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+}
+
+
+template< class _Alloc
+        , class _T
+        , class = std::enable_if_t
+                  <   std::is_same<_T, float>() 
+                   or std::is_same<_T, double>()
+                  >
+        >
+auto hseqr_impl( lapack_int const N
+               , std::complex<_T>* H, lapack_int const LDH
+               , std::complex<_T>* W
+               , utils::Type2Type<std::complex<_T>> ) -> void
+{
+	if (N == 0) return;
+
+	assert(N > 0);
+	assert(H != nullptr and LDH >= N);
+	assert(W != nullptr);
+
+	using size_type = std::make_unsigned_t<lapack_int>;
+
+	char const JOB   = 'E';
+	char const COMPZ = 'N';
+	lapack_int const  ILO   = 1;
+	lapack_int const  IHI   = N;
+	lapack_int const  LDZ   = 1;
+	lapack_int LWORK = -1;
+	lapack_int INFO  = 0;
+
+	{
+		std::complex<_T> _work_dummy;
+		tcm::import::hseqr<std::complex<_T>>
+			( &JOB, &COMPZ, &N, &ILO, &IHI
+			, H, &LDH, W
+			, nullptr, &LDZ
+			, &_work_dummy, &LWORK
+			, &INFO );
+		LWORK = std::max<lapack_int>(1, workspace_size(_work_dummy));
+	}
+
+	auto WORK = utils::_Storage<std::complex<_T>, _Alloc>{
+		static_cast<size_type>(LWORK) };
+	tcm::import::hseqr<std::complex<_T>>
+		( &JOB, &COMPZ, &N, &ILO, &IHI
+		, H, &LDH, W
+		, nullptr, &LDZ
+		, WORK.data(), &LWORK
+		, &INFO );
+
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+	else if (INFO > 0) {
+		throw std::runtime_error{"Call to ?HSEQR failed."};
+	}
+}
+
+
+template< class _Alloc
+        , class _T
+        , class = std::enable_if_t
+                  <   std::is_same<_T, float>() 
+                   or std::is_same<_T, double>()
+                  >
+        >
+auto hsein_impl( lapack_int const N
+               , std::complex<_T> const* H, lapack_int const LDH
+               , std::complex<_T>* W
+               , lapack_int const* SELECT
+               , std::complex<_T>* VR, lapack_int const LDVR
+               , lapack_int const MM
+               , utils::Type2Type<std::complex<_T>> ) -> lapack_int
+{
+	if (N == 0) return 0;
+
+	assert(N > 0);
+	assert(H != nullptr and LDH >= N);
+	assert(W != nullptr);
+	assert(SELECT != nullptr);
+	assert(VR != nullptr and LDVR >= N);
+
+	using size_type = std::make_unsigned_t<lapack_int>;
+
+	char const SIDE   = 'R';
+	char const EIGSRC = 'Q';
+	char const INITV  = 'N';
+	lapack_int const  LDVL   = 1;
+	lapack_int M      = 0;
+	lapack_int INFO   = 0;
+
+	auto WORK   = utils::_Storage<std::complex<_T>, _Alloc>{
+		static_cast<size_type>(N) * static_cast<size_type>(N) };
+	auto RWORK  = utils::_Storage<_T, _Alloc>{static_cast<size_type>(N)};
+	auto IFAILR = 
+		utils::_Storage<lapack_int, _Alloc>{static_cast<size_type>(MM)};
+
+	tcm::import::hsein<std::complex<_T>>
+		( &SIDE, &EIGSRC, &INITV
+		, SELECT, &N
+		, H, &LDH, W
+		, nullptr, &LDVL
+		, VR, &LDVR
+		, &MM, &M
+		, WORK.data(), RWORK.data(), nullptr, IFAILR.data()
+		, &INFO );
+
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+	else if (INFO > 0) {
+		throw std::runtime_error{ "Call to ?HSEIN failed: "
+		                        + std::to_string(INFO) + " eigenvectors "
+		                          "did not converge." };
+	}
+	return M;
+}
+
+
+template< class _Alloc
+        , class _T
+        >
+auto unmhr_impl( lapack_int const M, lapack_int const N
+               , _T const* A, lapack_int const LDA
+               , _T const* TAU
+               , _T* C, lapack_int const LDC ) -> void
+{
+	if (M == 0 or N == 0) return;
+
+	assert(M > 0 and N > 0);
+	assert(A != nullptr and LDA >= M);
+	assert(TAU != nullptr);
+	assert(C != nullptr and LDC >= M);
+
+	using size_type = std::make_unsigned_t<lapack_int>;
+
+	char const SIDE  = 'L';
+	char const TRANS = 'N';
+	lapack_int const  ILO   = 1;
+	lapack_int const  IHI   = M;
+	lapack_int LWORK = -1;
+	lapack_int INFO  = 0;
+
+	{
+		_T _work_dummy;
+		tcm::import::unmhr<_T>
+			( &SIDE, &TRANS, &M, &N, &ILO, &IHI
+			, A, &LDA, TAU
+			, C, &LDC
+			, &_work_dummy, &LWORK
+			, &INFO );
+		LWORK = workspace_size(_work_dummy);
+	}
+
+	auto WORK = utils::_Storage<_T, _Alloc>{static_cast<size_type>(LWORK)};
+	tcm::import::unmhr<_T>
+		( &SIDE, &TRANS, &M, &N, &ILO, &IHI
+		, A, &LDA, TAU
+		, C, &LDC
+		, WORK.data(), &LWORK
+		, &INFO );
+
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+}
+
 } // unnamed namespace
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Same as #geev() below, but takes the workspace from \p ws instead
+/// of allocating it.
+
+/// Use this when calling ?GEEV repeatedly, e.g. once per frequency.
+///////////////////////////////////////////////////////////////////////////////
 template< class _T
-        , class _Alloc = std::allocator<_T>
+        , class _Alloc
         >
 inline
 auto geev( std::size_t const n
@@ -188,20 +462,200 @@ auto geev( std::size_t const n
          , std::complex<utils::Base<_T>>* W
          , std::complex<utils::Base<_T>>* VL, std::size_t const ldvl
          , std::complex<utils::Base<_T>>* VR, std::size_t const ldvr
+         , Workspace<_Alloc>& ws
          ) -> void
 {
 	TCM_MEASURE("geev<" + boost::core::demangle(typeid(_T).name()) + ">()");
+	TCM_ACCOUNT(cost::geev<_T>(n, VL != nullptr or VR != nullptr));
 
-	geev_impl<_Alloc>
-		( boost::numeric_cast<int>(n)
-		, A, boost::numeric_cast<int>(lda)
+	geev_impl
+		( boost::numeric_cast<lapack_int>(n)
+		, A, boost::numeric_cast<lapack_int>(lda)
 		, W
-		, VL, boost::numeric_cast<int>(ldvl)
-		, VR, boost::numeric_cast<int>(ldvr)
+		, VL, boost::numeric_cast<lapack_int>(ldvl)
+		, VR, boost::numeric_cast<lapack_int>(ldvr)
+		, ws
 		, utils::Type2Type<_T>{} );
 }
 
 
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+inline
+auto geev( std::size_t const n
+         , _T* A, std::size_t const lda
+         , std::complex<utils::Base<_T>>* W
+         , std::complex<utils::Base<_T>>* VL, std::size_t const ldvl
+         , std::complex<utils::Base<_T>>* VR, std::size_t const ldvr
+         ) -> void
+{
+	Workspace<_Alloc> ws;
+	lapack::geev(n, A, lda, W, VL, ldvl, VR, ldvr, ws);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the LU factorisation \f$ A = PLU \f$ of an m x n matrix
+/// using partial pivoting (?GETRF).
+
+/// On exit \p A contains \f$ L \f$ and \f$ U \f$, and \p ipiv (of size
+/// \f$ \min(m, n) \f$) the pivot indices. Throws std::runtime_error if
+/// \f$ U \f$ is singular.
+///////////////////////////////////////////////////////////////////////////////
+template<class _T>
+inline
+auto getrf( std::size_t const m, std::size_t const n
+          , _T* A, std::size_t const lda
+          , lapack_int* ipiv ) -> void
+{
+	TCM_MEASURE("getrf<" + boost::core::demangle(typeid(_T).name()) + ">()");
+
+	getrf_impl
+		( boost::numeric_cast<lapack_int>(m), boost::numeric_cast<lapack_int>(n)
+		, A, boost::numeric_cast<lapack_int>(lda)
+		, ipiv );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Solves \f$ \mathcal{O}(A) X = B \f$ for \p nrhs right-hand sides
+/// at once, given the LU factorisation of \f$ A \f$ computed by #getrf()
+/// (?GETRS).
+
+/// \p trans is one of 'N', 'T' or 'C'. On exit \p B is overwritten by
+/// \f$ X \f$.
+///////////////////////////////////////////////////////////////////////////////
+template<class _T>
+inline
+auto getrs( char const trans
+          , std::size_t const n, std::size_t const nrhs
+          , _T const* A, std::size_t const lda
+          , lapack_int const* ipiv
+          , _T* B, std::size_t const ldb ) -> void
+{
+	TCM_MEASURE("getrs<" + boost::core::demangle(typeid(_T).name()) + ">()");
+
+	getrs_impl
+		( trans
+		, boost::numeric_cast<lapack_int>(n)
+		, boost::numeric_cast<lapack_int>(nrhs)
+		, A, boost::numeric_cast<lapack_int>(lda)
+		, ipiv
+		, B, boost::numeric_cast<lapack_int>(ldb) );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Reduces a general n x n matrix to upper Hessenberg form
+/// \f$ A = QHQ^\dagger \f$ (?GEHRD).
+
+/// On exit the upper Hessenberg part of \p A contains \f$ H \f$, and the
+/// elements below the first subdiagonal together with \p tau (of size
+/// \f$ n - 1 \f$) represent \f$ Q \f$ as a product of elementary
+/// reflectors, see #unmhr().
+///////////////////////////////////////////////////////////////////////////////
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+inline
+auto gehrd( std::size_t const n
+          , _T* A, std::size_t const lda
+          , _T* tau ) -> void
+{
+	TCM_MEASURE("gehrd<" + boost::core::demangle(typeid(_T).name()) + ">()");
+
+	gehrd_impl<_Alloc>
+		( boost::numeric_cast<lapack_int>(n)
+		, A, boost::numeric_cast<lapack_int>(lda)
+		, tau );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the eigenvalues of an upper Hessenberg matrix using the
+/// QR algorithm without accumulating the Schur vectors (?HSEQR with
+/// JOB='E', COMPZ='N').
+
+/// \p H is destroyed.
+///////////////////////////////////////////////////////////////////////////////
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+inline
+auto hseqr( std::size_t const n
+          , _T* H, std::size_t const ldh
+          , std::complex<utils::Base<_T>>* W ) -> void
+{
+	TCM_MEASURE("hseqr<" + boost::core::demangle(typeid(_T).name()) + ">()");
+
+	hseqr_impl<_Alloc>
+		( boost::numeric_cast<lapack_int>(n)
+		, H, boost::numeric_cast<lapack_int>(ldh)
+		, W
+		, utils::Type2Type<_T>{} );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes right eigenvectors of an upper Hessenberg matrix \p H
+/// for the eigenvalues \p W marked in \p select by inverse iteration
+/// (?HSEIN).
+
+/// \p W must be the eigenvalues as returned by #hseqr(). On exit, they may
+/// be slightly perturbed to separate close eigenvalues. The eigenvectors are
+/// stored in consecutive columns of \p VR (at most \p mm of them) in
+/// order of increasing index.
+///
+/// \return Number of computed eigenvectors.
+///////////////////////////////////////////////////////////////////////////////
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+inline
+auto hsein( std::size_t const n
+          , _T const* H, std::size_t const ldh
+          , std::complex<utils::Base<_T>>* W
+          , lapack_int const* select
+          , std::complex<utils::Base<_T>>* VR, std::size_t const ldvr
+          , std::size_t const mm ) -> std::size_t
+{
+	TCM_MEASURE("hsein<" + boost::core::demangle(typeid(_T).name()) + ">()");
+
+	return static_cast<std::size_t>(hsein_impl<_Alloc>
+		( boost::numeric_cast<lapack_int>(n)
+		, H, boost::numeric_cast<lapack_int>(ldh)
+		, W
+		, select
+		, VR, boost::numeric_cast<lapack_int>(ldvr)
+		, boost::numeric_cast<lapack_int>(mm)
+		, utils::Type2Type<_T>{} ));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Overwrites the m x n matrix \p C with \f$ QC \f$, where
+/// \f$ Q \f$ is the unitary matrix computed by #gehrd() (?UNMHR).
+///////////////////////////////////////////////////////////////////////////////
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+inline
+auto unmhr( std::size_t const m, std::size_t const n
+          , _T const* A, std::size_t const lda
+          , _T const* tau
+          , _T* C, std::size_t const ldc ) -> void
+{
+	TCM_MEASURE("unmhr<" + boost::core::demangle(typeid(_T).name()) + ">()");
+
+	unmhr_impl<_Alloc>
+		( boost::numeric_cast<lapack_int>(m), boost::numeric_cast<lapack_int>(n)
+		, A, boost::numeric_cast<lapack_int>(lda)
+		, tau
+		, C, boost::numeric_cast<lapack_int>(ldc) );
+}
+
+
 
 } // namespace lapack
 
@@ -9,8 +9,10 @@
 #include <boost/numeric/conversion/cast.hpp>
 
 #include <benchmark.hpp>
+#include <detail/cost_model.hpp>
 #include <detail/lapack_wrapper.hpp>
 #include <detail/utils.hpp>
+#include <detail/workspace.hpp>
 
 
 
@@ -29,6 +31,22 @@ namespace lapack {
 namespace {
 
 
+// Calls ?HEEVR or, if two_stage is true, ?HEEVR_2STAGE. The latter is only
+// available if CONFIG_LAPACK_2STAGE is defined.
+template<class _T, class... _Args>
+auto call_heevr(bool const two_stage, _Args&&... args) -> void
+{
+#ifdef CONFIG_LAPACK_2STAGE
+	if (two_stage) {
+		tcm::import::heevr_2stage<_T>(std::forward<_Args>(args)...);
+		return;
+	}
+#endif
+	assert(not two_stage);
+	tcm::import::heevr<_T>(std::forward<_Args>(args)...);
+}
+
+
 template< class _Alloc
         , class _T
         , class = std::enable_if_t
@@ -36,81 +54,482 @@ template< class _Alloc
                     or std::is_same<_T, double>()
 		          >
         >
-auto heevr_impl( int const N
-               , _T* A, int const LDA
+auto heevr_impl( lapack_int const N
+               , _T* A, lapack_int const LDA
+               , char const RANGE
+               , _T const VL, _T const VU
+               , lapack_int const IL, lapack_int const IU
+               , bool const two_stage
                , _T* W
-               , _T* Z, int const LDZ
-               , utils::Type2Type<_T> ) -> void
+               , _T* Z, lapack_int const LDZ
+               , Workspace<_Alloc>& ws
+               , utils::Type2Type<_T> ) -> lapack_int
 {
-	if (N == 0) return;
+	if (N == 0) return 0;
 
 	assert(N > 0);
 	assert(A != nullptr and LDA >= N);
 	assert(W != nullptr);
 	assert(LDZ >= (Z == nullptr) ? 1 : N);
-
-	/*
-	using _Alloc_traits = std::allocator_traits<_Alloc>;
-	typename _Alloc_traits::template rebind_alloc<_T>
-		_T_alloc;
-	typename _Alloc_traits::template rebind_alloc<int>
-		_int_alloc;
-	*/
-	using size_type = std::make_unsigned_t<int>;
-
-	char const JOBZ   = (Z == nullptr) ? 'N' : 'V';
-	char const RANGE  = 'A';
-	char const UPLO   = 'U';
-	_T   const VL     { 0.0 };
-	_T   const VU     { 0.0 };
-	int  const IL     = 0;
-	int  const IU     = 0;
-	_T   const ABSTOL { 0.0 }; //std::numeric_limits<_T>::min();
-	int        M      = 0;
-	auto       ISUPPZ = 
-		tcm::utils::_Storage<int, _Alloc>{2 * static_cast<size_type>(N)};
-	// tcm::utils::allocate_workspace(_int_alloc, 2 * N);
-	int        LWORK  = -1;
-	int        LIWORK = -1;
-	int        INFO   = 0;
-
-	{
+	assert(RANGE == 'A' or RANGE == 'V' or RANGE == 'I');
+	assert(RANGE != 'V' or VL < VU);
+	assert(RANGE != 'I' or (1 <= IL and IL <= IU and IU <= N));
+
+	using size_type = std::make_unsigned_t<lapack_int>;
+	using _Slot     = typename Workspace<_Alloc>::Slot;
+
+	char const JOBZ    = (Z == nullptr) ? 'N' : 'V';
+	char const UPLO    = 'U';
+	_T   const ABSTOL  { 0.0 }; //std::numeric_limits<_T>::min();
+	lapack_int M       = 0;
+	auto const routine = std::string{two_stage ? "?SYEVR_2STAGE/" : "?SYEVR/"}
+	                   + JOBZ + RANGE;
+	auto const ISUPPZ  = 
+		ws.template get<lapack_int>
+			(_Slot::ISuppZ, 2 * static_cast<size_type>(N));
+	lapack_int LWORK   = -1;
+	lapack_int LIWORK  = -1;
+	lapack_int INFO    = 0;
+
+	if (auto const* sizes = ws.template find<_T>(routine, N)) {
+		LWORK  = sizes->lwork;
+		LIWORK = sizes->liwork;
+	}
+	else {
 		_T  _work_dummy;
-		int _iwork_dummy;
+		lapack_int _iwork_dummy;
 
-		tcm::import::heevr<_T>
-			( &JOBZ, &RANGE, &UPLO, &N
+		call_heevr<_T>
+			( two_stage
+			, &JOBZ, &RANGE, &UPLO, &N
 			, A, &LDA
 			, &VL, &VU
 			, &IL, &IU
 			, &ABSTOL, &M
 			, W
 			, Z, &LDZ
-			, ISUPPZ.data()
+			, ISUPPZ
 			, &_work_dummy, &LWORK
 			, &_iwork_dummy, &LIWORK
 			, &INFO
 		    );
 
-		LWORK = static_cast<int>(_work_dummy);
+		if (INFO < 0) {
+			throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+			                           + " had an illegal value." };
+		} 
+		LWORK  = workspace_size(_work_dummy);
 		LIWORK = _iwork_dummy;
+		ws.template insert<_T>(routine, N, {LWORK, 0, LIWORK});
 	}
 
-	auto       WORK   = 
-		tcm::utils::_Storage<_T, _Alloc>{static_cast<size_type>(LWORK)};
-	// tcm::utils::allocate_workspace(_T_alloc, LWORK);
-	auto       IWORK  = 
-		tcm::utils::_Storage<int, _Alloc>{static_cast<size_type>(LIWORK)};
-	// allocate_workspace(_int_alloc, LIWORK);
+	auto const WORK    = 
+		ws.template get<_T>(_Slot::Work, static_cast<size_type>(LWORK));
+	auto const IWORK   = 
+		ws.template get<lapack_int>
+			(_Slot::IWork, static_cast<size_type>(LIWORK));
+
+	call_heevr<_T>
+		( two_stage
+		, &JOBZ, &RANGE, &UPLO, &N
+		, A, &LDA
+		, &VL, &VU
+		, &IL, &IU
+		, &ABSTOL, &M
+		, W, Z, &LDZ
+		, ISUPPZ
+		, WORK, &LWORK
+		, IWORK, &LIWORK
+		, &INFO
+		);
+
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+	else if (INFO > 0) {
+		throw std::runtime_error{ two_stage ? "Call to ?SYEVR_2STAGE failed."
+		                                    : "Call to ?SYEVR failed." };
+	}
+	return M;
+}
+
+
+
+template< class _Alloc
+        , class _T
+        , class = std::enable_if_t
+                  <    std::is_same<_T, float>()
+                    or std::is_same<_T, double>()
+                  >
+        >
+auto heevr_impl( lapack_int const N
+               , std::complex<_T>* A, lapack_int const LDA
+               , char const RANGE
+               , _T const VL, _T const VU
+               , lapack_int const IL, lapack_int const IU
+               , bool const two_stage
+               , _T* W
+               , std::complex<_T>* Z, lapack_int const LDZ
+               , Workspace<_Alloc>& ws
+               , utils::Type2Type<std::complex<_T>> ) -> lapack_int
+{
+	if (N == 0) return 0;
 
-	tcm::import::heevr<_T>
-		( &JOBZ, &RANGE, &UPLO, &N
+	assert(N > 0);
+	assert(A != nullptr and LDA >= N);
+	assert(W != nullptr);
+	assert(LDZ >= (Z == nullptr) ? 1 : N);
+	assert(RANGE == 'A' or RANGE == 'V' or RANGE == 'I');
+	assert(RANGE != 'V' or VL < VU);
+	assert(RANGE != 'I' or (1 <= IL and IL <= IU and IU <= N));
+
+	using size_type = std::make_unsigned_t<lapack_int>;
+	using _Slot     = typename Workspace<_Alloc>::Slot;
+
+	char const JOBZ    = (Z == nullptr) ? 'N' : 'V';
+	char const UPLO    = 'U';
+	_T   const ABSTOL  { 0.0 }; //std::numeric_limits<T>::min();
+	lapack_int M       = 0;
+	auto const routine = std::string{two_stage ? "?HEEVR_2STAGE/" : "?HEEVR/"}
+	                   + JOBZ + RANGE;
+	auto const ISUPPZ  = 
+		ws.template get<lapack_int>
+			(_Slot::ISuppZ, 2 * static_cast<size_type>(N));
+	lapack_int LWORK   = -1;
+	lapack_int LRWORK  = -1;
+	lapack_int LIWORK  = -1;
+	lapack_int INFO    = 0;
+
+	if (auto const* sizes = ws.template find<std::complex<_T>>(routine, N)) {
+		LWORK  = sizes->lwork;
+		LRWORK = sizes->lrwork;
+		LIWORK = sizes->liwork;
+	}
+	else {
+		std::complex<_T>   _work_dummy;
+		_T                 _rwork_dummy;
+		lapack_int         _iwork_dummy;
+
+		call_heevr<std::complex<_T>>
+			( two_stage
+			, &JOBZ, &RANGE, &UPLO, &N
+			, A, &LDA
+			, &VL, &VU
+			, &IL, &IU
+			, &ABSTOL, &M
+			, W
+			, Z, &LDZ
+			, ISUPPZ
+			, &_work_dummy, &LWORK
+			, &_rwork_dummy, &LRWORK
+			, &_iwork_dummy, &LIWORK
+			, &INFO
+		    );
+
+		if (INFO < 0) {
+			throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+			                           + " had an illegal value." };
+		} 
+		LWORK  = workspace_size(_work_dummy);
+		LRWORK = workspace_size(_rwork_dummy);
+		LIWORK = _iwork_dummy;
+		ws.template insert<std::complex<_T>>
+			(routine, N, {LWORK, LRWORK, LIWORK});
+	}
+
+	auto const WORK    = ws.template get<std::complex<_T>>
+		(_Slot::Work, static_cast<size_type>(LWORK));
+	auto const RWORK   = 
+		ws.template get<_T>(_Slot::RWork, static_cast<size_type>(LRWORK));
+	auto const IWORK   = 
+		ws.template get<lapack_int>
+			(_Slot::IWork, static_cast<size_type>(LIWORK));
+
+	call_heevr<std::complex<_T>>
+		( two_stage
+		, &JOBZ, &RANGE, &UPLO, &N
 		, A, &LDA
 		, &VL, &VU
 		, &IL, &IU
 		, &ABSTOL, &M
 		, W, Z, &LDZ
-		, ISUPPZ.data()
+		, ISUPPZ
+		, WORK, &LWORK
+		, RWORK, &LRWORK
+		, IWORK, &LIWORK
+		, &INFO
+		);
+
+	if(INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+	else if(INFO > 0) {
+		throw std::runtime_error{ two_stage ? "Call to ?HEEVR_2STAGE failed."
+		                                    : "Call to ?HEEVR failed." };
+	}
+	return M;
+}
+
+} // unnamed namespace 
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Same as #heevr() below, but takes the workspace from \p ws instead
+/// of allocating it.
+///////////////////////////////////////////////////////////////////////////////
+template< class _T
+        , class _Alloc
+        >
+auto heevr( std::size_t const n
+          , _T* A, std::size_t const lda
+          , utils::Base<_T>* W
+          , _T* Z, std::size_t const ldz
+          , Workspace<_Alloc>& ws ) -> void
+{
+	TCM_MEASURE("heevr<" + boost::core::demangle(typeid(_T).name()) + ">()");
+	TCM_ACCOUNT(cost::heev<_T>(n, Z != nullptr ? n : 0));
+
+	heevr_impl
+		( boost::numeric_cast<lapack_int>(n)
+	    , A, boost::numeric_cast<lapack_int>(lda)
+	    , 'A', utils::Base<_T>{0}, utils::Base<_T>{0}, 0, 0
+	    , false
+	    , W
+	    , Z, boost::numeric_cast<lapack_int>(ldz)
+	    , ws
+	    , utils::Type2Type<_T>{} );
+}
+
+
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+auto heevr( std::size_t const n
+          , _T* A, std::size_t const lda
+          , utils::Base<_T>* W
+          , _T* Z, std::size_t const ldz ) -> void
+{
+	Workspace<_Alloc> ws;
+	lapack::heevr(n, A, lda, W, Z, ldz, ws);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes eigenpairs of a Hermitian matrix with eigenvalues in the
+/// half-open interval \f$ (v_l, v_u] \f$ (?HEEVR with RANGE='V').
+
+/// As the number \f$ m \f$ of eigenvalues in the interval is not known in
+/// advance, \p W must have room for \p n elements and \p Z for \p n
+/// columns. Only the first \f$ m \f$ of them are written.
+///
+/// \return \f$ m \f$.
+///////////////////////////////////////////////////////////////////////////////
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+auto heevr_interval( std::size_t const n
+                   , _T* A, std::size_t const lda
+                   , utils::Base<_T> const vl, utils::Base<_T> const vu
+                   , utils::Base<_T>* W
+                   , _T* Z, std::size_t const ldz ) -> std::size_t
+{
+	TCM_MEASURE( "heevr_interval<" + boost::core::demangle(typeid(_T).name())
+	           + ">()" );
+
+	Workspace<_Alloc> ws;
+	auto const m = static_cast<std::size_t>(heevr_impl
+		( boost::numeric_cast<lapack_int>(n)
+	    , A, boost::numeric_cast<lapack_int>(lda)
+	    , 'V', vl, vu, 0, 0
+	    , false
+	    , W
+	    , Z, boost::numeric_cast<lapack_int>(ldz)
+	    , ws
+	    , utils::Type2Type<_T>{} ));
+	TCM_ACCOUNT(cost::heev<_T>(n, Z != nullptr ? m : 0));
+	return m;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the eigenpairs number \p il through \p iu (0-based,
+/// inclusive, in ascending order of eigenvalues) of a Hermitian matrix
+/// (?HEEVR with RANGE='I').
+
+/// \p W must have room for \p n elements (a LAPACK requirement), but \p Z
+/// only for \f$ iu - il + 1 \f$ columns.
+///////////////////////////////////////////////////////////////////////////////
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+auto heevr_index( std::size_t const n
+                , _T* A, std::size_t const lda
+                , std::size_t const il, std::size_t const iu
+                , utils::Base<_T>* W
+                , _T* Z, std::size_t const ldz ) -> void
+{
+	TCM_MEASURE( "heevr_index<" + boost::core::demangle(typeid(_T).name())
+	           + ">()" );
+	TCM_ACCOUNT(cost::heev<_T>(n, Z != nullptr ? iu - il + 1 : 0));
+
+	Workspace<_Alloc> ws;
+	heevr_impl
+		( boost::numeric_cast<lapack_int>(n)
+	    , A, boost::numeric_cast<lapack_int>(lda)
+	    , 'I', utils::Base<_T>{0}, utils::Base<_T>{0}
+	    , boost::numeric_cast<lapack_int>(il + 1)
+	    , boost::numeric_cast<lapack_int>(iu + 1)
+	    , false
+	    , W
+	    , Z, boost::numeric_cast<lapack_int>(ldz)
+	    , ws
+	    , utils::Type2Type<_T>{} );
+}
+
+
+#ifdef CONFIG_LAPACK_2STAGE
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Same as #heevr(), but uses the two-stage tridiagonal reduction
+/// (?HEEVR_2STAGE), which spends most of its time in BLAS-3 and thus scales
+/// better with the number of threads.
+
+/// \note Reference LAPACK (as of 3.12) only implements the eigenvalues-only
+/// mode of two-stage solvers and rejects \p Z != nullptr with
+/// std::invalid_argument.
+///////////////////////////////////////////////////////////////////////////////
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+auto heevr_2stage( std::size_t const n
+                 , _T* A, std::size_t const lda
+                 , utils::Base<_T>* W
+                 , _T* Z, std::size_t const ldz ) -> void
+{
+	TCM_MEASURE( "heevr_2stage<" + boost::core::demangle(typeid(_T).name())
+	           + ">()" );
+	TCM_ACCOUNT(cost::heev<_T>(n, Z != nullptr ? n : 0));
+
+	Workspace<_Alloc> ws;
+	heevr_impl
+		( boost::numeric_cast<lapack_int>(n)
+	    , A, boost::numeric_cast<lapack_int>(lda)
+	    , 'A', utils::Base<_T>{0}, utils::Base<_T>{0}, 0, 0
+	    , true
+	    , W
+	    , Z, boost::numeric_cast<lapack_int>(ldz)
+	    , ws
+	    , utils::Type2Type<_T>{} );
+}
+#endif // CONFIG_LAPACK_2STAGE
+
+
+
+} // namespace lapack
+
+} // namespace tcm
+
+
+
+
+
+
+
+
+// ============================================================================
+// ||                                                                        ||
+// ||                             ? H E E V D                                ||
+// ||                                                                        ||
+// ============================================================================
+
+
+namespace tcm {
+
+namespace lapack {
+
+
+namespace {
+
+
+// Calls ?HEEVD or, if two_stage is true, ?HEEVD_2STAGE.
+template<class _T, class... _Args>
+auto call_heevd(bool const two_stage, _Args&&... args) -> void
+{
+#ifdef CONFIG_LAPACK_2STAGE
+	if (two_stage) {
+		tcm::import::heevd_2stage<_T>(std::forward<_Args>(args)...);
+		return;
+	}
+#endif
+	assert(not two_stage);
+	tcm::import::heevd<_T>(std::forward<_Args>(args)...);
+}
+
+
+template< class _Alloc
+        , class _T
+        , class = std::enable_if_t
+                  <    std::is_same<_T, float>()
+                    or std::is_same<_T, double>()
+		          >
+        >
+auto heevd_impl( lapack_int const N
+               , _T* A, lapack_int const LDA
+               , _T* W
+               , bool const compute_eigenvectors
+               , bool const two_stage
+               , utils::Type2Type<_T> ) -> void
+{
+	if (N == 0) return;
+
+	assert(N > 0);
+	assert(A != nullptr and LDA >= N);
+	assert(W != nullptr);
+
+	using size_type = std::make_unsigned_t<lapack_int>;
+
+	char const JOBZ   = compute_eigenvectors ? 'V' : 'N';
+	char const UPLO   = 'U';
+	lapack_int LWORK  = -1;
+	lapack_int LIWORK = -1;
+	lapack_int INFO   = 0;
+
+	{
+		_T  _work_dummy;
+		lapack_int _iwork_dummy;
+
+		call_heevd<_T>
+			( two_stage
+			, &JOBZ, &UPLO, &N
+			, A, &LDA
+			, W
+			, &_work_dummy, &LWORK
+			, &_iwork_dummy, &LIWORK
+			, &INFO
+		    );
+
+		LWORK  = workspace_size(_work_dummy);
+		LIWORK = _iwork_dummy;
+	}
+
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+
+	auto       WORK   = 
+		tcm::utils::_Storage<_T, _Alloc>{static_cast<size_type>(LWORK)};
+	auto       IWORK  = 
+		tcm::utils::_Storage<lapack_int, _Alloc>{
+			static_cast<size_type>(LIWORK) };
+
+	call_heevd<_T>
+		( two_stage
+		, &JOBZ, &UPLO, &N
+		, A, &LDA
+		, W
 		, WORK.data(), &LWORK
 		, IWORK.data(), &LIWORK
 		, &INFO
@@ -121,12 +540,12 @@ auto heevr_impl( int const N
 		                           + " had an illegal value." };
 	} 
 	else if (INFO > 0) {
-		throw std::runtime_error{"Call to ?SYEVR failed."};
+		throw std::runtime_error{ two_stage ? "Call to ?SYEVD_2STAGE failed."
+		                                    : "Call to ?SYEVD failed." };
 	}
 }
 
 
-
 template< class _Alloc
         , class _T
         , class = std::enable_if_t
@@ -134,10 +553,11 @@ template< class _Alloc
                     or std::is_same<_T, double>()
                   >
         >
-auto heevr_impl( int const N
-               , std::complex<_T>* A, int const LDA
+auto heevd_impl( lapack_int const N
+               , std::complex<_T>* A, lapack_int const LDA
                , _T* W
-               , std::complex<_T>* Z, int const LDZ
+               , bool const compute_eigenvectors
+               , bool const two_stage
                , utils::Type2Type<std::complex<_T>> ) -> void
 {
 	if (N == 0) return;
@@ -145,96 +565,69 @@ auto heevr_impl( int const N
 	assert(N > 0);
 	assert(A != nullptr and LDA >= N);
 	assert(W != nullptr);
-	assert(LDZ >= (Z == nullptr) ? 1 : N);
 
-	/*
-	using _Alloc_traits = std::allocator_traits<_Alloc>;
-	typename _Alloc_traits::template rebind_alloc<std::complex<_T>>
-		_Cmpl_T_alloc;
-	typename _Alloc_traits::template rebind_alloc<_T>
-		_T_alloc;
-	typename _Alloc_traits::template rebind_alloc<int>
-		_int_alloc;
-	*/
-	using size_type = std::make_unsigned_t<int>;
-
-	char const JOBZ   = (Z == nullptr) ? 'N' : 'V';
-	char const RANGE  = 'A';
+	using size_type = std::make_unsigned_t<lapack_int>;
+
+	char const JOBZ   = compute_eigenvectors ? 'V' : 'N';
 	char const UPLO   = 'U';
-	_T   const VL     { 0.0 };
-	_T   const VU     { 0.0 };
-	int  const IL     = 0;
-	int  const IU     = 0;
-	_T   const ABSTOL { 0.0 }; //std::numeric_limits<T>::min();
-	int        M      = 0;
-	auto       ISUPPZ = 
-		tcm::utils::_Storage<int, _Alloc>{2 * static_cast<size_type>(N)};
-	// tcm::utils::allocate_workspace(_int_alloc, 2 * N);
-	                 // std::make_unique<int[]>(2 * N);
-	int        LWORK  = -1;
-	int        LRWORK = -1;
-	int        LIWORK = -1;
-	int        INFO   = 0;
+	lapack_int LWORK  = -1;
+	lapack_int LRWORK = -1;
+	lapack_int LIWORK = -1;
+	lapack_int INFO   = 0;
 
 	{
 		std::complex<_T>   _work_dummy;
 		_T                 _rwork_dummy;
-		int                _iwork_dummy;
+		lapack_int         _iwork_dummy;
 
-		tcm::import::heevr<std::complex<_T>>
-			( &JOBZ, &RANGE, &UPLO, &N
+		call_heevd<std::complex<_T>>
+			( two_stage
+			, &JOBZ, &UPLO, &N
 			, A, &LDA
-			, &VL, &VU
-			, &IL, &IU
-			, &ABSTOL, &M
 			, W
-			, Z, &LDZ
-			, ISUPPZ.data()
 			, &_work_dummy, &LWORK
 			, &_rwork_dummy, &LRWORK
 			, &_iwork_dummy, &LIWORK
 			, &INFO
 		    );
 
-		LWORK  = static_cast<int>(std::real(_work_dummy));
-		LRWORK = static_cast<int>(_rwork_dummy);
+		LWORK  = workspace_size(_work_dummy);
+		LRWORK = workspace_size(_rwork_dummy);
 		LIWORK = _iwork_dummy;
 	}
 
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+
 	auto       WORK   = 
 		tcm::utils::_Storage<std::complex<_T>, _Alloc>{
 			static_cast<size_type>(LWORK) };
-	// tcm::utils::allocate_workspace(_Cmpl_T_alloc, LWORK);
-	                 // std::make_unique<std::complex<_T>[]>(LWORK);
 	auto       RWORK  = 
 		tcm::utils::_Storage<_T, _Alloc>{static_cast<size_type>(LRWORK)};
-	// tcm::utils::allocate_workspace(_T_alloc, LRWORK);
-	                 // std::make_unique<_T[]>(LRWORK);
 	auto       IWORK  = 
-		tcm::utils::_Storage<int, _Alloc>{static_cast<size_type>(LIWORK)};
-	// tcm::utils::allocate_workspace(_int_alloc, LIWORK);
-	                 // std::make_unique<int[]>(LIWORK);
+		tcm::utils::_Storage<lapack_int, _Alloc>{
+			static_cast<size_type>(LIWORK) };
 
-	tcm::import::heevr<std::complex<_T>>
-		( &JOBZ, &RANGE, &UPLO, &N
+	call_heevd<std::complex<_T>>
+		( two_stage
+		, &JOBZ, &UPLO, &N
 		, A, &LDA
-		, &VL, &VU
-		, &IL, &IU
-		, &ABSTOL, &M
-		, W, Z, &LDZ
-		, ISUPPZ.data()
+		, W
 		, WORK.data(), &LWORK
 		, RWORK.data(), &LRWORK
 		, IWORK.data(), &LIWORK
 		, &INFO
 		);
 
-	if(INFO < 0) {
+	if (INFO < 0) {
 		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
 		                           + " had an illegal value." };
 	} 
-	else if(INFO > 0) {
-		throw std::runtime_error{"Call to ?HEEVR failed."};
+	else if (INFO > 0) {
+		throw std::runtime_error{ two_stage ? "Call to ?HEEVD_2STAGE failed."
+		                                    : "Call to ?HEEVD failed." };
 	}
 }
 
@@ -242,25 +635,137 @@ auto heevr_impl( int const N
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes all eigenvalues and, optionally, eigenvectors of a
+/// Hermitian matrix using the divide-and-conquer algorithm (?HEEVD).
+
+/// Eigenvectors overwrite \p A. Compared to #heevr() it needs a larger
+/// workspace (\f$ \mathcal{O}(N^2) \f$ in addition to \p A), but does most
+/// of the work in BLAS-3 and is usually faster with multithreaded BLAS.
+///////////////////////////////////////////////////////////////////////////////
 template< class _T
         , class _Alloc = std::allocator<_T>
         >
-auto heevr( std::size_t const n
+auto heevd( std::size_t const n
           , _T* A, std::size_t const lda
           , utils::Base<_T>* W
-          , _T* Z, std::size_t const ldz ) -> void
+          , bool const compute_eigenvectors ) -> void
 {
-	TCM_MEASURE("heevr<" + boost::core::demangle(typeid(_T).name()) + ">()");
+	TCM_MEASURE("heevd<" + boost::core::demangle(typeid(_T).name()) + ">()");
+	TCM_ACCOUNT(cost::heev<_T>(n, compute_eigenvectors ? n : 0));
 
-	heevr_impl<_Alloc>
-		( boost::numeric_cast<int>(n)
-	    , A, boost::numeric_cast<int>(lda)
+	heevd_impl<_Alloc>
+		( boost::numeric_cast<lapack_int>(n)
+	    , A, boost::numeric_cast<lapack_int>(lda)
 	    , W
-	    , Z, boost::numeric_cast<int>(ldz)
+	    , compute_eigenvectors
+	    , false
 	    , utils::Type2Type<_T>{} );
 }
 
 
+#ifdef CONFIG_LAPACK_2STAGE
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Same as #heevd(), but uses the two-stage tridiagonal reduction
+/// (?HEEVD_2STAGE).
+
+/// \note See #heevr_2stage() regarding eigenvectors.
+///////////////////////////////////////////////////////////////////////////////
+template< class _T
+        , class _Alloc = std::allocator<_T>
+        >
+auto heevd_2stage( std::size_t const n
+                 , _T* A, std::size_t const lda
+                 , utils::Base<_T>* W
+                 , bool const compute_eigenvectors ) -> void
+{
+	TCM_MEASURE( "heevd_2stage<" + boost::core::demangle(typeid(_T).name())
+	           + ">()" );
+	TCM_ACCOUNT(cost::heev<_T>(n, compute_eigenvectors ? n : 0));
+
+	heevd_impl<_Alloc>
+		( boost::numeric_cast<lapack_int>(n)
+	    , A, boost::numeric_cast<lapack_int>(lda)
+	    , W
+	    , compute_eigenvectors
+	    , true
+	    , utils::Type2Type<_T>{} );
+}
+#endif // CONFIG_LAPACK_2STAGE
+
+
+
+} // namespace lapack
+
+} // namespace tcm
+
+
+
+
+// ============================================================================
+// ||                                                                        ||
+// ||                             ? P O T R F                                ||
+// ||                                                                        ||
+// ============================================================================
+
+
+namespace tcm {
+
+namespace lapack {
+
+
+namespace {
+
+
+template<class _T>
+auto potrf_impl( char const UPLO
+               , lapack_int const N
+               , _T* A, lapack_int const LDA ) -> void
+{
+	if (N == 0) return;
+
+	assert(UPLO == 'L' or UPLO == 'U');
+	assert(N > 0);
+	assert(A != nullptr and LDA >= N);
+
+	lapack_int INFO = 0;
+	tcm::import::potrf<_T>(&UPLO, &N, A, &LDA, &INFO);
+
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO) 
+		                           + " had an illegal value." };
+	} 
+	else if (INFO > 0) {
+		throw std::runtime_error{ "Call to ?POTRF failed: the leading minor "
+		                          "of order " + std::to_string(INFO)
+		                        + " is not positive definite." };
+	}
+}
+
+} // unnamed namespace 
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the Cholesky factorisation \f$ A = L L^\dagger \f$ of a
+/// Hermitian positive definite matrix (?POTRF).
+
+/// Only the lower triangle of \p A is referenced; it is overwritten by
+/// \f$ L \f$. Throws std::runtime_error if \p A is not positive definite.
+///////////////////////////////////////////////////////////////////////////////
+template<class _T>
+auto potrf( std::size_t const n
+          , _T* A, std::size_t const lda ) -> void
+{
+	TCM_MEASURE("potrf<" + boost::core::demangle(typeid(_T).name()) + ">()");
+
+	potrf_impl
+		( 'L'
+	    , boost::numeric_cast<lapack_int>(n)
+	    , A, boost::numeric_cast<lapack_int>(lda) );
+}
+
+
 
 } // namespace lapack
 
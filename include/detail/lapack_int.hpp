@@ -0,0 +1,85 @@
+#ifndef TCM_LAPACK_INT_HPP
+#define TCM_LAPACK_INT_HPP
+
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include <detail/config.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file lapack_int.hpp
+/// \brief Integer type used for sizes, leading dimensions, workspace lengths
+///        and INFO in calls to BLAS and LAPACK.
+///
+/// By default BLAS and LAPACK use 32-bit integers (LP64), which limits the
+/// number of elements in a single workspace to \f$ 2^{31} - 1 \f$. Defining
+/// CONFIG_ILP64 (or MKL_ILP64, which Intel's link line advisor adds for the
+/// ILP64 interface of MKL) switches to 64-bit integers. The BLAS/LAPACK
+/// library must then be built with 64-bit integers as well, e.g. MKL's
+/// `mkl_intel_ilp64` layer or OpenBLAS with INTERFACE64=1.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace import {
+
+
+#if defined(CONFIG_ILP64) or defined(MKL_ILP64)
+	using lapack_int = long long int;
+#else
+	using lapack_int = int;
+#endif
+
+using blas_int = lapack_int;
+
+
+} // namespace import
+
+
+namespace lapack {
+
+
+using lapack_int = import::lapack_int;
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Converts the optimal workspace size returned by a workspace query
+/// (LWORK = -1) to #lapack_int.
+
+/// LAPACK returns the size in WORK(1), i.e. as a floating point number. In
+/// single precision it may be rounded down, so we round it up a little. If
+/// it does not fit into #lapack_int, std::overflow_error is thrown
+/// rather than silently passing a truncated size to LAPACK.
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+auto workspace_size(_R const x) -> lapack_int
+{
+	static_assert( std::is_floating_point<_R>::value
+	             , "Workspace sizes are returned as real numbers." );
+	auto const size = std::ceil(x * (_R{1} + std::numeric_limits<_R>::epsilon()));
+	if (not (size < static_cast<_R>(std::numeric_limits<lapack_int>::max()))) {
+		throw std::overflow_error{ "Requested workspace of " + std::to_string(x)
+		                         + " elements does not fit into lapack_int. "
+		                           "Rebuild with -DCONFIG_ILP64 and an ILP64 "
+		                           "BLAS/LAPACK." };
+	}
+	return static_cast<lapack_int>(size);
+}
+
+
+template <class _R>
+auto workspace_size(std::complex<_R> const x) -> lapack_int
+{ return workspace_size(std::real(x)); }
+
+
+} // namespace lapack
+
+} // namespace tcm
+
+
+#endif // TCM_LAPACK_INT_HPP
@@ -0,0 +1,567 @@
+#ifndef TCM_LAPACK_PROTOTYPES_HPP
+#define TCM_LAPACK_PROTOTYPES_HPP
+
+
+#include <complex>
+
+#include <detail/lapack_int.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file lapack_prototypes.hpp
+/// \brief Prototypes of the Fortran LAPACK routines we use. They are the
+///        same for reference LAPACK, OpenBLAS and ATLAS.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace import {
+
+
+extern "C" {
+
+
+//                   ===================
+//                   |      ?SYEV      |
+//                   ===================
+
+void ssyev_
+    ( const char* JOB, const char* UPLO, const lapack_int* N
+    , float* A, const lapack_int* LDA, float* W
+    , float* WORK, const lapack_int* LWORK
+    , lapack_int* INFO );
+
+void dsyev_
+    ( const char* JOB, const char* UPLO, const lapack_int* N
+    , double* A, const lapack_int* LDA, double* W
+    , double* WORK, const lapack_int* LWORK
+    , lapack_int* INFO );
+
+
+
+
+//                   ===================
+//                   |      ?SYEVR     |
+//                   ===================
+
+void ssyevr_
+    ( char const* JOBZ, char const* RANGE, char const* UPLO, lapack_int const* N
+    , float* A, lapack_int const* LDA
+    , float const* VL, float const* VU, lapack_int const* IL, lapack_int const* IU
+    , float const* ABSTOL, lapack_int* M
+    , float* W, float* Z, lapack_int const* LDZ
+    , lapack_int* ISUPPZ
+    , float* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void dsyevr_
+    ( char const* JOBZ, char const* RANGE, char const* UPLO, lapack_int const* N
+    , double* A, lapack_int const* LDA
+    , double const* VL, double const* VU, lapack_int const* IL, lapack_int const* IU
+    , double const* ABSTOL, lapack_int* M
+    , double* W, double* Z, lapack_int const* LDZ
+    , lapack_int* ISUPPZ
+    , double* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+
+
+
+//                   ===================
+//                   |      ?HEEV      |
+//                   ===================
+
+void cheev_
+    ( const char* JOB, const char* UPLO, const lapack_int* N
+    , std::complex<float>* A, const lapack_int* LDA, float* W
+    , std::complex<float>* WORK, const lapack_int* LWORK, float* RWORK
+    , lapack_int* INFO );
+
+void zheev_
+    ( const char* JOB, const char* UPLO, const lapack_int* N
+    , std::complex<double>* A, const lapack_int* LDA, double* W
+    , std::complex<double>* WORK, const lapack_int* LWORK, double* RWORK
+    , lapack_int* INFO );
+
+
+
+
+//                   ===================
+//                   |      ?HEEVR     |
+//                   ===================
+
+void cheevr_
+    ( char const* JOBZ, char const* RANGE, char const* UPLO, lapack_int const* N
+    , std::complex<float>* A, lapack_int const* LDA
+    , float const* VL, float const* VU, lapack_int const* IL, lapack_int const* IU
+    , float const* ABSTOL, lapack_int* M
+    , float* W, std::complex<float>* Z, lapack_int const* LDZ
+    , lapack_int* ISUPPZ
+    , std::complex<float>* WORK, lapack_int* LWORK
+    , float* RWORK, lapack_int* LRWORK
+    , lapack_int* IWORK, lapack_int* LIWORK
+    , lapack_int* INFO );
+
+void zheevr_
+    ( char const* JOBZ, char const* RANGE, char const* UPLO, lapack_int const* N
+    , std::complex<double>* A, lapack_int const* LDA
+    , double const* VL, double const* VU, lapack_int const* IL, lapack_int const* IU
+    , double const* ABSTOL, lapack_int* M
+    , double* W, std::complex<double>* Z, lapack_int const* LDZ
+    , lapack_int* ISUPPZ
+    , std::complex<double>* WORK, lapack_int* LWORK
+    , double* RWORK, lapack_int* LRWORK
+    , lapack_int* IWORK, lapack_int* LIWORK
+    , lapack_int* INFO );
+
+
+
+
+//                   ===================
+//                   |      ?HEEVD     |
+//                   ===================
+
+void ssyevd_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , float* A, lapack_int const* LDA, float* W
+    , float* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void dsyevd_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , double* A, lapack_int const* LDA, double* W
+    , double* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void cheevd_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , std::complex<float>* A, lapack_int const* LDA, float* W
+    , std::complex<float>* WORK, lapack_int const* LWORK
+    , float* RWORK, lapack_int const* LRWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void zheevd_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , std::complex<double>* A, lapack_int const* LDA, double* W
+    , std::complex<double>* WORK, lapack_int const* LWORK
+    , double* RWORK, lapack_int const* LRWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+
+
+#ifdef CONFIG_LAPACK_2STAGE
+// Two-stage tridiagonal reduction, available since LAPACK 3.7.
+
+//                   ===================
+//                   |  ?HEEVD_2STAGE  |
+//                   ===================
+
+void ssyevd_2stage_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , float* A, lapack_int const* LDA, float* W
+    , float* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void dsyevd_2stage_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , double* A, lapack_int const* LDA, double* W
+    , double* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void cheevd_2stage_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , std::complex<float>* A, lapack_int const* LDA, float* W
+    , std::complex<float>* WORK, lapack_int const* LWORK
+    , float* RWORK, lapack_int const* LRWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void zheevd_2stage_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , std::complex<double>* A, lapack_int const* LDA, double* W
+    , std::complex<double>* WORK, lapack_int const* LWORK
+    , double* RWORK, lapack_int const* LRWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+
+
+
+//                   ===================
+//                   |  ?HEEVR_2STAGE  |
+//                   ===================
+
+void ssyevr_2stage_
+    ( char const* JOBZ, char const* RANGE, char const* UPLO, lapack_int const* N
+    , float* A, lapack_int const* LDA
+    , float const* VL, float const* VU, lapack_int const* IL, lapack_int const* IU
+    , float const* ABSTOL, lapack_int* M
+    , float* W, float* Z, lapack_int const* LDZ
+    , lapack_int* ISUPPZ
+    , float* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void dsyevr_2stage_
+    ( char const* JOBZ, char const* RANGE, char const* UPLO, lapack_int const* N
+    , double* A, lapack_int const* LDA
+    , double const* VL, double const* VU, lapack_int const* IL, lapack_int const* IU
+    , double const* ABSTOL, lapack_int* M
+    , double* W, double* Z, lapack_int const* LDZ
+    , lapack_int* ISUPPZ
+    , double* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void cheevr_2stage_
+    ( char const* JOBZ, char const* RANGE, char const* UPLO, lapack_int const* N
+    , std::complex<float>* A, lapack_int const* LDA
+    , float const* VL, float const* VU, lapack_int const* IL, lapack_int const* IU
+    , float const* ABSTOL, lapack_int* M
+    , float* W, std::complex<float>* Z, lapack_int const* LDZ
+    , lapack_int* ISUPPZ
+    , std::complex<float>* WORK, lapack_int* LWORK
+    , float* RWORK, lapack_int* LRWORK
+    , lapack_int* IWORK, lapack_int* LIWORK
+    , lapack_int* INFO );
+
+void zheevr_2stage_
+    ( char const* JOBZ, char const* RANGE, char const* UPLO, lapack_int const* N
+    , std::complex<double>* A, lapack_int const* LDA
+    , double const* VL, double const* VU, lapack_int const* IL, lapack_int const* IU
+    , double const* ABSTOL, lapack_int* M
+    , double* W, std::complex<double>* Z, lapack_int const* LDZ
+    , lapack_int* ISUPPZ
+    , std::complex<double>* WORK, lapack_int* LWORK
+    , double* RWORK, lapack_int* LRWORK
+    , lapack_int* IWORK, lapack_int* LIWORK
+    , lapack_int* INFO );
+#endif // CONFIG_LAPACK_2STAGE
+
+
+
+
+//                   ===================
+//                   |      ?POTRF     |
+//                   ===================
+
+void spotrf_
+    ( char const* UPLO, lapack_int const* N
+    , float* A, lapack_int const* LDA
+    , lapack_int* INFO );
+
+void dpotrf_
+    ( char const* UPLO, lapack_int const* N
+    , double* A, lapack_int const* LDA
+    , lapack_int* INFO );
+
+void cpotrf_
+    ( char const* UPLO, lapack_int const* N
+    , std::complex<float>* A, lapack_int const* LDA
+    , lapack_int* INFO );
+
+void zpotrf_
+    ( char const* UPLO, lapack_int const* N
+    , std::complex<double>* A, lapack_int const* LDA
+    , lapack_int* INFO );
+
+
+
+//                   ===================
+//                   |      ?GEEV      |
+//                   ===================
+
+void sgeev_
+    ( char const* JOBVL, char const* JOBVR, lapack_int const* N
+    , float* A, lapack_int const* LDA, float* WR, float* WI
+    , float* VL, lapack_int const* LDVL, float* VR, lapack_int const* LDVR
+    , float* WORK, lapack_int const* LWORK
+    , lapack_int* info );
+
+void dgeev_
+    ( char const* JOBVL, char const* JOBVR, lapack_int const* N
+    , double* A, lapack_int const* LDA, double* WR, double* WI
+    , double* VL, lapack_int const* LDVL, double* VR, lapack_int const* LDVR
+    , double* WORK, lapack_int const* LWORK
+    , lapack_int* info );
+
+void cgeev_
+    ( char const* JOBVL, char const* JOBVR, lapack_int const* N
+    , std::complex<float>* A, lapack_int const* LDA, std::complex<float>* W
+    , std::complex<float>* VL, lapack_int const* LDVL
+    , std::complex<float>* VR, lapack_int const* LDVR
+    , std::complex<float>* WORK, lapack_int const* LWORK, float* RWORK
+    , lapack_int* info );
+
+void zgeev_
+    ( char const* JOBVL, char const* JOBVR, lapack_int const* N
+    , std::complex<double>* A, lapack_int const* LDA, std::complex<double>* W
+    , std::complex<double>* VL, lapack_int const* LDVL
+    , std::complex<double>* VR, lapack_int const* LDVR
+    , std::complex<double>* WORK, lapack_int const* LWORK, double* RWORK
+    , lapack_int* info );
+
+
+
+//                   ===================
+//                   |      ?GETRF     |
+//                   ===================
+
+void sgetrf_
+    ( lapack_int const* M, lapack_int const* N
+    , float* A, lapack_int const* LDA, lapack_int* IPIV
+    , lapack_int* INFO );
+
+void dgetrf_
+    ( lapack_int const* M, lapack_int const* N
+    , double* A, lapack_int const* LDA, lapack_int* IPIV
+    , lapack_int* INFO );
+
+void cgetrf_
+    ( lapack_int const* M, lapack_int const* N
+    , std::complex<float>* A, lapack_int const* LDA, lapack_int* IPIV
+    , lapack_int* INFO );
+
+void zgetrf_
+    ( lapack_int const* M, lapack_int const* N
+    , std::complex<double>* A, lapack_int const* LDA, lapack_int* IPIV
+    , lapack_int* INFO );
+
+
+
+
+//                   ===================
+//                   |      ?GETRS     |
+//                   ===================
+
+void sgetrs_
+    ( char const* TRANS, lapack_int const* N, lapack_int const* NRHS
+    , float const* A, lapack_int const* LDA, lapack_int const* IPIV
+    , float* B, lapack_int const* LDB
+    , lapack_int* INFO );
+
+void dgetrs_
+    ( char const* TRANS, lapack_int const* N, lapack_int const* NRHS
+    , double const* A, lapack_int const* LDA, lapack_int const* IPIV
+    , double* B, lapack_int const* LDB
+    , lapack_int* INFO );
+
+void cgetrs_
+    ( char const* TRANS, lapack_int const* N, lapack_int const* NRHS
+    , std::complex<float> const* A, lapack_int const* LDA, lapack_int const* IPIV
+    , std::complex<float>* B, lapack_int const* LDB
+    , lapack_int* INFO );
+
+void zgetrs_
+    ( char const* TRANS, lapack_int const* N, lapack_int const* NRHS
+    , std::complex<double> const* A, lapack_int const* LDA, lapack_int const* IPIV
+    , std::complex<double>* B, lapack_int const* LDB
+    , lapack_int* INFO );
+
+
+
+//                   ===================
+//                   |      ?GEHRD     |
+//                   ===================
+
+void sgehrd_
+    ( lapack_int const* N, lapack_int const* ILO, lapack_int const* IHI
+    , float* A, lapack_int const* LDA, float* TAU
+    , float* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+void dgehrd_
+    ( lapack_int const* N, lapack_int const* ILO, lapack_int const* IHI
+    , double* A, lapack_int const* LDA, double* TAU
+    , double* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+void cgehrd_
+    ( lapack_int const* N, lapack_int const* ILO, lapack_int const* IHI
+    , std::complex<float>* A, lapack_int const* LDA, std::complex<float>* TAU
+    , std::complex<float>* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+void zgehrd_
+    ( lapack_int const* N, lapack_int const* ILO, lapack_int const* IHI
+    , std::complex<double>* A, lapack_int const* LDA, std::complex<double>* TAU
+    , std::complex<double>* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+
+
+
+//                   ===================
+//                   |      ?HSEQR     |
+//                   ===================
+
+void shseqr_
+    ( char const* JOB, char const* COMPZ, lapack_int const* N
+    , lapack_int const* ILO, lapack_int const* IHI
+    , float* H, lapack_int const* LDH, float* WR, float* WI
+    , float* Z, lapack_int const* LDZ
+    , float* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+void dhseqr_
+    ( char const* JOB, char const* COMPZ, lapack_int const* N
+    , lapack_int const* ILO, lapack_int const* IHI
+    , double* H, lapack_int const* LDH, double* WR, double* WI
+    , double* Z, lapack_int const* LDZ
+    , double* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+void chseqr_
+    ( char const* JOB, char const* COMPZ, lapack_int const* N
+    , lapack_int const* ILO, lapack_int const* IHI
+    , std::complex<float>* H, lapack_int const* LDH, std::complex<float>* W
+    , std::complex<float>* Z, lapack_int const* LDZ
+    , std::complex<float>* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+void zhseqr_
+    ( char const* JOB, char const* COMPZ, lapack_int const* N
+    , lapack_int const* ILO, lapack_int const* IHI
+    , std::complex<double>* H, lapack_int const* LDH, std::complex<double>* W
+    , std::complex<double>* Z, lapack_int const* LDZ
+    , std::complex<double>* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+
+
+
+//                   ===================
+//                   |      ?HSEIN     |
+//                   ===================
+
+void shsein_
+    ( char const* SIDE, char const* EIGSRC, char const* INITV
+    , lapack_int* SELECT, lapack_int const* N
+    , float const* H, lapack_int const* LDH, float* WR, float const* WI
+    , float* VL, lapack_int const* LDVL, float* VR, lapack_int const* LDVR
+    , lapack_int const* MM, lapack_int* M
+    , float* WORK, lapack_int* IFAILL, lapack_int* IFAILR
+    , lapack_int* INFO );
+
+void dhsein_
+    ( char const* SIDE, char const* EIGSRC, char const* INITV
+    , lapack_int* SELECT, lapack_int const* N
+    , double const* H, lapack_int const* LDH, double* WR, double const* WI
+    , double* VL, lapack_int const* LDVL, double* VR, lapack_int const* LDVR
+    , lapack_int const* MM, lapack_int* M
+    , double* WORK, lapack_int* IFAILL, lapack_int* IFAILR
+    , lapack_int* INFO );
+
+void chsein_
+    ( char const* SIDE, char const* EIGSRC, char const* INITV
+    , lapack_int const* SELECT, lapack_int const* N
+    , std::complex<float> const* H, lapack_int const* LDH, std::complex<float>* W
+    , std::complex<float>* VL, lapack_int const* LDVL
+    , std::complex<float>* VR, lapack_int const* LDVR
+    , lapack_int const* MM, lapack_int* M
+    , std::complex<float>* WORK, float* RWORK, lapack_int* IFAILL, lapack_int* IFAILR
+    , lapack_int* INFO );
+
+void zhsein_
+    ( char const* SIDE, char const* EIGSRC, char const* INITV
+    , lapack_int const* SELECT, lapack_int const* N
+    , std::complex<double> const* H, lapack_int const* LDH, std::complex<double>* W
+    , std::complex<double>* VL, lapack_int const* LDVL
+    , std::complex<double>* VR, lapack_int const* LDVR
+    , lapack_int const* MM, lapack_int* M
+    , std::complex<double>* WORK, double* RWORK, lapack_int* IFAILL, lapack_int* IFAILR
+    , lapack_int* INFO );
+
+
+
+
+//                   ===================
+//                   |  ?ORMHR/?UNMHR  |
+//                   ===================
+
+void sormhr_
+    ( char const* SIDE, char const* TRANS, lapack_int const* M, lapack_int const* N
+    , lapack_int const* ILO, lapack_int const* IHI
+    , float const* A, lapack_int const* LDA, float const* TAU
+    , float* C, lapack_int const* LDC
+    , float* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+void dormhr_
+    ( char const* SIDE, char const* TRANS, lapack_int const* M, lapack_int const* N
+    , lapack_int const* ILO, lapack_int const* IHI
+    , double const* A, lapack_int const* LDA, double const* TAU
+    , double* C, lapack_int const* LDC
+    , double* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+void cunmhr_
+    ( char const* SIDE, char const* TRANS, lapack_int const* M, lapack_int const* N
+    , lapack_int const* ILO, lapack_int const* IHI
+    , std::complex<float> const* A, lapack_int const* LDA
+    , std::complex<float> const* TAU
+    , std::complex<float>* C, lapack_int const* LDC
+    , std::complex<float>* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+void zunmhr_
+    ( char const* SIDE, char const* TRANS, lapack_int const* M, lapack_int const* N
+    , lapack_int const* ILO, lapack_int const* IHI
+    , std::complex<double> const* A, lapack_int const* LDA
+    , std::complex<double> const* TAU
+    , std::complex<double>* C, lapack_int const* LDC
+    , std::complex<double>* WORK, lapack_int const* LWORK
+    , lapack_int* INFO );
+
+
+
+//                   ===================
+//                   |      ?SPMV      |
+//                   ===================
+// Symmetric (not Hermitian) packed matrix-vector product. The real versions
+// are part of BLAS, the complex ones of LAPACK.
+
+void sspmv_
+    ( char const* UPLO, lapack_int const* N
+    , float const* ALPHA, float const* AP
+    , float const* X, lapack_int const* INCX
+    , float const* BETA, float* Y, lapack_int const* INCY );
+
+void dspmv_
+    ( char const* UPLO, lapack_int const* N
+    , double const* ALPHA, double const* AP
+    , double const* X, lapack_int const* INCX
+    , double const* BETA, double* Y, lapack_int const* INCY );
+
+void cspmv_
+    ( char const* UPLO, lapack_int const* N
+    , std::complex<float> const* ALPHA, std::complex<float> const* AP
+    , std::complex<float> const* X, lapack_int const* INCX
+    , std::complex<float> const* BETA, std::complex<float>* Y
+    , lapack_int const* INCY );
+
+void zspmv_
+    ( char const* UPLO, lapack_int const* N
+    , std::complex<double> const* ALPHA, std::complex<double> const* AP
+    , std::complex<double> const* X, lapack_int const* INCX
+    , std::complex<double> const* BETA, std::complex<double>* Y
+    , lapack_int const* INCY );
+
+} // extern "C"
+
+
+} // namespace import
+
+} // namespace tcm
+
+
+#endif // TCM_LAPACK_PROTOTYPES_HPP
@@ -1,17 +1,52 @@
 #ifndef TCM_LAPACK_WRAPPER_HPP
 #define TCM_LAPACK_WRAPPER_HPP
 
+#include <complex>
+#include <utility>
+
 #include <detail/config.hpp>
+#include <detail/lapack_int.hpp>
+#include <detail/backend.hpp>
+#include <detail/utils.hpp>
 
-#ifdef USING_INTEL_MKL
+#if defined(USING_RUNTIME_BACKEND)
+#	include <detail/lapack_prototypes.hpp>
+#elif defined(USING_INTEL_MKL)
 #	include <detail/lapack_wrapper_mkl.hpp>
+#elif defined(USING_ATLAS) or defined(USING_OPENBLAS)
+#	include <detail/lapack_prototypes.hpp>
 #else
-#	ifdef USING_ATLAS
-#		include <detail/lapack_wrapper_atlas.hpp>
-#	else
-#		error "Need ATLAS or MKL"
-#	endif
+#	error "Need ATLAS, OpenBLAS, MKL or USING_RUNTIME_BACKEND"
 #endif
 
 
+
+namespace tcm {
+
+namespace import {
+
+
+TCM_REGISTER(heev, ssyev_, dsyev_, cheev_, zheev_)
+TCM_REGISTER(heevr, ssyevr_, dsyevr_, cheevr_, zheevr_)
+TCM_REGISTER(heevd, ssyevd_, dsyevd_, cheevd_, zheevd_)
+#ifdef CONFIG_LAPACK_2STAGE
+TCM_REGISTER(heevd_2stage, ssyevd_2stage_, dsyevd_2stage_, cheevd_2stage_, zheevd_2stage_)
+TCM_REGISTER(heevr_2stage, ssyevr_2stage_, dsyevr_2stage_, cheevr_2stage_, zheevr_2stage_)
+#endif
+TCM_REGISTER(potrf, spotrf_, dpotrf_, cpotrf_, zpotrf_)
+TCM_REGISTER(geev, sgeev_, dgeev_, cgeev_, zgeev_)
+TCM_REGISTER(getrf, sgetrf_, dgetrf_, cgetrf_, zgetrf_)
+TCM_REGISTER(getrs, sgetrs_, dgetrs_, cgetrs_, zgetrs_)
+TCM_REGISTER(gehrd, sgehrd_, dgehrd_, cgehrd_, zgehrd_)
+TCM_REGISTER(hseqr, shseqr_, dhseqr_, chseqr_, zhseqr_)
+TCM_REGISTER(hsein, shsein_, dhsein_, chsein_, zhsein_)
+TCM_REGISTER(unmhr, sormhr_, dormhr_, cunmhr_, zunmhr_)
+TCM_REGISTER(spmv, sspmv_, dspmv_, cspmv_, zspmv_)
+
+
+} // namespace import
+
+} // namespace tcm
+
+
 #endif // TCM_LAPACK_WRAPPER_HPP
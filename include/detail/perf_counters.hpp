@@ -0,0 +1,351 @@
+#ifndef TCM_PERF_COUNTERS_HPP
+#define TCM_PERF_COUNTERS_HPP
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <detail/config.hpp>
+
+#if defined(CONFIG_PERF_COUNTERS) and defined(__linux__)
+#	include <linux/perf_event.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#	define TCM_HAVE_PERF_COUNTERS
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file perf_counters.hpp
+/// \brief Hardware performance counters for timed regions.
+///
+/// With CONFIG_PERF_COUNTERS (Linux only) every #TCM_MEASURE region can
+/// also count cycles, instructions, last-level cache misses and, on recent
+/// Intel and AMD CPUs, floating point operations. Counting is off by
+/// default, because reading the counters costs one or two system calls per
+/// region boundary. It is switched on by tcm::perf::enable() or by setting
+/// the environment variable TCM_PERF_COUNTERS=1.
+///
+/// Counters are opened per thread with `perf_event_open`, only count user
+/// space and need `kernel.perf_event_paranoid <= 2`. Whatever cannot be
+/// opened (e.g. in VMs without a virtual PMU, or FP events on unknown CPUs)
+/// is left out, and #status() tells why; timing works as before.
+///
+/// A region only counts the thread that entered it. Worker threads of a
+/// threaded BLAS (OpenBLAS, MKL) or of OpenMP are not included, so for
+/// regions like ?GEMM or ?GEEV the cycles and FP operations, and with them
+/// GFLOP/s and bytes per flop, are those of the calling thread only, i.e.
+/// too small by up to the number of BLAS threads. For whole-process
+/// numbers run with one BLAS thread per rank, or use `perf stat`.
+/// (`inherit` would only cover threads created after the counters are
+/// opened, and BLAS thread pools already exist by then.)
+///
+/// FP operations are counted with the CPU's FP_ARITH (Intel) or
+/// RETIRED_SSE_AVX_FLOPS (AMD) events. On Intel these count double
+/// precision by default; set TCM_PERF_FP_PRECISION=single for single
+/// precision.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace perf {
+
+
+/// \brief What is counted.
+enum Kind : unsigned { Cycles, Instructions, LLCMisses, Flops, KindCount };
+
+
+/// \brief Counter values, indexed by #Kind.
+using Counts = std::array<std::uint64_t, KindCount>;
+
+
+namespace detail {
+
+struct State {
+	std::atomic<bool>     enabled{false};
+	/// Bit `k` is set if some thread managed to open a counter of kind `k`.
+	std::atomic<unsigned> available{0};
+	std::mutex            mutex;
+	std::string           status = "not enabled";
+};
+
+
+inline auto state() -> State&
+{
+	static State x;
+	return x;
+}
+
+
+#ifdef TCM_HAVE_PERF_COUNTERS
+
+struct Event {
+	std::uint32_t type;
+	std::uint64_t config;
+	Kind          kind;
+	std::uint64_t weight;
+};
+
+
+inline auto cpu_vendor() -> std::string
+{
+	std::ifstream cpuinfo{"/proc/cpuinfo"};
+	std::string line;
+	while (std::getline(cpuinfo, line)) {
+		if (line.compare(0, 9, "vendor_id") == 0)
+			return line.substr(line.find(':') + 2);
+	}
+	return "";
+}
+
+
+/// \brief Events, in groups that are scheduled onto the PMU together. The
+/// first event of a group is its leader.
+inline auto groups() -> std::vector<std::vector<Event>>
+{
+	std::vector<std::vector<Event>> result =
+		{ { {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, Cycles, 1}
+		  , {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, Instructions, 1}
+		  , {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, LLCMisses, 1} } };
+
+	auto const vendor = cpu_vendor();
+	if (vendor == "GenuineIntel") {
+		// FP_ARITH_INST_RETIRED (event 0xC7). The umask selects scalar,
+		// 128, 256 and 512 bit; weights are the flops per instruction. FMAs
+		// are already counted twice.
+		auto const* precision = std::getenv("TCM_PERF_FP_PRECISION");
+		auto const single = precision != nullptr
+			and std::string{precision} == "single";
+		auto const umask = [single](unsigned x) -> std::uint64_t
+			{ return 0xC7 | ((single ? 2 * x : x) << 8); };
+		auto const lanes = single ? 2u : 1u;
+		result.push_back(
+			{ {PERF_TYPE_RAW, umask(0x01), Flops, 1}
+			, {PERF_TYPE_RAW, umask(0x04), Flops, 2 * lanes}
+			, {PERF_TYPE_RAW, umask(0x10), Flops, 4 * lanes}
+			, {PERF_TYPE_RAW, umask(0x40), Flops, 8 * lanes} } );
+	}
+	else if (vendor == "AuthenticAMD") {
+		// RETIRED_SSE_AVX_FLOPS (Zen 2 and later), all types: counts flops.
+		result.push_back({ {PERF_TYPE_RAW, 0xFF03, Flops, 1} });
+	}
+	return result;
+}
+
+
+inline auto open_event(Event const& event, int const group) -> int
+{
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size           = sizeof(attr);
+	attr.type           = event.type;
+	attr.config         = event.config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv     = 1;
+	attr.read_format    = PERF_FORMAT_GROUP
+	                    | PERF_FORMAT_TOTAL_TIME_ENABLED
+	                    | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return static_cast<int>(::syscall( SYS_perf_event_open, &attr
+	                                 , 0 /* this thread only */, -1 /* any cpu */
+	                                 , group, 0 ));
+}
+
+
+/// \brief Counters of one thread.
+class ThreadCounters {
+
+	struct Group {
+		int                fd = -1;
+		std::vector<int>   members;
+		std::vector<Event> events;
+	};
+
+	std::vector<Group>         _groups;
+	std::vector<std::uint64_t> _buffer;
+
+public:
+	explicit ThreadCounters(std::vector<std::vector<Event>> const& groups)
+	{
+		auto& s = state();
+		std::string errors;
+		for (auto const& events : groups) {
+			Group group;
+			for (auto const& event : events) {
+				auto const fd = open_event(event, group.fd);
+				if (fd < 0) {
+					if (group.fd < 0) {
+						char what[64];
+						std::snprintf( what, sizeof(what), "%sevent %u:0x%llx: "
+						             , errors.empty() ? "" : "; ", event.type
+						             , static_cast<unsigned long long>(event.config) );
+						errors += what;
+						errors += std::strerror(errno);
+						break;
+					}
+					continue;
+				}
+				if (group.fd < 0) group.fd = fd;
+				else group.members.push_back(fd);
+				group.events.push_back(event);
+				s.available.fetch_or(1u << event.kind);
+			}
+			if (group.fd >= 0) _groups.push_back(std::move(group));
+		}
+		_buffer.resize(3 + groups.size() * 8);
+
+		std::lock_guard<std::mutex> lock{s.mutex};
+		s.status = _groups.empty() ? "unavailable (" + errors + ")"
+			: errors.empty() ? "ok" : "partially available (" + errors + ")";
+	}
+
+	ThreadCounters(ThreadCounters const&) = delete;
+	auto operator=(ThreadCounters const&) -> ThreadCounters& = delete;
+
+	~ThreadCounters()
+	{
+		for (auto const& group : _groups) {
+			for (auto const fd : group.members) ::close(fd);
+			::close(group.fd);
+		}
+	}
+
+	auto empty() const noexcept { return _groups.empty(); }
+
+	/// \brief Adds the current values, scaled for multiplexing, to
+	/// \p counts.
+	auto read(Counts& counts) noexcept -> void
+	{
+		for (auto const& group : _groups) {
+			auto const bytes = (3 + group.events.size()) * sizeof(std::uint64_t);
+			if (::read(group.fd, _buffer.data(), bytes)
+			    != static_cast<ssize_t>(bytes)) continue;
+			auto const enabled = _buffer[1];
+			auto const running = _buffer[2];
+			if (running == 0) continue;
+			auto const scale = static_cast<double>(enabled) / running;
+			for (std::size_t i = 0; i < group.events.size(); ++i) {
+				auto const& event = group.events[i];
+				counts[event.kind] += event.weight * static_cast<std::uint64_t>(
+					scale * static_cast<double>(_buffer[3 + i]));
+			}
+		}
+	}
+};
+
+
+inline auto this_thread() -> ThreadCounters&
+{
+	thread_local ThreadCounters x{groups()};
+	return x;
+}
+
+
+inline auto enabled_by_environment() -> bool
+{
+	auto const* value = std::getenv("TCM_PERF_COUNTERS");
+	return value != nullptr and *value != '\0' and std::string{value} != "0";
+}
+
+#endif // TCM_HAVE_PERF_COUNTERS
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Switches counting on. Returns false if no counter could be
+/// opened in the calling thread (see #status()); counting stays off then.
+///////////////////////////////////////////////////////////////////////////////
+inline auto enable() -> bool
+{
+#ifdef TCM_HAVE_PERF_COUNTERS
+	auto const ok = not detail::this_thread().empty();
+	detail::state().enabled.store(ok, std::memory_order_release);
+	return ok;
+#else
+	std::lock_guard<std::mutex> lock{detail::state().mutex};
+	detail::state().status = "unavailable (built without CONFIG_PERF_COUNTERS)";
+	return false;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Switches counting off.
+///////////////////////////////////////////////////////////////////////////////
+inline auto disable() noexcept -> void
+{
+	detail::state().enabled.store(false, std::memory_order_release);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Whether counting is on. Honours TCM_PERF_COUNTERS on first call.
+
+/// That call may open the counters of the calling thread (see #read()) and
+/// hence throw.
+///////////////////////////////////////////////////////////////////////////////
+inline auto enabled() -> bool
+{
+#ifdef TCM_HAVE_PERF_COUNTERS
+	static bool const from_environment =
+		detail::enabled_by_environment() and enable();
+	static_cast<void>(from_environment);
+	return detail::state().enabled.load(std::memory_order_relaxed);
+#else
+	return false;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Whether some thread could count \p kind.
+///////////////////////////////////////////////////////////////////////////////
+inline auto available(Kind const kind) noexcept -> bool
+{
+	return (detail::state().available.load(std::memory_order_relaxed)
+	        >> kind) & 1u;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Human-readable state of the counters, e.g. why they are missing.
+///////////////////////////////////////////////////////////////////////////////
+inline auto status() -> std::string
+{
+	std::lock_guard<std::mutex> lock{detail::state().mutex};
+	return detail::state().status;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Returns the counters of the calling thread since it first used
+/// them. Only differences are meaningful.
+
+/// The first call in a thread opens its counters, which allocates and may
+/// throw std::bad_alloc. Later calls do not throw.
+///////////////////////////////////////////////////////////////////////////////
+inline auto read() -> Counts
+{
+	Counts counts{};
+#ifdef TCM_HAVE_PERF_COUNTERS
+	detail::this_thread().read(counts);
+#endif
+	return counts;
+}
+
+
+} // namespace perf
+
+} // namespace tcm
+
+
+#endif // TCM_PERF_COUNTERS_HPP
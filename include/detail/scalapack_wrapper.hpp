@@ -0,0 +1,125 @@
+#ifndef TCM_SCALAPACK_WRAPPER_HPP
+#define TCM_SCALAPACK_WRAPPER_HPP
+
+#include <complex>
+#include <utility>
+
+#include <mpi.h>
+
+#include <detail/config.hpp>
+#include <detail/lapack_int.hpp>
+#include <detail/backend.hpp>
+#include <detail/utils.hpp>
+
+#if defined(USING_RUNTIME_BACKEND)
+#	error "ScaLAPACK can not be combined with USING_RUNTIME_BACKEND"
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file scalapack_wrapper.hpp
+/// \brief Prototypes of the BLACS and ScaLAPACK routines we use. They are
+///        the same for reference ScaLAPACK and MKL's cluster components.
+///////////////////////////////////////////////////////////////////////////////
+
+
+
+namespace tcm {
+
+namespace import {
+
+
+extern "C" {
+
+
+//                   ===================
+//                   |      BLACS      |
+//                   ===================
+
+int  Csys2blacs_handle(MPI_Comm comm);
+
+void Cblacs_gridinit
+    ( int* context, char const* order, int nprow, int npcol );
+
+void Cblacs_gridinfo
+    ( int context, int* nprow, int* npcol, int* myrow, int* mycol );
+
+void Cblacs_gridexit(int context);
+
+void Cfree_blacs_system_handle(int handle);
+
+
+
+//                   ===================
+//                   |    DESCINIT     |
+//                   ===================
+
+void descinit_
+    ( lapack_int* DESC
+    , lapack_int const* M, lapack_int const* N
+    , lapack_int const* MB, lapack_int const* NB
+    , lapack_int const* IRSRC, lapack_int const* ICSRC
+    , lapack_int const* ICTXT, lapack_int const* LLD
+    , lapack_int* INFO );
+
+
+
+//                   ===================
+//                   |     P?HEEVD     |
+//                   ===================
+
+void pssyevd_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , float* A, lapack_int const* IA, lapack_int const* JA
+    , lapack_int const* DESCA, float* W
+    , float* Z, lapack_int const* IZ, lapack_int const* JZ
+    , lapack_int const* DESCZ
+    , float* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void pdsyevd_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , double* A, lapack_int const* IA, lapack_int const* JA
+    , lapack_int const* DESCA, double* W
+    , double* Z, lapack_int const* IZ, lapack_int const* JZ
+    , lapack_int const* DESCZ
+    , double* WORK, lapack_int const* LWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void pcheevd_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , std::complex<float>* A, lapack_int const* IA, lapack_int const* JA
+    , lapack_int const* DESCA, float* W
+    , std::complex<float>* Z, lapack_int const* IZ, lapack_int const* JZ
+    , lapack_int const* DESCZ
+    , std::complex<float>* WORK, lapack_int const* LWORK
+    , float* RWORK, lapack_int const* LRWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+void pzheevd_
+    ( char const* JOBZ, char const* UPLO, lapack_int const* N
+    , std::complex<double>* A, lapack_int const* IA, lapack_int const* JA
+    , lapack_int const* DESCA, double* W
+    , std::complex<double>* Z, lapack_int const* IZ, lapack_int const* JZ
+    , lapack_int const* DESCZ
+    , std::complex<double>* WORK, lapack_int const* LWORK
+    , double* RWORK, lapack_int const* LRWORK
+    , lapack_int* IWORK, lapack_int const* LIWORK
+    , lapack_int* INFO );
+
+
+} // extern "C"
+
+
+TCM_REGISTER(pheevd, pssyevd_, pdsyevd_, pcheevd_, pzheevd_)
+
+
+} // namespace import
+
+} // namespace tcm
+
+
+#endif // TCM_SCALAPACK_WRAPPER_HPP
@@ -7,6 +7,8 @@
 #include <memory>
 #include <utility>
 
+#include <memory.hpp>
+
 namespace tcm {
 
 
@@ -19,6 +21,8 @@ namespace utils {
 /// This class is like a %std::vector except that it allows no resizing and is
 /// thus smaller in size by `sizeof(pointer)`.
 ///
+/// With #CONFIG_TRACK_MEMORY allocations go through memory::Tracked.
+///
 /// \tparam _Tp    element type.
 /// \tparam _Alloc allocator type.
 ///////////////////////////////////////////////////////////////////////////////
@@ -26,11 +30,12 @@ template < class _Tp
          , class _Alloc
          >
 struct _Storage 
-	: public std::allocator_traits<_Alloc>::template rebind_alloc<_Tp> {
+	: public std::allocator_traits<memory::tracked_t<_Alloc>>::template
+		rebind_alloc<_Tp> {
 
 private:
-	using _Tp_alloc_type    = typename std::allocator_traits<_Alloc>::template 
-		rebind_alloc<_Tp>;
+	using _Tp_alloc_type    = typename std::allocator_traits<
+		memory::tracked_t<_Alloc>>::template rebind_alloc<_Tp>;
 	using _Alloc_traits     = std::allocator_traits<_Tp_alloc_type>;
 
 public:
@@ -97,7 +102,8 @@ public:
 	}
 
 	_Storage(_Storage const& x)
-		: _Storage{ x._get_Tp_allocator() }
+		: _Storage{ _Alloc_traits::select_on_container_copy_construction(
+		                x._get_Tp_allocator()) }
 	{
 		_create_storage(x._finish - x._start);
 		std::copy( x._start, x._finish, _start );
@@ -149,6 +155,9 @@ public:
 
 	friend auto swap(_Storage & x, _Storage & y)
 	{
+		// Allocators may be stateful (see memory::Tracked) and must stay
+		// with the memory they allocated.
+		std::swap(x._get_Tp_allocator(), y._get_Tp_allocator());
 		std::swap(x._start, y._start);
 		std::swap(x._finish, y._finish);
 	}
@@ -274,4 +283,54 @@ auto register_operator(F f)
 
 } // namespace tcm
 
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Defines `general_f<T>(args...)`, which calls \p s_f, \p d_f,
+/// \p c_f or \p z_f for `T` being `float`, `double`, `std::complex<float>`
+/// or `std::complex<double>`.
+
+/// Used for the BLAS, LAPACK and ScaLAPACK wrappers in namespace
+/// tcm::import. The routines are looked up with TCM_IMPORT (see
+/// detail/backend.hpp), which must be defined where this is expanded.
+///////////////////////////////////////////////////////////////////////////////
+#define TCM_REGISTER(general_f, s_f, d_f, c_f, z_f)                         \
+	namespace {                                                             \
+		template<class... Args>                                             \
+		__attribute__((always_inline))                                      \
+		inline                                                              \
+		auto general_f##_impl( utils::Type2Type<float>                      \
+		                     , Args&&... args)                              \
+		{ return TCM_IMPORT(s_f)(std::forward<Args>(args)...); }            \
+		                                                                    \
+		template<class... Args>                                             \
+		__attribute__((always_inline))                                      \
+		inline                                                              \
+		auto general_f##_impl( utils::Type2Type<double>                     \
+		                     , Args&&... args)                              \
+		{ return TCM_IMPORT(d_f)(std::forward<Args>(args)...); }            \
+		                                                                    \
+		template<class... Args>                                             \
+		__attribute__((always_inline))                                      \
+		inline                                                              \
+		auto general_f##_impl( utils::Type2Type< std::complex<float> >      \
+		                     , Args&&... args)                              \
+		{ return TCM_IMPORT(c_f)(std::forward<Args>(args)...); }            \
+		                                                                    \
+		template<class... Args>                                             \
+		__attribute__((always_inline))                                      \
+		inline                                                              \
+		auto general_f##_impl( utils::Type2Type< std::complex<double> >     \
+		                     , Args&&... args)                              \
+		{ return TCM_IMPORT(z_f)(std::forward<Args>(args)...); }            \
+	}                                                                       \
+	                                                                        \
+	template<class T, class... Args>                                        \
+	__attribute__((always_inline))                                          \
+	inline                                                                  \
+	auto general_f(Args&&... args)                                          \
+	{ return general_f##_impl( utils::Type2Type<T>{}                        \
+	                         , std::forward<Args>(args)...);                \
+	}
+
+
 #endif // TCM_UTILS_HPP
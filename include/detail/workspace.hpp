@@ -0,0 +1,135 @@
+#ifndef TCM_WORKSPACE_HPP
+#define TCM_WORKSPACE_HPP
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+
+#include <boost/align/aligned_allocator_adaptor.hpp>
+
+#include <detail/lapack_int.hpp>
+#include <detail/utils.hpp>
+#include <memory.hpp>
+
+
+namespace tcm {
+
+namespace lapack {
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Workspace that is reused across LAPACK calls.
+
+/// Drivers like ?GEEV and ?HEEVR first query the optimal size of their
+/// workspace (LWORK = -1) and then allocate it. For large \f$ N \f$ these
+/// buffers are hundreds of MB, and allocating them on every call means that
+/// every page is faulted in anew. A Workspace avoids both:
+/// 1) Results of workspace queries are cached, keyed by the routine (which
+///    includes job parameters like JOBZ), the element type and \f$ N \f$.
+/// 2) Buffers only ever grow. When a buffer grows, it is zeroed right away
+///    so that page faults happen once, outside of the LAPACK call.
+///
+/// Every buffer is identified by a #Slot, so that one call can use several
+/// of them at once. A Workspace must not be shared between threads.
+///
+/// \tparam _Alloc Allocator. It is rebound to `char`.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Alloc = std::allocator<char>>
+class Workspace {
+
+public:
+	using size_type = std::size_t;
+
+	/// \brief Buffers, named after the LAPACK arguments they are used for.
+	enum class Slot { Work, RWork, IWork, ISuppZ, Count };
+
+	/// \brief LWORK, LRWORK and LIWORK as returned by a workspace query.
+	/// Unused sizes are 0.
+	struct Sizes {
+		lapack_int lwork  = 0;
+		lapack_int lrwork = 0;
+		lapack_int liwork = 0;
+	};
+
+private:
+	using _Byte_alloc = boost::alignment::aligned_allocator_adaptor
+		< typename std::allocator_traits<_Alloc>::template rebind_alloc<char>
+		, 64 >;
+	using _Buffer = utils::_Storage<char, _Byte_alloc>;
+	using _Key    = std::tuple<std::string, std::type_index, lapack_int>;
+
+	std::array<_Buffer, static_cast<std::size_t>(Slot::Count)> _buffers;
+	std::map<_Key, Sizes>                                      _sizes;
+
+public:
+	Workspace() = default;
+	Workspace(Workspace const&) = delete;
+	Workspace(Workspace &&) = default;
+	auto operator=(Workspace const&) -> Workspace& = delete;
+
+	/// \brief Returns cached sizes for \p routine on `_T`s of size \p n, or
+	/// `nullptr` if no query has been recorded yet.
+	template <class _T>
+	auto find(std::string const& routine, lapack_int const n) const -> Sizes const*
+	{
+		auto const i = _sizes.find(_Key{routine, typeid(_T), n});
+		return i != std::end(_sizes) ? &i->second : nullptr;
+	}
+
+	/// \brief Records the result of a workspace query.
+	template <class _T>
+	auto insert( std::string const& routine, lapack_int const n
+	           , Sizes const sizes ) -> void
+	{ _sizes[_Key{routine, typeid(_T), n}] = sizes; }
+
+	/// \brief Returns a buffer of at least \p n `_T`s in \p slot.
+	/// Contents are unspecified.
+	///
+	/// Pointers previously returned for the same slot are invalidated if
+	/// the buffer has to grow.
+	template <class _T>
+	auto get(Slot const slot, size_type const n) -> _T*
+	{
+		static_assert( std::is_trivially_destructible<_T>::value
+		             , "Workspace only holds LAPACK scalars." );
+		auto& buffer = _buffers[static_cast<std::size_t>(slot)];
+		auto const bytes = n * sizeof(_T);
+		if (buffer.size() < bytes) {
+			TCM_MEMORY_TAG("lapack workspace");
+			_Buffer fresh{bytes};
+			std::memset(fresh.data(), 0, bytes);
+			swap(buffer, fresh);
+		}
+		return reinterpret_cast<_T*>(buffer.data());
+	}
+
+	/// \brief Total size of all buffers in bytes.
+	auto bytes() const noexcept -> size_type
+	{
+		size_type total = 0;
+		for (auto const& buffer : _buffers) total += buffer.size();
+		return total;
+	}
+
+	/// \brief Releases all buffers. Cached sizes are kept.
+	auto release() -> void
+	{
+		for (auto& buffer : _buffers) {
+			_Buffer empty;
+			swap(buffer, empty);
+		}
+	}
+};
+
+
+} // namespace lapack
+
+} // namespace tcm
+
+
+#endif // TCM_WORKSPACE_HPP
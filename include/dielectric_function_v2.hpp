@@ -19,6 +19,8 @@
 #include <constants.hpp>
 #include <matrix.hpp>
 #include <blas.hpp>
+#include <detail/cost_model.hpp>
+#include <memory.hpp>
 
 
 
@@ -111,28 +113,19 @@ auto at( std::size_t const i, std::size_t const j
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Computes \f$ G(\omega) \f$.
+/// \brief Computes columns [\p first, \p last) of \f$ G(\omega) \f$.
 
-/// \f[ G_{i,j}(\omega) = \frac{f_i - f_j}{E_i - E_j - \omega}. \f]
-///
-/// \param omega    Frequency \f$\omega\f$ at which to calculate \f$ G \f$.
-///                 It may be either real or complex.
-/// \param E        Energies of the system: \f$1 \times N\f$ matrix (i.e. a 
-///                 column vector). `_F` must be floating point.
-/// \param cs       Constants map. This function requires the availability of
-///                 \f$ T, \mu, k_\text{B}, \hbar \f$ to run. Checks are
-///                 performed at runtime, i.e. this function <b>may throw</b>!
-///                 `_R`, the type of constants in \p cs must also be floating
-///                 point.
-/// \param lg       The logger.
-/// \return         \f$G(\omega)\f$.
-/// \exception      May throw.
+/// Same as make(), but only an \f$ N\times (\text{last} - \text{first})
+/// \f$ block of \f$ G \f$ is allocated. Used to build \f$ \chi \f$ in
+/// column blocks of \f$ G \f$ when the full matrix does not fit.
 ///////////////////////////////////////////////////////////////////////////////
 template<class _Number, class _F, class _R, class _Logger>
-auto make( _Number const omega
-         , Matrix<_F> const& E
-         , std::map<std::string, _R> const& cs 
-         , _Logger & lg )
+auto make_columns( _Number const omega
+                 , Matrix<_F> const& E
+                 , std::map<std::string, _R> const& cs 
+                 , std::size_t const first
+                 , std::size_t const last
+                 , _Logger & lg )
 {
 	static_assert(std::is_floating_point<_F>::value, "Energy must be real.");
 	static_assert(std::is_floating_point<_R>::value, "Physical constants " 
@@ -149,11 +142,14 @@ auto make( _Number const omega
 
 	TCM_MEASURE( "g_function::make<" + boost::core::demangle(
 		typeid(Complex).name()) + ">()" );
+	TCM_ACCOUNT(cost::g_build<Complex>(E.height(), last - first));
+	TCM_MEMORY_TAG("G");
 	LOG(lg, debug) << "Calculating G for omega = " << omega << "...";
 	require(__PRETTY_FUNCTION__, cs, "temperature");
 	require(__PRETTY_FUNCTION__, cs, "chemical-potential");
 	require(__PRETTY_FUNCTION__, cs, "boltzmann-constant");
 	assert( is_column(E) == 1 );
+	assert( first <= last and last <= E.height() );
 	const auto t  = cs.at("temperature");
 	const auto mu = cs.at("chemical-potential");
 	const auto kb = cs.at("boltzmann-constant");
@@ -163,10 +159,10 @@ auto make( _Number const omega
 	std::transform( E.data(), E.data() + N, f.data()
 	              , [t, mu, kb](auto Ei) noexcept
 	                { return fermi_dirac(Ei, t, mu, kb); } );
-	Matrix<Complex> G{N, N};
-	for (std::size_t j = 0; j < N; ++j) {
+	Matrix<Complex> G{N, last - first};
+	for (std::size_t j = first; j < last; ++j) {
 		for (std::size_t i = 0; i < N; ++i) {
-			G(i,j) = at(i, j, omega, E.data(), f.data());
+			G(i, j - first) = at(i, j, omega, E.data(), f.data());
 		}
 	}
 
@@ -175,6 +171,34 @@ auto make( _Number const omega
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes \f$ G(\omega) \f$.
+
+/// \f[ G_{i,j}(\omega) = \frac{f_i - f_j}{E_i - E_j - \omega}. \f]
+///
+/// \param omega    Frequency \f$\omega\f$ at which to calculate \f$ G \f$.
+///                 It may be either real or complex.
+/// \param E        Energies of the system: \f$1 \times N\f$ matrix (i.e. a 
+///                 column vector). `_F` must be floating point.
+/// \param cs       Constants map. This function requires the availability of
+///                 \f$ T, \mu, k_\text{B}, \hbar \f$ to run. Checks are
+///                 performed at runtime, i.e. this function <b>may throw</b>!
+///                 `_R`, the type of constants in \p cs must also be floating
+///                 point.
+/// \param lg       The logger.
+/// \return         \f$G(\omega)\f$.
+/// \exception      May throw.
+///////////////////////////////////////////////////////////////////////////////
+template<class _Number, class _F, class _R, class _Logger>
+auto make( _Number const omega
+         , Matrix<_F> const& E
+         , std::map<std::string, _R> const& cs 
+         , _Logger & lg )
+{
+	return make_columns(omega, E, cs, 0, E.height(), lg);
+}
+
+
 } // namespace g_function
 
 
@@ -205,7 +229,9 @@ namespace chi_function {
 ///
 /// \param a    Row of the matrix.
 /// \param b    Column of the matrix.
-/// \param Psi  Eigenstates of the system.
+/// \param Psi  Eigenstates of the system: \f$ N\times M \f$ matrix with
+///             one state per column. \f$ M < N \f$ if only states in an
+///             energy window around \f$ \mu \f$ were computed.
 /// \param G    G function calculated by calling g_function::make().
 ///
 /// \returns    \f$ \chi_{a,b}(\omega) \f$.
@@ -219,10 +245,11 @@ auto at( std::size_t const a, std::size_t const b
 		typeid(_F).name()) + ", " + boost::core::demangle(
 		typeid(_C).name()) + ">()" );
 	using Complex = std::common_type_t<_F, _C>;
+	TCM_ACCOUNT(cost::hadamard<_F>(Psi.width()));
 
-	const auto N = Psi.height();
-	Matrix<Complex>    A{N, 1};
-	Matrix<Complex> temp{N, 1};
+	const auto M = Psi.width();
+	Matrix<Complex>    A{M, 1};
+	Matrix<Complex> temp{M, 1};
 
 	std::transform( Psi.cbegin_row(a), Psi.cend_row(a)
 	              , Psi.cbegin_row(b)
@@ -234,13 +261,99 @@ auto at( std::size_t const a, std::size_t const b
 	return Complex{2} * blas::dot(A, temp);
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Contribution of a column block of \f$ G(\omega) \f$ to
+/// \f$ \chi_{a,b}(\omega) \f$.
+
+/// \p G holds columns [\p first, \p first + `G.width()`) of
+/// \f$ G(\omega) \f$, see g_function::make_columns(). Summing over all
+/// column blocks gives at(a, b, Psi, G).
+///////////////////////////////////////////////////////////////////////////////
+template <class _F, class _C>
+auto at( std::size_t const a, std::size_t const b
+       , Matrix<_F> const& Psi, Matrix<_C> const& G
+       , std::size_t const first )
+{
+	TCM_MEASURE( "chi_function::at<" + boost::core::demangle(
+		typeid(_F).name()) + ", " + boost::core::demangle(
+		typeid(_C).name()) + ">(block)" );
+	using Complex = std::common_type_t<_F, _C>;
+	TCM_ACCOUNT(cost::hadamard<_F>(Psi.width()));
+
+	const auto M = Psi.width();
+	const auto n = G.width();
+	assert( G.height() == M and first + n <= M );
+	Matrix<Complex>     A{M, 1};
+	Matrix<Complex> A_block{n, 1};
+	Matrix<Complex>  temp{n, 1};
+
+	std::transform( Psi.cbegin_row(a), Psi.cend_row(a)
+	              , Psi.cbegin_row(b)
+	              , A.data()
+	              , [](auto x, auto y) { return x * std::conj(y); } );
+	std::copy_n(A.data() + first, n, A_block.data());
+	blas::gemv( blas::Operator::T
+	          , Complex{1}, G, A
+	          , Complex{0}, temp );
+	return Complex{2} * blas::dot(A_block, temp);
+}
+
 namespace {
+// Builds chi from column blocks of G of width `tile`, so that only an
+// M x tile block of G is alive at a time. Every block adds its
+// contribution to all elements; if `symmetric`, only to the upper triangle.
+template<class _Number, class _F, class _T, class _R, class _Logger>
+auto make_tiled( _Number const omega
+               , Matrix<_F> const& E
+               , Matrix<_T> const& Psi
+               , std::map<std::string, _R> const& cs
+               , std::size_t const tile
+               , bool const symmetric
+               , _Logger & lg )
+{
+	TCM_MEASURE( "chi_function::make_tiled<" + boost::core::demangle(
+		typeid(_T).name()) + ">()" );
+	TCM_MEMORY_TAG("chi");
+	auto const N = Psi.height();
+	auto const M = Psi.width();
+	LOG(lg, debug) << "Calculating chi in blocks of " << tile
+	               << " columns of G...";
+
+	using G_type = decltype(g_function::make(omega, E, cs, lg));
+	using T = decltype( at( std::declval<std::size_t>()
+	                      , std::declval<std::size_t>()
+	                      , std::declval<Matrix<_T>>()
+	                      , std::declval<G_type>() ));
+	Matrix<T> Chi{N, N};
+	std::fill(Chi.data(), Chi.data() + Chi.ldim() * N, T{0});
+
+	for (std::size_t first = 0; first < M; first += tile) {
+		auto const G = g_function::make_columns
+			(omega, E, cs, first, std::min(M, first + tile), lg);
+		for (std::size_t j = 0; j < N; ++j) {
+			for (std::size_t i = 0; i < (symmetric ? j + 1 : N); ++i) {
+				Chi(i, j) += at(i, j, Psi, G, first);
+			}
+		}
+	}
+	if (symmetric) {
+		for (std::size_t j = 0; j < N; ++j) {
+			for (std::size_t i = 0; i < j; ++i) {
+				Chi(j, i) = Chi(i, j);
+			}
+		}
+	}
+	return Chi;
+}
+
 // For the case that eigenstates are actually real.
 template<class _Number, class _F, class _R, class _Logger>
 auto make_impl( _Number const omega
               , Matrix<_F> const& E
               , Matrix<_F> const& Psi
               , std::map<std::string, _R> const& cs
+              , std::size_t const g_tile
               , _Logger & lg )
 {
 	static_assert(std::is_floating_point<_F>::value, "Energy must be real.");
@@ -248,7 +361,10 @@ auto make_impl( _Number const omega
 		"such as chemical potential and temperature must be real.");
 	TCM_MEASURE( "chi_function::make_impl<" + boost::core::demangle(
 		typeid(_F).name()) + ">()" );
-	auto const N = E.height();
+	if (g_tile != 0 and g_tile < Psi.width())
+		return make_tiled(omega, E, Psi, cs, g_tile, true, lg);
+	TCM_MEMORY_TAG("chi");
+	auto const N = Psi.height();
 	auto const G = g_function::make(omega, E, cs, lg);
 
 	using T = decltype( at( std::declval<std::size_t>()
@@ -294,6 +410,7 @@ auto make_impl( _Number const omega
               , Matrix<_F> const& E
               , Matrix<std::complex<_F>> const& Psi
               , std::map<std::string, _R> const& cs
+              , std::size_t const g_tile
               , _Logger & lg )
 {
 	static_assert(std::is_floating_point<_F>::value, "Energy must be real.");
@@ -301,7 +418,10 @@ auto make_impl( _Number const omega
 		"such as chemical potential and temperature must be real.");
 	TCM_MEASURE( "chi_function::make_impl<" + boost::core::demangle(
 		typeid(std::complex<_F>).name()) + ">()" );
-	auto const N = E.height();
+	if (g_tile != 0 and g_tile < Psi.width())
+		return make_tiled(omega, E, Psi, cs, g_tile, false, lg);
+	TCM_MEMORY_TAG("chi");
+	auto const N = Psi.height();
 	auto const G = g_function::make(omega, E, cs, lg);
 
 	using T = decltype( at( std::declval<std::size_t>()
@@ -341,12 +461,18 @@ auto make_impl( _Number const omega
 /// \tparam _Logger   Type of the logger. 
 /// \param omega      Frequency \f$ \omega \f$ at which to calculate 
 ///                   \f$\chi\f$.
-/// \param E          Eigenenergies of the system.
-/// \param Psi        Eigenstates of the system.
+/// \param E          Eigenenergies of the system, \f$ M\times 1 \f$.
+/// \param Psi        Eigenstates of the system, \f$ N\times M \f$. When
+///                   \f$ M < N \f$, transitions involving states outside
+///                   of the window are neglected.
 /// \param cs         Constants. 
 /// \param lg         Logger object.
+/// \param g_tile     If non-zero and less than \f$ M \f$, \f$ G \f$ is
+///                   built in blocks of this many columns, which bounds its
+///                   memory to \f$ M\times\text{g\_tile} \f$ at the cost
+///                   of recomputing the Hadamard products once per block.
 ///
-/// \returns \f$ \chi(\omega) \f$ as a Matrix<_C>.
+/// \returns \f$ \chi(\omega) \f$ as a \f$ N\times N \f$ Matrix<_C>.
 /// \exception May throw.
 ///////////////////////////////////////////////////////////////////////////////
 template<class _Number, class _F, class _C, class _R, class _Logger>
@@ -354,18 +480,17 @@ auto make( _Number const omega
          , Matrix<_F> const& E
          , Matrix<_C> const& Psi
          , std::map<std::string, _R> const& cs
-         , _Logger & lg )
+         , _Logger & lg
+         , std::size_t const g_tile = 0 )
 {
 	TCM_MEASURE( "chi_function::make<" + boost::core::demangle(
 		typeid(_C).name()) + ">()" );
 	LOG(lg, debug) << "Calculating chi for omega = " << omega << "...";
 
-	const auto N = E.height();
 	assert( is_column(E) );
-	assert( is_square(Psi) );
-	assert( N == Psi.height() );
+	assert( E.height() == Psi.width() );
 
-	auto const Chi = make_impl(omega, E, Psi, cs, lg);
+	auto const Chi = make_impl(omega, E, Psi, cs, g_tile, lg);
 	LOG(lg, debug) << "Successfully calculating chi.";
 	return Chi;
 }
@@ -501,30 +626,26 @@ namespace dielectric_function {
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Calculates the dielectric function matrix \f$\epsilon(\omega)\f$.
+/// \brief Calculates \f$ \epsilon = 1 - V\chi \f$ from an already computed
+/// \f$ \chi \f$.
+
+/// Useful when \f$ \chi \f$ itself is needed afterwards, e.g. by
+/// complex_symmetric::epsilon_eigenpairs().
 ///////////////////////////////////////////////////////////////////////////////
-template< class _Number, class _F, class _C, class _R, class _T, class _Logger>
-auto make( _Number const omega
-         , Matrix<_F> const& E
-         , Matrix<_C> const& Psi
+template<class _T, class _Logger>
+auto make( Matrix<_T> const& Chi
          , Matrix<_T> const& V
-         , std::map<std::string, _R> const& cs 
          , _Logger & lg )
 {
 	TCM_MEASURE( "dielectric_function::make<" + boost::core::demangle(
-		typeid(_C).name()) + ">()" );
-	LOG(lg, debug) << "Calculating epsilon for omega = " << omega << "...";
+		typeid(_T).name()) + ">(Chi, V)" );
+	TCM_MEMORY_TAG("epsilon");
 
-	const auto N = E.height();
-	assert( is_column(E) );
-	assert( is_square(Psi) );
+	const auto N = Chi.height();
+	assert( is_square(Chi) );
 	assert( is_square(V) );
-	assert( Psi.height() == N );
 	assert( V.height() == N );
 
-	auto const Chi = chi_function::make(omega, E, Psi, cs, lg);
-
-	static_assert(std::is_same<_T, typename decltype(Chi)::value_type>::value, "");
 	Matrix<_T> epsilon{N, N};
 	for (std::size_t j = 0; j < N; ++j) {
 		for (std::size_t i = 0; i < N; ++i) {
@@ -541,6 +662,72 @@ auto make( _Number const omega
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Calculates columns \p first, ..., \p first + \p count - 1 of
+/// \f$ \epsilon = 1 - V\chi \f$ from an already computed \f$ \chi \f$.
+
+/// Lets \f$ \epsilon \f$ be written out while \f$ \chi \f$ is kept, without
+/// both of them being stored in full at the same time.
+///////////////////////////////////////////////////////////////////////////////
+template<class _T>
+auto make_panel( Matrix<_T> const& Chi
+               , Matrix<_T> const& V
+               , std::size_t const first
+               , std::size_t const count ) -> Matrix<_T>
+{
+	const auto N = Chi.height();
+	assert( is_square(Chi) );
+	assert( is_square(V) );
+	assert( V.height() == N );
+	assert( first + count <= N );
+
+	Matrix<_T> panel{N, count};
+	for (std::size_t j = 0; j < count; ++j) {
+		for (std::size_t i = 0; i < N; ++i) {
+			panel(i, j) = (i == first + j) ? 1.0 : 0.0;
+		}
+	}
+
+	import::gemm( blas::Operator::None, blas::Operator::None
+	            , N, count, N
+	            , _T{-1.0}, V.data(), V.ldim()
+	            , Chi.data(0, first), Chi.ldim()
+	            , _T{ 1.0}, panel.data(), panel.ldim() );
+	return panel;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Calculates the dielectric function matrix \f$\epsilon(\omega)\f$.
+
+/// \p Psi may be rectangular (\f$ N\times M \f$ with \f$ M \f$ the length
+/// of \p E), see chi_function::make(), which also explains \p g_tile.
+///////////////////////////////////////////////////////////////////////////////
+template< class _Number, class _F, class _C, class _R, class _T, class _Logger>
+auto make( _Number const omega
+         , Matrix<_F> const& E
+         , Matrix<_C> const& Psi
+         , Matrix<_T> const& V
+         , std::map<std::string, _R> const& cs 
+         , _Logger & lg
+         , std::size_t const g_tile = 0 )
+{
+	TCM_MEASURE( "dielectric_function::make<" + boost::core::demangle(
+		typeid(_C).name()) + ">()" );
+	LOG(lg, debug) << "Calculating epsilon for omega = " << omega << "...";
+
+	assert( is_column(E) );
+	assert( is_square(V) );
+	assert( E.height() == Psi.width() );
+	assert( V.height() == Psi.height() );
+
+	auto const Chi = chi_function::make(omega, E, Psi, cs, lg, g_tile);
+
+	static_assert(std::is_same<_T, typename decltype(Chi)::value_type>::value, "");
+	return make(Chi, V, lg);
+}
+
+
 
 } // namespace dielectric function
 
@@ -0,0 +1,79 @@
+#ifndef TCM_FILE_NAMES_HPP
+#define TCM_FILE_NAMES_HPP
+
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glob.h>
+
+#include <boost/lexical_cast.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file file_names.hpp
+/// \brief Finds the \f$ \epsilon(\omega) \f$ files written by hello and the
+/// frequencies they belong to.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Expands shell wildcards in \p patterns, e.g. for when the argument
+/// list would be too long for the shell.
+
+/// Patterns without wildcards are kept as they are, patterns matching
+/// nothing are dropped.
+/// \exception std::runtime_error if `glob` fails.
+///////////////////////////////////////////////////////////////////////////////
+inline auto expand_files(std::vector<std::string> const& patterns)
+	-> std::vector<std::string>
+{
+	std::vector<std::string> files;
+	for (auto const& pattern : patterns) {
+		if (pattern.find_first_of("*?[") == std::string::npos) {
+			files.push_back(pattern);
+			continue;
+		}
+		glob_t matches;
+		auto const status = ::glob(pattern.c_str(), 0, nullptr, &matches);
+		if (status == 0) {
+			files.insert( std::end(files)
+			            , matches.gl_pathv, matches.gl_pathv + matches.gl_pathc );
+		}
+		::globfree(&matches);
+		if (status != 0 and status != GLOB_NOMATCH) {
+			throw std::runtime_error{"Failed to expand `" + pattern + "`."};
+		}
+	}
+	return files;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Extracts \f$ \omega \f$ from a file name of the form
+/// `[base].[omega].matrix.bin`.
+
+/// \exception std::invalid_argument if \p file_name is not of that form.
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+auto parse_frequency(std::string const& file_name) -> _R
+{
+	std::regex const re
+		{"^.*?\\.([+-]?[0-9]+\\.?[0-9]*([eE][+-]?[0-9]+)?)\\.matrix\\.bin$"};
+	std::smatch results;
+	if (not std::regex_match(file_name, results, re)) {
+		throw std::invalid_argument{ "Could not extract frequency from `"
+		                           + file_name + "`." };
+	}
+	return boost::lexical_cast<_R>(results[1].str());
+}
+
+
+} // namespace tcm
+
+
+#endif // TCM_FILE_NAMES_HPP
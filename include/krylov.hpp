@@ -0,0 +1,1145 @@
+#ifndef TCM_KRYLOV_HPP
+#define TCM_KRYLOV_HPP
+
+#include <cmath>
+#include <cassert>
+
+#include <vector>
+#include <map>
+#include <limits>
+#include <random>
+#include <numeric>
+#include <algorithm>
+
+#include <boost/core/demangle.hpp>
+
+#include <benchmark.hpp>
+#include <logging.hpp>
+
+#include <matrix.hpp>
+#include <blas.hpp>
+#include <lapack.hpp>
+#include <dielectric_function_v2.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file krylov.hpp
+/// \brief Iterative solvers for \f$ \epsilon(\omega) x = b \f$.
+///
+/// \detail An _operator_ is anything that provides
+/// * `size()` returning \f$ N \f$, and
+/// * `operator()(x, y)` computing \f$ y := A x \f$, where `x` and `y` are
+///   pointers to \f$ N \f$ contiguous elements.
+///
+/// Two operators are provided: DenseOperator wrapping an already computed
+/// matrix, and EpsilonOperator applying \f$ \epsilon = 1 - V\chi \f$ without
+/// ever forming \f$ \chi \f$. On top of them, estimate_loss() computes
+/// \f$ -\text{Im}\,\text{Tr}\,\epsilon^{-1} \f$ by Hutchinson's method,
+/// and loss_eigenpairs() the few eigenmodes with the largest loss using
+/// shift-invert Arnoldi.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace krylov {
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Outcome of an iterative solve.
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+struct SolverResult {
+	std::size_t iterations; ///< Number of operator applications.
+	_R          residual;   ///< Final relative residual \f$ |b - Ax|/|b| \f$.
+	bool        converged;
+};
+
+
+namespace {
+
+template <class _C>
+auto norm(std::size_t const n, _C const* x) -> utils::Base<_C>
+{
+	return std::sqrt(std::real(import::dot(n, x, 1, x, 1)));
+}
+
+// Computes a complex Givens rotation (c, s) such that
+// [c s; -conj(s) c] * (a, b)^T = (r, 0)^T.
+template <class _C>
+auto make_rotation(_C const a, _C const b, utils::Base<_C>& c, _C& s) -> void
+{
+	using _R = utils::Base<_C>;
+	auto const abs_a = std::abs(a);
+	if (abs_a == _R{0}) {
+		c = _R{0};
+		s = _C{1};
+		return;
+	}
+	auto const d = std::sqrt(std::norm(a) + std::norm(b));
+	c = abs_a / d;
+	s = (a / abs_a) * std::conj(b) / d;
+}
+
+} // unnamed namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Solves \f$ A x = b \f$ using restarted GMRES(m).
+
+/// Modified Gram-Schmidt is used for orthogonalisation and the Hessenberg
+/// least-squares problem is solved incrementally with Givens rotations, so
+/// the residual is known at every step without extra operator applications.
+///
+/// \param A         The operator.
+/// \param b         Right-hand side, \f$ N \f$ elements.
+/// \param x         On entry the initial guess, on exit the solution.
+/// \param restart   Dimension \f$ m \f$ of the Krylov subspace.
+/// \param tol       Relative residual at which to stop.
+/// \param max_iter  Maximal number of operator applications.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Operator, class _C>
+auto gmres( _Operator const& A, _C const* b, _C* x
+          , std::size_t const restart
+          , utils::Base<_C> const tol
+          , std::size_t const max_iter ) -> SolverResult<utils::Base<_C>>
+{
+	TCM_MEASURE( "krylov::gmres<" + boost::core::demangle(
+		typeid(_C).name()) + ">()" );
+	using _R = utils::Base<_C>;
+	assert(restart > 0);
+
+	auto const N      = A.size();
+	auto const b_norm = norm(N, b);
+	if (b_norm == _R{0}) {
+		std::fill_n(x, N, _C{0});
+		return {0, _R{0}, true};
+	}
+
+	Matrix<_C>      V{N, restart + 1};
+	Matrix<_C>      H{restart + 1, restart};
+	std::vector<_R> cs(restart);
+	std::vector<_C> sn(restart);
+	std::vector<_C> g(restart + 1);
+
+	std::size_t iterations = 0;
+	_R          residual   = std::numeric_limits<_R>::infinity();
+	while (iterations < max_iter) {
+		// r = b - A x
+		A(x, V.data(0, 0));
+		++iterations;
+		for (std::size_t i = 0; i < N; ++i)
+			V(i, 0) = b[i] - V(i, 0);
+		auto const beta = norm(N, V.data(0, 0));
+		residual = beta / b_norm;
+		if (residual <= tol) break;
+
+		std::for_each( V.begin_column(0), V.end_column(0)
+		             , [beta](auto& v) { v /= beta; } );
+		std::fill(std::begin(g), std::end(g), _C{0});
+		g[0] = beta;
+
+		std::size_t k = 0;
+		for (; k < restart and iterations < max_iter; ++k) {
+			A(V.data(0, k), V.data(0, k + 1));
+			++iterations;
+			for (std::size_t i = 0; i <= k; ++i) {
+				H(i, k) = import::dot(N, V.data(0, i), 1, V.data(0, k + 1), 1);
+				import::axpy(N, -H(i, k), V.data(0, i), 1, V.data(0, k + 1), 1);
+			}
+			H(k + 1, k) = norm(N, V.data(0, k + 1));
+			if (H(k + 1, k) != _C{0}) {
+				auto const scale = _C{1} / H(k + 1, k);
+				std::for_each( V.begin_column(k + 1), V.end_column(k + 1)
+				             , [scale](auto& v) { v *= scale; } );
+			}
+
+			for (std::size_t i = 0; i < k; ++i) {
+				auto const t = cs[i] * H(i, k) + sn[i] * H(i + 1, k);
+				H(i + 1, k)  = -std::conj(sn[i]) * H(i, k) + cs[i] * H(i + 1, k);
+				H(i, k)      = t;
+			}
+			make_rotation(H(k, k), H(k + 1, k), cs[k], sn[k]);
+			H(k, k)     = cs[k] * H(k, k) + sn[k] * H(k + 1, k);
+			H(k + 1, k) = _C{0};
+			g[k + 1]    = -std::conj(sn[k]) * g[k];
+			g[k]        = cs[k] * g[k];
+
+			residual = std::abs(g[k + 1]) / b_norm;
+			if (residual <= tol) { ++k; break; }
+		}
+
+		// Back substitution for the upper triangular H(0:k, 0:k) y = g.
+		for (std::size_t i = k; i-- > 0; ) {
+			for (std::size_t j = i + 1; j < k; ++j)
+				g[i] -= H(i, j) * g[j];
+			g[i] /= H(i, i);
+		}
+		for (std::size_t j = 0; j < k; ++j)
+			import::axpy(N, g[j], V.data(0, j), 1, x, 1);
+
+		if (residual <= tol) break;
+	}
+
+	return {iterations, residual, residual <= tol};
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Solves \f$ A x = b \f$ using BiCGStab.
+
+/// Unlike gmres() memory usage does not grow with the number of iterations,
+/// but each iteration costs two operator applications and convergence is
+/// not monotonic.
+///
+/// \param A         The operator.
+/// \param b         Right-hand side, \f$ N \f$ elements.
+/// \param x         On entry the initial guess, on exit the solution.
+/// \param tol       Relative residual at which to stop.
+/// \param max_iter  Maximal number of operator applications.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Operator, class _C>
+auto bicgstab( _Operator const& A, _C const* b, _C* x
+             , utils::Base<_C> const tol
+             , std::size_t const max_iter ) -> SolverResult<utils::Base<_C>>
+{
+	TCM_MEASURE( "krylov::bicgstab<" + boost::core::demangle(
+		typeid(_C).name()) + ">()" );
+	using _R = utils::Base<_C>;
+
+	auto const N      = A.size();
+	auto const b_norm = norm(N, b);
+	if (b_norm == _R{0}) {
+		std::fill_n(x, N, _C{0});
+		return {0, _R{0}, true};
+	}
+
+	std::vector<_C> r(N), r0(N), p(N, _C{0}), v(N, _C{0}), s(N), t(N);
+	A(x, r.data());
+	std::size_t iterations = 1;
+	for (std::size_t i = 0; i < N; ++i)
+		r[i] = b[i] - r[i];
+	r0 = r;
+
+	_C rho   = _C{1};
+	_C alpha = _C{1};
+	_C omega = _C{1};
+	_R residual = norm(N, r.data()) / b_norm;
+	while (residual > tol and iterations + 2 <= max_iter) {
+		auto const rho_new = import::dot(N, r0.data(), 1, r.data(), 1);
+		if (rho_new == _C{0}) break; // breakdown
+		auto const beta = (rho_new / rho) * (alpha / omega);
+		rho = rho_new;
+		for (std::size_t i = 0; i < N; ++i)
+			p[i] = r[i] + beta * (p[i] - omega * v[i]);
+
+		A(p.data(), v.data());
+		alpha = rho / import::dot(N, r0.data(), 1, v.data(), 1);
+		for (std::size_t i = 0; i < N; ++i)
+			s[i] = r[i] - alpha * v[i];
+
+		A(s.data(), t.data());
+		iterations += 2;
+		auto const tt = import::dot(N, t.data(), 1, t.data(), 1);
+		omega = tt == _C{0} ? _C{0}
+		                    : import::dot(N, t.data(), 1, s.data(), 1) / tt;
+		for (std::size_t i = 0; i < N; ++i) {
+			x[i] += alpha * p[i] + omega * s[i];
+			r[i]  = s[i] - omega * t[i];
+		}
+		residual = norm(N, r.data()) / b_norm;
+		if (omega == _C{0}) break; // breakdown
+	}
+
+	return {iterations, residual, residual <= tol};
+}
+
+
+
+
+// ============================================================================
+//                                 OPERATORS
+// ============================================================================
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Wraps a matrix as an operator. The matrix is not copied.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C>
+class DenseOperator {
+	Matrix<_C> const& _A;
+
+public:
+	explicit DenseOperator(Matrix<_C> const& A) : _A{A}
+	{ assert(is_square(A)); }
+
+	auto size() const noexcept -> std::size_t { return _A.height(); }
+
+	auto operator()(_C const* x, _C* y) const -> void
+	{
+		import::gemv( blas::Operator::None, _A.height(), _A.width()
+		            , _C{1}, _A.data(), _A.ldim(), x, 1
+		            , _C{0}, y, 1 );
+	}
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Applies \f$ \epsilon(\omega) = 1 - V\chi(\omega) \f$ without
+/// forming \f$ \chi(\omega) \f$.
+
+/// From \f$ \chi_{a,b} = 2\sum_{i,j} G_{i,j}\Psi_{a,i}\Psi^*_{a,j}
+/// \Psi^*_{b,i}\Psi_{b,j} \f$ it follows that
+/// \f[
+///     \chi x = 2\,\text{diag}\left(\Psi\,(G\circ\rho)\,\Psi^\dagger\right),
+///     \quad \rho = \Psi^\dagger\,\text{diag}(x)\,\Psi,
+/// \f]
+/// i.e. only \f$ G(\omega) \f$ has to be kept in memory rather than
+/// \f$ \chi \f$ and \f$ \epsilon \f$.
+///
+/// This trades memory for time: one application costs two \f$ N\times M
+/// \times M \f$ `?GEMM`s, \f$ 16NM^2 \f$ real FLOPs, against \f$ 8N^2 \f$
+/// for a stored \f$ \epsilon \f$. With \f$ M \approx N \f$ that is
+/// \f$ \mathcal{O}(N^3) \f$ per application, and the hundreds to thousands
+/// of applications of a shift-invert Arnoldi run (every one of its steps is
+/// a GMRES solve) cost far more than building \f$ \epsilon \f$ and calling
+/// `?GEEV` once. Use it only when \f$ \epsilon \f$ does not fit.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C>
+class EpsilonOperator {
+	using _R = utils::Base<_C>;
+
+	Matrix<_C>         _Psi;
+	Matrix<_C> const&  _V;
+	Matrix<_C>         _G;
+	mutable Matrix<_C> _D;
+	mutable Matrix<_C> _K;
+	mutable Matrix<_C> _chi_x;
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	/// \param omega  Frequency \f$ \omega \f$.
+	/// \param E      Eigenenergies, \f$ M \times 1 \f$.
+	/// \param Psi    Eigenstates, \f$ N \times M \f$. Real eigenstates are
+	///               converted to complex once.
+	/// \param V      Coulomb potential, \f$ N \times N \f$. It is not copied.
+	/// \param cs     Constants, see tcm::g_function::make().
+	/// \param lg     The logger.
+	///////////////////////////////////////////////////////////////////////////
+	template <class _Number, class _F, class _T, class _Logger>
+	EpsilonOperator( _Number const omega
+	               , Matrix<_F> const& E
+	               , Matrix<_T> const& Psi
+	               , Matrix<_C> const& V
+	               , std::map<std::string, _R> const& cs
+	               , _Logger & lg )
+		: _Psi{Psi.height(), Psi.width()}
+		, _V{V}
+		, _G{Psi.width(), Psi.width()}
+		, _D{Psi.height(), Psi.width()}
+		, _K{Psi.width(), Psi.width()}
+		, _chi_x{Psi.height(), 1}
+	{
+		assert(is_column(E));
+		assert(is_square(V));
+		assert(E.height() == Psi.width());
+		assert(V.height() == Psi.height());
+		for (std::size_t j = 0; j < Psi.width(); ++j)
+			std::transform( Psi.cbegin_column(j), Psi.cend_column(j)
+			              , _Psi.begin_column(j)
+			              , [](auto const z) { return static_cast<_C>(z); } );
+		auto const G = g_function::make(omega, E, cs, lg);
+		for (std::size_t j = 0; j < G.width(); ++j)
+			std::transform( G.cbegin_column(j), G.cend_column(j)
+			              , _G.begin_column(j)
+			              , [](auto const z) { return static_cast<_C>(z); } );
+	}
+
+	auto size() const noexcept -> std::size_t { return _Psi.height(); }
+
+	auto operator()(_C const* x, _C* y) const -> void
+	{
+		TCM_MEASURE( "krylov::EpsilonOperator<" + boost::core::demangle(
+			typeid(_C).name()) + ">::operator()" );
+		auto const N = _Psi.height();
+		auto const M = _Psi.width();
+
+		for (std::size_t j = 0; j < M; ++j)
+			for (std::size_t i = 0; i < N; ++i)
+				_D(i, j) = x[i] * _Psi(i, j);
+		blas::gemm( blas::Operator::H, blas::Operator::None
+		          , _C{1}, _Psi, _D, _C{0}, _K );
+		for (std::size_t j = 0; j < M; ++j)
+			for (std::size_t i = 0; i < M; ++i)
+				_K(i, j) *= _G(i, j);
+		blas::gemm( blas::Operator::None, blas::Operator::None
+		          , _C{1}, _Psi, _K, _C{0}, _D );
+
+		std::fill(_chi_x.begin_column(0), _chi_x.end_column(0), _C{0});
+		for (std::size_t j = 0; j < M; ++j)
+			for (std::size_t i = 0; i < N; ++i)
+				_chi_x(i, 0) += _D(i, j) * std::conj(_Psi(i, j));
+
+		// y = x - V (chi x), remembering the factor 2 in chi.
+		std::copy_n(x, N, y);
+		import::gemv( blas::Operator::None, N, N
+		            , _C{-2}, _V.data(), _V.ldim(), _chi_x.data(), 1
+		            , _C{1}, y, 1 );
+	}
+};
+
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Applies \f$ (A - \sigma)^{-1} \f$ using a dense LU factorisation.
+
+/// The factorisation is computed once in the constructor, each application
+/// is then just a `?GETRS` call.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C>
+class ShiftInvertLU {
+	Matrix<_C>       _LU;
+	std::vector<lapack::lapack_int> _ipiv;
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	/// \param A      Matrix \f$ A \f$. It is overwritten by the factorisation.
+	/// \param sigma  Shift \f$ \sigma \f$.
+	///////////////////////////////////////////////////////////////////////////
+	ShiftInvertLU(Matrix<_C>&& A, _C const sigma) : _LU{std::move(A)}
+	{
+		assert(is_square(_LU));
+		for (std::size_t i = 0; i < _LU.height(); ++i)
+			_LU(i, i) -= sigma;
+		lapack::getrf(_LU, _ipiv);
+	}
+
+	auto size() const noexcept -> std::size_t { return _LU.height(); }
+
+	auto operator()(_C const* x, _C* y) const -> void
+	{
+		std::copy_n(x, size(), y);
+		lapack::getrs( 'N', size(), 1, _LU.data(), _LU.ldim()
+		             , _ipiv.data(), y, size() );
+	}
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Applies \f$ (A - \sigma)^{-1} \f$ by solving with gmres(), i.e.
+/// \f$ A \f$ is only ever applied to vectors.
+
+/// Inner solves must be considerably more accurate than the outer
+/// eigensolver tolerance, otherwise Ritz values stagnate.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Operator, class _C>
+class ShiftInvertKrylov {
+	using _R = utils::Base<_C>;
+
+	_Operator const& _A;
+	_C               _sigma;
+	std::size_t      _restart;
+	_R               _tol;
+	std::size_t      _max_iter;
+	mutable std::vector<_C> _temp;
+	mutable std::size_t     _applications = 0;
+	mutable std::size_t     _failures     = 0;
+
+	struct _Shifted {
+		ShiftInvertKrylov const& self;
+
+		auto size() const noexcept -> std::size_t { return self._A.size(); }
+
+		auto operator()(_C const* x, _C* y) const -> void
+		{
+			self._A(x, y);
+			import::axpy(size(), -self._sigma, x, 1, y, 1);
+		}
+	};
+
+public:
+	ShiftInvertKrylov( _Operator const& A, _C const sigma
+	                 , std::size_t const restart = 50
+	                 , _R const tol = 1E-12
+	                 , std::size_t const max_iter = 2000 )
+		: _A{A}, _sigma{sigma}
+		, _restart{restart}, _tol{tol}, _max_iter{max_iter}
+	{}
+
+	auto size() const noexcept -> std::size_t { return _A.size(); }
+
+	auto operator()(_C const* x, _C* y) const -> void
+	{
+		std::fill_n(y, size(), _C{0});
+		auto const result = gmres( _Shifted{*this}, x, y
+		                         , _restart, _tol, _max_iter );
+		_applications += result.iterations;
+		if (not result.converged) ++_failures;
+	}
+
+	/// Total number of applications of \f$ A \f$ so far.
+	auto applications() const noexcept { return _applications; }
+
+	/// Number of inner solves that did not reach the tolerance.
+	auto failures() const noexcept { return _failures; }
+};
+
+
+
+
+// ============================================================================
+//                             TRACE ESTIMATION
+// ============================================================================
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Parameters of estimate_loss().
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+struct TraceOptions {
+	std::size_t min_probes  = 10;
+	std::size_t max_probes  = 200;
+	_R          rel_error   = 0.01; ///< Target relative half-width of the CI.
+	_R          confidence  = 1.96; ///< z-score of the CI, 1.96 means 95%.
+	_R          solver_tol  = 1e-8;
+	std::size_t restart     = 50;
+	std::size_t max_iter    = 1000;
+	bool        use_gmres   = true; ///< GMRES(m) if true, BiCGStab otherwise.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Result of estimate_loss().
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+struct TraceEstimate {
+	_R          value;      ///< Estimate of \f$ -\text{Im}\,\text{Tr}\,A^{-1} \f$.
+	_R          error;      ///< Half-width of the confidence interval.
+	std::size_t probes;
+	std::size_t iterations; ///< Total number of operator applications.
+	bool        converged;  ///< Whether the requested error was reached.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Estimates \f$ -\text{Im}\,\text{Tr}\,A^{-1} \f$ using Hutchinson's
+/// method with Rademacher probes.
+
+/// For random \f$ z \f$ with independent \f$ \pm 1 \f$ entries
+/// \f$ \mathbb{E}[z^\dagger A^{-1} z] = \text{Tr}\,A^{-1} \f$. Each sample
+/// costs one Krylov solve \f$ A y = z \f$. Probes are added until the
+/// half-width of the confidence interval drops below
+/// `opts.rel_error * |value|` (but at least `opts.min_probes` and at most
+/// `opts.max_probes` are used).
+///
+/// \param A    The operator, e.g. EpsilonOperator.
+/// \param opts Parameters.
+/// \param gen  Random number generator.
+/// \param lg   The logger.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Operator, class _R, class _Generator, class _Logger>
+auto estimate_loss( _Operator const& A
+                  , TraceOptions<_R> const& opts
+                  , _Generator& gen
+                  , _Logger & lg ) -> TraceEstimate<_R>
+{
+	using _C = std::complex<_R>;
+	TCM_MEASURE( "krylov::estimate_loss<" + boost::core::demangle(
+		typeid(_C).name()) + ">()" );
+	assert(opts.min_probes >= 2 and opts.min_probes <= opts.max_probes);
+
+	auto const N = A.size();
+	std::vector<_C> z(N), y(N);
+	std::bernoulli_distribution coin;
+
+	// Welford's online mean and variance.
+	_R          mean = 0;
+	_R          m2   = 0;
+	_R          half_width = std::numeric_limits<_R>::infinity();
+	std::size_t iterations = 0;
+	std::size_t s = 0;
+	while (s < opts.max_probes) {
+		std::generate( std::begin(z), std::end(z)
+		             , [&coin, &gen]() { return coin(gen) ? _C{1} : _C{-1}; } );
+		std::fill(std::begin(y), std::end(y), _C{0});
+
+		auto const result = opts.use_gmres
+			? gmres( A, z.data(), y.data(), opts.restart
+			       , opts.solver_tol, opts.max_iter )
+			: bicgstab(A, z.data(), y.data(), opts.solver_tol, opts.max_iter);
+		iterations += result.iterations;
+		if (not result.converged) {
+			LOG(lg, warning) << "Krylov solver did not converge: residual = "
+			                 << result.residual << " after "
+			                 << result.iterations << " iterations.";
+		}
+
+		auto const sample = -std::imag(import::dot(N, z.data(), 1, y.data(), 1));
+		++s;
+		auto const delta = sample - mean;
+		mean += delta / static_cast<_R>(s);
+		m2   += delta * (sample - mean);
+
+		if (s >= opts.min_probes) {
+			half_width = opts.confidence
+				* std::sqrt(m2 / static_cast<_R>((s - 1) * s));
+			if (half_width <= opts.rel_error * std::abs(mean)) break;
+		}
+	}
+
+	LOG(lg, debug) << "Trace estimate: " << mean << " +/- " << half_width
+	               << " after " << s << " probes.";
+	return { mean, half_width, s, iterations
+	       , half_width <= opts.rel_error * std::abs(mean) };
+}
+
+
+
+
+// ============================================================================
+//                               EIGENSOLVERS
+// ============================================================================
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Parameters of arnoldi().
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+struct ArnoldiOptions {
+	std::size_t count        = 2;     ///< Number \f$ k \f$ of wanted eigenpairs.
+	std::size_t subspace     = 0;     ///< \f$ m \f$, 0 means \f$ \max(2k+1, 20) \f$.
+	_R          tol          = 1E-10; ///< Relative accuracy of Ritz values.
+	std::size_t max_restarts = 300;
+	unsigned    seed         = 42;    ///< Seed for the starting vector.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A few eigenpairs of an operator.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C>
+struct EigenResult {
+	Matrix<_C>  values;       ///< \f$ k\times 1 \f$.
+	Matrix<_C>  vectors;      ///< \f$ N\times k \f$, normalised columns.
+	std::size_t restarts;
+	std::size_t applications; ///< Number of operator applications.
+	bool        converged;
+};
+
+
+namespace {
+
+// Extends the Arnoldi factorisation A V(:, 0:k) = V(:, 0:k) H(0:k, 0:k)
+// + f e_k^T to size m. Classical Gram-Schmidt is repeated once (DGKS) which
+// keeps V orthonormal to working precision. Returns the size actually
+// reached, which is smaller than m only if an invariant subspace was found.
+template <class _Operator, class _C>
+auto arnoldi_extend( _Operator const& A
+                   , Matrix<_C>& V, Matrix<_C>& H, std::vector<_C>& f
+                   , std::size_t const k, std::size_t const m
+                   , std::size_t& applications ) -> std::size_t
+{
+	using _R = utils::Base<_C>;
+	auto const N = A.size();
+	std::vector<_C> h(m);
+
+	for (std::size_t j = k; j < m; ++j) {
+		if (j > 0) {
+			auto const beta = norm(N, f.data());
+			if (beta <= std::numeric_limits<_R>::epsilon() * static_cast<_R>(N)) return j;
+			H(j, j - 1) = beta;
+			std::transform( std::begin(f), std::end(f), V.begin_column(j)
+			              , [beta](auto const x) { return x / beta; } );
+		}
+
+		A(V.data(0, j), f.data());
+		++applications;
+		for (std::size_t pass = 0; pass < 2; ++pass) {
+			import::gemv( blas::Operator::H, N, j + 1
+			            , _C{1}, V.data(), V.ldim(), f.data(), 1
+			            , _C{0}, h.data(), 1 );
+			import::gemv( blas::Operator::None, N, j + 1
+			            , _C{-1}, V.data(), V.ldim(), h.data(), 1
+			            , _C{1}, f.data(), 1 );
+			for (std::size_t i = 0; i <= j; ++i)
+				H(i, j) += h[i];
+		}
+	}
+	return m;
+}
+
+// Performs one step of the shifted QR algorithm on the upper Hessenberg
+// H(0:m, 0:m): H := Q^H H Q where H - mu = QR. Q is accumulated into U.
+template <class _C>
+auto shifted_qr_step( Matrix<_C>& H, Matrix<_C>& U
+                    , std::size_t const m, _C const mu ) -> void
+{
+	using _R = utils::Base<_C>;
+	std::vector<_R> cs(m);
+	std::vector<_C> sn(m);
+
+	for (std::size_t i = 0; i < m; ++i)
+		H(i, i) -= mu;
+	for (std::size_t j = 0; j + 1 < m; ++j) {
+		make_rotation(H(j, j), H(j + 1, j), cs[j], sn[j]);
+		for (std::size_t l = j; l < m; ++l) {
+			auto const t = cs[j] * H(j, l) + sn[j] * H(j + 1, l);
+			H(j + 1, l)  = -std::conj(sn[j]) * H(j, l) + cs[j] * H(j + 1, l);
+			H(j, l)      = t;
+		}
+	}
+	for (std::size_t j = 0; j + 1 < m; ++j) {
+		auto const rows = std::min(j + 2, m);
+		for (std::size_t l = 0; l < rows; ++l) {
+			auto const t   = H(l, j) * cs[j] + H(l, j + 1) * std::conj(sn[j]);
+			H(l, j + 1)    = -H(l, j) * sn[j] + H(l, j + 1) * cs[j];
+			H(l, j)        = t;
+		}
+		for (std::size_t l = 0; l < U.height(); ++l) {
+			auto const t   = U(l, j) * cs[j] + U(l, j + 1) * std::conj(sn[j]);
+			U(l, j + 1)    = -U(l, j) * sn[j] + U(l, j + 1) * cs[j];
+			U(l, j)        = t;
+		}
+	}
+	for (std::size_t i = 0; i < m; ++i)
+		H(i, i) += mu;
+}
+
+} // unnamed namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes \f$ k \f$ eigenpairs of a general operator using the
+/// implicitly restarted Arnoldi method.
+
+/// The wanted eigenvalues are the ones with the largest `key(theta)`. Each
+/// restart keeps the wanted part of an \f$ m \f$-dimensional Arnoldi
+/// factorisation by applying the \f$ m - k \f$ unwanted Ritz values as exact
+/// shifts (Sorensen, 1992), so memory is bounded by \f$ N(m + 1) \f$. The
+/// small \f$ m\times m \f$ Hessenberg eigenproblems are solved by
+/// lapack::geev().
+///
+/// \param A     The operator, e.g. ShiftInvertLU or ShiftInvertKrylov.
+/// \param key   Real-valued ranking of eigenvalues.
+/// \param opts  Parameters.
+/// \param lg    The logger.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Operator, class _Key, class _R, class _Logger>
+auto arnoldi( _Operator const& A, _Key&& key
+            , ArnoldiOptions<_R> const& opts
+            , _Logger & lg ) -> EigenResult<std::complex<_R>>
+{
+	using _C = std::complex<_R>;
+	TCM_MEASURE( "krylov::arnoldi<" + boost::core::demangle(
+		typeid(_C).name()) + ">()" );
+
+	auto const N = A.size();
+	auto const k = std::min(opts.count, N);
+	auto const m = std::min( N
+	                       , opts.subspace != 0
+	                             ? std::max(opts.subspace, k + 1)
+	                             : std::max<std::size_t>(2 * k + 1, 20) );
+	if (k == 0) {
+		throw std::invalid_argument{"At least one eigenpair is required."};
+	}
+
+	Matrix<_C>      V{N, m};
+	Matrix<_C>      H{m, m};
+	std::vector<_C> f(N);
+	std::fill(H.data(), H.data() + H.ldim() * m, _C{0});
+	{
+		std::mt19937 gen{opts.seed};
+		std::normal_distribution<_R> normal;
+		std::generate( V.begin_column(0), V.end_column(0)
+		             , [&]() { return _C{normal(gen), normal(gen)}; } );
+		auto const beta = norm(N, V.data(0, 0));
+		std::for_each( V.begin_column(0), V.end_column(0)
+		             , [beta](auto& v) { v /= beta; } );
+	}
+
+	std::size_t applications = 0;
+	std::size_t start        = 0;
+	Matrix<_C>  theta{m, 1};
+	Matrix<_C>  Y{m, m};
+	std::vector<std::size_t> order(m);
+	lapack::Workspace<> workspace;
+	for (std::size_t restart = 0; ; ++restart) {
+		auto const size = arnoldi_extend(A, V, H, f, start, m, applications);
+
+		// Ritz pairs of the current factorisation.
+		Matrix<_C> _H{size, size};
+		Matrix<_C> _theta{size, 1};
+		Matrix<_C> _Y{size, size};
+		for (std::size_t j = 0; j < size; ++j)
+			std::copy_n(H.data(0, j), size, _H.data(0, j));
+		lapack::geev(_H, _theta, _Y, workspace);
+
+		order.resize(size);
+		std::iota(std::begin(order), std::end(order), 0);
+		std::stable_sort( std::begin(order), std::end(order)
+		                , [&_theta, &key](auto const a, auto const b)
+		                  { return key(_theta(a, 0)) > key(_theta(b, 0)); } );
+
+		auto const beta = size < m ? _R{0} : norm(N, f.data());
+		auto const converged = std::all_of( std::begin(order)
+		                                  , std::begin(order) + std::min(k, size)
+		                                  , [&](auto const i) {
+			auto const bound = std::max( std::numeric_limits<_R>::epsilon()
+			                           , opts.tol * std::abs(_theta(i, 0)) );
+			return beta * std::abs(_Y(size - 1, i)) <= bound;
+		});
+
+		if (converged or size < m or restart >= opts.max_restarts) {
+			if (not converged and size == m) {
+				LOG(lg, warning) << "Arnoldi did not converge after "
+				                 << restart << " restarts.";
+			}
+			auto const count = std::min(k, size);
+			EigenResult<_C> result{ Matrix<_C>{count, 1}, Matrix<_C>{N, count}
+			                      , restart, applications
+			                      , converged or size < m };
+			for (std::size_t i = 0; i < count; ++i) {
+				auto const j = order[i];
+				result.values(i, 0) = _theta(j, 0);
+				import::gemv( blas::Operator::None, N, size
+				            , _C{1}, V.data(), V.ldim(), _Y.data(0, j), 1
+				            , _C{0}, result.vectors.data(0, i), 1 );
+				auto const scale = _R{1} / norm(N, result.vectors.data(0, i));
+				std::for_each( result.vectors.begin_column(i)
+				             , result.vectors.end_column(i)
+				             , [scale](auto& v) { v *= scale; } );
+			}
+			LOG(lg, debug) << "Arnoldi: " << restart << " restarts, "
+			               << applications << " applications.";
+			return result;
+		}
+
+		// Implicit restart with the unwanted Ritz values as shifts.
+		Matrix<_C> U{m, m};
+		for (std::size_t j = 0; j < m; ++j)
+			for (std::size_t i = 0; i < m; ++i)
+				U(i, j) = i == j ? _C{1} : _C{0};
+		for (std::size_t i = k; i < m; ++i)
+			shifted_qr_step(H, U, m, _theta(order[i], 0));
+
+		// V := V U(:, 0:k), f := V U(:, k) H(k, k-1) + f U(m-1, k-1)
+		Matrix<_C> _V{N, k + 1};
+		import::gemm( blas::Operator::None, blas::Operator::None
+		            , N, k + 1, m
+		            , _C{1}, V.data(), V.ldim(), U.data(), U.ldim()
+		            , _C{0}, _V.data(), _V.ldim() );
+		auto const sigma = U(m - 1, k - 1);
+		auto const h     = H(k, k - 1);
+		for (std::size_t i = 0; i < N; ++i)
+			f[i] = _V(i, k) * h + f[i] * sigma;
+		for (std::size_t j = 0; j < k; ++j)
+			std::copy(_V.cbegin_column(j), _V.cend_column(j), V.begin_column(j));
+		for (std::size_t j = 0; j < m; ++j)
+			for (std::size_t i = 0; i < m; ++i)
+				if (i >= k or j >= k) H(i, j) = _C{0};
+		start = k;
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Finds the \f$ k \f$ eigenmodes of \f$ \epsilon \f$ with the largest
+/// loss \f$ -\text{Im}(1/\lambda) \f$ using shift-invert Arnoldi.
+
+/// Plasmons correspond to eigenvalues \f$ \lambda \approx 0 \f$, which are
+/// interior and thus converge very slowly for \f$ \epsilon \f$ itself.
+/// Instead arnoldi() is applied to \f$ (\epsilon - \sigma)^{-1} \f$ whose
+/// eigenvalues \f$ \theta = 1/(\lambda - \sigma) \f$ are extremal.
+///
+/// \param inverse  Operator applying \f$ (\epsilon - \sigma)^{-1} \f$, i.e.
+///                 ShiftInvertLU or ShiftInvertKrylov.
+/// \param sigma    Shift \f$ \sigma \f$ used to construct \p inverse.
+/// \param opts     Parameters.
+/// \param lg       The logger.
+///
+/// \return Eigenpairs of \f$ \epsilon \f$ sorted by decreasing loss.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Operator, class _R, class _Logger>
+auto loss_eigenpairs( _Operator const& inverse
+                    , std::complex<_R> const sigma
+                    , ArnoldiOptions<_R> const& opts
+                    , _Logger & lg ) -> EigenResult<std::complex<_R>>
+{
+	using _C = std::complex<_R>;
+	auto const to_lambda = [sigma](_C const theta) {
+		return sigma + _C{1} / theta; };
+	auto const key = [&to_lambda](_C const theta) {
+		return theta == _C{0} ? -std::numeric_limits<_R>::infinity()
+		                      : -std::imag(_C{1} / to_lambda(theta)); };
+
+	auto result = arnoldi(inverse, key, opts, lg);
+	std::transform( result.values.cbegin_column(0)
+	              , result.values.cend_column(0)
+	              , result.values.begin_column(0), to_lambda );
+	return result;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Parameters of davidson().
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+struct DavidsonOptions {
+	std::size_t count    = 2;     ///< Number \f$ k \f$ of wanted eigenpairs.
+	std::size_t extra    = 2;     ///< Ritz vectors kept on restart on top of \f$ k \f$.
+	std::size_t subspace = 0;     ///< Maximal basis size, 0 means \f$ \max(3(k + \text{extra}), 20) \f$.
+	_R          tol      = 1E-10; ///< Relative residual of Ritz pairs.
+	std::size_t max_iter = 300;
+	unsigned    seed     = 42;    ///< Seed for padding the initial guess.
+};
+
+
+namespace {
+
+// Orthonormalises columns [first, last) of V against the preceding ones
+// using classical Gram-Schmidt repeated once. Numerically dependent columns
+// are dropped. If AV is not null, the same column operations are applied to
+// it, so that AV = A V is preserved. Returns the new number of columns.
+template <class _C>
+auto orthonormalize( Matrix<_C>& V, Matrix<_C>* AV
+                   , std::size_t const first, std::size_t const last )
+	-> std::size_t
+{
+	using _R = utils::Base<_C>;
+	auto const N = V.height();
+	std::vector<_C> h(last);
+
+	auto size = first;
+	for (std::size_t j = first; j < last; ++j) {
+		if (j != size) {
+			std::copy(V.cbegin_column(j), V.cend_column(j), V.begin_column(size));
+			if (AV != nullptr)
+				std::copy( AV->cbegin_column(j), AV->cend_column(j)
+				         , AV->begin_column(size) );
+		}
+		auto const original = norm(N, V.data(0, size));
+		for (std::size_t pass = 0; pass < 2 and size > 0; ++pass) {
+			import::gemv( blas::Operator::H, N, size
+			            , _C{1}, V.data(), V.ldim(), V.data(0, size), 1
+			            , _C{0}, h.data(), 1 );
+			import::gemv( blas::Operator::None, N, size
+			            , _C{-1}, V.data(), V.ldim(), h.data(), 1
+			            , _C{1}, V.data(0, size), 1 );
+			if (AV != nullptr)
+				import::gemv( blas::Operator::None, N, size
+				            , _C{-1}, AV->data(), AV->ldim(), h.data(), 1
+				            , _C{1}, AV->data(0, size), 1 );
+		}
+		auto const beta = norm(N, V.data(0, size));
+		if (not (beta > _R{1E-8} * original)) continue;
+		std::for_each( V.begin_column(size), V.end_column(size)
+		             , [beta](auto& x) { x /= beta; } );
+		if (AV != nullptr)
+			std::for_each( AV->begin_column(size), AV->end_column(size)
+			             , [beta](auto& x) { x /= beta; } );
+		++size;
+	}
+	return size;
+}
+
+} // unnamed namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes \f$ k \f$ eigenpairs of an operator using the block
+/// Davidson method, starting from the subspace spanned by \p guess.
+
+/// This is the method of choice when a good approximation of the wanted
+/// eigenvectors is known, e.g. eigenvectors at a neighbouring frequency.
+/// Each iteration performs a Rayleigh-Ritz projection onto the search space
+/// and expands it by the residuals of the unconverged wanted Ritz pairs
+/// (i.e. the correction equation is "solved" with the identity
+/// preconditioner). When the basis is full, it is restarted with the
+/// \f$ k + \text{extra} \f$ best Ritz vectors.
+///
+/// \param A      The operator, e.g. ShiftInvertLU or ShiftInvertKrylov.
+/// \param key    Real-valued ranking of eigenvalues (larger is better).
+/// \param guess  \f$ N\times l \f$ initial guess. Missing columns (up to
+///               \f$ k + \text{extra} \f$) are filled with random vectors.
+/// \param opts   Parameters.
+/// \param lg     The logger.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Operator, class _Key, class _R, class _Logger>
+auto davidson( _Operator const& A, _Key&& key
+             , Matrix<std::complex<_R>> const& guess
+             , DavidsonOptions<_R> const& opts
+             , _Logger & lg ) -> EigenResult<std::complex<_R>>
+{
+	using _C = std::complex<_R>;
+	TCM_MEASURE( "krylov::davidson<" + boost::core::demangle(
+		typeid(_C).name()) + ">()" );
+
+	auto const N = A.size();
+	auto const k = std::min(opts.count, N);
+	auto const p = std::min(k + opts.extra, N);
+	auto const m = std::min( N
+	                       , opts.subspace != 0
+	                             ? std::max(opts.subspace, p + k)
+	                             : std::max<std::size_t>(3 * p, 20) );
+	if (k == 0) {
+		throw std::invalid_argument{"At least one eigenpair is required."};
+	}
+	assert(guess.height() == N);
+
+	Matrix<_C> V{N, m};
+	Matrix<_C> AV{N, m};
+	{
+		std::mt19937 gen{opts.seed};
+		std::normal_distribution<_R> normal;
+		for (std::size_t j = 0; j < p; ++j) {
+			if (j < guess.width())
+				std::copy( guess.cbegin_column(j), guess.cend_column(j)
+				         , V.begin_column(j) );
+			else
+				std::generate( V.begin_column(j), V.end_column(j)
+				             , [&]() { return _C{normal(gen), normal(gen)}; } );
+		}
+	}
+	auto size = orthonormalize(V, static_cast<Matrix<_C>*>(nullptr), 0, p);
+	for (std::size_t j = 0; j < size; ++j)
+		A(V.data(0, j), AV.data(0, j));
+	std::size_t applications = size;
+
+	std::vector<std::size_t> order;
+	lapack::Workspace<> workspace;
+	for (std::size_t iteration = 1; ; ++iteration) {
+		// Rayleigh-Ritz: H = V^H A V = S diag(theta) S^-1.
+		Matrix<_C> H{size, size};
+		Matrix<_C> theta{size, 1};
+		Matrix<_C> S{size, size};
+		import::gemm( blas::Operator::H, blas::Operator::None
+		            , size, size, N
+		            , _C{1}, V.data(), V.ldim(), AV.data(), AV.ldim()
+		            , _C{0}, H.data(), H.ldim() );
+		lapack::geev(H, theta, S, workspace);
+		order.resize(size);
+		std::iota(std::begin(order), std::end(order), 0);
+		std::stable_sort( std::begin(order), std::end(order)
+		                , [&theta, &key](auto const a, auto const b)
+		                  { return key(theta(a, 0)) > key(theta(b, 0)); } );
+
+		// Wanted Ritz vectors X = V S and residuals R = A X - X theta.
+		auto const wanted = std::min(k, size);
+		Matrix<_C> X{N, wanted};
+		Matrix<_C> R{N, wanted};
+		std::vector<std::size_t> unconverged;
+		for (std::size_t i = 0; i < wanted; ++i) {
+			auto const t = theta(order[i], 0);
+			import::gemv( blas::Operator::None, N, size
+			            , _C{1}, V.data(), V.ldim(), S.data(0, order[i]), 1
+			            , _C{0}, X.data(0, i), 1 );
+			import::gemv( blas::Operator::None, N, size
+			            , _C{1}, AV.data(), AV.ldim(), S.data(0, order[i]), 1
+			            , _C{0}, R.data(0, i), 1 );
+			import::axpy(N, -t, X.data(0, i), 1, R.data(0, i), 1);
+			auto const bound = std::max( std::numeric_limits<_R>::epsilon()
+			                           , opts.tol * std::abs(t) );
+			if (norm(N, R.data(0, i)) > bound) unconverged.push_back(i);
+		}
+
+		auto const converged = unconverged.empty() and wanted == k;
+		if (converged or size == N or iteration >= opts.max_iter) {
+			if (not converged and size < N) {
+				LOG(lg, warning) << "Davidson did not converge after "
+				                 << iteration << " iterations.";
+			}
+			EigenResult<_C> result{ Matrix<_C>{wanted, 1}, std::move(X)
+			                      , iteration, applications
+			                      , converged or size == N };
+			for (std::size_t i = 0; i < wanted; ++i)
+				result.values(i, 0) = theta(order[i], 0);
+			LOG(lg, debug) << "Davidson: " << iteration << " iterations, "
+			               << applications << " applications.";
+			return result;
+		}
+
+		// Restart with the best Ritz vectors if the basis would overflow.
+		if (size + unconverged.size() > m) {
+			auto const keep = std::min(p, size);
+			Matrix<_C> _S{size, keep};
+			for (std::size_t j = 0; j < keep; ++j)
+				std::copy(S.cbegin_column(order[j]), S.cend_column(order[j]), _S.begin_column(j));
+			Matrix<_C> _V{N, keep};
+			Matrix<_C> _AV{N, keep};
+			import::gemm( blas::Operator::None, blas::Operator::None
+			            , N, keep, size
+			            , _C{1}, V.data(), V.ldim(), _S.data(), _S.ldim()
+			            , _C{0}, _V.data(), _V.ldim() );
+			import::gemm( blas::Operator::None, blas::Operator::None
+			            , N, keep, size
+			            , _C{1}, AV.data(), AV.ldim(), _S.data(), _S.ldim()
+			            , _C{0}, _AV.data(), _AV.ldim() );
+			for (std::size_t j = 0; j < keep; ++j) {
+				std::copy(_V.cbegin_column(j), _V.cend_column(j), V.begin_column(j));
+				std::copy(_AV.cbegin_column(j), _AV.cend_column(j), AV.begin_column(j));
+			}
+			size = orthonormalize(V, &AV, 0, keep);
+		}
+
+		// Expand the search space by the residuals.
+		auto const count = std::min(unconverged.size(), N - size);
+		for (std::size_t j = 0; j < count; ++j)
+			std::copy( R.cbegin_column(unconverged[j])
+			         , R.cend_column(unconverged[j])
+			         , V.begin_column(size + j) );
+		auto const new_size = orthonormalize
+			(V, static_cast<Matrix<_C>*>(nullptr), size, size + count);
+		if (new_size == size) {
+			LOG(lg, warning) << "Davidson stagnated after " << iteration
+			                 << " iterations.";
+			EigenResult<_C> result{ Matrix<_C>{wanted, 1}, std::move(X)
+			                      , iteration, applications, false };
+			for (std::size_t i = 0; i < wanted; ++i)
+				result.values(i, 0) = theta(order[i], 0);
+			return result;
+		}
+		for (std::size_t j = size; j < new_size; ++j)
+			A(V.data(0, j), AV.data(0, j));
+		applications += new_size - size;
+		size = new_size;
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Same as loss_eigenpairs(), but warm-started from \p guess using
+/// davidson().
+
+/// Typically \p guess are the eigenvectors at the previous frequency of a
+/// sweep. If Davidson fails to converge, the caller may fall back to the
+/// Arnoldi-based version.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Operator, class _R, class _Logger>
+auto loss_eigenpairs( _Operator const& inverse
+                    , std::complex<_R> const sigma
+                    , Matrix<std::complex<_R>> const& guess
+                    , DavidsonOptions<_R> const& opts
+                    , _Logger & lg ) -> EigenResult<std::complex<_R>>
+{
+	using _C = std::complex<_R>;
+	auto const to_lambda = [sigma](_C const theta) {
+		return sigma + _C{1} / theta; };
+	auto const key = [&to_lambda](_C const theta) {
+		return theta == _C{0} ? -std::numeric_limits<_R>::infinity()
+		                      : -std::imag(_C{1} / to_lambda(theta)); };
+
+	auto result = davidson(inverse, key, guess, opts, lg);
+	std::transform( result.values.cbegin_column(0)
+	              , result.values.cend_column(0)
+	              , result.values.begin_column(0), to_lambda );
+	return result;
+}
+
+
+} // namespace krylov
+
+} // namespace tcm
+
+
+#endif // TCM_KRYLOV_HPP
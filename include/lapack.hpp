@@ -1,6 +1,12 @@
 #ifndef TCM_LAPACK_HPP
 #define TCM_LAPACK_HPP
 
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <numeric>
+#include <algorithm>
+
 #include <matrix.hpp>
 #include <detail/hermitian.hpp>
 #include <detail/general.hpp>
@@ -75,6 +81,252 @@ auto heevr(_Matrix1& A, _Vector& W, _Matrix2& Z) -> void
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Same as #heevr() above, but reuses the workspace \p ws.
+///////////////////////////////////////////////////////////////////////////////
+template< class _Matrix1
+        , class _Matrix2
+        , class _Vector
+        , class _Alloc
+        >
+auto heevr(_Matrix1& A, _Vector& W, _Matrix2& Z, Workspace<_Alloc>& ws)
+	-> void
+{
+	auto const N = A.height();
+
+	assert(is_square(A));
+	assert(is_square(Z));
+	assert(is_column(W));
+	assert(W.height() == N);
+	assert(Z.height() == N);
+
+	lapack::heevr
+		( N
+		, A.data(), A.ldim()
+		, W.data()
+		, Z.data(), Z.ldim()
+		, ws );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Algorithms for the full Hermitian eigenproblem.
+///////////////////////////////////////////////////////////////////////////////
+enum class Eigensolver {
+	Auto,                   ///< Let choose_eigensolver() decide.
+	MRRR,                   ///< ?HEEVR
+	DivideAndConquer,       ///< ?HEEVD
+	MRRR2Stage,             ///< ?HEEVR_2STAGE, needs CONFIG_LAPACK_2STAGE.
+	DivideAndConquer2Stage, ///< ?HEEVD_2STAGE, needs CONFIG_LAPACK_2STAGE.
+};
+
+
+inline
+auto to_string(Eigensolver const solver) -> std::string
+{
+	switch (solver) {
+	case Eigensolver::Auto:                   return "auto";
+	case Eigensolver::MRRR:                   return "heevr";
+	case Eigensolver::DivideAndConquer:       return "heevd";
+	case Eigensolver::MRRR2Stage:             return "heevr-2stage";
+	case Eigensolver::DivideAndConquer2Stage: return "heevd-2stage";
+	}
+	return "unknown";
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Inverse of to_string(). Throws std::invalid_argument for unknown
+/// names and for two-stage solvers if CONFIG_LAPACK_2STAGE is not defined.
+///////////////////////////////////////////////////////////////////////////////
+inline
+auto parse_eigensolver(std::string const& name) -> Eigensolver
+{
+	for (auto const solver : { Eigensolver::Auto, Eigensolver::MRRR
+	                         , Eigensolver::DivideAndConquer
+	                         , Eigensolver::MRRR2Stage
+	                         , Eigensolver::DivideAndConquer2Stage }) {
+		if (name != to_string(solver)) continue;
+#ifndef CONFIG_LAPACK_2STAGE
+		if ( solver == Eigensolver::MRRR2Stage
+		     or solver == Eigensolver::DivideAndConquer2Stage ) {
+			throw std::invalid_argument{ "Eigensolver `" + name + "` "
+			                             "requires CONFIG_LAPACK_2STAGE." };
+		}
+#endif
+		return solver;
+	}
+	throw std::invalid_argument{"Invalid eigensolver `" + name + "`."};
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Picks an eigensolver for an \p n x \p n matrix given the number of
+/// \p threads BLAS will use.
+
+/// Divide-and-conquer spends most of its time in ?GEMM and wins once the
+/// matrix is large enough to keep several threads busy. MRRR needs less
+/// workspace and is faster for small matrices and single-threaded runs.
+/// Two-stage variants are never chosen automatically as reference LAPACK
+/// cannot compute eigenvectors with them.
+///////////////////////////////////////////////////////////////////////////////
+inline
+auto choose_eigensolver(std::size_t const n, std::size_t const threads)
+	-> Eigensolver
+{
+	return threads > 1 and n >= 2000 ? Eigensolver::DivideAndConquer
+	                                 : Eigensolver::MRRR;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes all eigenpairs of a Hermitian matrix \p A using the
+/// given \p solver. \p A is destroyed.
+
+/// A two-stage solver which turns out not to support eigenvectors (see
+/// #heevr_2stage()) falls back to its one-stage counterpart.
+///
+/// \return The solver that was actually used.
+///////////////////////////////////////////////////////////////////////////////
+template< class _Matrix1
+        , class _Matrix2
+        , class _Vector
+        , class _Alloc = typename _Matrix1::allocator_type
+        >
+auto diagonalize( _Matrix1& A, _Vector& W, _Matrix2& Z
+                , Eigensolver solver = Eigensolver::Auto
+                , std::size_t const threads = 1 ) -> Eigensolver
+{
+	using _T = typename _Matrix1::value_type;
+	auto const N = A.height();
+
+	assert(is_square(A));
+	assert(is_square(Z));
+	assert(is_column(W));
+	assert(W.height() == N);
+	assert(Z.height() == N);
+
+	if (solver == Eigensolver::Auto)
+		solver = choose_eigensolver(N, threads);
+
+	switch (solver) {
+#ifdef CONFIG_LAPACK_2STAGE
+	case Eigensolver::MRRR2Stage:
+		try {
+			lapack::heevr_2stage<_T, _Alloc>
+				(N, A.data(), A.ldim(), W.data(), Z.data(), Z.ldim());
+			return solver;
+		}
+		catch (std::invalid_argument&) {
+			// Arguments are checked before A is touched.
+		}
+		// fallthrough
+#endif
+	case Eigensolver::MRRR:
+		lapack::heevr<_T, _Alloc>
+			(N, A.data(), A.ldim(), W.data(), Z.data(), Z.ldim());
+		return Eigensolver::MRRR;
+#ifdef CONFIG_LAPACK_2STAGE
+	case Eigensolver::DivideAndConquer2Stage:
+		try {
+			lapack::heevd_2stage<_T, _Alloc>
+				(N, A.data(), A.ldim(), W.data(), true);
+			for (std::size_t j = 0; j < N; ++j)
+				std::copy(A.cbegin_column(j), A.cend_column(j), Z.begin_column(j));
+			return solver;
+		}
+		catch (std::invalid_argument&) {
+		}
+		// fallthrough
+#endif
+	case Eigensolver::DivideAndConquer:
+		lapack::heevd<_T, _Alloc>(N, A.data(), A.ldim(), W.data(), true);
+		for (std::size_t j = 0; j < N; ++j)
+			std::copy(A.cbegin_column(j), A.cend_column(j), Z.begin_column(j));
+		return Eigensolver::DivideAndConquer;
+	default:
+		throw std::invalid_argument{ "Eigensolver `" + to_string(solver)
+		                           + "` is not available." };
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes eigenpairs of a Hermitian matrix \p A with eigenvalues in
+/// \f$ (v_l, v_u] \f$.
+
+/// \p W and \p Z are replaced by \f$ m\times 1 \f$ and \f$ N\times m \f$
+/// matrices, where \f$ m \f$ is the number of eigenvalues found. Note that
+/// an \f$ N\times N \f$ workspace for \p Z is needed nevertheless, because
+/// \f$ m \f$ is not known in advance; use #heevr_index() to avoid it.
+///////////////////////////////////////////////////////////////////////////////
+template< class _Matrix1
+        , class _Matrix2
+        , class _Vector
+        , class _Alloc = typename _Matrix1::allocator_type
+        >
+auto heevr_interval( _Matrix1& A
+                   , utils::Base<typename _Matrix1::value_type> const vl
+                   , utils::Base<typename _Matrix1::value_type> const vu
+                   , _Vector& W, _Matrix2& Z ) -> void
+{
+	auto const N = A.height();
+	assert(is_square(A));
+
+	_Vector  _W{N, 1};
+	_Matrix2 _Z{N, N};
+	auto const m = lapack::heevr_interval<typename _Matrix1::value_type, _Alloc>
+		( N
+		, A.data(), A.ldim()
+		, vl, vu
+		, _W.data()
+		, _Z.data(), _Z.ldim() );
+
+	W = _Vector{m, 1};
+	Z = _Matrix2{N, m};
+	std::copy(_W.data(), _W.data() + m, W.data());
+	for (std::size_t j = 0; j < m; ++j)
+		std::copy(_Z.cbegin_column(j), _Z.cend_column(j), Z.begin_column(j));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the eigenpairs number \p il through \p iu (0-based,
+/// inclusive) of a Hermitian matrix \p A.
+
+/// \p W must be a \f$ m\times 1 \f$ and \p Z a \f$ N\times m \f$ matrix
+/// with \f$ m = iu - il + 1 \f$.
+///////////////////////////////////////////////////////////////////////////////
+template< class _Matrix1
+        , class _Matrix2
+        , class _Vector
+        , class _Alloc = typename _Matrix1::allocator_type
+        >
+auto heevr_index( _Matrix1& A
+                , std::size_t const il, std::size_t const iu
+                , _Vector& W, _Matrix2& Z ) -> void
+{
+	auto const N = A.height();
+	auto const m = iu - il + 1;
+
+	assert(is_square(A));
+	assert(il <= iu and iu < N);
+	assert(is_column(W));
+	assert(W.height() == m);
+	assert(Z.height() == N and Z.width() == m);
+
+	// ?HEEVR needs room for N eigenvalues even if only m are computed.
+	std::vector<utils::Base<typename _Matrix1::value_type>> _W(N);
+	lapack::heevr_index<typename _Matrix1::value_type, _Alloc>
+		( N
+		, A.data(), A.ldim()
+		, il, iu
+		, _W.data()
+		, Z.data(), Z.ldim() );
+	std::copy(_W.data(), _W.data() + m, W.data());
+}
+
+
 template< class _Matrix
         , class _Vector
         , class _Alloc = typename _Matrix::allocator_type 
@@ -122,6 +374,179 @@ auto geev(_Matrix1& A, _Vector& W, _Matrix2& Z) -> void
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Same as #geev() above, but reuses the workspace \p ws.
+///////////////////////////////////////////////////////////////////////////////
+template< class _Matrix1
+        , class _Matrix2
+        , class _Vector
+        , class _Alloc
+        >
+auto geev(_Matrix1& A, _Vector& W, _Matrix2& Z, Workspace<_Alloc>& ws)
+	-> void
+{
+	auto const N = A.height();
+
+	assert(is_square(A));
+	assert(is_square(Z));
+	assert(is_column(W));
+	assert(W.height() == N);
+	assert(Z.height() == N);
+
+	lapack::geev
+		( N
+		, A.data(), A.ldim()
+		, W.data()
+		, typename _Vector::pointer{}, 1
+		, Z.data(), Z.ldim()
+		, ws
+		);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the Cholesky factorisation \f$ A = L L^\dagger \f$ of a
+/// Hermitian positive definite matrix \p A in-place.
+
+/// On exit the lower triangle of \p A holds \f$ L \f$. The strictly upper
+/// triangle is zeroed, so that \p A can be used as a general matrix.
+///////////////////////////////////////////////////////////////////////////////
+template<class _Matrix>
+auto potrf(_Matrix& A) -> void
+{
+	assert(is_square(A));
+	lapack::potrf<typename _Matrix::value_type>
+		( A.height()
+		, A.data(), A.ldim() );
+	for (std::size_t j = 1; j < A.width(); ++j)
+		for (std::size_t i = 0; i < j; ++i)
+			A(i, j) = typename _Matrix::value_type{0};
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the LU factorisation of \p A in-place. \p ipiv is resized
+/// to hold the pivot indices.
+///////////////////////////////////////////////////////////////////////////////
+template<class _Matrix>
+auto getrf(_Matrix& A, std::vector<lapack_int>& ipiv) -> void
+{
+	ipiv.resize(std::min(A.height(), A.width()));
+	lapack::getrf<typename _Matrix::value_type>
+		( A.height(), A.width()
+		, A.data(), A.ldim()
+		, ipiv.data() );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Overwrites \p B with \f$ A^{-1} B \f$, where \p LU and \p ipiv
+/// are the output of #getrf(). All columns of \p B are solved for at once.
+///////////////////////////////////////////////////////////////////////////////
+template<class _Matrix1, class _Matrix2>
+auto getrs( _Matrix1 const& LU, std::vector<lapack_int> const& ipiv
+          , _Matrix2& B ) -> void
+{
+	static_assert( std::is_same< typename _Matrix1::value_type
+	                           , typename _Matrix2::value_type >::value
+	             , "Element types of matrices must match!" );
+	assert(is_square(LU));
+	assert(ipiv.size() == LU.height());
+	assert(B.height() == LU.height());
+
+	lapack::getrs<typename _Matrix1::value_type>
+		( 'N'
+		, LU.height(), B.width()
+		, LU.data(), LU.ldim()
+		, ipiv.data()
+		, B.data(), B.ldim() );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes all eigenvalues of a general matrix \p A, but right
+/// eigenvectors only for the `Z.width()` eigenvalues with the largest
+/// `key(lambda)`.
+
+/// Instead of back-transforming all \f$ N \f$ eigenvectors like #geev(),
+/// \p A is reduced to Hessenberg form (#gehrd()), the eigenvalues are
+/// computed without Schur vectors (#hseqr()), and the selected eigenvectors
+/// are obtained by inverse iteration (#hsein()) and transformed back
+/// (#unmhr()). \p A is destroyed.
+///
+/// \return Indices into \p W of the selected eigenvalues, sorted by
+/// decreasing key. Columns of \p Z (normalised) are in the same order.
+///////////////////////////////////////////////////////////////////////////////
+template< class _Matrix1
+        , class _Matrix2
+        , class _Vector
+        , class _Key
+        , class _Alloc = typename _Matrix1::allocator_type
+        >
+auto geev_selected(_Matrix1& A, _Vector& W, _Key&& key, _Matrix2& Z)
+	-> std::vector<std::size_t>
+{
+	using _T = typename _Matrix1::value_type;
+	auto const N = A.height();
+	auto const k = Z.width();
+
+	assert(is_square(A));
+	assert(is_column(W));
+	assert(W.height() == N);
+	assert(Z.height() == N);
+	assert(k <= N);
+
+	std::vector<_T> tau(std::max<std::size_t>(N, 2) - 1);
+	lapack::gehrd<_T, _Alloc>(N, A.data(), A.ldim(), tau.data());
+
+	{
+		// ?HSEQR destroys H, but ?HSEIN still needs it.
+		_Matrix1 H{N, N};
+		for (std::size_t j = 0; j < N; ++j)
+			for (std::size_t i = 0; i < N; ++i)
+				H(i, j) = i <= j + 1 ? A(i, j) : _T{0};
+		lapack::hseqr<_T, _Alloc>(N, H.data(), H.ldim(), W.data());
+	}
+
+	std::vector<std::size_t> order(N);
+	std::iota(std::begin(order), std::end(order), 0);
+	std::stable_sort( std::begin(order), std::end(order)
+	                , [&W, &key](auto const a, auto const b)
+	                  { return key(W(a, 0)) > key(W(b, 0)); } );
+	order.resize(k);
+
+	std::vector<lapack_int> select(N, 0);
+	for (auto const i : order)
+		select[i] = 1;
+	std::vector<_T> _W(W.data(), W.data() + N);
+	lapack::hsein<_T, _Alloc>( N, A.data(), A.ldim(), _W.data()
+	                         , select.data(), Z.data(), Z.ldim(), k );
+	lapack::unmhr<_T, _Alloc>( N, k, A.data(), A.ldim(), tau.data()
+	                         , Z.data(), Z.ldim() );
+
+	// ?HSEIN returns the eigenvectors in order of increasing index.
+	std::vector<std::size_t> column(N);
+	{
+		std::size_t c = 0;
+		for (std::size_t i = 0; i < N; ++i)
+			if (select[i]) column[i] = c++;
+	}
+	_Matrix2 _Z{N, k};
+	for (std::size_t j = 0; j < k; ++j) {
+		auto const from = column[order[j]];
+		auto const scale = 1 / std::sqrt(std::accumulate(
+			Z.cbegin_column(from), Z.cend_column(from), utils::Base<_T>{0}
+			, [](auto const acc, auto const x) { return acc + std::norm(x); } ));
+		std::transform( Z.cbegin_column(from), Z.cend_column(from)
+		              , _Z.begin_column(j)
+		              , [scale](auto const x) { return x * scale; } );
+	}
+	for (std::size_t j = 0; j < k; ++j)
+		std::copy(_Z.cbegin_column(j), _Z.cend_column(j), Z.begin_column(j));
+	return order;
+}
+
+
 
 } // namespace lapack
 
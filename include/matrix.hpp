@@ -3,6 +3,7 @@
 
 
 #include <cassert>
+#include <cmath>
 #include <complex>
 #include <memory>
 #include <type_traits>
@@ -390,6 +391,43 @@ constexpr
 auto is_square(_M const& A) noexcept -> bool {return A.width() == A.height();}
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Returns true if all imaginary parts of \p A are negligible, i.e.
+/// \f$ \max_{i,j} |\text{Im}\,A_{i,j}| \leq \text{tol}\cdot\max_{i,j}
+/// |A_{i,j}| \f$. Always true for real matrices.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T, std::size_t _Align, class _Alloc>
+auto is_real( Matrix<_T, _Align, _Alloc> const& A
+            , utils::Base<_T> const tol ) -> bool
+{
+	utils::Base<_T> max_abs  = 0;
+	utils::Base<_T> max_imag = 0;
+	for (std::size_t j = 0; j < A.width(); ++j) {
+		for (auto i = A.cbegin_column(j); i != A.cend_column(j); ++i) {
+			max_abs  = std::max(max_abs, std::abs(*i));
+			max_imag = std::max(max_imag, std::abs(std::imag(*i)));
+		}
+	}
+	return max_imag <= tol * max_abs;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Returns the real part of \p A.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T, std::size_t _Align, class _Alloc>
+auto real_part(Matrix<_T, _Align, _Alloc> const& A)
+	-> Matrix<utils::Base<_T>>
+{
+	Matrix<utils::Base<_T>> result{A.height(), A.width()};
+	for (std::size_t j = 0; j < A.width(); ++j)
+		std::transform( A.cbegin_column(j), A.cend_column(j)
+		              , result.begin_column(j)
+		              , [](auto const x) { return std::real(x); } );
+	return result;
+}
+
+
 template <class _T, std::size_t _Align, class _Alloc>
 auto operator<< (std::ostream& out, Matrix<_T, _Align, _Alloc> const& A) 
 	-> std::ostream&
@@ -0,0 +1,550 @@
+#ifndef TCM_MEMORY_HPP
+#define TCM_MEMORY_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <detail/config.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file memory.hpp
+/// \brief Accounting of the memory held by matrices and LAPACK buffers.
+///
+/// If #CONFIG_TRACK_MEMORY is defined, utils::_Storage (and hence every
+/// tcm::Matrix and lapack::Workspace) allocates through a #Tracked
+/// allocator. It keeps the live and peak number of bytes, both in total and
+/// per _tag_. The tag of an allocation is the one of the innermost
+/// #TCM_MEMORY_TAG scope that was active when its container was created,
+/// e.g. "G" for everything g_function::make() allocates. Timed regions (see
+/// benchmark.hpp) record the high-water mark reached while they ran, so
+/// that tcm::timing::report() shows the peak memory per phase.
+///
+/// Without #CONFIG_TRACK_MEMORY nothing is tracked and all functions report
+/// zeros.
+///
+/// Independently of tracking, an #Estimate predicts the peak from the sizes
+/// of the buffers that are alive at the same time, before anything is
+/// allocated.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace memory {
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Whether allocations are tracked.
+///////////////////////////////////////////////////////////////////////////////
+#ifdef CONFIG_TRACK_MEMORY
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Memory statistics of one tag.
+///////////////////////////////////////////////////////////////////////////////
+struct TagStats {
+	std::string   name;
+	std::uint64_t live;        ///< Bytes currently allocated.
+	std::uint64_t peak;        ///< Largest value of `live`.
+	std::uint64_t allocations; ///< Number of allocations so far.
+};
+
+
+namespace detail {
+
+/// \brief Counters of one tag. Updated atomically by all threads.
+struct Counters {
+	std::atomic<std::uint64_t> live{0};
+	std::atomic<std::uint64_t> peak{0};
+	std::atomic<std::uint64_t> allocations{0};
+};
+
+
+inline auto raise(std::atomic<std::uint64_t>& x, std::uint64_t const value)
+	noexcept -> void
+{
+	auto current = x.load(std::memory_order_relaxed);
+	while ( current < value
+	        and not x.compare_exchange_weak( current, value
+	                                       , std::memory_order_relaxed ) ) {
+	}
+}
+
+
+/// \brief Tags and their counters. Tag 0 is "untagged"; there is room for
+/// #max_tags tags, further ones are counted as "other".
+class Registry {
+public:
+	static constexpr std::size_t max_tags = 64;
+
+private:
+	std::mutex                                   _mutex;
+	std::vector<std::string>                     _names{"untagged"};
+	std::unordered_map<std::string, std::size_t> _ids{{"untagged", 0}};
+	std::array<Counters, max_tags>               _tags;
+	Counters                                     _total;
+	/// Peak since the innermost #Watermark was created.
+	std::atomic<std::uint64_t>                   _mark{0};
+
+public:
+	auto id(std::string name) -> std::size_t
+	{
+		std::lock_guard<std::mutex> lock{_mutex};
+		auto const i = _ids.find(name);
+		if (i != std::end(_ids)) return i->second;
+		if (_names.size() == max_tags - 1) _names.push_back("other");
+		if (_names.size() == max_tags) return max_tags - 1;
+		_names.push_back(name);
+		_ids.emplace(std::move(name), _names.size() - 1);
+		return _names.size() - 1;
+	}
+
+	auto allocate(std::size_t const tag, std::uint64_t const bytes) noexcept
+		-> void
+	{
+		auto constexpr relaxed = std::memory_order_relaxed;
+		auto& x = _tags[tag];
+		raise(x.peak, x.live.fetch_add(bytes, relaxed) + bytes);
+		x.allocations.fetch_add(1, relaxed);
+		auto const live = _total.live.fetch_add(bytes, relaxed) + bytes;
+		raise(_total.peak, live);
+		raise(_mark, live);
+		_total.allocations.fetch_add(1, relaxed);
+	}
+
+	auto deallocate(std::size_t const tag, std::uint64_t const bytes) noexcept
+		-> void
+	{
+		auto constexpr relaxed = std::memory_order_relaxed;
+		_tags[tag].live.fetch_sub(bytes, relaxed);
+		_total.live.fetch_sub(bytes, relaxed);
+	}
+
+	auto total() const noexcept -> Counters const& { return _total; }
+	auto mark() noexcept -> std::atomic<std::uint64_t>& { return _mark; }
+
+	auto tags() -> std::vector<TagStats>
+	{
+		std::lock_guard<std::mutex> lock{_mutex};
+		std::vector<TagStats> result;
+		auto constexpr relaxed = std::memory_order_relaxed;
+		for (std::size_t i = 0; i < _names.size(); ++i) {
+			result.push_back({ _names[i], _tags[i].live.load(relaxed)
+			                 , _tags[i].peak.load(relaxed)
+			                 , _tags[i].allocations.load(relaxed) });
+		}
+		return result;
+	}
+};
+
+
+/// \brief Intentionally leaked: containers may be destroyed during static
+/// destruction.
+inline auto registry() -> Registry&
+{
+	static auto* x = new Registry;
+	return *x;
+}
+
+
+inline auto current_tag() noexcept -> std::size_t&
+{
+	thread_local std::size_t x = 0;
+	return x;
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Returns the id of the tag called \p name. Ids are stable, so the
+/// result may be cached.
+///////////////////////////////////////////////////////////////////////////////
+inline auto register_tag(std::string name) -> std::size_t
+{
+	return detail::registry().id(std::move(name));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Makes tag \p id the current tag of this thread for its lifetime.
+///////////////////////////////////////////////////////////////////////////////
+class Scope {
+	std::size_t _previous;
+
+public:
+	explicit Scope(std::size_t const id) noexcept
+		: _previous{detail::current_tag()}
+	{ detail::current_tag() = id; }
+
+	Scope(Scope const&) = delete;
+	Scope& operator= (Scope const&) = delete;
+
+	~Scope() { detail::current_tag() = _previous; }
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Allocator adaptor that counts the bytes allocated through
+/// \p _Alloc.
+
+/// Every instance remembers the tag that was current when it was created
+/// (or of the allocator it was copied from), so that deallocations are
+/// subtracted from the same tag.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Alloc>
+class Tracked : public _Alloc {
+	using _Traits = std::allocator_traits<_Alloc>;
+
+	template <class> friend class Tracked;
+
+	std::size_t _tag;
+
+public:
+	using value_type      = typename _Traits::value_type;
+	using pointer         = typename _Traits::pointer;
+	using const_pointer   = typename _Traits::const_pointer;
+	using size_type       = typename _Traits::size_type;
+	using difference_type = typename _Traits::difference_type;
+
+	template <class _U>
+	struct rebind {
+		using other = Tracked<typename _Traits::template rebind_alloc<_U>>;
+	};
+
+	Tracked() noexcept(std::is_nothrow_default_constructible<_Alloc>::value)
+		: _Alloc{}, _tag{detail::current_tag()}
+	{}
+
+	template <class _U>
+	Tracked(Tracked<_U> const& other) noexcept
+		: _Alloc{other.inner()}, _tag{other._tag}
+	{}
+
+	template < class _U
+	         , class = std::enable_if_t<std::is_constructible<_Alloc, _U const&>::value>
+	         >
+	Tracked(_U const& inner) noexcept
+		: _Alloc{inner}, _tag{detail::current_tag()}
+	{}
+
+	auto inner() const noexcept -> _Alloc const& { return *this; }
+	auto inner() noexcept -> _Alloc& { return *this; }
+
+	/// \brief Copies of a container are charged to the current tag.
+	auto select_on_container_copy_construction() const -> Tracked
+	{
+		return Tracked{ _Traits::select_on_container_copy_construction(inner()) };
+	}
+
+	auto allocate(size_type const n) -> pointer
+	{
+		auto const p = _Traits::allocate(inner(), n);
+		detail::registry().allocate(_tag, n * sizeof(value_type));
+		return p;
+	}
+
+	auto deallocate(pointer const p, size_type const n) noexcept -> void
+	{
+		_Traits::deallocate(inner(), p, n);
+		detail::registry().deallocate(_tag, n * sizeof(value_type));
+	}
+
+	template <class _U>
+	auto operator==(Tracked<_U> const& other) const noexcept -> bool
+	{ return inner() == other.inner(); }
+
+	template <class _U>
+	auto operator!=(Tracked<_U> const& other) const noexcept -> bool
+	{ return not (*this == other); }
+};
+
+
+namespace detail {
+
+template <class _Alloc>
+struct tracked_impl { using type = Tracked<_Alloc>; };
+
+template <class _Alloc>
+struct tracked_impl<Tracked<_Alloc>> { using type = Tracked<_Alloc>; };
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief \p _Alloc wrapped in #Tracked if #CONFIG_TRACK_MEMORY is defined,
+/// otherwise \p _Alloc itself.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Alloc>
+using tracked_t = std::conditional_t< enabled
+                                    , typename detail::tracked_impl<_Alloc>::type
+                                    , _Alloc >;
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Bytes currently allocated through #Tracked allocators.
+///////////////////////////////////////////////////////////////////////////////
+inline auto live() noexcept -> std::uint64_t
+{ return detail::registry().total().live.load(std::memory_order_relaxed); }
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Largest value #live() has had.
+///////////////////////////////////////////////////////////////////////////////
+inline auto peak() noexcept -> std::uint64_t
+{ return detail::registry().total().peak.load(std::memory_order_relaxed); }
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Statistics of all tags, in order of registration.
+///////////////////////////////////////////////////////////////////////////////
+inline auto tags() -> std::vector<TagStats>
+{ return detail::registry().tags(); }
+
+
+namespace detail {
+
+/// \brief Starts a new high-water mark at the current #live(). Returns the
+/// enclosing one, which must be passed to #pop_mark().
+inline auto push_mark() noexcept -> std::uint64_t
+{ return registry().mark().exchange(live()); }
+
+/// \brief Ends the mark started by #push_mark() that returned \p saved.
+/// Returns its high-water mark.
+inline auto pop_mark(std::uint64_t const saved) noexcept -> std::uint64_t
+{
+	auto const peak = registry().mark().load(std::memory_order_relaxed);
+	raise(registry().mark(), saved);
+	return peak;
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Measures the high-water mark of #live() during its lifetime.
+
+/// Watermarks nest. They are exact as long as the lifetimes of all
+/// watermarks in the program nest, e.g. with one thread per process;
+/// otherwise #peak() may miss allocations made before another thread
+/// created its watermark.
+///////////////////////////////////////////////////////////////////////////////
+class Watermark {
+	std::uint64_t _saved;
+
+public:
+	Watermark() noexcept
+		: _saved{detail::push_mark()}
+	{}
+
+	Watermark(Watermark const&) = delete;
+	Watermark& operator= (Watermark const&) = delete;
+
+	~Watermark() { detail::pop_mark(_saved); }
+
+	/// \brief Largest #live() since construction.
+	auto peak() const noexcept -> std::uint64_t
+	{ return detail::registry().mark().load(std::memory_order_relaxed); }
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Formats \p bytes like "1.50 GiB".
+///////////////////////////////////////////////////////////////////////////////
+inline auto format_bytes(std::uint64_t const bytes) -> std::string
+{
+	char const* const units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+	auto x = static_cast<double>(bytes);
+	std::size_t unit = 0;
+	while (x >= 1024 and unit + 1 < std::extent<decltype(units)>::value) {
+		x /= 1024;
+		++unit;
+	}
+	char buffer[32];
+	std::snprintf( buffer, sizeof(buffer), unit == 0 ? "%.0f %s" : "%.2f %s"
+	             , x, units[unit] );
+	return buffer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Pretty-prints the statistics of all tags that were used.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Stream>
+auto report(_Stream& out) -> void
+{
+	auto stats = tags();
+	stats.erase( std::remove_if( std::begin(stats), std::end(stats)
+	                           , [](auto const& x) { return x.allocations == 0; } )
+	           , std::end(stats) );
+	std::stable_sort( std::begin(stats), std::end(stats)
+	                , [](auto const& a, auto const& b) { return a.peak > b.peak; } );
+	std::size_t width = 3;
+	for (auto const& x : stats) width = std::max(width, x.name.size());
+
+	auto const hline = std::string(width + 2 * 12 + 12 + 11, '-');
+	out << "[" << hline << "]\n";
+	out << "[ " << std::left << std::setw(width) << "tag" << std::right
+	    << " | " << std::setw(12) << "live"
+	    << " | " << std::setw(12) << "peak"
+	    << " | " << std::setw(12) << "allocations"
+	    << " ]\n";
+	out << "[" << hline << "]\n";
+	for (auto const& x : stats) {
+		out << "[ " << std::left << std::setw(width) << x.name << std::right
+		    << " | " << std::setw(12) << format_bytes(x.live)
+		    << " | " << std::setw(12) << format_bytes(x.peak)
+		    << " | " << std::setw(12) << x.allocations
+		    << " ]\n";
+	}
+	out << "[" << hline << "]\n";
+	out << "Total: " << format_bytes(live()) << " live, "
+	    << format_bytes(peak()) << " peak.\n";
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Bytes taken by an \p height x \p width Matrix of `_T`s, whose
+/// columns are padded to \p _Align bytes.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T, std::size_t _Align = 64>
+constexpr auto matrix_bytes(std::uint64_t const height, std::uint64_t const width)
+	noexcept -> std::uint64_t
+{
+	return ((height * sizeof(_T) + _Align - 1) / _Align) * _Align * width;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Predicted memory use of a computation.
+
+/// The computation is described by buffers that live throughout
+/// (#resident()) and a sequence of phases, each with the buffers it adds
+/// (#add()). The peak is the resident size plus that of the largest phase.
+///////////////////////////////////////////////////////////////////////////////
+class Estimate {
+public:
+	struct Item {
+		std::string   name;
+		std::uint64_t bytes;
+	};
+
+	struct Phase {
+		std::string       name;
+		std::vector<Item> items;
+
+		auto bytes() const noexcept -> std::uint64_t
+		{
+			std::uint64_t total = 0;
+			for (auto const& x : items) total += x.bytes;
+			return total;
+		}
+	};
+
+private:
+	Phase              _resident{"resident", {}};
+	std::vector<Phase> _phases;
+
+public:
+	/// \brief Adds a buffer that lives throughout the computation.
+	auto resident(std::string name, std::uint64_t const bytes) -> Estimate&
+	{
+		_resident.items.push_back({std::move(name), bytes});
+		return *this;
+	}
+
+	/// \brief Starts a new phase.
+	auto phase(std::string name) -> Estimate&
+	{
+		_phases.push_back({std::move(name), {}});
+		return *this;
+	}
+
+	/// \brief Adds a buffer to the current phase.
+	auto add(std::string name, std::uint64_t const bytes) -> Estimate&
+	{
+		if (_phases.empty()) phase("main");
+		_phases.back().items.push_back({std::move(name), bytes});
+		return *this;
+	}
+
+	auto resident() const noexcept -> Phase const& { return _resident; }
+	auto phases() const noexcept -> std::vector<Phase> const& { return _phases; }
+
+	/// \brief The phase with the largest memory use, or `nullptr`.
+	auto peak_phase() const noexcept -> Phase const*
+	{
+		auto const i = std::max_element
+			( std::begin(_phases), std::end(_phases)
+			, [](auto const& a, auto const& b) { return a.bytes() < b.bytes(); } );
+		return i != std::end(_phases) ? &*i : nullptr;
+	}
+
+	auto peak() const noexcept -> std::uint64_t
+	{
+		auto const* const p = peak_phase();
+		return _resident.bytes() + (p != nullptr ? p->bytes() : 0);
+	}
+
+	/// \brief Prints every phase with its total and buffers.
+	template <class _Stream>
+	auto print(_Stream& out) const -> void
+	{
+		auto const line = [&out](Phase const& p, std::uint64_t const base) {
+			out << "  " << p.name << ": " << format_bytes(base + p.bytes());
+			char const* separator = " (";
+			for (auto const& x : p.items) {
+				out << separator << x.name << " " << format_bytes(x.bytes);
+				separator = ", ";
+			}
+			out << (p.items.empty() ? "" : ")") << "\n";
+		};
+		line(_resident, 0);
+		for (auto const& p : _phases) line(p, _resident.bytes());
+		auto const* const p = peak_phase();
+		out << "  peak: " << format_bytes(peak())
+		    << (p != nullptr ? " during " + p->name : std::string{}) << "\n";
+	}
+};
+
+
+} // namespace memory
+
+} // namespace tcm
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Tags allocations until the end of the enclosing scope with
+/// \p tag_name.
+
+/// Does nothing unless #CONFIG_TRACK_MEMORY is defined. Like #TCM_MEASURE,
+/// \p tag_name is only evaluated once per call site.
+///////////////////////////////////////////////////////////////////////////////
+#ifdef CONFIG_TRACK_MEMORY
+#	define TCM_MEMORY_TAG(tag_name) \
+		static auto const _memory_tag_id_ = \
+			::tcm::memory::register_tag(tag_name); \
+		::tcm::memory::Scope _memory_tag_scope_{_memory_tag_id_}
+#else
+#	define TCM_MEMORY_TAG(tag_name) \
+		do {} while(false)
+#endif
+
+
+#endif // TCM_MEMORY_HPP
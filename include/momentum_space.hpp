@@ -0,0 +1,413 @@
+#ifndef TCM_MOMENTUM_SPACE_HPP
+#define TCM_MOMENTUM_SPACE_HPP
+
+#include <cmath>
+#include <cassert>
+
+#include <vector>
+#include <array>
+#include <map>
+#include <limits>
+#include <algorithm>
+
+#include <boost/core/demangle.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <benchmark.hpp>
+#include <logging.hpp>
+
+#include <constants.hpp>
+#include <matrix.hpp>
+#include <blas.hpp>
+#include <dielectric_function_v2.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file momentum_space.hpp
+/// \brief Tools to work with the response functions in the plane-wave basis.
+///
+/// \detail For loss spectra we only need the projection of \f$\chi(\omega)\f$
+/// onto a plane wave \f$ |q\rangle \f$:
+/// \f[
+///     \chi(q, \omega) = \langle q|\chi(\omega)|q\rangle
+///         = 2\sum_{i,j} |\rho_{i,j}(q)|^2 G_{i,j}(\omega),
+///     \quad \rho(q) = \Psi^\dagger\,\text{diag}(q)\,\Psi.
+/// \f]
+/// \f$ |\rho_{i,j}(q)|^2 \f$ is computed once per \f$ q \f$ using `?GEMM`,
+/// after which each frequency costs just \f$ \mathcal{O}(N^2) \f$.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the plane wave \f$ |q\rangle \f$ on the atomic sites.
+
+/// \f[ \langle r|q\rangle = (2\pi)^{-d/2}\exp(i q\cdot r). \f]
+///
+/// \tparam _Dim       Dimension \f$ d \f$ used for normalisation.
+/// \param wavevector  \f$ q \f$.
+/// \param positions   Positions of the atoms.
+/// \param pi          \f$ \pi \f$.
+///
+/// \return \f$ |q\rangle \f$ as a column vector.
+///////////////////////////////////////////////////////////////////////////////
+template < std::size_t _Dim = 3
+         , class _R1 = double
+         , class _R2 = double
+         , class _R3 = std::common_type_t<_R1, _R2>
+         >
+auto make_momentum_eigenvector( std::array<_R1, 3> const wavevector
+                              , std::vector<std::array<_R2, 3>> const& positions
+                              , _R3 const pi = _R3{M_PI} )
+{
+	using _R = std::common_type_t<_R1, _R2, _R3>;
+	using _C = std::complex<_R>;
+
+	auto const _norm =
+		std::pow(_R{2} * pi, -boost::numeric_cast<_R>(_Dim) / _R{2});
+	auto const _dot = [] (auto const& x, auto const& y) noexcept {
+		return x[0]*y[0] + x[1]*y[1] + x[2]*y[2];
+	};
+
+	tcm::Matrix<_C> q{positions.size(), 1};
+	std::transform( std::begin(positions), std::end(positions)
+	              , q.data()
+				  , [ _norm
+	                , &wavevector
+	                , _dot = std::cref(_dot)
+	                ] (auto const& r) {
+	                    return _norm * std::exp(_C{0, _dot(wavevector, r)});
+	                } );
+	return q;
+}
+
+
+namespace {
+template <class _R>
+auto is_uniform_grid(std::vector<_R> const& qs) noexcept -> bool
+{
+	if (qs.size() < 3) return qs.size() == 2;
+	auto const step = (qs.back() - qs.front()) / static_cast<_R>(qs.size() - 1);
+	auto const tol  = _R{64} * std::numeric_limits<_R>::epsilon()
+		* std::max(std::abs(qs.front()), std::abs(qs.back()));
+	for (std::size_t k = 0; k < qs.size(); ++k) {
+		if (std::abs(qs[k] - (qs.front() + static_cast<_R>(k) * step)) > tol)
+			return false;
+	}
+	return step != _R{0};
+}
+} // unnamed namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes plane waves \f$ |k_0 + q_k\hat{n}\rangle \f$ for all
+/// \f$ q_k \f$ at once.
+
+/// Column \f$ k \f$ of the result equals
+/// `make_momentum_eigenvector(offset + qs[k] * direction, positions)`. When
+/// \p qs is a uniform grid, columns are obtained by the recurrence
+/// \f[ e^{i(q+\Delta q)\hat{n}\cdot r} = e^{iq\hat{n}\cdot r}\cdot
+///     e^{i\Delta q\hat{n}\cdot r}, \f]
+/// i.e. a complex multiplication per site instead of a call to `std::exp`.
+/// To keep rounding errors from accumulating every \p resync -th column is
+/// recomputed exactly.
+///
+/// \param offset     Constant wavevector \f$ k_0 \f$, e.g. \f$ (0, q_y, 0) \f$
+///                   when scanning a row of a 2D \f$ (q_x, q_y) \f$ map.
+/// \param direction  Unit vector \f$ \hat{n} \f$.
+/// \param qs         Absolute values of the wavevectors.
+/// \param positions  Positions of the atoms.
+/// \param pi         \f$ \pi \f$.
+/// \param resync     Period of exact recomputation.
+///
+/// \return \f$ N\times Q \f$ matrix of plane waves.
+///////////////////////////////////////////////////////////////////////////////
+template < std::size_t _Dim = 3
+         , class _R
+         >
+auto make_momentum_matrix( std::array<_R, 3> const& offset
+                         , std::array<_R, 3> const& direction
+                         , std::vector<_R> const& qs
+                         , std::vector<std::array<_R, 3>> const& positions
+                         , _R const pi = _R{M_PI}
+                         , std::size_t const resync = 32 )
+{
+	using _C = std::complex<_R>;
+	TCM_MEASURE( "make_momentum_matrix<" + boost::core::demangle(
+		typeid(_C).name()) + ">()" );
+	assert( resync > 0 );
+
+	auto const N     = positions.size();
+	auto const Q     = qs.size();
+	auto const _norm =
+		std::pow(_R{2} * pi, -boost::numeric_cast<_R>(_Dim) / _R{2});
+	auto const _dot = [] (auto const& x, auto const& y) noexcept {
+		return x[0]*y[0] + x[1]*y[1] + x[2]*y[2];
+	};
+
+	std::vector<_R> x(N), y(N);
+	for (std::size_t i = 0; i < N; ++i) {
+		x[i] = _dot(direction, positions[i]);
+		y[i] = _dot(offset, positions[i]);
+	}
+
+	Matrix<_C> plane_waves{N, Q};
+	auto const exact = [&](std::size_t const k) {
+		for (std::size_t i = 0; i < N; ++i)
+			plane_waves(i, k) = _norm * std::exp(_C{0, qs[k] * x[i] + y[i]});
+	};
+
+	if (not is_uniform_grid(qs)) {
+		for (std::size_t k = 0; k < Q; ++k) exact(k);
+		return plane_waves;
+	}
+
+	auto const step = (qs.back() - qs.front()) / static_cast<_R>(Q - 1);
+	std::vector<_C> shift(N);
+	std::transform( x.begin(), x.end(), shift.begin()
+	              , [step](auto const xi) { return std::exp(_C{0, step * xi}); } );
+	for (std::size_t k = 0; k < Q; ++k) {
+		if (k % resync == 0) {
+			exact(k);
+			continue;
+		}
+		for (std::size_t i = 0; i < N; ++i)
+			plane_waves(i, k) = plane_waves(i, k - 1) * shift[i];
+	}
+	return plane_waves;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Same as above with \f$ k_0 = 0 \f$.
+///////////////////////////////////////////////////////////////////////////////
+template < std::size_t _Dim = 3
+         , class _R
+         >
+auto make_momentum_matrix( std::array<_R, 3> const& direction
+                         , std::vector<_R> const& qs
+                         , std::vector<std::array<_R, 3>> const& positions
+                         , _R const pi = _R{M_PI}
+                         , std::size_t const resync = 32 )
+{
+	return make_momentum_matrix<_Dim>( std::array<_R, 3>{0, 0, 0}
+	                                 , direction, qs, positions
+	                                 , pi, resync );
+}
+
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Defines tools to compute \f$ \chi(q, \omega) \f$ along a single
+/// direction without ever building \f$ \chi(\omega) \f$.
+///////////////////////////////////////////////////////////////////////////////
+namespace chi_q_function {
+
+
+namespace {
+// Plane waves are complex, thus so is rho, even if eigenstates are real:
+// rho = Psi^T diag(cos) Psi + i Psi^T diag(sin) Psi.
+template <class _F, class _C>
+auto make_rho(Matrix<_F> const& Psi, Matrix<_C> const& q)
+{
+	static_assert(std::is_floating_point<_F>::value, "");
+	auto const N = Psi.height();
+	auto const M = Psi.width();
+
+	Matrix<_F> D{N, M};
+	Matrix<_F> Re{M, M};
+	Matrix<_F> Im{M, M};
+	for (std::size_t j = 0; j < M; ++j)
+		for (std::size_t i = 0; i < N; ++i)
+			D(i, j) = std::real(q(i, 0)) * Psi(i, j);
+	blas::gemm( blas::Operator::T, blas::Operator::None
+	          , _F{1}, Psi, D, _F{0}, Re );
+	for (std::size_t j = 0; j < M; ++j)
+		for (std::size_t i = 0; i < N; ++i)
+			D(i, j) = std::imag(q(i, 0)) * Psi(i, j);
+	blas::gemm( blas::Operator::T, blas::Operator::None
+	          , _F{1}, Psi, D, _F{0}, Im );
+
+	Matrix<_F> rho2{M, M};
+	for (std::size_t j = 0; j < M; ++j)
+		for (std::size_t i = 0; i < M; ++i)
+			rho2(i, j) = Re(i, j) * Re(i, j) + Im(i, j) * Im(i, j);
+	return rho2;
+}
+
+template <class _F, class _C>
+auto make_rho(Matrix<std::complex<_F>> const& Psi, Matrix<_C> const& q)
+{
+	using _T = std::complex<_F>;
+	auto const N = Psi.height();
+	auto const M = Psi.width();
+
+	Matrix<_T> D{N, M};
+	Matrix<_T> rho{M, M};
+	for (std::size_t j = 0; j < M; ++j)
+		for (std::size_t i = 0; i < N; ++i)
+			D(i, j) = static_cast<_T>(q(i, 0)) * Psi(i, j);
+	blas::gemm( blas::Operator::H, blas::Operator::None
+	          , _T{1}, Psi, D, _T{0}, rho );
+
+	Matrix<_F> rho2{M, M};
+	for (std::size_t j = 0; j < M; ++j)
+		for (std::size_t i = 0; i < M; ++i)
+			rho2(i, j) = std::norm(rho(i, j));
+	return rho2;
+}
+} // unnamed namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes \f$ |\rho_{i,j}(q)|^2 \f$, where
+/// \f$ \rho(q) = \Psi^\dagger\,\text{diag}(q)\,\Psi \f$.
+
+/// \param q    Plane wave, e.g. obtained from make_momentum_eigenvector().
+/// \param Psi  Eigenstates of the system. Real and complex eigenstates are
+///             both supported.
+///
+/// \return \f$ |\rho(q)|^2 \f$ as a real matrix.
+/// \exception May throw if memory allocations fail.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C, class _T>
+auto matrix_elements(Matrix<_C> const& q, Matrix<_T> const& Psi)
+{
+	TCM_MEASURE( "chi_q_function::matrix_elements<" + boost::core::demangle(
+		typeid(_T).name()) + ">()" );
+	assert( is_column(q) );
+	assert( q.height() == Psi.height() );
+	return make_rho(Psi, q);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the \f$ q\to 0 \f$ (dipole) limit of matrix_elements().
+
+/// For small \f$ q \f$ we have \f$ \rho_{i,j}(q) \approx (2\pi)^{-3/2}
+/// (\delta_{i,j} + i|q|\,x_{i,j}) \f$ with
+/// \f$ x = \Psi^\dagger\,\text{diag}(\hat{q}\cdot r)\,\Psi \f$. Diagonal
+/// terms drop out of \f$ \chi \f$ because \f$ G_{i,i} = 0 \f$, thus
+/// \f$ \lim_{q\to 0}\chi(q,\omega)/|q|^2 \f$ is obtained by feeding
+/// \f$ (2\pi)^{-3}|x_{i,j}|^2 \f$ to make().
+///
+/// \param direction  Unit vector \f$ \hat{q} \f$.
+/// \param positions  Positions of the atoms.
+/// \param Psi        Eigenstates of the system.
+/// \param pi         \f$ \pi \f$.
+///////////////////////////////////////////////////////////////////////////////
+template <class _R, class _T>
+auto dipole_matrix_elements( std::array<_R, 3> const& direction
+                           , std::vector<std::array<_R, 3>> const& positions
+                           , Matrix<_T> const& Psi
+                           , _R const pi = _R{M_PI} )
+{
+	TCM_MEASURE( "chi_q_function::dipole_matrix_elements<"
+		+ boost::core::demangle(typeid(_T).name()) + ">()" );
+	assert( positions.size() == Psi.height() );
+
+	auto const _norm = std::pow(_R{2} * pi, _R{-1.5});
+	Matrix<std::complex<_R>> x{positions.size(), 1};
+	std::transform( std::begin(positions), std::end(positions)
+	              , x.data()
+	              , [_norm, &direction](auto const& r) {
+	                    return std::complex<_R>{ _norm * ( direction[0] * r[0]
+	                                                     + direction[1] * r[1]
+	                                                     + direction[2] * r[2] )
+	                                           , _R{0} };
+	                } );
+	return make_rho(Psi, x);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Calculates \f$ \chi(q, \omega) \f$ for a batch of frequencies.
+
+/// \f[ \chi(q, \omega) = 2\sum_{i,j} |\rho_{i,j}(q)|^2
+///     \frac{f_i - f_j}{E_i - E_j - \omega}. \f]
+/// Every pair \f$ (i, j) \f$ is visited once and its contribution is added
+/// to all frequencies in \p omegas, so \p rho2 is streamed from memory only
+/// once per batch.
+///
+/// \param omegas  Frequencies (complex, i.e. \f$ \omega + i\tau \f$).
+/// \param E       Eigenenergies of the system.
+/// \param rho2    \f$ |\rho(q)|^2 \f$ as computed by matrix_elements().
+/// \param cs      Constants. Temperature, chemical potential and
+///                Boltzmann's constant are required.
+/// \param lg      The logger.
+///
+/// \return \f$ \chi(q, \omega) \f$ for each \f$ \omega \f$ in \p omegas.
+/// \exception May throw.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Number, class _F, class _R, class _Logger>
+auto make( std::vector<_Number> const& omegas
+         , Matrix<_F> const& E
+         , Matrix<_F> const& rho2
+         , std::map<std::string, _R> const& cs
+         , _Logger & lg )
+{
+	static_assert(std::is_floating_point<_F>::value, "Energy must be real.");
+	TCM_MEASURE( "chi_q_function::make<" + boost::core::demangle(
+		typeid(_F).name()) + ">()" );
+	LOG(lg, debug) << "Calculating chi(q) for " << omegas.size()
+	               << " frequencies...";
+	require(__PRETTY_FUNCTION__, cs, "temperature");
+	require(__PRETTY_FUNCTION__, cs, "chemical-potential");
+	require(__PRETTY_FUNCTION__, cs, "boltzmann-constant");
+	assert( is_column(E) );
+	assert( is_square(rho2) );
+	assert( rho2.height() == E.height() );
+
+	auto const t  = cs.at("temperature");
+	auto const mu = cs.at("chemical-potential");
+	auto const kb = cs.at("boltzmann-constant");
+	auto const M  = E.height();
+	auto const W  = omegas.size();
+
+	std::vector<_F> f(M);
+	std::transform( E.data(), E.data() + M, f.begin()
+	              , [t, mu, kb](auto Ei) noexcept
+	                { return fermi_dirac(Ei, t, mu, kb); } );
+
+	std::vector<_F> re_omega(W), im_omega(W);
+	for (std::size_t w = 0; w < W; ++w) {
+		re_omega[w] = std::real(omegas[w]);
+		im_omega[w] = std::imag(omegas[w]);
+	}
+
+	std::vector<_F> re_chi(W, _F{0}), im_chi(W, _F{0});
+	for (std::size_t j = 0; j < M; ++j) {
+		for (std::size_t i = 0; i < M; ++i) {
+			// c / (dE - omega) with c and dE real.
+			auto const c = _F{2} * rho2(i, j) * (f[i] - f[j]);
+			if (c == _F{0}) continue;
+			auto const dE = E(i, 0) - E(j, 0);
+			for (std::size_t w = 0; w < W; ++w) {
+				auto const x = dE - re_omega[w];
+				auto const y = -im_omega[w];
+				auto const scale = c / (x * x + y * y);
+				re_chi[w] += scale * x;
+				im_chi[w] -= scale * y;
+			}
+		}
+	}
+
+	std::vector<std::complex<_F>> chi(W);
+	for (std::size_t w = 0; w < W; ++w)
+		chi[w] = {re_chi[w], im_chi[w]};
+
+	LOG(lg, debug) << "Successfully calculated chi(q).";
+	return chi;
+}
+
+
+} // namespace chi_q_function
+
+
+} // namespace tcm
+
+
+#endif // TCM_MOMENTUM_SPACE_HPP
@@ -0,0 +1,506 @@
+#ifndef TCM_OUT_OF_CORE_HPP
+#define TCM_OUT_OF_CORE_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <complex>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include <boost/core/demangle.hpp>
+
+#include <benchmark.hpp>
+#include <logging.hpp>
+#include <memory.hpp>
+
+#include <matrix.hpp>
+#include <blas.hpp>
+#include <dielectric_function_v2.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file out_of_core.hpp
+/// \brief Computes \f$ \chi(\omega) \f$ and \f$ \epsilon(\omega) \f$ when
+/// they do not fit into memory.
+///
+/// The \f$ N\times N \f$ matrices live in a TiledMatrix, i.e. a file on
+/// local scratch (ideally NVMe) holding square tiles. Only \f$ \Psi \f$,
+/// \f$ V \f$, \f$ G \f$ (or a column block of it) and a few tiles or column
+/// panels are kept in memory:
+///
+/// - chi() computes one tile after the other with ?GEMM and writes them
+///   behind, i.e. while the next tile is computed;
+/// - epsilon() streams \f$ \chi \f$ in column panels, prefetching the next
+///   panel while \f$ 1 - V\chi \f$ is computed for the current one, and
+///   overwrites \f$ \chi \f$ with \f$ \epsilon \f$;
+/// - Operator applies a TiledMatrix to vectors in the same streaming order,
+///   so that eigenmodes can be computed with krylov::ShiftInvertKrylov.
+///
+/// planner::make_plan() chooses the tile size.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace out_of_core {
+
+
+namespace detail {
+
+inline auto io_error(std::string const& what, std::string const& path)
+	-> std::runtime_error
+{
+	return std::runtime_error{ "Could not " + what + " `" + path + "`: "
+	                         + std::strerror(errno) };
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Free space in bytes of the file system containing \p path.
+///////////////////////////////////////////////////////////////////////////////
+inline auto free_space(std::string const& path) -> std::uint64_t
+{
+	struct statvfs info;
+	if (::statvfs(path.c_str(), &info) != 0)
+		throw detail::io_error("stat", path);
+	return static_cast<std::uint64_t>(info.f_bavail) * info.f_frsize;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A square matrix stored in a file as square tiles.
+
+/// Tile \f$ (I, J) \f$ holds rows \f$ [I t, (I+1) t) \f$ and columns
+/// \f$ [J t, (J+1) t) \f$ in column-major order, where \f$ t \f$ is the
+/// tile size. Tiles are stored in column-major order of \f$ (I, J) \f$,
+/// all with room for \f$ t^2 \f$ elements. Reads and writes of different
+/// tiles may run concurrently.
+///
+/// The file is removed on destruction unless keep() was called.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T>
+class TiledMatrix {
+	static_assert( std::is_trivially_copyable<_T>::value
+	             , "Tiles are written byte by byte." );
+
+public:
+	using value_type = _T;
+	using size_type  = std::size_t;
+
+private:
+	std::string _path;
+	int         _fd   = -1;
+	size_type   _size = 0;
+	size_type   _tile = 0;
+	bool        _keep = false;
+
+	auto offset(size_type const I, size_type const J) const noexcept -> off_t
+	{
+		return static_cast<off_t>((J * tiles() + I) * _tile * _tile * sizeof(_T));
+	}
+
+	template <class _Op>
+	auto transfer( _Op&& op, char const* what, size_type const I
+	             , size_type const J, char* buffer ) const -> void
+	{
+		auto const bytes = rows(I) * rows(J) * sizeof(_T);
+		std::size_t done = 0;
+		while (done < bytes) {
+			auto const n = op(_fd, buffer + done, bytes - done, offset(I, J) + done);
+			if (n < 0 and errno == EINTR) continue;
+			if (n <= 0) throw detail::io_error(what, _path);
+			done += static_cast<std::size_t>(n);
+		}
+	}
+
+public:
+	TiledMatrix() = default;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Creates (or truncates) \p path for an \p size x \p size
+	/// matrix in tiles of \p tile x \p tile. Contents are unspecified.
+	///////////////////////////////////////////////////////////////////////////
+	TiledMatrix(std::string path, size_type const size, size_type const tile)
+		: _path{std::move(path)}, _size{size}, _tile{tile}
+	{
+		if (_tile == 0) throw std::invalid_argument{"Tile size must be positive."};
+		_fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (_fd < 0) throw detail::io_error("create", _path);
+		if (::ftruncate(_fd, offset(0, tiles())) != 0) {
+			auto const error = detail::io_error("resize", _path);
+			::close(_fd);
+			::unlink(_path.c_str());
+			throw error;
+		}
+	}
+
+	TiledMatrix(TiledMatrix const&) = delete;
+	TiledMatrix& operator= (TiledMatrix const&) = delete;
+
+	TiledMatrix(TiledMatrix&& other) noexcept
+		: _path{std::move(other._path)}, _fd{other._fd}, _size{other._size}
+		, _tile{other._tile}, _keep{other._keep}
+	{ other._fd = -1; }
+
+	TiledMatrix& operator= (TiledMatrix&& other) noexcept
+	{
+		using std::swap;
+		swap(_path, other._path);
+		swap(_fd, other._fd);
+		swap(_size, other._size);
+		swap(_tile, other._tile);
+		swap(_keep, other._keep);
+		return *this;
+	}
+
+	~TiledMatrix()
+	{
+		if (_fd < 0) return;
+		::close(_fd);
+		if (not _keep) ::unlink(_path.c_str());
+	}
+
+	auto size() const noexcept -> size_type { return _size; }
+	auto tile() const noexcept -> size_type { return _tile; }
+	auto path() const noexcept -> std::string const& { return _path; }
+
+	/// \brief Number of tiles per row and column.
+	auto tiles() const noexcept -> size_type
+	{ return (_size + _tile - 1) / _tile; }
+
+	/// \brief Number of rows of tile row \p I (or columns of tile column
+	/// \p I).
+	auto rows(size_type const I) const noexcept -> size_type
+	{ return std::min(_tile, _size - I * _tile); }
+
+	/// \brief Keeps the file after destruction.
+	auto keep() noexcept -> void { _keep = true; }
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Reads tile \f$ (I, J) \f$ into the column-major block at
+	/// \p dst with leading dimension \p ld.
+	///////////////////////////////////////////////////////////////////////////
+	auto read( size_type const I, size_type const J
+	         , _T* const dst, size_type const ld ) const -> void
+	{
+		auto const m = rows(I);
+		auto const n = rows(J);
+		std::vector<_T> buffer(ld == m ? 0 : m * n);
+		auto* const packed = ld == m ? dst : buffer.data();
+		transfer( [](int fd, char* p, std::size_t n, off_t o)
+		              { return ::pread(fd, p, n, o); }
+		        , "read", I, J, reinterpret_cast<char*>(packed) );
+		if (ld != m) {
+			for (size_type j = 0; j < n; ++j)
+				std::copy_n(buffer.data() + j * m, m, dst + j * ld);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Writes the column-major block at \p src with leading dimension
+	/// \p ld to tile \f$ (I, J) \f$.
+	///////////////////////////////////////////////////////////////////////////
+	auto write( size_type const I, size_type const J
+	          , _T const* const src, size_type const ld ) -> void
+	{
+		auto const m = rows(I);
+		auto const n = rows(J);
+		std::vector<_T> buffer(ld == m ? 0 : m * n);
+		if (ld != m) {
+			for (size_type j = 0; j < n; ++j)
+				std::copy_n(src + j * ld, m, buffer.data() + j * m);
+		}
+		auto const* const packed = ld == m ? src : buffer.data();
+		transfer( [](int fd, char* p, std::size_t n, off_t o)
+		              { return ::pwrite(fd, p, n, o); }
+		        , "write", I, J
+		        , const_cast<char*>(reinterpret_cast<char const*>(packed)) );
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Reads tile column \p J into an \f$ N\times t \f$ panel.
+	///////////////////////////////////////////////////////////////////////////
+	auto read_panel(size_type const J) const -> Matrix<_T>
+	{
+		Matrix<_T> panel{_size, rows(J)};
+		for (size_type I = 0; I < tiles(); ++I)
+			read(I, J, panel.data(I * _tile, 0), panel.ldim());
+		return panel;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Writes an \f$ N\times t \f$ panel to tile column \p J.
+	///////////////////////////////////////////////////////////////////////////
+	auto write_panel(size_type const J, Matrix<_T> const& panel) -> void
+	{
+		assert(panel.height() == _size and panel.width() == rows(J));
+		for (size_type I = 0; I < tiles(); ++I)
+			write(I, J, panel.data(I * _tile, 0), panel.ldim());
+	}
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Runs writes in the background, at most \p depth at a time.
+
+/// The destructor waits for pending writes; call wait() to see their
+/// errors.
+///////////////////////////////////////////////////////////////////////////////
+class WriteBehind {
+	std::deque<std::future<void>> _pending;
+	std::size_t                   _depth;
+
+public:
+	explicit WriteBehind(std::size_t const depth = 2) : _depth{depth} {}
+
+	WriteBehind(WriteBehind const&) = delete;
+	WriteBehind& operator= (WriteBehind const&) = delete;
+
+	~WriteBehind()
+	{
+		for (auto& x : _pending) x.wait();
+	}
+
+	/// \brief Starts \p write, first waiting for the oldest pending one if
+	/// there are already #depth of them.
+	template <class _Write>
+	auto push(_Write&& write) -> void
+	{
+		while (_pending.size() >= _depth) pop();
+		_pending.push_back(std::async(std::launch::async, std::forward<_Write>(write)));
+	}
+
+	/// \brief Waits for all pending writes. Rethrows their errors.
+	auto wait() -> void
+	{
+		while (not _pending.empty()) pop();
+	}
+
+private:
+	auto pop() -> void
+	{
+		auto x = std::move(_pending.front());
+		_pending.pop_front();
+		x.get();
+	}
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes \f$ \chi(\omega) \f$ into a TiledMatrix at \p path.
+
+/// Same result as chi_function::make(), but with ?GEMM: for a row
+/// \f$ a \f$ of a tile and its columns \f$ b \f$, let
+/// \f$ X_{i,b} = \psi_{a,i}\psi_{b,i}^* \f$; then
+/// \f[ \chi_{a,b} = 2\sum_j X_{j,b}^* (G^T X)_{j,b}. \f]
+/// For real \f$ \Psi \f$, \f$ \chi \f$ is symmetric, and only tiles on and
+/// above the diagonal are computed.
+///
+/// \param tile    Tile size \f$ t \f$. Memory use is
+///                \f$ G \f$ plus about \f$ 2Mt + 3t^2 \f$ elements.
+/// \param g_tile  If non-zero and less than \f$ M \f$, \f$ G \f$ is built
+///                in column blocks of this width for every tile instead of
+///                once, see chi_function::make().
+///////////////////////////////////////////////////////////////////////////////
+template <class _Number, class _F, class _T, class _R, class _Logger>
+auto chi( _Number const omega
+        , Matrix<_F> const& E
+        , Matrix<_T> const& Psi
+        , std::map<std::string, _R> const& cs
+        , std::string const& path
+        , std::size_t const tile
+        , _Logger & lg
+        , std::size_t const g_tile = 0 )
+{
+	TCM_MEASURE( "out_of_core::chi<" + boost::core::demangle(
+		typeid(_T).name()) + ">()" );
+	TCM_MEMORY_TAG("chi (out of core)");
+	using G_type  = decltype(g_function::make(omega, E, cs, lg));
+	using Complex = std::common_type_t<_T, typename G_type::value_type>;
+	auto const N = Psi.height();
+	auto const M = Psi.width();
+	auto const symmetric = std::is_floating_point<_T>::value;
+	auto const block = (g_tile != 0 and g_tile < M) ? g_tile : M;
+	LOG(lg, debug) << "Calculating chi for omega = " << omega << " out of "
+	               << "core in tiles of " << tile << " into `" << path << "`...";
+
+	TiledMatrix<Complex> Chi{path, N, tile};
+	G_type G;
+	if (block == M) G = g_function::make(omega, E, cs, lg);
+
+	Matrix<Complex> X{M, tile};
+	Matrix<Complex> Y{block, tile};
+	WriteBehind writes;
+	for (std::size_t J = 0; J < Chi.tiles(); ++J) {
+		for (std::size_t I = 0; I < (symmetric ? J + 1 : Chi.tiles()); ++I) {
+			auto const m = Chi.rows(I);
+			auto const n = Chi.rows(J);
+			Matrix<Complex> result{m, n};
+			std::fill(result.data(), result.data() + result.ldim() * n, Complex{0});
+
+			for (std::size_t first = 0; first < M; first += block) {
+				auto const last = std::min(M, first + block);
+				if (block != M)
+					G = g_function::make_columns(omega, E, cs, first, last, lg);
+				for (std::size_t i = 0; i < m; ++i) {
+					auto const a = I * tile + i;
+					for (std::size_t j = 0; j < n; ++j) {
+						auto const b = J * tile + j;
+						for (std::size_t k = 0; k < M; ++k)
+							X(k, j) = Complex{Psi(a, k) * std::conj(Psi(b, k))};
+					}
+					{
+						TCM_ACCOUNT(cost::gemm<Complex>(last - first, n, M));
+						import::gemm( blas::Operator::T, blas::Operator::None
+						            , last - first, n, M
+						            , Complex{1}, G.data(), G.ldim()
+						            , X.data(), X.ldim()
+						            , Complex{0}, Y.data(), Y.ldim() );
+					}
+					for (std::size_t j = 0; j < n; ++j) {
+						Complex sum{0};
+						for (std::size_t k = first; k < last; ++k)
+							sum += std::conj(X(k, j)) * Y(k - first, j);
+						result(i, j) += Complex{2} * sum;
+					}
+				}
+			}
+
+			if (symmetric and I != J) {
+				Matrix<Complex> mirror{n, m};
+				for (std::size_t j = 0; j < n; ++j)
+					for (std::size_t i = 0; i < m; ++i)
+						mirror(j, i) = result(i, j);
+				writes.push([&Chi, J, I, x = std::move(mirror)]()
+					{ Chi.write(J, I, x.data(), x.ldim()); });
+			}
+			writes.push([&Chi, I, J, x = std::move(result)]()
+				{ Chi.write(I, J, x.data(), x.ldim()); });
+		}
+	}
+	writes.wait();
+	LOG(lg, debug) << "Successfully calculated chi.";
+	return Chi;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Overwrites \f$ \chi \f$ with \f$ \epsilon = 1 - V\chi \f$.
+
+/// Column panels of \p Chi are streamed: while \f$ 1 - V\chi_{:,J} \f$ is
+/// computed, panel \f$ J+1 \f$ is read and panel \f$ J-1 \f$ written.
+/// Memory use is \f$ V \f$ plus four \f$ N\times t \f$ panels.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T, class _Logger>
+auto epsilon(TiledMatrix<_T>&& Chi, Matrix<_T> const& V, _Logger & lg)
+	-> TiledMatrix<_T>
+{
+	TCM_MEASURE( "out_of_core::epsilon<" + boost::core::demangle(
+		typeid(_T).name()) + ">()" );
+	TCM_MEMORY_TAG("epsilon (out of core)");
+	assert( is_square(V) and V.height() == Chi.size() );
+	LOG(lg, debug) << "Calculating epsilon out of core in `" << Chi.path()
+	               << "`...";
+
+	auto epsilon = std::move(Chi);
+	auto const& source = epsilon;
+	auto const prefetch = [&source](std::size_t const J) {
+		return std::async(std::launch::async, [&source, J]() { return source.read_panel(J); });
+	};
+
+	WriteBehind writes{1};
+	auto next = prefetch(0);
+	for (std::size_t J = 0; J < epsilon.tiles(); ++J) {
+		auto const panel = next.get();
+		if (J + 1 < epsilon.tiles()) next = prefetch(J + 1);
+
+		Matrix<_T> result{panel.height(), panel.width()};
+		blas::gemm( blas::Operator::None, blas::Operator::None
+		          , _T{-1}, V, panel, _T{0}, result );
+		for (std::size_t j = 0; j < result.width(); ++j)
+			result(J * epsilon.tile() + j, j) += _T{1};
+		writes.push([&epsilon, J, x = std::move(result)]()
+			{ epsilon.write_panel(J, x); });
+	}
+	writes.wait();
+	LOG(lg, debug) << "Successfully calculated epsilon.";
+	return epsilon;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes \f$ \epsilon(\omega) \f$ into a TiledMatrix at \p path,
+/// see chi() and epsilon().
+///////////////////////////////////////////////////////////////////////////////
+template <class _Number, class _F, class _T, class _R, class _C, class _Logger>
+auto epsilon( _Number const omega
+            , Matrix<_F> const& E
+            , Matrix<_T> const& Psi
+            , Matrix<_C> const& V
+            , std::map<std::string, _R> const& cs
+            , std::string const& path
+            , std::size_t const tile
+            , _Logger & lg
+            , std::size_t const g_tile = 0 ) -> TiledMatrix<_C>
+{
+	return epsilon(chi(omega, E, Psi, cs, path, tile, lg, g_tile), V, lg);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Applies a TiledMatrix to vectors, reading it panel by panel with
+/// prefetching. Models the operator concept of krylov::gmres().
+
+/// Every application reads the whole file, \f$ N^2 \f$ elements, so an
+/// iterative solver costs one pass over the disk per iteration.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T>
+class Operator {
+	TiledMatrix<_T> const& _A;
+
+public:
+	explicit Operator(TiledMatrix<_T> const& A) : _A{A} {}
+
+	auto size() const noexcept -> std::size_t { return _A.size(); }
+
+	auto operator()(_T const* x, _T* y) const -> void
+	{
+		TCM_MEASURE( "out_of_core::Operator<" + boost::core::demangle(
+			typeid(_T).name()) + ">::operator()" );
+		TCM_MEMORY_TAG("epsilon (out of core)");
+		auto const prefetch = [this](std::size_t const J) {
+			return std::async(std::launch::async, [this, J]() { return _A.read_panel(J); });
+		};
+		std::fill_n(y, size(), _T{0});
+		auto next = prefetch(0);
+		for (std::size_t J = 0; J < _A.tiles(); ++J) {
+			auto const panel = next.get();
+			if (J + 1 < _A.tiles()) next = prefetch(J + 1);
+			TCM_ACCOUNT(cost::gemv<_T>(panel.height(), panel.width()));
+			import::gemv( blas::Operator::None, panel.height(), panel.width()
+			            , _T{1}, panel.data(), panel.ldim()
+			            , x + J * _A.tile(), 1, _T{1}, y, 1 );
+		}
+	}
+};
+
+
+} // namespace out_of_core
+
+} // namespace tcm
+
+
+#endif // TCM_OUT_OF_CORE_HPP
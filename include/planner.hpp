@@ -0,0 +1,408 @@
+#ifndef TCM_PLANNER_HPP
+#define TCM_PLANNER_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <memory.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file planner.hpp
+/// \brief Chooses how to compute \f$ \epsilon(\omega) \f$ and its modes
+/// within a memory budget, before anything is allocated.
+///
+/// A #Problem describes the sizes, the layout of ranks and threads on a node
+/// and the requested eigensolver. #make_plan() predicts the peak memory of
+/// each strategy (see memory::Estimate) and takes the first one that fits
+/// into the share of the budget of one rank, in this order:
+///
+/// 1. the requested solver with the full \f$ G \f$;
+/// 2. the requested solver with \f$ G \f$ built in column blocks (see
+///    chi_function::make());
+/// 3. solvers that keep fewer eigenvectors: 'geev-select' and 'arnoldi'
+///    keep \f$ k \f$ of them instead of \f$ N \f$;
+/// 4. 'arnoldi-mf', which never stores \f$ \epsilon \f$;
+/// 5. if a scratch directory is given, \f$ \chi \f$ and \f$ \epsilon \f$
+///    out of core in the largest tiles that fit into memory and onto the
+///    disk (see out_of_core.hpp). \f$ \epsilon \f$ is then only saved
+///    unless Problem::ooc_diagonalize is set: shift-invert Arnoldi with
+///    GMRES inner solves reads the whole tile file for every application
+///    of \f$ \epsilon \f$, up to thousands of times per Arnoldi step, and
+///    the plan prints that volume.
+///
+/// Falling back changes what is computed (fewer eigenpairs are saved), and
+/// the plan says so. If nothing fits, #make_plan() throws.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace planner {
+
+
+/// Columns of \f$ \epsilon \f$ that 'csym' forms at a time while saving it,
+/// so that \f$ \chi \f$, which it needs afterwards, and \f$ \epsilon \f$ are
+/// never stored in full together.
+constexpr std::size_t epsilon_panel = 256;
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief What is to be computed, and where.
+///////////////////////////////////////////////////////////////////////////////
+struct Problem {
+	std::size_t   N;                      ///< Size of the basis, i.e. of \f$ \chi \f$.
+	std::size_t   M;                      ///< Number of states, i.e. of \f$ G \f$.
+	bool          complex_states;         ///< Whether \f$ \Psi \f$ is complex.
+	bool          diagonalize    = true;
+	std::string   solver         = "geev";
+	std::size_t   eigen_count    = 2;
+	std::size_t   eigen_subspace = 0;     ///< 0 means \f$ \max(2k+1, 20) \f$.
+	std::size_t   eigen_check    = 8;     ///< Eigenpairs checked by 'csym'.
+	std::size_t   ranks_per_node = 1;
+	std::size_t   threads        = 1;     ///< BLAS threads per rank.
+	/// Memory of one node available to us in bytes, 0 means unlimited.
+	std::uint64_t budget         = 0;
+	/// Buffer that threaded BLAS implementations keep per thread (OpenBLAS'
+	/// default on x86-64).
+	std::uint64_t blas_buffer    = std::uint64_t{32} << 20;
+	/// Directory for out-of-core tiles, empty means in core only.
+	std::string   scratch;
+	/// Free space in \ref scratch in bytes, shared by the ranks of a node.
+	std::uint64_t scratch_space  = 0;
+	/// Whether out-of-core \f$ \epsilon \f$ is diagonalized, too.
+	bool          ooc_diagonalize = false;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief How it is computed.
+///////////////////////////////////////////////////////////////////////////////
+struct Plan {
+	std::string      solver;
+	std::size_t      eigenvectors = 0; ///< Number of eigenvectors kept.
+	bool             store_epsilon = true;
+	std::size_t      g_tile = 0;       ///< Columns per block of G, 0 means all.
+	/// Tile size of out-of-core \f$ \chi \f$ and \f$ \epsilon \f$, 0 means
+	/// in core.
+	std::size_t      tile   = 0;
+	memory::Estimate estimate;
+	std::uint64_t    budget = 0;       ///< Share of one rank, 0 means unlimited.
+	std::uint64_t    disk   = 0;       ///< Scratch space needed by one rank.
+	/// Whether \f$ \epsilon \f$ is diagonalized; out of core only with
+	/// Problem::ooc_diagonalize.
+	bool             diagonalize = true;
+	/// Bytes read from scratch per application of out-of-core
+	/// \f$ \epsilon \f$ to a vector, 0 if not applicable.
+	std::uint64_t    io_per_application = 0;
+
+	auto fits() const noexcept -> bool
+	{ return budget == 0 or estimate.peak() <= budget; }
+};
+
+
+namespace detail {
+
+inline auto subspace(Problem const& p) noexcept -> std::size_t
+{
+	auto const k = std::min(p.eigen_count, p.N);
+	return std::min( p.N, p.eigen_subspace != 0
+	                          ? std::max(p.eigen_subspace, k + 1)
+	                          : std::max<std::size_t>(2 * k + 1, 20) );
+}
+
+inline auto stores_epsilon(Problem const& p, std::string const& solver) -> bool
+{ return not (p.diagonalize and solver == "arnoldi-mf"); }
+
+inline auto eigenvectors(Problem const& p, std::string const& solver) noexcept
+	-> std::size_t
+{
+	if (not p.diagonalize) return 0;
+	return (solver == "geev" or solver == "csym") ? p.N
+	                                              : std::min(p.eigen_count, p.N);
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Predicts the memory use of one rank computing one frequency of
+/// \p p with \p solver, building \f$ G \f$ in blocks of \p g_tile columns.
+
+/// If \p tile is non-zero, \f$ \chi \f$ and \f$ \epsilon \f$ are out of core
+/// in tiles of that size and \p solver is ignored.
+///
+/// \tparam _R  Real type of the computation; \f$ \chi \f$ and
+///             \f$ \epsilon \f$ are `std::complex<_R>`.
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+auto estimate( Problem const& p, std::string const& solver
+             , std::size_t const g_tile = 0
+             , std::size_t const tile = 0 ) -> memory::Estimate
+{
+	using memory::matrix_bytes;
+	using _C = std::complex<_R>;
+	auto const N = p.N;
+	auto const M = p.M;
+	auto const k = std::min(p.eigen_count, N);
+	auto const m = detail::subspace(p);
+	auto const G = matrix_bytes<_C>(M, g_tile != 0 ? std::min(g_tile, M) : M);
+
+	memory::Estimate estimate;
+	estimate.resident("E", matrix_bytes<_R>(M, 1))
+	        .resident("Psi", p.complex_states ? matrix_bytes<_C>(N, M)
+	                                          : matrix_bytes<_R>(N, M))
+	        .resident("V", matrix_bytes<_C>(N, N))
+	        .resident("BLAS buffers", p.threads * p.blas_buffer);
+
+	if (tile != 0) {
+		auto const t = std::min(tile, N);
+		// Tile being computed, its mirror image and two being written, each
+		// with a packing buffer.
+		estimate.phase("chi (out of core)")
+		        .add(g_tile != 0 ? "G block" : "G", G)
+		        .add("X and Y", matrix_bytes<_C>(M, t) + matrix_bytes<_C>(M, t))
+		        .add("tiles", 6 * matrix_bytes<_C>(t, t));
+		// Panel being computed, its result, the next one and one being
+		// written.
+		estimate.phase("epsilon (out of core)")
+		        .add("panels", 4 * matrix_bytes<_C>(N, t));
+		if (not p.diagonalize) return estimate;
+		estimate.phase("arnoldi (out of core)")
+		        .add("panels", 2 * matrix_bytes<_C>(N, t))
+		        .add("Krylov basis", matrix_bytes<_C>(N, m) + matrix_bytes<_C>(N, k))
+		        .add("GMRES basis", matrix_bytes<_C>(N, 51));
+		return estimate;
+	}
+
+	if (not detail::stores_epsilon(p, solver)) {
+		estimate.phase("arnoldi-mf")
+		        .add("Psi copy", matrix_bytes<_C>(N, M))
+		        .add("G (twice)", 2 * matrix_bytes<_C>(M, M))
+		        .add("D", matrix_bytes<_C>(N, M))
+		        .add("K", matrix_bytes<_C>(M, M))
+		        .add("Krylov basis", matrix_bytes<_C>(N, m) + matrix_bytes<_C>(N, k));
+		return estimate;
+	}
+
+	estimate.phase("chi")
+	        .add(g_tile != 0 ? "G block" : "G", G)
+	        .add("chi", matrix_bytes<_C>(N, N));
+	estimate.phase("epsilon")
+	        .add("chi", matrix_bytes<_C>(N, N));
+	if (solver == "csym")
+		estimate.add("epsilon panel", matrix_bytes<_C>(N, std::min(N, epsilon_panel)));
+	else
+		estimate.add("epsilon", matrix_bytes<_C>(N, N));
+	if (not p.diagonalize) return estimate;
+
+	estimate.phase(solver);
+	if (solver == "csym") {
+		// S is built in the place of chi next to the real L, packed, and chi
+		// is released before Z is allocated. L later lives in the space of
+		// S. The ?GEEV fallback needs as much as 'geev' and is not counted.
+		auto const packed = N * (N + 1) / 2 * sizeof(_C);
+		estimate.add("W and Z", matrix_bytes<_C>(N, 1) + matrix_bytes<_C>(N, N))
+		        .add("packed S", packed);
+		if (p.eigen_check != 0) estimate.add("copy of S", packed);
+	}
+	else if (solver == "arnoldi") {
+		estimate.add("LU", matrix_bytes<_C>(N, N))
+		        .add("Krylov basis", matrix_bytes<_C>(N, m) + matrix_bytes<_C>(N, k));
+	}
+	else if (solver == "geev-select") {
+		estimate.add("epsilon", matrix_bytes<_C>(N, N))
+		        .add("Hessenberg", matrix_bytes<_C>(N, N))
+		        .add("W and Z", matrix_bytes<_C>(N, 1) + 2 * matrix_bytes<_C>(N, k));
+	}
+	else {
+		estimate.add("epsilon", matrix_bytes<_C>(N, N))
+		        .add("W and Z", matrix_bytes<_C>(N, 1) + matrix_bytes<_C>(N, N))
+		        .add("LAPACK workspace", 65 * N * sizeof(_C));
+	}
+	return estimate;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Chooses the first strategy for \p p that fits into its budget.
+
+/// \exception std::runtime_error if none does; the message contains the
+///            smallest estimate.
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+auto make_plan(Problem const& p) -> Plan
+{
+	auto const ranks  = std::max<std::size_t>(1, p.ranks_per_node);
+	auto const budget = p.budget / ranks;
+	auto const make = [&p, budget]( std::string const& solver, std::size_t const g_tile
+	                              , std::size_t const tile ) {
+		auto q = p;
+		if (tile != 0) q.diagonalize = p.diagonalize and p.ooc_diagonalize;
+		Plan plan;
+		plan.solver        = solver;
+		plan.diagonalize   = q.diagonalize;
+		plan.eigenvectors  = detail::eigenvectors(q, solver);
+		plan.store_epsilon = detail::stores_epsilon(q, solver);
+		plan.g_tile        = g_tile;
+		plan.tile          = tile;
+		plan.estimate      = estimate<_R>(q, solver, g_tile, tile);
+		plan.budget        = budget;
+		if (tile != 0) {
+			auto const tiles = (p.N + tile - 1) / tile;
+			plan.disk = tiles * tiles * tile * tile * sizeof(std::complex<_R>);
+			if (q.diagonalize)
+				plan.io_per_application = p.N * p.N * sizeof(std::complex<_R>);
+		}
+		return plan;
+	};
+
+	// Strategies in order of preference: the requested solver first, then
+	// the ones that keep fewer eigenvectors, then the one without epsilon.
+	std::vector<std::string> solvers = {p.solver};
+	if (p.diagonalize) {
+		for (auto const* x : {"geev-select", "arnoldi", "arnoldi-mf"}) {
+			if (std::find(std::begin(solvers), std::end(solvers), x)
+			    == std::end(solvers)) solvers.push_back(x);
+		}
+	}
+
+	auto smallest = make(p.solver, 0, 0);
+	// Tries the full G, then halves its blocks until it fits or G is no
+	// longer the problem.
+	auto const try_g_tiles = [&p, &make, &smallest]( std::string const& solver
+	                                              , std::size_t const tile
+	                                              , Plan& result ) {
+		auto const consider = [&smallest, &result](Plan plan) {
+			if (plan.estimate.peak() < smallest.estimate.peak()) smallest = plan;
+			if (plan.fits()) { result = std::move(plan); return true; }
+			return false;
+		};
+		if (consider(make(solver, 0, tile))) return true;
+		if (not detail::stores_epsilon(p, solver) and tile == 0) return false;
+		for (auto g_tile = p.M / 2;
+		     g_tile > 0 and g_tile >= std::min<std::size_t>(64, p.M); g_tile /= 2) {
+			if (consider(make(solver, g_tile, tile))) return true;
+		}
+		return false;
+	};
+
+	Plan plan;
+	for (auto const& solver : solvers) {
+		if (try_g_tiles(solver, 0, plan)) return plan;
+	}
+	if (not p.scratch.empty()) {
+		auto const disk = p.scratch_space / ranks;
+		auto const solver = p.diagonalize and p.ooc_diagonalize ? "arnoldi" : p.solver;
+		// Smaller tiles pad the last tile row and column less, so they may
+		// fit onto the disk when larger ones do not.
+		std::uint64_t least_disk = 0;
+		for (std::size_t tile = 4096; tile >= 64; tile /= 2) {
+			if (tile > 64 and tile / 2 >= p.N) continue;
+			if (not try_g_tiles(solver, tile, plan)) continue;
+			if (plan.disk <= disk) return plan;
+			if (least_disk == 0 or plan.disk < least_disk) least_disk = plan.disk;
+		}
+		if (least_disk != 0) {
+			throw std::runtime_error{ "Out of core, " + std::string{solver} + " needs "
+			                        + memory::format_bytes(least_disk) + " of `"
+			                        + p.scratch + "` per rank, but only "
+			                        + memory::format_bytes(disk) + " are free." };
+		}
+	}
+	throw std::runtime_error{ "Nothing fits into " + memory::format_bytes(budget)
+	                        + " per rank: the smallest plan (" + smallest.solver
+	                        + (smallest.g_tile != 0 ? ", tiled G" : "")
+	                        + (smallest.tile != 0 ? ", out of core" : "")
+	                        + ") needs " + memory::format_bytes(smallest.estimate.peak())
+	                        + (p.scratch.empty()
+	                              ? ". A scratch directory allows out of core plans."
+	                              : ".") };
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Parses a size like "64G", "1.5 GiB" or "512MB" into bytes.
+
+/// Units are powers of 1024; no unit means bytes.
+/// \exception std::invalid_argument if \p text is not a size.
+///////////////////////////////////////////////////////////////////////////////
+inline auto parse_bytes(std::string const& text) -> std::uint64_t
+{
+	std::size_t end = 0;
+	double value = 0;
+	try { value = std::stod(text, &end); }
+	catch (std::exception const&) { end = 0; }
+	auto unit = text.substr(end);
+	unit.erase( std::remove_if( std::begin(unit), std::end(unit)
+	                          , [](unsigned char c) { return std::isspace(c); } )
+	          , std::end(unit) );
+	std::transform( std::begin(unit), std::end(unit), std::begin(unit)
+	              , [](unsigned char c) { return std::toupper(c); } );
+	auto const prefixes = std::string{"KMGT"};
+	auto const i = unit.empty() ? std::string::npos : prefixes.find(unit[0]);
+	auto const suffix = unit.empty() ? std::string{}
+		: unit.substr(i != std::string::npos ? 1 : 0);
+	if ( end == 0 or value < 0
+	     or (suffix != "" and suffix != "B" and suffix != "IB")
+	     or (i == std::string::npos and suffix == "IB") ) {
+		throw std::invalid_argument{"Invalid size `" + text + "`."};
+	}
+	auto const scale = i != std::string::npos
+		? static_cast<double>(std::uint64_t{1} << (10 * (i + 1))) : 1.0;
+	return static_cast<std::uint64_t>(value * scale);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Prints \p plan for \p p, with its estimate.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Stream>
+auto print(_Stream& out, Problem const& p, Plan const& plan) -> void
+{
+	out << "Plan for N = " << p.N << ", M = " << p.M << ":\n"
+	    << "  solver: " << plan.solver
+	    << (plan.solver != p.solver ? " (instead of " + p.solver + ")" : "")
+	    << "\n"
+	    << "  epsilon: " << ( plan.tile != 0
+	                          ? "on disk in tiles of " + std::to_string(plan.tile)
+	                            + " (" + memory::format_bytes(plan.disk) + " in `"
+	                            + p.scratch + "`)"
+	                          : plan.store_epsilon ? std::string{"stored"}
+	                                               : std::string{"applied matrix-free"} )
+	    << "\n"
+	    << "  eigenvectors kept: " << plan.eigenvectors
+	    << (p.diagonalize and not plan.diagonalize
+	           ? " (epsilon is saved out of core, but not diagonalized)" : "")
+	    << "\n";
+	if (plan.io_per_application != 0) {
+		// Every GMRES iteration of krylov::ShiftInvertKrylov applies epsilon
+		// once, and it allows 2000 of them per inner solve.
+		out << "  disk reads: " << memory::format_bytes(plan.io_per_application)
+		    << " per application of epsilon, up to "
+		    << memory::format_bytes(2000 * plan.io_per_application)
+		    << " per Arnoldi step\n";
+	}
+	out << "  G: " << (plan.g_tile != 0
+	                   ? "in blocks of " + std::to_string(plan.g_tile) + " columns"
+	                   : std::string{"full"}) << "\n"
+	    << "  budget: " << (plan.budget != 0
+	                        ? memory::format_bytes(plan.budget) + " per rank ("
+	                          + std::to_string(p.ranks_per_node) + " per node)"
+	                        : std::string{"unlimited"}) << "\n"
+	    << "Estimated memory use per rank:\n";
+	plan.estimate.print(out);
+}
+
+
+} // namespace planner
+
+} // namespace tcm
+
+
+#endif // TCM_PLANNER_HPP
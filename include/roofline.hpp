@@ -0,0 +1,240 @@
+#ifndef TCM_ROOFLINE_HPP
+#define TCM_ROOFLINE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark.hpp>
+#include <detail/blas_wrapper.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file roofline.hpp
+/// \brief Compares the model work of timed regions with what the machine
+/// can do.
+///
+/// Kernels attribute their model FLOPs and bytes to their timers with
+/// #TCM_ACCOUNT (see detail/cost_model.hpp). #measure() estimates the peak
+/// of the machine with two microbenchmarks: DGEMM for the arithmetic peak
+/// (i.e. what the BLAS in use can reach, with its own threading) and the
+/// STREAM triad for the memory bandwidth. #report() then prints, for every
+/// region with model work, the achieved GFLOP/s and GB/s, the arithmetic
+/// intensity and how close the region gets to the roofline
+/// \f[ \min(\text{peak}, \text{intensity}\cdot\text{bandwidth}). \f]
+///
+/// Ranks sharing a node share its bandwidth: call #measure() on all of them
+/// at the same time, each with its own number of threads and the number of
+/// ranks on the node, to get the share of one rank.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace roofline {
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Peak performance available to this process.
+///////////////////////////////////////////////////////////////////////////////
+struct Machine {
+	double flops     = 0; ///< FLOP/s.
+	double bandwidth = 0; ///< Bytes/s.
+};
+
+
+namespace detail {
+
+using clock = std::chrono::steady_clock;
+
+inline auto seconds(clock::duration const t) -> double
+{ return std::chrono::duration<double>{t}.count(); }
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Best DGEMM rate of \p n x \p n matrices, in FLOP/s, measured for
+/// about \p budget. Bypasses the timers.
+///////////////////////////////////////////////////////////////////////////////
+inline auto measure_flops( std::size_t const n = 1024
+                         , std::chrono::duration<double> const budget =
+                               std::chrono::milliseconds{300} ) -> double
+{
+	std::vector<double> A(n * n, 1.0), B(n * n, 0.5), C(n * n, 0.0);
+	auto const ld    = static_cast<import::blas_int>(n);
+	auto const flops = 2.0 * n * n * n;
+	auto const end   = detail::clock::now() + budget;
+	double best = 0;
+	do {
+		auto const start = detail::clock::now();
+		import::gemm( import::Operator::None, import::Operator::None, n, n, n
+		            , 1.0, A.data(), ld, B.data(), ld, 0.0, C.data(), ld );
+		best = std::max(best, flops / detail::seconds(detail::clock::now() - start));
+	} while (detail::clock::now() < end);
+	return best;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Best STREAM triad `a = b + s * c` bandwidth in bytes/s using
+/// \p threads threads, on arrays of \p n doubles each, out of \p repeat
+/// runs.
+
+/// The arrays of all ranks on a node together must be far larger than the
+/// last-level cache. The default is meant for one rank per node; see
+/// #measure() for several.
+///////////////////////////////////////////////////////////////////////////////
+inline auto measure_bandwidth( std::size_t const threads =
+                                   std::max(1u, std::thread::hardware_concurrency())
+                             , std::size_t const n = std::size_t{1} << 24
+                             , std::size_t const repeat = 5 ) -> double
+{
+	std::vector<double> a(n), b(n), c(n);
+	auto const run = [&](auto&& f) {
+		std::vector<std::thread> pool;
+		for (std::size_t t = 0; t < threads; ++t) {
+			pool.emplace_back([&f, t, threads, n]()
+				{ f(t * n / threads, (t + 1) * n / threads); });
+		}
+		for (auto& x : pool) x.join();
+	};
+	// Every thread touches its part first, so that pages are local to it.
+	run([&](auto const first, auto const last) {
+		std::fill(a.data() + first, a.data() + last, 0.0);
+		std::fill(b.data() + first, b.data() + last, 1.0);
+		std::fill(c.data() + first, c.data() + last, 2.0);
+	});
+
+	double best = 0;
+	for (std::size_t i = 0; i < repeat; ++i) {
+		auto const start = detail::clock::now();
+		run([&](auto const first, auto const last) {
+			for (auto j = first; j < last; ++j) a[j] = b[j] + 3.0 * c[j];
+		});
+		auto const t = detail::seconds(detail::clock::now() - start);
+		best = std::max(best, 3 * sizeof(double) * n / t);
+	}
+	return best;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Runs both microbenchmarks. Takes about a second.
+
+/// \param threads  Threads of this rank, e.g. its number of BLAS threads.
+/// \param ranks    Number of ranks on the node measuring at the same time.
+///                 The STREAM arrays are divided among them, so that the
+///                 node allocates 384 MiB in total (but at least 24 MiB per
+///                 rank).
+///////////////////////////////////////////////////////////////////////////////
+inline auto measure( std::size_t const threads =
+                         std::max(1u, std::thread::hardware_concurrency())
+                   , std::size_t const ranks = 1 ) -> Machine
+{
+	auto const n = std::max( std::size_t{1} << 20
+	                       , (std::size_t{1} << 24) / std::max<std::size_t>(1, ranks) );
+	return {measure_flops(), measure_bandwidth(std::max<std::size_t>(1, threads), n)};
+}
+
+
+namespace detail {
+
+inline auto has_work(timing::Record const& r) noexcept -> bool
+{ return r.work.flops > 0 or r.work.bytes > 0; }
+
+
+inline auto name_width( std::vector<timing::Record> const& records
+                      , std::size_t const depth ) -> std::size_t
+{
+	std::size_t width = 0;
+	for (auto const& r : records) {
+		if (not has_work(r)) continue;
+		width = std::max(width, 2 * depth + r.name.size());
+		width = std::max(width, name_width(r.children, depth + 1));
+	}
+	return width;
+}
+
+
+template <class _Stream>
+auto print( _Stream& out, std::vector<timing::Record> const& records
+          , Machine const& machine, std::size_t const depth
+          , std::size_t const width ) -> void
+{
+	for (auto const& r : records) {
+		if (not has_work(r)) continue;
+		auto const flops      = r.inclusive > 0 ? r.work.flops / r.inclusive : 0.0;
+		auto const bandwidth  = r.inclusive > 0 ? r.work.bytes / r.inclusive : 0.0;
+		auto const intensity  = r.work.bytes > 0 ? r.work.flops / r.work.bytes : 0.0;
+		auto const attainable = r.work.bytes > 0
+			? std::min(machine.flops, intensity * machine.bandwidth)
+			: machine.flops;
+		auto const memory_bound = r.work.bytes > 0
+			and intensity * machine.bandwidth < machine.flops;
+		out << "[ " << std::left << std::setw(width)
+		    << (std::string(2 * depth, ' ') + r.name) << std::right
+		    << " | " << std::setw(12) << std::defaultfloat << r.inclusive
+		    << std::fixed
+		    << " | " << std::setw(9) << 1E-9 * flops
+		    << " | " << std::setw(9) << 1E-9 * bandwidth
+		    << " | " << std::setw(9) << intensity
+		    << " | " << std::setw(6)
+		    << (attainable > 0 ? 100 * flops / attainable : 0.0)
+		    << " | " << std::setw(7) << (memory_bound ? "memory" : "compute")
+		    << " ]\n";
+		print(out, r.children, machine, depth + 1, width);
+	}
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Prints the roofline summary of all timed regions with model work.
+
+/// For every region: inclusive time, achieved GFLOP/s and GB/s, arithmetic
+/// intensity (FLOP per byte), achieved percentage of the attainable
+/// performance and whether the roofline limits it by memory bandwidth or by
+/// arithmetic.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Stream>
+auto report(_Stream& out, Machine const& machine) -> void
+{
+	auto const records   = timing::snapshot();
+	auto const flags     = out.flags();
+	auto const precision = out.precision();
+	out << std::fixed << std::setprecision(2);
+	out << "Peak: " << 1E-9 * machine.flops << " GFLOP/s (DGEMM), "
+	    << 1E-9 * machine.bandwidth << " GB/s (triad); ridge point at "
+	    << (machine.bandwidth > 0 ? machine.flops / machine.bandwidth : 0.0)
+	    << " FLOP/byte.\n";
+
+	auto const width = std::max<std::size_t>(6, detail::name_width(records, 0));
+	auto const hline = std::string(width + 12 + 3 * 9 + 6 + 7 + 20, '-');
+	out << "[" << hline << "]\n";
+	out << "[ " << std::left << std::setw(width) << "region" << std::right
+	    << " | " << std::setw(12) << "incl [s]"
+	    << " | " << std::setw(9)  << "GFLOP/s"
+	    << " | " << std::setw(9)  << "GB/s"
+	    << " | " << std::setw(9)  << "FLOP/B"
+	    << " | " << std::setw(6)  << "% roof"
+	    << " | " << std::setw(7)  << "bound"
+	    << " ]\n";
+	out << "[" << hline << "]\n";
+	detail::print(out, records, machine, 0, width);
+	out << "[" << hline << "]\n";
+	out.flags(flags);
+	out.precision(precision);
+}
+
+
+} // namespace roofline
+
+} // namespace tcm
+
+
+#endif // TCM_ROOFLINE_HPP
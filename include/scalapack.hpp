@@ -0,0 +1,635 @@
+#ifndef TCM_SCALAPACK_HPP
+#define TCM_SCALAPACK_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <mpi.h>
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/core/demangle.hpp>
+#include <boost/mpi/collectives.hpp>
+#include <boost/mpi/communicator.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <detail/config.hpp>
+#include <detail/lapack_int.hpp>
+#include <detail/scalapack_wrapper.hpp>
+#include <benchmark.hpp>
+#include <matrix.hpp>
+#include <matrix_serialization.hpp>
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file scalapack.hpp
+/// \brief Distributed dense matrices and the ScaLAPACK eigensolver.
+///
+/// Matrices are distributed 2D block-cyclically over a BLACS process grid,
+/// with square blocks and the first block on process (0, 0). Each process
+/// stores its part as a column-major local matrix, which is exactly what
+/// ScaLAPACK expects.
+///
+/// Matrices are read and written with MPI-IO in the same binary archive
+/// format as tcm::Matrix (see matrix_serialization.hpp), so files are
+/// interchangeable with the serial tools. Every process only touches its
+/// own blocks.
+///////////////////////////////////////////////////////////////////////////////
+
+
+namespace tcm {
+
+namespace scalapack {
+
+
+using lapack_int = import::lapack_int;
+
+
+namespace detail {
+
+inline auto check_mpi(int const code, char const* what) -> void
+{
+	if (code == MPI_SUCCESS) return;
+	char message[MPI_MAX_ERROR_STRING];
+	int  length = 0;
+	MPI_Error_string(code, message, &length);
+	throw std::runtime_error{ std::string{what} + " failed: "
+	                        + std::string{message, message + length} };
+}
+
+
+/// \brief Number of rows (or columns) of a global dimension \p n owned by
+/// process \p p out of \p nprocs, for blocks of size \p nb. Same as
+/// ScaLAPACK's NUMROC with ISRCPROC = 0.
+inline auto numroc( std::size_t const n, std::size_t const nb
+                  , std::size_t const p, std::size_t const nprocs )
+	noexcept -> std::size_t
+{
+	auto const blocks = n / nb;
+	auto       count  = (blocks / nprocs) * nb;
+	auto const extra  = blocks % nprocs;
+	if (p < extra)       count += nb;
+	else if (p == extra) count += n % nb;
+	return count;
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A BLACS process grid.
+///
+/// The processes of a communicator are arranged in an as square as possible
+/// nprow x npcol grid in row-major order, i.e. rank `r` is at
+/// `(r / npcol, r % npcol)`. This is also the order MPI uses for
+/// distributed array types, which is what makes the MPI-IO below work.
+///////////////////////////////////////////////////////////////////////////////
+class Grid {
+	boost::mpi::communicator _comm;
+	int _handle;
+	int _context;
+	int _nprow;
+	int _npcol;
+	int _row;
+	int _col;
+
+public:
+	explicit Grid(boost::mpi::communicator const& comm)
+		: _comm{comm}
+	{
+		auto const size = _comm.size();
+		_nprow = static_cast<int>(std::sqrt(static_cast<double>(size)));
+		while (size % _nprow != 0) --_nprow;
+		_npcol = size / _nprow;
+
+		_handle  = import::Csys2blacs_handle(static_cast<MPI_Comm>(_comm));
+		_context = _handle;
+		import::Cblacs_gridinit(&_context, "Row", _nprow, _npcol);
+		int nprow, npcol;
+		import::Cblacs_gridinfo(_context, &nprow, &npcol, &_row, &_col);
+		if (nprow != _nprow or npcol != _npcol) {
+			throw std::runtime_error{"Failed to create the BLACS grid."};
+		}
+	}
+
+	Grid(Grid const&) = delete;
+	auto operator=(Grid const&) -> Grid& = delete;
+
+	~Grid()
+	{
+		import::Cblacs_gridexit(_context);
+		import::Cfree_blacs_system_handle(_handle);
+	}
+
+	auto communicator() const noexcept -> boost::mpi::communicator const&
+	{ return _comm; }
+	auto context() const noexcept { return _context; }
+	auto nprow()   const noexcept { return _nprow; }
+	auto npcol()   const noexcept { return _npcol; }
+	auto row()     const noexcept { return _row; }
+	auto col()     const noexcept { return _col; }
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Block-cyclically distributed matrix.
+///
+/// Only the local part is stored. Global element \f$ (i, j) \f$ lives on
+/// process \f$ (\lfloor i/nb \rfloor \bmod nprow, \lfloor j/nb \rfloor
+/// \bmod npcol) \f$.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T>
+class DistributedMatrix {
+
+public:
+	using value_type = _T;
+	using size_type  = std::size_t;
+
+private:
+	Grid const*               _grid;
+	size_type                 _height;
+	size_type                 _width;
+	size_type                 _block;
+	size_type                 _local_height;
+	size_type                 _local_width;
+	std::vector<_T>           _local;
+	std::array<lapack_int, 9> _desc;
+
+public:
+	DistributedMatrix( Grid const& grid
+	                 , size_type const height, size_type const width
+	                 , size_type const block )
+		: _grid{&grid}, _height{height}, _width{width}
+		, _block{ block != 0 ? block : throw std::invalid_argument{
+		            "Block size must be positive." } }
+		, _local_height{ detail::numroc( height, _block
+		                               , static_cast<size_type>(grid.row())
+		                               , static_cast<size_type>(grid.nprow()) ) }
+		, _local_width{ detail::numroc( width, _block
+		                              , static_cast<size_type>(grid.col())
+		                              , static_cast<size_type>(grid.npcol()) ) }
+		, _local(ldim() * _local_width)
+	{
+		lapack_int const M     = boost::numeric_cast<lapack_int>(height);
+		lapack_int const N     = boost::numeric_cast<lapack_int>(width);
+		lapack_int const NB    = boost::numeric_cast<lapack_int>(block);
+		lapack_int const ZERO  = 0;
+		lapack_int const CTXT  = grid.context();
+		lapack_int const LLD   = boost::numeric_cast<lapack_int>(ldim());
+		lapack_int       INFO  = 0;
+		import::descinit_( _desc.data(), &M, &N, &NB, &NB, &ZERO, &ZERO
+		                 , &CTXT, &LLD, &INFO );
+		if (INFO != 0) {
+			throw std::invalid_argument{ "DESCINIT: argument #"
+			                           + std::to_string(-INFO)
+			                           + " had an illegal value." };
+		}
+	}
+
+	DistributedMatrix(DistributedMatrix const&) = delete;
+	DistributedMatrix(DistributedMatrix &&) = default;
+	auto operator=(DistributedMatrix const&) -> DistributedMatrix& = delete;
+	auto operator=(DistributedMatrix &&) -> DistributedMatrix& = default;
+
+	auto grid()         const noexcept -> Grid const& { return *_grid; }
+	auto height()       const noexcept { return _height; }
+	auto width()        const noexcept { return _width; }
+	auto block()        const noexcept { return _block; }
+	auto local_height() const noexcept { return _local_height; }
+	auto local_width()  const noexcept { return _local_width; }
+	/// \brief Leading dimension of the local matrix. ScaLAPACK wants it to
+	/// be at least 1 even if this process owns no rows.
+	auto ldim()         const noexcept
+	{ return std::max<size_type>(1, _local_height); }
+	auto descriptor()   const noexcept { return _desc.data(); }
+
+	auto data()       noexcept { return _local.data(); }
+	auto data() const noexcept { return _local.data(); }
+
+	/// \brief Element \f$ (i, j) \f$ of the local matrix.
+	auto local(size_type const i, size_type const j) noexcept -> _T&
+	{ return _local[i + j * ldim()]; }
+	auto local(size_type const i, size_type const j) const noexcept -> _T const&
+	{ return _local[i + j * ldim()]; }
+
+	/// \brief Global row index of local row \p i.
+	auto global_row(size_type const i) const noexcept -> size_type
+	{
+		auto const nprow = static_cast<size_type>(_grid->nprow());
+		return ( (i / _block) * nprow + static_cast<size_type>(_grid->row()) )
+		       * _block + i % _block;
+	}
+
+	/// \brief Global column index of local column \p j.
+	auto global_column(size_type const j) const noexcept -> size_type
+	{
+		auto const npcol = static_cast<size_type>(_grid->npcol());
+		return ( (j / _block) * npcol + static_cast<size_type>(_grid->col()) )
+		       * _block + j % _block;
+	}
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Returns a matrix with the same distribution as \p A and elements
+/// `f(A(i, j))`.
+///////////////////////////////////////////////////////////////////////////////
+template <class _To, class _T, class _F>
+auto transform(DistributedMatrix<_T> const& A, _F&& f) -> DistributedMatrix<_To>
+{
+	DistributedMatrix<_To> B{A.grid(), A.height(), A.width(), A.block()};
+	for (std::size_t j = 0; j < A.local_width(); ++j)
+		for (std::size_t i = 0; i < A.local_height(); ++i)
+			B.local(i, j) = f(A.local(i, j));
+	return B;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Distributed version of tcm::is_real().
+///////////////////////////////////////////////////////////////////////////////
+template <class _T>
+auto is_real(DistributedMatrix<_T> const& A, utils::Base<_T> const tol) -> bool
+{
+	using _R = utils::Base<_T>;
+	_R max_abs  = 0;
+	_R max_imag = 0;
+	for (std::size_t j = 0; j < A.local_width(); ++j) {
+		for (std::size_t i = 0; i < A.local_height(); ++i) {
+			max_abs  = std::max(max_abs, std::abs(A.local(i, j)));
+			max_imag = std::max(max_imag, std::abs(std::imag(A.local(i, j))));
+		}
+	}
+	auto const& comm = A.grid().communicator();
+	boost::mpi::all_reduce( comm, boost::mpi::inplace(max_abs)
+	                      , boost::mpi::maximum<_R>{} );
+	boost::mpi::all_reduce( comm, boost::mpi::inplace(max_imag)
+	                      , boost::mpi::maximum<_R>{} );
+	return max_imag <= tol * max_abs;
+}
+
+
+
+//                   ===================
+//                   |      HEEVD      |
+//                   ===================
+
+namespace {
+
+template <class _T>
+auto call_pheevd( lapack_int const N
+                , DistributedMatrix<_T>& A, _T* W, DistributedMatrix<_T>& Z
+                , utils::Type2Type<_T> ) -> void
+{
+	char const JOBZ   = 'V';
+	char const UPLO   = 'U';
+	lapack_int const ONE = 1;
+	lapack_int LWORK  = -1;
+	lapack_int LIWORK = -1;
+	lapack_int INFO   = 0;
+
+	{
+		_T         _work_dummy;
+		lapack_int _iwork_dummy;
+		import::pheevd<_T>( &JOBZ, &UPLO, &N
+		                  , A.data(), &ONE, &ONE, A.descriptor(), W
+		                  , Z.data(), &ONE, &ONE, Z.descriptor()
+		                  , &_work_dummy, &LWORK
+		                  , &_iwork_dummy, &LIWORK
+		                  , &INFO );
+		LWORK  = lapack::workspace_size(_work_dummy);
+		// ScaLAPACK's own workspace query underestimates LIWORK for some
+		// grids; the documented minimum is 7N + 8NPCOL + 2.
+		LIWORK = std::max( _iwork_dummy
+		                 , 7 * N + 8 * A.grid().npcol() + 2 );
+	}
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO)
+		                           + " had an illegal value." };
+	}
+
+	std::vector<_T>         WORK(static_cast<std::size_t>(LWORK));
+	std::vector<lapack_int> IWORK(static_cast<std::size_t>(LIWORK));
+	import::pheevd<_T>( &JOBZ, &UPLO, &N
+	                  , A.data(), &ONE, &ONE, A.descriptor(), W
+	                  , Z.data(), &ONE, &ONE, Z.descriptor()
+	                  , WORK.data(), &LWORK
+	                  , IWORK.data(), &LIWORK
+	                  , &INFO );
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO)
+		                           + " had an illegal value." };
+	}
+	if (INFO > 0) {
+		throw std::runtime_error{ "P?SYEVD failed to compute an eigenvalue." };
+	}
+}
+
+
+template <class _T>
+auto call_pheevd( lapack_int const N
+                , DistributedMatrix<std::complex<_T>>& A, _T* W
+                , DistributedMatrix<std::complex<_T>>& Z
+                , utils::Type2Type<std::complex<_T>> ) -> void
+{
+	char const JOBZ   = 'V';
+	char const UPLO   = 'U';
+	lapack_int const ONE = 1;
+	lapack_int LWORK  = -1;
+	lapack_int LRWORK = -1;
+	lapack_int LIWORK = -1;
+	lapack_int INFO   = 0;
+
+	{
+		std::complex<_T> _work_dummy;
+		_T               _rwork_dummy;
+		lapack_int       _iwork_dummy;
+		import::pheevd<std::complex<_T>>
+			( &JOBZ, &UPLO, &N
+			, A.data(), &ONE, &ONE, A.descriptor(), W
+			, Z.data(), &ONE, &ONE, Z.descriptor()
+			, &_work_dummy, &LWORK
+			, &_rwork_dummy, &LRWORK
+			, &_iwork_dummy, &LIWORK
+			, &INFO );
+		LWORK  = lapack::workspace_size(_work_dummy);
+		LRWORK = lapack::workspace_size(_rwork_dummy);
+		LIWORK = std::max( _iwork_dummy
+		                 , 7 * N + 8 * A.grid().npcol() + 2 );
+	}
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO)
+		                           + " had an illegal value." };
+	}
+
+	std::vector<std::complex<_T>> WORK(static_cast<std::size_t>(LWORK));
+	std::vector<_T>               RWORK(static_cast<std::size_t>(LRWORK));
+	std::vector<lapack_int>       IWORK(static_cast<std::size_t>(LIWORK));
+	import::pheevd<std::complex<_T>>
+		( &JOBZ, &UPLO, &N
+		, A.data(), &ONE, &ONE, A.descriptor(), W
+		, Z.data(), &ONE, &ONE, Z.descriptor()
+		, WORK.data(), &LWORK
+		, RWORK.data(), &LRWORK
+		, IWORK.data(), &LIWORK
+		, &INFO );
+	if (INFO < 0) {
+		throw std::invalid_argument{ "Argument #" + std::to_string(-INFO)
+		                           + " had an illegal value." };
+	}
+	if (INFO > 0) {
+		throw std::runtime_error{ "P?HEEVD failed to compute an eigenvalue." };
+	}
+}
+
+} // unnamed namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes all eigenvalues and eigenvectors of the Hermitian matrix
+/// \p A using divide-and-conquer (P?HEEVD).
+///
+/// \p A is destroyed. Eigenvalues are returned in ascending order in \p W,
+/// which is the same on all processes. \p Z must be distributed like \p A.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T>
+auto heevd( DistributedMatrix<_T>& A
+          , Matrix<utils::Base<_T>>& W
+          , DistributedMatrix<_T>& Z ) -> void
+{
+	TCM_MEASURE( "scalapack::heevd<" + boost::core::demangle(
+		typeid(_T).name()) + ">()" );
+	if (A.height() != A.width()) {
+		throw std::invalid_argument{"Matrix must be square."};
+	}
+	if ( Z.height() != A.height() or Z.width() != A.width()
+	     or Z.block() != A.block() or &Z.grid() != &A.grid() ) {
+		throw std::invalid_argument{ "Eigenvectors must be distributed like "
+		                             "the matrix." };
+	}
+	auto const N = A.height();
+	W = Matrix<utils::Base<_T>>{N, 1};
+	if (N == 0) return;
+	call_pheevd( boost::numeric_cast<lapack_int>(N)
+	           , A, W.data(), Z, utils::Type2Type<_T>{} );
+}
+
+
+
+//                   ===================
+//                   |       I/O       |
+//                   ===================
+
+namespace detail {
+
+/// \brief The bytes preceding the elements in a binary archive of an
+/// \p height x \p width Matrix<_T>.
+///
+/// boost::archive writes a fixed preamble, then the height and width as raw
+/// `std::size_t`s and then the elements in column-major order without any
+/// separators. We let boost produce the preamble for an empty matrix and
+/// patch the dimensions.
+template <class _T>
+auto archive_header(std::size_t const height, std::size_t const width)
+	-> std::string
+{
+	std::ostringstream out;
+	{
+		boost::archive::binary_oarchive archive{out};
+		archive << Matrix<_T>{};
+	}
+	auto header = out.str();
+	auto const offset = header.size() - 2 * sizeof(std::size_t);
+	std::memcpy(&header[offset], &height, sizeof(std::size_t));
+	std::memcpy(&header[offset + sizeof(std::size_t)], &width, sizeof(std::size_t));
+	return header;
+}
+
+
+/// \brief RAII wrapper around MPI_File.
+class File {
+	MPI_File _fh = MPI_FILE_NULL;
+
+public:
+	File( boost::mpi::communicator const& comm, std::string const& filename
+	    , int const mode )
+	{
+		auto const code = MPI_File_open( static_cast<MPI_Comm>(comm)
+		                               , filename.c_str(), mode
+		                               , MPI_INFO_NULL, &_fh );
+		if (code != MPI_SUCCESS) {
+			check_mpi(code, ("Opening `" + filename + "`").c_str());
+		}
+	}
+
+	File(File const&) = delete;
+	auto operator=(File const&) -> File& = delete;
+
+	~File() { if (_fh != MPI_FILE_NULL) MPI_File_close(&_fh); }
+
+	auto get() noexcept -> MPI_File { return _fh; }
+};
+
+
+/// \brief RAII wrapper around the MPI datatypes describing the local part
+/// of \p A: one element and the block-cyclic file view.
+class Layout {
+	MPI_Datatype _element  = MPI_DATATYPE_NULL;
+	MPI_Datatype _filetype = MPI_DATATYPE_NULL;
+
+public:
+	template <class _T>
+	explicit Layout(DistributedMatrix<_T> const& A)
+	{
+		check_mpi( MPI_Type_contiguous(sizeof(_T), MPI_BYTE, &_element)
+		         , "MPI_Type_contiguous" );
+		check_mpi(MPI_Type_commit(&_element), "MPI_Type_commit");
+
+		auto const& grid = A.grid();
+		int const gsizes[]   = { boost::numeric_cast<int>(A.height())
+		                       , boost::numeric_cast<int>(A.width()) };
+		int const distribs[] = { MPI_DISTRIBUTE_CYCLIC, MPI_DISTRIBUTE_CYCLIC };
+		int const dargs[]    = { boost::numeric_cast<int>(A.block())
+		                       , boost::numeric_cast<int>(A.block()) };
+		int const psizes[]   = { grid.nprow(), grid.npcol() };
+		check_mpi( MPI_Type_create_darray( grid.communicator().size()
+		                                 , grid.communicator().rank()
+		                                 , 2, gsizes, distribs, dargs, psizes
+		                                 , MPI_ORDER_FORTRAN, _element
+		                                 , &_filetype )
+		         , "MPI_Type_create_darray" );
+		check_mpi(MPI_Type_commit(&_filetype), "MPI_Type_commit");
+	}
+
+	Layout(Layout const&) = delete;
+	auto operator=(Layout const&) -> Layout& = delete;
+
+	~Layout()
+	{
+		if (_filetype != MPI_DATATYPE_NULL) MPI_Type_free(&_filetype);
+		if (_element != MPI_DATATYPE_NULL) MPI_Type_free(&_element);
+	}
+
+	auto element()  const noexcept { return _element; }
+	auto filetype() const noexcept { return _filetype; }
+};
+
+
+inline auto to_count(std::size_t const n) -> int
+{ return boost::numeric_cast<int>(n); }
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Reads a Matrix<_T> saved with boost::archive::binary_oarchive
+/// from \p filename and distributes it over \p grid in blocks of \p block.
+///
+/// All processes of the grid must call this function.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T>
+auto read( Grid const& grid, std::string const& filename
+         , std::size_t const block ) -> DistributedMatrix<_T>
+{
+	TCM_MEASURE( "scalapack::read<" + boost::core::demangle(
+		typeid(_T).name()) + ">()" );
+	detail::File file{grid.communicator(), filename, MPI_MODE_RDONLY};
+
+	auto const expected = detail::archive_header<_T>(0, 0);
+	std::string header(expected.size(), '\0');
+	MPI_Status status;
+	detail::check_mpi( MPI_File_read_at_all( file.get(), 0, &header[0]
+	                                       , detail::to_count(header.size())
+	                                       , MPI_BYTE, &status )
+	                 , "MPI_File_read_at_all" );
+	auto const offset = header.size() - 2 * sizeof(std::size_t);
+	if (header.compare(0, offset, expected, 0, offset) != 0) {
+		throw std::runtime_error{ "`" + filename + "` is not a binary archive "
+		                          "of a matrix of " + boost::core::demangle(
+		                          typeid(_T).name()) + "." };
+	}
+	std::size_t height, width;
+	std::memcpy(&height, &header[offset], sizeof(std::size_t));
+	std::memcpy(&width, &header[offset + sizeof(std::size_t)], sizeof(std::size_t));
+	MPI_Offset size;
+	detail::check_mpi( MPI_File_get_size(file.get(), &size)
+	                 , "MPI_File_get_size" );
+	if ( static_cast<std::size_t>(size)
+	     != header.size() + height * width * sizeof(_T) ) {
+		throw std::runtime_error{ "`" + filename + "` does not contain a "
+		                          + std::to_string(height) + " x "
+		                          + std::to_string(width) + " matrix of "
+		                          + boost::core::demangle(typeid(_T).name())
+		                          + "." };
+	}
+
+	DistributedMatrix<_T> A{grid, height, width, block};
+	detail::Layout const layout{A};
+	char native[] = "native";
+	detail::check_mpi( MPI_File_set_view( file.get()
+	                                    , static_cast<MPI_Offset>(header.size())
+	                                    , layout.element(), layout.filetype()
+	                                    , native, MPI_INFO_NULL )
+	                 , "MPI_File_set_view" );
+	detail::check_mpi( MPI_File_read_all( file.get(), A.data()
+	                                    , detail::to_count(
+	                                        A.local_height() * A.local_width())
+	                                    , layout.element(), &status )
+	                 , "MPI_File_read_all" );
+	return A;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Writes \p A to \p filename in the format of
+/// boost::archive::binary_oarchive, i.e. the file can be read back as a
+/// Matrix<_T> by the serial tools.
+///
+/// All processes of the grid must call this function.
+///////////////////////////////////////////////////////////////////////////////
+template <class _T>
+auto write(DistributedMatrix<_T> const& A, std::string const& filename) -> void
+{
+	TCM_MEASURE( "scalapack::write<" + boost::core::demangle(
+		typeid(_T).name()) + ">()" );
+	auto const& comm = A.grid().communicator();
+	detail::File file{comm, filename, MPI_MODE_WRONLY | MPI_MODE_CREATE};
+	detail::check_mpi( MPI_File_set_size(file.get(), 0), "MPI_File_set_size" );
+
+	auto const header = detail::archive_header<_T>(A.height(), A.width());
+	MPI_Status status;
+	if (comm.rank() == 0) {
+		detail::check_mpi( MPI_File_write_at( file.get(), 0, header.data()
+		                                    , detail::to_count(header.size())
+		                                    , MPI_BYTE, &status )
+		                 , "MPI_File_write_at" );
+	}
+
+	detail::Layout const layout{A};
+	char native[] = "native";
+	detail::check_mpi( MPI_File_set_view( file.get()
+	                                    , static_cast<MPI_Offset>(header.size())
+	                                    , layout.element(), layout.filetype()
+	                                    , native, MPI_INFO_NULL )
+	                 , "MPI_File_set_view" );
+	detail::check_mpi( MPI_File_write_all( file.get(), A.data()
+	                                     , detail::to_count(
+	                                         A.local_height() * A.local_width())
+	                                     , layout.element(), &status )
+	                 , "MPI_File_write_all" );
+}
+
+
+} // namespace scalapack
+
+} // namespace tcm
+
+
+#endif // TCM_SCALAPACK_HPP
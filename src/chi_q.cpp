@@ -0,0 +1,303 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <iterator>
+#include <cmath>
+#include <regex>
+#include <typeinfo>
+#include <typeindex>
+#include <unordered_map>
+
+#include <boost/program_options.hpp>
+#include <boost/log/sources/logger.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <benchmark.hpp>
+#include <logging.hpp>
+
+#include <constants.hpp>
+#include <matrix_serialization.hpp>
+#include <momentum_space.hpp>
+
+
+
+namespace po = boost::program_options;
+
+auto init_options() -> po::options_description
+{
+	po::options_description description;
+	description.add_options()
+		( "help", "Produce the help message." )
+		( "type"
+		, po::value<std::string>()->required()
+		, "Type of an element of the eigenstates matrix. It may be one of: "
+		  "float, double, cfloat, cdouble." )
+		( "energies"
+		, po::value<std::string>()->required()
+		, "File to where the eigenenergies were saved to (by solve_system)." )
+		( "states"
+		, po::value<std::string>()->required()
+		, "File to where the eigenstates were saved to (by solve_system)." )
+		( "positions"
+		, po::value<std::string>()->required()
+		, "File to where atomic site positions were saved to." )
+		( "q"
+		, po::value<std::string>()
+		, "List of |q|s separated by commas. MIND YOU: no spaces! Required "
+		  "unless --optical is given." )
+		( "direction"
+		, po::value<std::string>()->required()
+		, "Direction of q as (x,y,z). It is automatically normalized." )
+		( "optical"
+		, "Compute the q -> 0 (dipole) limit chi(q, omega) / |q|^2 "
+		  "instead of chi(q, omega) for given |q|s." )
+		( "frequency.start"
+		, po::value<double>()->required()
+		, "Starting frequency in eV." )
+		( "frequency.stop"
+		, po::value<double>()->required()
+		, "Stopping frequency in eV." )
+		( "frequency.step"
+		, po::value<double>()->required()
+		, "Step in frequency in eV." );
+	description.add(tcm::init_constants_options<double>());
+	return description;
+}
+
+
+auto element_type(std::string input) -> std::type_index
+{
+	using namespace std::string_literals;
+	static std::unordered_map<std::string, std::type_index> const types =
+		{ { "float"s,   std::type_index(typeid(float))                }
+		, { "double"s,  std::type_index(typeid(double))               }
+		, { "cfloat"s,  std::type_index(typeid(std::complex<float>))  }
+		, { "cdouble"s, std::type_index(typeid(std::complex<double>)) }
+		};
+
+	boost::to_lower(input);
+	try {
+		return types.at(input);
+	} catch(std::out_of_range & e) {
+		std::cerr << "Invalid element type `" + input + "`!\n";
+		throw;
+	}
+}
+
+
+template <class _R>
+auto parse_direction(std::string str) -> std::array<_R, 3>
+{
+	using namespace boost;
+	using namespace boost::algorithm;
+
+	auto const normalize = [](_R const x, _R const y, _R const z)
+		-> std::array<_R, 3> {
+		auto const _abs = _R{1.0} / std::sqrt(x * x + y * y + z * z);
+		return {_abs * x, _abs * y, _abs * z};
+	};
+
+	std::regex vector_re{"\\((.*),(.*),(.*)\\)"};
+	std::smatch results;
+
+	trim(str);
+	if (std::regex_match(str, results, vector_re)) {
+		assert(results.size() == 4);
+		return normalize( lexical_cast<_R>(trim_copy(results[1].str()))
+		                , lexical_cast<_R>(trim_copy(results[2].str()))
+		                , lexical_cast<_R>(trim_copy(results[3].str())) );
+	}
+	throw std::invalid_argument{ "Could not convert '" + str
+	                           + "' to a 3D vector."};
+}
+
+
+template <class _R>
+auto parse_qs(std::string const& str) -> std::vector<_R>
+{
+	std::vector<std::string> tokens;
+	boost::algorithm::split(tokens, str, [](auto const ch) { return ch == ','; });
+
+	std::vector<_R> qs;
+	qs.reserve(tokens.size());
+	for (auto const& token : tokens)
+		qs.push_back(boost::lexical_cast<_R>(boost::algorithm::trim_copy(token)));
+	return qs;
+}
+
+
+template<class _Help, class _Run>
+auto process_command_line( int argc, char** argv
+                         , _Help&& help
+						 , _Run&& run ) -> void
+{
+	auto const description = init_options();
+	po::variables_map vm;
+
+	po::store( po::command_line_parser(argc, argv)
+	              .options(description)
+	              .run()
+	         , vm );
+
+	if (vm.count("help")) {
+		help(description);
+		return;
+	}
+
+	po::notify(vm);
+	run(vm);
+}
+
+
+template<class _T>
+auto load_matrix(std::string const& file_name) -> tcm::Matrix<_T>
+{
+	std::ifstream in_stream{file_name};
+	if (not in_stream)
+		throw std::runtime_error{"Failed to open `" + file_name + "`."};
+	boost::archive::binary_iarchive in_archive{in_stream};
+
+	tcm::Matrix<_T> A;
+	in_archive >> A;
+	return A;
+}
+
+
+template<class _T>
+auto read_positions(std::string const& file_name)
+	-> std::vector<std::array<_T, 3>>
+{
+	std::ifstream in_stream{file_name};
+	if (not in_stream)
+		throw std::runtime_error{"Failed to open `" + file_name + "`."};
+
+	std::vector<std::array<_T, 3>> positions;
+	auto i = std::istream_iterator<_T>{in_stream};
+	while(i != std::istream_iterator<_T>{}) {
+		const auto x = *i++;
+		const auto y = *i++;
+		const auto z = *i++;
+		positions.push_back({x, y, z});
+	}
+
+	return positions;
+}
+
+
+// Returns start, start + step, ..., stop as given by --frequency.*. Includes
+// stop even if it is a few ulps short of the grid.
+auto frequencies(po::variables_map const& vm) -> std::vector<double>
+{
+	auto const start = vm["frequency.start"].as<double>();
+	auto const stop  = vm["frequency.stop"].as<double>();
+	auto const step  = vm["frequency.step"].as<double>();
+	if (not (step > 0)) {
+		throw std::invalid_argument{"--frequency.step must be positive."};
+	}
+	if (not std::isfinite(start) or not std::isfinite(stop)) {
+		throw std::invalid_argument{ "--frequency.start and --frequency.stop "
+		                             "must be finite." };
+	}
+
+	std::vector<double> ws;
+	if (stop < start) return ws;
+	auto const last = std::floor((stop - start) / step + 1E-6);
+	if (not (last < 1E9)) {
+		throw std::invalid_argument{ "--frequency.step is too small for the "
+		                             "given range." };
+	}
+	auto const count = static_cast<std::size_t>(last) + 1;
+	ws.reserve(count);
+	for (std::size_t i = 0; i < count; ++i)
+		ws.push_back(start + i * step);
+	return ws;
+}
+
+
+template <class _T>
+auto run(po::variables_map const& vm) -> void
+{
+	using _R = tcm::utils::Base<_T>;
+	boost::log::sources::severity_logger<tcm::severity_level> lg;
+
+	auto const ws = frequencies(vm);
+	auto const direction =
+		parse_direction<_R>(vm["direction"].as<std::string>());
+	auto const positions =
+		read_positions<_R>(vm["positions"].as<std::string>());
+	auto const E   = load_matrix<_R>(vm["energies"].as<std::string>());
+	auto const Psi = load_matrix<_T>(vm["states"].as<std::string>());
+	auto const cs  =
+		tcm::load_constants<_R, double, std::map<std::string, _R>>(vm);
+
+	if (Psi.height() != positions.size() or Psi.width() != E.height()) {
+		throw std::invalid_argument{ "Dimensions of energies, states and "
+		                             "positions do not match." };
+	}
+
+	// All frequencies are batched, so that |rho(q)|^2 is read from memory
+	// only once per q.
+	std::vector<std::complex<_R>> omegas;
+	omegas.reserve(ws.size());
+	for (auto const w : ws) {
+		omegas.emplace_back(w, cs.at("tau"));
+	}
+
+	auto const print = [&omegas](auto const q, auto const& chi) {
+		for (std::size_t w = 0; w < omegas.size(); ++w) {
+			std::cout << q << '\t' << std::real(omegas[w]) << '\t'
+			          << std::real(chi[w]) << '\t'
+			          << std::imag(chi[w]) << '\n';
+		}
+	};
+
+	std::cout << std::scientific << std::setprecision(15);
+	if (vm.count("optical")) {
+		LOG(lg, info) << "Calculating the optical limit...";
+		auto const x2  = tcm::chi_q_function::dipole_matrix_elements
+			(direction, positions, Psi, cs.at("pi"));
+		print(_R{0}, tcm::chi_q_function::make(omegas, E, x2, cs, lg));
+		return;
+	}
+
+	if (not vm.count("q")) {
+		throw std::invalid_argument{"Either --q or --optical is required."};
+	}
+	for (auto const q : parse_qs<_R>(vm["q"].as<std::string>())) {
+		LOG(lg, info) << "Calculating chi for |q| = " << q << "...";
+		auto const wavevector = std::array<_R, 3>
+			{q * direction[0], q * direction[1], q * direction[2]};
+		auto const rho2 = tcm::chi_q_function::matrix_elements
+			( tcm::make_momentum_eigenvector(wavevector, positions, cs.at("pi"))
+			, Psi );
+		print(q, tcm::chi_q_function::make(omegas, E, rho2, cs, lg));
+	}
+}
+
+
+auto dispatch(po::variables_map const& vm) -> void
+{
+	std::unordered_map< std::type_index,
+		void (*)(po::variables_map const&)> const callbacks =
+			{ { typeid(float), &run<float> }
+			, { typeid(double), &run<double> }
+			, { typeid(std::complex<float>), &run<std::complex<float>> }
+			, { typeid(std::complex<double>), &run<std::complex<double>> }
+			};
+
+	tcm::setup_console_logging();
+	callbacks.at(element_type(vm["type"].as<std::string>()))(vm);
+}
+
+
+int main(int argc, char** argv)
+{
+	process_command_line
+		( argc, argv
+		, [](auto desc) { std::cout << desc << '\n'; }
+		, &dispatch
+		);
+	return EXIT_SUCCESS;
+}
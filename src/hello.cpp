@@ -3,19 +3,30 @@
 #include <sstream>
 #include <iomanip>
 #include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
 
 #include <boost/program_options.hpp>
 #include <boost/log/sources/logger.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <boost/mpi.hpp>
 
 #include <benchmark.hpp>
+#include <benchmark_mpi.hpp>
+#include <roofline.hpp>
+#include <memory.hpp>
+#include <planner.hpp>
+#include <out_of_core.hpp>
 #include <logging.hpp>
 
 #include <constants.hpp>
 #include <lapack.hpp>
+#include <krylov.hpp>
+#include <complex_symmetric.hpp>
 #include <matrix_serialization.hpp>
 #include <dielectric_function_v2.hpp>
 
@@ -69,6 +80,63 @@ auto init_options() -> po::options_description
 		  "\"[eps-file].[PROCESS_RANK].bin\", which indicates that "
 		  "dielectric functions will be stored in binary format of the "
 		  "boost::serialization library." )
+		( "out.file.trace"
+		, po::value<std::string>()->default_value("")
+		, "If not empty, a timeline of all timed regions is saved to "
+		  "\"[trace-file].[PROCESS_RANK].json\" in the Chrome trace-event "
+		  "format (open it in chrome://tracing or ui.perfetto.dev). Use "
+		  "bin/merge_traces.py to merge the files of all ranks. Needs a "
+		  "build with CONFIG_DO_MEASURE." )
+		( "out.trace.min-duration"
+		, po::value<double>()->default_value(10)
+		, "Timed regions shorter than this (in microseconds) are left out "
+		  "of the trace." )
+		( "out.file.profile"
+		, po::value<std::string>()->default_value("profile")
+		, "Rank 0 saves a summary of the timings of all ranks (min, mean "
+		  "and max per timed region, load imbalance, throughput and idle "
+		  "time per rank) to \"[profile-file].txt\" and "
+		  "\"[profile-file].json\". Empty disables the summary." )
+		( "out.roofline"
+		, "At the end, measure the peak GFLOP/s (DGEMM) and memory "
+		  "bandwidth (STREAM triad) available to every rank, and log a "
+		  "roofline summary of the BLAS/LAPACK calls and of the G and chi "
+		  "builds: achieved GFLOP/s and GB/s versus the peak. Every rank "
+		  "measures with its BLAS threads (see --memory.threads). Takes "
+		  "about a second. Needs a build with CONFIG_DO_MEASURE." )
+		( "memory.budget"
+		, po::value<std::string>()->default_value("")
+		, "Memory of one node that may be used, e.g. \"64G\". Before "
+		  "starting, a plan is made that fits into the share of every rank: "
+		  "G may be built in blocks, and if that is not enough, a solver "
+		  "that keeps fewer eigenvectors ('geev-select', 'arnoldi') or does "
+		  "not store epsilon ('arnoldi-mf') is used instead of "
+		  "--eigen.solver. The calculation is refused if nothing fits. "
+		  "Empty means no limit." )
+		( "memory.scratch"
+		, po::value<std::string>()->default_value("")
+		, "Directory on a local disk (ideally NVMe) for chi and epsilon "
+		  "when they do not fit into --memory.budget. They are then "
+		  "computed out of core in tiles, and epsilon is left there as "
+		  "\"epsilon.[omega].tiles\" instead of being written to "
+		  "--out.file.eps. Empty disables out of core." )
+		( "memory.ooc-diagonalize"
+		, "Also find the eigenmodes of out-of-core epsilon, with "
+		  "shift-invert Arnoldi (see --eigen.count). Every GMRES iteration "
+		  "reads all of epsilon from disk, so this can mean thousands of "
+		  "passes over it; the plan shows the volume." )
+		( "memory.ranks-per-node"
+		, po::value<std::size_t>()->default_value(0)
+		, "Number of ranks sharing the memory of a node. 0 means the "
+		  "number of ranks on the node of rank 0." )
+		( "memory.threads"
+		, po::value<std::size_t>()->default_value(0)
+		, "Number of BLAS threads per rank, each of which needs a buffer. "
+		  "0 means $OMP_NUM_THREADS or the number of cores per rank." )
+		( "dry-run"
+		, "Read only the dimensions of the input, print the plan (see "
+		  "--memory.budget) with the estimated peak memory per rank and "
+		  "exit. The eigenstates are assumed to be complex." )
 		( "in.file.energies"
 		, po::value<std::string>()->required()
 		, "Name of the BIN file where the eigenenergies of the hamiltonian"
@@ -78,7 +146,10 @@ auto init_options() -> po::options_description
 		, po::value<std::string>()->required()
 		, "Name of the BIN file where the eigenstates of the hamiltonian "
 		  "are read from. This file must be in the format of the "
-		  "boost::serialization library. This option is REQUIRED." )
+		  "boost::serialization library. It may contain only the M < N "
+		  "states of an energy window (see solve_system --window.*), in "
+		  "which case transitions involving the other states are "
+		  "neglected. This option is REQUIRED." )
 		( "in.file.potential"
 		, po::value<std::string>()->required()
 		, "Name of the BIN file where the interaction potential "
@@ -94,7 +165,59 @@ auto init_options() -> po::options_description
 		  "is REQUIRED." )
 		( "in.frequency.step"
 		, po::value<R>()->required()
-		, "Step in frequency in eV. Must be a real value." );
+		, "Step in frequency in eV. Must be a real value." )
+		( "no-diagonalize"
+		, "Only save the dielectric function matrices and skip their "
+		  "diagonalization. Use this when only loss spectra are needed: "
+		  "`loss_function --inverse` computes them from the matrices "
+		  "at a fraction of the cost." )
+		( "eigen.solver"
+		, po::value<std::string>()->default_value("geev")
+		, "How to diagonalize the dielectric function. 'geev' computes all "
+		  "eigenpairs. 'geev-select' computes all eigenvalues, but "
+		  "eigenvectors (and saves eigenpairs) only for the --eigen.count "
+		  "ones with the largest loss -Im[1/lambda]. 'arnoldi' uses shift-invert Arnoldi with an LU "
+		  "factorisation of epsilon to compute only the --eigen.count "
+		  "modes with the largest loss -Im[1/lambda]. 'arnoldi-mf' does the "
+		  "same, but applies epsilon matrix-free and uses GMRES for the "
+		  "inner solves, i.e. epsilon is never formed (and not saved). "
+		  "'csym' (only when built with ASSUME_REAL) computes all "
+		  "eigenpairs by reducing epsilon to the complex symmetric "
+		  "1 - L^T chi L, where V = L L^T, and falls back to 'geev' if "
+		  "that fails. epsilon is saved a few columns at a time, so that "
+		  "it is never stored next to the whole chi; the fallback needs as "
+		  "much memory as 'geev'." )
+		( "eigen.check"
+		, po::value<std::size_t>()->default_value(8)
+		, "Number of eigenpairs whose residual 'csym' checks. The check "
+		  "keeps a copy of the packed 1 - L^T chi L (N^2/2 complex "
+		  "numbers); 0 disables it." )
+		( "eigen.count"
+		, po::value<std::size_t>()->default_value(2)
+		, "Number of eigenmodes to compute with 'geev-select', 'arnoldi' "
+		  "and 'arnoldi-mf'." )
+		( "eigen.subspace"
+		, po::value<std::size_t>()->default_value(0)
+		, "Dimension of the Krylov subspace. 0 means "
+		  "max(2 * eigen.count + 1, 20)." )
+		( "eigen.shift"
+		, po::value<R>()->default_value(0)
+		, "Shift sigma: eigenvalues closest to it converge first." )
+		( "eigen.tol"
+		, po::value<R>()->default_value(1E-10)
+		, "Relative accuracy of the computed eigenvalues." )
+		( "real.tolerance"
+		, po::value<R>()->default_value(1E-12)
+		, "If all imaginary parts of the eigenstates are below "
+		  "real.tolerance times their largest element, they are treated "
+		  "as real, which halves the memory and makes chi about four "
+		  "times cheaper. A negative value disables the check." )
+		( "backend"
+		, po::value<std::string>()->default_value("")
+		, "BLAS/LAPACK library to use on all ranks: openblas, reference, "
+		  "mkl, atlas, flexiblas or a path to a shared library. Only "
+		  "available if built with USING_RUNTIME_BACKEND. Empty means "
+		  "$TCM_BLAS_BACKEND." );
 	description.add(tcm::init_constants_options<double>());
 	return description;
 }
@@ -118,8 +241,7 @@ auto parse_command_line( int argc, char** argv
 	}
 
 	po::notify(vm);
-	proceed(vm);
-	return true;
+	return proceed(vm);
 }
 
 
@@ -129,6 +251,12 @@ auto log_file_name(int const rank, std::string file_name_base)
 }
 
 
+auto trace_file_name(int const rank, std::string file_name_base)
+{
+	return file_name_base + "." + std::to_string(rank) + ".json";
+}
+
+
 auto initialize_logging( int const rank
                        , std::string const& file_name_base) -> void
 {
@@ -152,8 +280,32 @@ struct IPackage {
 	std::string                           eps_file_name_base;
 	tcm::Matrix<_R>                       E;
 	tcm::Matrix<_C>                       Psi;
+	// Psi converted to real if it turned out to be real, in which case Psi
+	// itself is empty.
+	tcm::Matrix<_R>                       Psi_real;
 	tcm::Matrix<std::complex<_R>>         V;
 	std::map<std::string, _R>             constants;
+	bool                                  diagonalize;
+	std::string                           eigen_solver;
+	std::size_t                           eigen_count;
+	std::size_t                           eigen_subspace;
+	_R                                    eigen_shift;
+	_R                                    eigen_tol;
+	std::size_t                           eigen_check;
+	std::string                           backend;
+	std::string                           trace_file_name_base;
+	double                                trace_min_duration;
+	std::string                           profile_file_name_base;
+	bool                                  roofline;
+	// BLAS threads of a rank and ranks of a node, as used by the planner.
+	std::size_t                           threads;
+	std::size_t                           ranks_per_node;
+	// Chosen by the planner: 0 means that G is built at once, and 0 as
+	// ooc_tile means that chi and epsilon are kept in memory.
+	std::size_t                           g_tile;
+	std::size_t                           ooc_tile;
+	std::string                           scratch;
+	std::string                           plan;
 
 private:
 	friend boost::serialization::access;
@@ -168,8 +320,27 @@ private:
 		   << eps_file_name_base
 		   << E 
 		   << Psi
+		   << Psi_real
 		   << V
-		   << constants;
+		   << constants
+		   << diagonalize
+		   << eigen_solver
+		   << eigen_count
+		   << eigen_subspace
+		   << eigen_shift
+		   << eigen_tol
+		   << eigen_check
+		   << backend
+		   << trace_file_name_base
+		   << trace_min_duration
+		   << profile_file_name_base
+		   << roofline
+		   << threads
+		   << ranks_per_node
+		   << g_tile
+		   << ooc_tile
+		   << scratch
+		   << plan;
 	}
 
 	template<class _Archive>
@@ -182,8 +353,27 @@ private:
 		   >> eps_file_name_base
 		   >> E 
 		   >> Psi
+		   >> Psi_real
 		   >> V
-		   >> constants;
+		   >> constants
+		   >> diagonalize
+		   >> eigen_solver
+		   >> eigen_count
+		   >> eigen_subspace
+		   >> eigen_shift
+		   >> eigen_tol
+		   >> eigen_check
+		   >> backend
+		   >> trace_file_name_base
+		   >> trace_min_duration
+		   >> profile_file_name_base
+		   >> roofline
+		   >> threads
+		   >> ranks_per_node
+		   >> g_tile
+		   >> ooc_tile
+		   >> scratch
+		   >> plan;
 	}
 
 	BOOST_SERIALIZATION_SPLIT_MEMBER()
@@ -204,26 +394,165 @@ auto load_matrix(std::string const& file_name) -> tcm::Matrix<_T>
 }
 
 
+// Dimensions of a matrix archive. Matrices are saved as height, width and
+// the elements, so reading just the first two is enough for --dry-run.
+struct MatrixShape {
+	std::size_t height = 0;
+	std::size_t width  = 0;
+
+	template<class _Archive>
+	auto serialize(_Archive & ar, unsigned int const) -> void
+	{ ar & height & width; }
+};
+
+
+auto load_shape(std::string const& file_name) -> MatrixShape
+{
+	std::ifstream in_stream{file_name};
+	if(not in_stream)
+		throw std::runtime_error{"Failed to open `" + file_name + "`."};
+	boost::archive::binary_iarchive in_archive{in_stream};
+
+	MatrixShape shape;
+	in_archive >> shape;
+	return shape;
+}
+
+
+template<class _T>
+auto shape_of(tcm::Matrix<_T> const& A) -> MatrixShape
+{ return {A.height(), A.width()}; }
+
+
 
 
-auto load_ipackage(po::variables_map const& vm) -> IPackage<R, C>
+auto blas_threads( po::variables_map const& vm
+                 , std::size_t const ranks_per_node ) -> std::size_t
 {
-	return { std::make_tuple( vm["in.frequency.start"].as<R>()
+	auto const threads = vm["memory.threads"].as<std::size_t>();
+	if (threads != 0) return threads;
+	if (auto const* omp = std::getenv("OMP_NUM_THREADS")) {
+		auto const n = std::strtoul(omp, nullptr, 10);
+		if (n != 0) return n;
+	}
+	return std::max<std::size_t>( 1, std::thread::hardware_concurrency()
+	                                     / std::max<std::size_t>(1, ranks_per_node) );
+}
+
+
+auto load_ipackage( po::variables_map const& vm
+                  , std::size_t const ranks_per_node ) -> IPackage<R, C>
+{
+	auto const solver = vm["eigen.solver"].as<std::string>();
+	if ( solver != "geev" and solver != "geev-select"
+	     and solver != "arnoldi" and solver != "arnoldi-mf"
+	     and solver != "csym" ) {
+		throw std::invalid_argument{ "Invalid eigensolver `" + solver 
+		                           + "`." };
+	}
+
+	// A dry run must not need the memory that it is meant to plan for, so
+	// only the dimensions of the matrices are read.
+	auto const dry_run        = vm.count("dry-run") != 0;
+	auto const file_energies  = vm["in.file.energies"].as<std::string>();
+	auto const file_states    = vm["in.file.states"].as<std::string>();
+	auto const file_potential = vm["in.file.potential"].as<std::string>();
+
+	IPackage<R, C> input
+	       { std::make_tuple( vm["in.frequency.start"].as<R>()
 	                        , vm["in.frequency.stop"].as<R>()
 	                        , vm["in.frequency.step"].as<R>() )
 	       , vm["out.file.log"].as<std::string>()
 	       , vm["out.file.eps"].as<std::string>()
-	       , load_matrix<R>(vm["in.file.energies"].as<std::string>())
-	       , load_matrix<C>(vm["in.file.states"].as<std::string>())
-	       , load_matrix<std::complex<R>>(vm["in.file.potential"].as<std::string>())
+	       , dry_run ? tcm::Matrix<R>{} : load_matrix<R>(file_energies)
+	       , dry_run ? tcm::Matrix<C>{} : load_matrix<C>(file_states)
+	       , tcm::Matrix<R>{}
+	       , dry_run ? tcm::Matrix<std::complex<R>>{}
+	                 : load_matrix<std::complex<R>>(file_potential)
 		   , tcm::load_constants<R, double, std::map<std::string, R>>(vm)
+		   , vm.count("no-diagonalize") == 0
+		   , solver
+		   , vm["eigen.count"].as<std::size_t>()
+		   , vm["eigen.subspace"].as<std::size_t>()
+		   , vm["eigen.shift"].as<R>()
+		   , vm["eigen.tol"].as<R>()
+		   , vm["eigen.check"].as<std::size_t>()
+		   , vm["backend"].as<std::string>()
+		   , vm["out.file.trace"].as<std::string>()
+		   , vm["out.trace.min-duration"].as<double>()
+		   , vm["out.file.profile"].as<std::string>()
+		   , vm.count("out.roofline") != 0
+		   , 0
+		   , 0
+		   , 0
+		   , 0
+		   , vm["memory.scratch"].as<std::string>()
+		   , ""
 		   };
+
+	auto const E_shape   = dry_run ? load_shape(file_energies)  : shape_of(input.E);
+	auto const Psi_shape = dry_run ? load_shape(file_states)    : shape_of(input.Psi);
+	auto const V_shape   = dry_run ? load_shape(file_potential) : shape_of(input.V);
+	if (Psi_shape.width != E_shape.height) {
+		throw std::invalid_argument{ "Number of eigenstates does not match "
+		                             "the number of eigenenergies." };
+	}
+	if ( V_shape.height != Psi_shape.height
+	     or V_shape.width != Psi_shape.height ) {
+		throw std::invalid_argument{ "Dimensions of the potential and of "
+		                             "the eigenstates do not match." };
+	}
+
+	// Without the eigenstates, a dry run assumes that they are complex,
+	// which needs more memory than real ones.
+	auto const tolerance = vm["real.tolerance"].as<R>();
+	if ( not dry_run and not std::is_same<C, R>::value and tolerance >= 0
+	     and tcm::is_real(input.Psi, tolerance) ) {
+		input.Psi_real = tcm::real_part(input.Psi);
+		input.Psi      = tcm::Matrix<C>{};
+	}
+	if ( not dry_run and solver == "csym" and not std::is_same<C, R>::value
+	     and input.Psi_real.height() == 0 ) {
+		throw std::invalid_argument{ "Eigensolver `csym` requires real "
+		                             "eigenstates." };
+	}
+
+	tcm::planner::Problem problem;
+	problem.N              = Psi_shape.height;
+	problem.M              = E_shape.height;
+	problem.complex_states = input.Psi_real.height() == 0 and not std::is_same<C, R>::value;
+	problem.diagonalize    = input.diagonalize;
+	problem.solver         = input.eigen_solver;
+	problem.eigen_count    = input.eigen_count;
+	problem.eigen_subspace = input.eigen_subspace;
+	problem.eigen_check    = input.eigen_check;
+	problem.ranks_per_node = vm["memory.ranks-per-node"].as<std::size_t>() != 0
+		? vm["memory.ranks-per-node"].as<std::size_t>() : ranks_per_node;
+	problem.threads        = blas_threads(vm, problem.ranks_per_node);
+	auto const budget      = vm["memory.budget"].as<std::string>();
+	problem.budget         = budget.empty() ? 0 : tcm::planner::parse_bytes(budget);
+	problem.scratch        = input.scratch;
+	problem.scratch_space  = input.scratch.empty()
+		? 0 : tcm::out_of_core::free_space(input.scratch);
+	problem.ooc_diagonalize = vm.count("memory.ooc-diagonalize") != 0;
+
+	auto const plan = tcm::planner::make_plan<R>(problem);
+	input.eigen_solver   = plan.solver;
+	input.diagonalize    = plan.diagonalize;
+	input.g_tile         = plan.g_tile;
+	input.ooc_tile       = plan.tile;
+	input.threads        = problem.threads;
+	input.ranks_per_node = problem.ranks_per_node;
+	std::ostringstream summary;
+	tcm::planner::print(summary, problem, plan);
+	input.plan = summary.str();
+	return input;
 }
 
 
-template <class _T, class _Logger>
+template <class _X, class _Logger>
 auto cache( std::string const& message
-          , tcm::Matrix<_T> const& X
+          , _X const& X
 		  , std::string const& file_name
           , _Logger & lg ) -> void
 {
@@ -239,6 +568,36 @@ auto cache( std::string const& message
 }
 
 
+// epsilon = 1 - V chi, saved in the same format as a full tcm::Matrix (see
+// matrix_serialization.hpp), but formed tcm::planner::epsilon_panel columns
+// at a time, so that chi can be kept without doubling the memory.
+template <class _T>
+struct EpsilonPanels {
+	tcm::Matrix<_T> const& chi;
+	tcm::Matrix<_T> const& V;
+
+	template <class _Archive>
+	auto save(_Archive & ar, unsigned int const) const -> void
+	{
+		auto const height = chi.height();
+		auto const width  = chi.width();
+		ar << height;
+		ar << width;
+
+		for (std::size_t first = 0; first < width;
+		     first += tcm::planner::epsilon_panel) {
+			auto panel = tcm::dielectric_function::make_panel(chi, V, first
+				, std::min(tcm::planner::epsilon_panel, width - first));
+			for (std::size_t col = 0; col < panel.width(); ++col)
+				for (std::size_t row = 0; row < height; ++row)
+					ar << panel(row, col);
+		}
+	}
+
+	BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+
 template<class _Real, class _Logger>
 auto get_job( mpi::communicator const& world
             , std::tuple<_Real, _Real, _Real> const& range
@@ -285,7 +644,16 @@ auto calculate_single( _Number const omega
 					 , tcm::Matrix<std::complex<_R>> const& V
 					 , std::map<std::string, _R> const& cs
                      , _Logger & lg 
-					 , std::string const& file_name_base ) -> void
+					 , std::string const& file_name_base
+					 , bool const diagonalize
+					 , std::string const& solver
+					 , tcm::krylov::ArnoldiOptions<_R> const& opts
+					 , _R const shift
+					 , std::size_t const check
+					 , std::size_t const g_tile
+					 , std::size_t const tile
+					 , std::string const& scratch
+					 , tcm::lapack::Workspace<>& workspace ) -> void
 {
 	using namespace std::complex_literals;
 	LOG(lg, info) << "Calculating dielectric function for omega = "
@@ -301,16 +669,142 @@ auto calculate_single( _Number const omega
 		file_name_base + "." + std::to_string(std::real(omega)) 
 		+ ".eigenstates.bin";
 
-	auto epsilon = tcm::dielectric_function::make(omega, E, Psi, V, cs, lg);
+	if (diagonalize and solver == "arnoldi-mf") {
+		LOG(lg, info) << "Computing " << opts.count << " eigenmodes of the "
+		              << "dielectric function for omega = " << omega
+		              << " matrix-free...";
+		TCM_MEMORY_TAG("eigensolver");
+		tcm::krylov::EpsilonOperator<std::complex<_R>> const epsilon
+			{omega, E, Psi, V, cs, lg};
+		tcm::krylov::ShiftInvertKrylov<decltype(epsilon), std::complex<_R>>
+			const inverse{epsilon, shift};
+		auto const modes = tcm::krylov::loss_eigenpairs
+			(inverse, std::complex<_R>{shift}, opts, lg);
+		LOG(lg, info) << inverse.applications() << " applications of "
+		              << "epsilon, " << inverse.failures() << " inner "
+		              << "solves did not converge.";
+
+		cache("Dielectric function eigenvalues", modes.values, file_name_eigenvalues, lg);
+		cache("Dielectric function eigenstates", modes.vectors, file_name_eigenstates, lg);
+		LOG(lg, info) << "Done for omega = " << omega << "!";
+		return;
+	}
+
+	if (tile != 0) {
+		auto const file_name_tiles = 
+			scratch + "/epsilon." + std::to_string(std::real(omega)) + ".tiles";
+		auto epsilon = tcm::out_of_core::epsilon
+			(omega, E, Psi, V, cs, file_name_tiles, tile, lg, g_tile);
+		if (not diagonalize) {
+			epsilon.keep();
+			LOG(lg, info) << "Dielectric function matrix left in `"
+			              << file_name_tiles << "`.";
+			LOG(lg, info) << "Done for omega = " << omega << "!";
+			return;
+		}
+
+		LOG(lg, info) << "Computing " << opts.count << " eigenmodes of the "
+		              << "dielectric function for omega = " << omega
+		              << " out of core...";
+		TCM_MEMORY_TAG("eigensolver");
+		tcm::out_of_core::Operator<std::complex<_R>> const op{epsilon};
+		tcm::krylov::ShiftInvertKrylov<decltype(op), std::complex<_R>>
+			const inverse{op, shift};
+		auto const modes = tcm::krylov::loss_eigenpairs
+			(inverse, std::complex<_R>{shift}, opts, lg);
+		LOG(lg, info) << inverse.applications() << " applications of "
+		              << "epsilon, " << inverse.failures() << " inner "
+		              << "solves did not converge.";
+
+		cache("Dielectric function eigenvalues", modes.values, file_name_eigenvalues, lg);
+		cache("Dielectric function eigenstates", modes.vectors, file_name_eigenstates, lg);
+		LOG(lg, info) << "Done for omega = " << omega << "!";
+		return;
+	}
+
+	if (solver == "csym") {
+		auto chi = tcm::chi_function::make(omega, E, Psi, cs, lg, g_tile);
+		cache( "Dielectric function matrix"
+		     , EpsilonPanels<std::complex<_R>>{chi, V}
+		     , file_name_matrix, lg );
+		if (not diagonalize) {
+			LOG(lg, info) << "Done for omega = " << omega << "!";
+			return;
+		}
+
+		LOG(lg, info) << "Diagonalizing dielectric function for omega = "
+		              << omega << " using the complex symmetric form...";
+		TCM_MEMORY_TAG("eigensolver");
+		auto const N = V.height();
+		tcm::Matrix<std::complex<_R>> W, Z;
+		try {
+			// Consumes chi, so that S takes its place.
+			tcm::complex_symmetric::epsilon_eigenpairs
+				(std::move(chi), V, W, Z, lg, _R{1E-6}, check);
+		}
+		catch (std::runtime_error& e) {
+			LOG(lg, warning) << "Complex symmetric eigensolver failed ("
+			                 << e.what() << "). Falling back to ?GEEV.";
+			W = tcm::Matrix<std::complex<_R>>{};
+			Z = tcm::Matrix<std::complex<_R>>{};
+			auto epsilon = tcm::dielectric_function::make
+				(omega, E, Psi, V, cs, lg, g_tile);
+			W = tcm::Matrix<std::complex<_R>>{N, 1};
+			Z = tcm::Matrix<std::complex<_R>>{N, N};
+			tcm::lapack::geev(epsilon, W, Z, workspace);
+		}
+
+		cache("Dielectric function eigenvalues", W, file_name_eigenvalues, lg);
+		cache("Dielectric function eigenstates", Z, file_name_eigenstates, lg);
+		LOG(lg, info) << "Done for omega = " << omega << "!";
+		return;
+	}
+
+	auto epsilon = tcm::dielectric_function::make(omega, E, Psi, V, cs, lg, g_tile);
 	cache("Dielectric function matrix", epsilon, file_name_matrix, lg);
+	if (not diagonalize) {
+		LOG(lg, info) << "Done for omega = " << omega << "!";
+		return;
+	}
 
 	LOG(lg, info) << "Diagonalizing dielectric function for omega = "
 	              << omega << "...";
+	TCM_MEMORY_TAG("eigensolver");
 
 	using epsilon_type = typename decltype(epsilon)::value_type;
+	if (solver == "arnoldi") {
+		tcm::krylov::ShiftInvertLU<epsilon_type> const inverse
+			{std::move(epsilon), epsilon_type{shift}};
+		auto const modes = tcm::krylov::loss_eigenpairs
+			(inverse, epsilon_type{shift}, opts, lg);
+
+		cache("Dielectric function eigenvalues", modes.values, file_name_eigenvalues, lg);
+		cache("Dielectric function eigenstates", modes.vectors, file_name_eigenstates, lg);
+		LOG(lg, info) << "Done for omega = " << omega << "!";
+		return;
+	}
+
+	if (solver == "geev-select") {
+		auto const k = std::min(opts.count, epsilon.height());
+		tcm::Matrix<epsilon_type> W{epsilon.height(), 1};
+		tcm::Matrix<epsilon_type> Z{epsilon.height(), k};
+		auto const order = tcm::lapack::geev_selected
+			( epsilon, W
+			, [](auto const x) { return -std::imag(_R{1} / x); }
+			, Z );
+
+		tcm::Matrix<epsilon_type> selected{k, 1};
+		for (std::size_t i = 0; i < k; ++i)
+			selected(i, 0) = W(order[i], 0);
+		cache("Dielectric function eigenvalues", selected, file_name_eigenvalues, lg);
+		cache("Dielectric function eigenstates", Z, file_name_eigenstates, lg);
+		LOG(lg, info) << "Done for omega = " << omega << "!";
+		return;
+	}
+
 	tcm::Matrix<epsilon_type> W{epsilon.height(), 1};
 	tcm::Matrix<epsilon_type> Z{epsilon.height(), epsilon.height()};
-	tcm::lapack::geev(epsilon, W, Z);
+	tcm::lapack::geev(epsilon, W, Z, workspace);
 
 	cache("Dielectric function eigenvalues", W, file_name_eigenvalues, lg);
 	cache("Dielectric function eigenstates", Z, file_name_eigenstates, lg);
@@ -323,23 +817,81 @@ auto calculate_single( _Number const omega
 auto run( mpi::communicator & world
         , IPackage<R, C> & input ) -> void
 {
-	mpi::broadcast(world, input, admin_rank());
+	{
+		TCM_MEMORY_TAG("input");
+		mpi::broadcast(world, input, admin_rank());
+	}
 
 	initialize_logging(world.rank(), input.log_file_name_base);
 	boost::log::sources::severity_logger<tcm::severity_level> lg;
+	if (not input.backend.empty()) tcm::backend::load(input.backend);
+	LOG(lg, info) << "Using BLAS/LAPACK backend " << tcm::backend::name() << ".";
+	LOG(lg, info) << input.plan;
+	if (not input.trace_file_name_base.empty()) {
+#ifndef CONFIG_DO_MEASURE
+		LOG(lg, warning) << "Built without CONFIG_DO_MEASURE: the trace "
+		                 << "will be empty.";
+#endif
+		tcm::timing::start_trace
+			( world.rank()
+			, std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::duration<double, std::micro>{
+					input.trace_min_duration }) );
+	}
 
 	auto const homework = get_job<R>(world, input.frequency_range, lg);
-	if (homework.empty()) 
-		return;
-	for(auto const& w : homework) {
-		calculate_single( std::complex<R>{w, input.constants.at("tau")}
-		                , input.E
-						, input.Psi
-						, input.V
-						, input.constants
-						, lg
-						, input.eps_file_name_base );
+	// Ranks without work do not return early: they still take part in the
+	// profile summary below.
+	auto const start = std::chrono::steady_clock::now();
+
+	tcm::krylov::ArnoldiOptions<R> eigen_opts;
+	eigen_opts.count    = input.eigen_count;
+	eigen_opts.subspace = input.eigen_subspace;
+	eigen_opts.tol      = input.eigen_tol;
+	// ?GEEV workspace is reused across frequencies.
+	tcm::lapack::Workspace<> workspace;
+	auto const calculate_all = [&](auto const& Psi) {
+		for(auto const& w : homework) {
+			// One entry per frequency in the timing tree, so that its
+			// children show how the time of a frequency is spent.
+			TCM_MEASURE("frequency");
+			tcm::memory::Watermark const watermark;
+			calculate_single( std::complex<R>{w, input.constants.at("tau")}
+			                , input.E
+			                , Psi
+			                , input.V
+			                , input.constants
+			                , lg
+			                , input.eps_file_name_base
+			                , input.diagonalize
+			                , input.eigen_solver
+			                , eigen_opts
+			                , input.eigen_shift
+			                , input.eigen_check
+			                , input.g_tile
+			                , input.ooc_tile
+			                , input.scratch
+			                , workspace );
+			if (tcm::memory::enabled) {
+				LOG(lg, info) << "Memory high-water mark for omega = " << w
+				              << ": " << tcm::memory::format_bytes(watermark.peak())
+				              << ".";
+			}
+		}
+	};
+	if (input.Psi_real.height() != 0) {
+		LOG(lg, info) << "Eigenstates are real: using real kernels.";
+		calculate_all(input.Psi_real);
+	}
+	else {
+		auto const kind = std::is_same<C, R>::value ? "real" : "complex";
+		LOG(lg, info) << "Eigenstates are " << kind << ": using " << kind
+		              << " kernels.";
+		calculate_all(input.Psi);
 	}
+	LOG(lg, debug) << "LAPACK workspace: " << workspace.bytes() << " bytes.";
+	auto const wall = std::chrono::duration<double>{
+		std::chrono::steady_clock::now() - start }.count();
 
 	auto record = lg.open_record(boost::log::keywords::severity = 
 	                                 tcm::severity_level::info);
@@ -350,6 +902,55 @@ auto run( mpi::communicator & world
 		stream.flush();
 		lg.push_record(std::move(record));
 	}
+	if (tcm::memory::enabled) {
+		std::ostringstream summary;
+		tcm::memory::report(summary);
+		LOG(lg, info) << "Memory:\n" << summary.str();
+	}
+
+	if (input.roofline) {
+#ifndef CONFIG_DO_MEASURE
+		LOG(lg, warning) << "Built without CONFIG_DO_MEASURE: the roofline "
+		                 << "summary will be empty.";
+#endif
+		// All ranks measure at the same time, each with its own threads,
+		// so that each gets its share of the memory bandwidth of the node.
+		world.barrier();
+		auto const machine = tcm::roofline::measure
+			(input.threads, input.ranks_per_node);
+		std::ostringstream summary;
+		tcm::roofline::report(summary, machine);
+		LOG(lg, info) << "Roofline:\n" << summary.str();
+	}
+
+	if (not input.trace_file_name_base.empty()) {
+		tcm::timing::stop_trace();
+		auto const file_name =
+			trace_file_name(world.rank(), input.trace_file_name_base);
+		std::ofstream out{file_name};
+		if (not out)
+			throw std::runtime_error{"Could not open `" + file_name + "`."};
+		tcm::timing::write_trace(out);
+		LOG(lg, info) << "Saved the trace to `" << file_name << "`.";
+	}
+
+	if (not input.profile_file_name_base.empty()) {
+		auto const summary = tcm::timing::gather_profile
+			(world, {wall, homework.size()}, admin_rank());
+		if (world.rank() == admin_rank()) {
+			auto const base = input.profile_file_name_base;
+			std::ofstream table{base + ".txt"};
+			std::ofstream json{base + ".json"};
+			if (not table or not json) {
+				throw std::runtime_error{ "Could not open `" + base
+				                        + ".txt` or `" + base + ".json`." };
+			}
+			tcm::timing::report(table, summary);
+			tcm::timing::write_json(json, summary);
+			LOG(lg, info) << "Saved the timings of all ranks to `" << base
+			              << ".txt` and `" << base << ".json`.";
+		}
+	}
 }
 
 
@@ -362,13 +963,26 @@ int main(int argc, char** argv)
 	mpi::environment env;
 	mpi::communicator world;
 
+	// The planner divides the memory of a node among its ranks.
+	MPI_Comm node;
+	MPI_Comm_split_type( world, MPI_COMM_TYPE_SHARED, world.rank()
+	                   , MPI_INFO_NULL, &node );
+	auto const ranks_per_node = static_cast<std::size_t>(
+		mpi::communicator{node, mpi::comm_take_ownership}.size() );
+
 	IPackage<R, C> input;
 	bool proceed_with_calculation;
 	if (world.rank() == admin_rank()) {
 		proceed_with_calculation = 
 			parse_command_line( argc, argv
 			                  , [&env] (auto _desc) { std::cout << _desc << '\n'; }
-			                  , [&input] (auto _vm) { input = load_ipackage(_vm); } );
+			                  , [&input, ranks_per_node] (auto _vm) {
+				                  TCM_MEMORY_TAG("input");
+				                  input = load_ipackage(_vm, ranks_per_node);
+				                  if (_vm.count("dry-run") == 0) return true;
+				                  std::cout << input.plan;
+				                  return false;
+			                  } );
 	}
 	
 	mpi::broadcast(world, proceed_with_calculation, admin_rank());
@@ -5,6 +5,10 @@
 #include <cmath>
 #include <regex>
 #include <numeric>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
 
 #include <boost/program_options.hpp>
 #include <boost/log/sources/logger.hpp>
@@ -23,9 +27,12 @@
 
 #include <benchmark.hpp>
 #include <logging.hpp>
+#include <file_names.hpp>
 
 #include <blas.hpp>
+#include <lapack.hpp>
 #include <matrix_serialization.hpp>
+#include <momentum_space.hpp>
 
 
 
@@ -41,19 +48,44 @@ auto init_options() -> po::options_description
 		, "Type of an element of the epsilon matrix. It may be "
 		  "either cfloat or cdouble." )
 		( "epsilon"
-		, po::value<std::string>()->required()
-		, "File to where epsilon matrix was saved to." )
+		, po::value<std::vector<std::string>>()->multitoken()->required()
+		, "Files to where epsilon matrices were saved to. Glob patterns "
+		  "(e.g. 'Epsilon.*.matrix.bin') are expanded. The frequency is "
+		  "extracted from the file name which must have the form "
+		  "'<base>.<frequency>.matrix.bin'." )
 		( "positions"
 		, po::value<std::string>()->required()
 		, "File to where atomic site positions were saved to." )
 		( "q"
-		, po::value<std::string>()->required()
-		, "List of |q|s separated by commas. MIND YOU: "
-		  "no spaces!" )
+		, po::value<std::string>()
+		, "List of |q|s separated by commas, or a uniform grid as "
+		  "start:stop:step. MIND YOU: no spaces!" )
 		( "direction"
-		, po::value<std::string>()->required()
-		, "Direction of q as (x,y,z). It is automatically"
-		  "normalized." );
+		, po::value<std::vector<std::string>>()->multitoken()
+		, "Directions of q as (x,y,z). They are automatically "
+		  "normalized. Multiple directions may be given." )
+		( "map.qx"
+		, po::value<std::string>()
+		, "Instead of --q and --direction, compute a 2D map over all "
+		  "(qx, qy, 0). Same format as --q." )
+		( "map.qy"
+		, po::value<std::string>()
+		, "See --map.qx." )
+		( "jobs"
+		, po::value<std::size_t>()->default_value(1)
+		, "Number of frequencies processed in parallel. At most this many "
+		  "epsilon matrices are kept in memory at any time." )
+		( "format"
+		, po::value<std::string>()->default_value("text")
+		, "Output format: 'text' prints tab-separated columns "
+		  "(freq, qx, qy, qz, eps_r, eps_i, loss), 'bin' writes the same "
+		  "columns as a Matrix in the boost::serialization format." )
+		( "inverse"
+		, "Compute <q|eps^-1|q> instead of <q|eps|q>. Epsilon is "
+		  "LU-factorised once per frequency and solved for all q at once. "
+		  "The eps_r and eps_i columns then hold <q|eps^-1|q> and loss is "
+		  "-Im<q|eps^-1|q>, which, unlike -Im[1/<q|eps|q>], accounts for "
+		  "local field effects." );
 	return description;
 }
 
@@ -114,10 +146,29 @@ auto parse_qs(std::string const& str) -> std::vector<_R>
 	};
 
 	std::vector<std::string> tokens;
-	split(tokens, str, [](auto const ch) { return ch == ','; });
-
-
 	std::vector<_R> qs;
+	if (str.find(':') != std::string::npos) {
+		split(tokens, str, [](auto const ch) { return ch == ':'; });
+		if (tokens.size() != 3) {
+			throw std::invalid_argument{ "Could not convert '" + str
+			                           + "' to a grid start:stop:step." };
+		}
+		auto const start = parse_number(tokens[0]);
+		auto const stop  = parse_number(tokens[1]);
+		auto const step  = parse_number(tokens[2]);
+		if (not (step > 0)) {
+			throw std::invalid_argument{ "Step of the grid '" + str
+			                           + "' must be positive." };
+		}
+		// Same as in bin/functions.sh, but without accumulating rounding
+		// errors. Includes stop even if it is a few ulps short of the grid.
+		auto const last = stop + step * _R{1E-6};
+		for (std::size_t i = 0; start + i * step <= last; ++i)
+			qs.push_back(start + i * step);
+		return qs;
+	}
+
+	split(tokens, str, [](auto const ch) { return ch == ','; });
 	qs.reserve(tokens.size());
 	copy( tokens | transformed(std::cref(parse_number)) 
 	    , std::back_inserter(qs) );
@@ -183,109 +234,242 @@ auto read_positions(std::string const& file_name)
 }
 
 
-template < std::size_t _Dim = 3
-         , class _R1 = double
-         , class _R2 = double
-         , class _R3 = std::common_type_t<_R1, _R2>
-         >
-auto make_momentum_eigenvector( std::array<_R1, 3> const wavevector
-                              , std::vector<std::array<_R2, 3>> const& positions
-                              , _R3 const pi = _R3{M_PI} )
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes \f$ \langle q|\epsilon|q\rangle \f$ for all columns of
+/// \p plane_waves.
+
+/// All plane waves are assembled into one \f$ N\times Q \f$ matrix \f$ P \f$
+/// (see tcm::make_momentum_matrix()), so that \f$ \epsilon^\dagger P \f$ is
+/// a single `?GEMM` call. Results are then just column-wise dot products.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Matrix1, class _Matrix2>
+auto loss_function(_Matrix1 const& epsilon, _Matrix2 const& plane_waves)
 {
-	using _R = std::common_type_t<_R1, _R2, _R3>;
-	using _C = std::complex<_R>;
+	assert(tcm::is_square(epsilon));
+	assert(epsilon.height() == plane_waves.height());
+	using _C = typename _Matrix1::value_type;
+	static_assert( std::is_same<typename _Matrix2::value_type, _C>::value
+	             , "Types mismatch." );
 
-	auto constexpr I = _C{0, 1};
-	auto const _norm = 
-		std::pow(_R{2} * pi, -boost::numeric_cast<_R>(_Dim) / _R{2});
-	auto const _dot = [] (auto const& x, auto const& y) noexcept {
-		return x[0]*y[0] + x[1]*y[1] + x[2]*y[2];
-	};
+	auto const N = epsilon.height();
+	auto const Q = plane_waves.width();
+
+	tcm::Matrix<_C> _temp{N, Q};
+	tcm::blas::gemm( tcm::blas::Operator::H, tcm::blas::Operator::None
+	               , _C{1}, epsilon, plane_waves
+	               , _C{0}, _temp );
 
-	tcm::Matrix<_C> q{positions.size(), 1};
-	std::transform( std::begin(positions), std::end(positions)
-	              , q.data()
-				  , [ _norm
-	                , &wavevector
-	                , _dot = std::cref(_dot)
-	                ] (auto const& r) {
-	                    return _norm * std::exp<_R>(I * _dot(wavevector, r));
-	                } );
-	return q;
+	std::vector<_C> epsilon_q(Q);
+	for (std::size_t k = 0; k < Q; ++k) {
+		epsilon_q[k] = tcm::import::dot( N, _temp.data(0, k), 1
+		                               , plane_waves.data(0, k), 1 );
+	}
+	return epsilon_q;
 }
 
 
-template <class _R, class _Matrix>
-auto loss_function( std::array<_R, 3> const& direction
-                  , std::vector<_R> const& qs
-                  , _Matrix const& epsilon
-                  , std::vector<std::array<_R, 3>> const& positions )
-{
-	using namespace boost;
-	using namespace boost::adaptors;
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes \f$ \langle q|\epsilon^{-1}|q\rangle \f$ for all columns
+/// of \p plane_waves.
 
+/// \p epsilon is overwritten by its LU factorisation. All plane waves are
+/// then solved for with a single `?GETRS` call, which is much cheaper than
+/// the full diagonalisation (`?GEEV`) otherwise needed to get at
+/// \f$ \epsilon^{-1} \f$.
+///////////////////////////////////////////////////////////////////////////////
+template <class _Matrix1, class _Matrix2>
+auto inverse_loss_function(_Matrix1& epsilon, _Matrix2 const& plane_waves)
+{
 	assert(tcm::is_square(epsilon));
-	assert(epsilon.height() == positions.size());
-	using _C = typename _Matrix::value_type;
-	static_assert( std::is_same<typename _C::value_type, _R>::value
+	assert(epsilon.height() == plane_waves.height());
+	using _C = typename _Matrix1::value_type;
+	static_assert( std::is_same<typename _Matrix2::value_type, _C>::value
 	             , "Types mismatch." );
 
-	auto const make_wavevector = [&direction](auto const q) noexcept
-		-> std::array<_R, 3> {
-		return {q * direction[0], q * direction[1], q * direction[2]};
-	};
+	auto const N = epsilon.height();
+	auto const Q = plane_waves.width();
 
-	auto const make_epsilon_q = [&epsilon,&positions](auto const& wavevector) {
-		auto const q_state = make_momentum_eigenvector(wavevector, positions);
-		tcm::Matrix<_C> _temp{epsilon.height(), 1};
-		tcm::blas::gemv( tcm::blas::Operator::H
-		               , _C{1}, epsilon, q_state 
-		               , _C{0}, _temp );
-		return tcm::blas::dot(_temp, q_state);
-	};
+	std::vector<tcm::lapack::lapack_int> ipiv;
+	tcm::lapack::getrf(epsilon, ipiv);
 
-	std::vector<_C> epsilon_q;
-	epsilon_q.reserve(qs.size());
-	copy( qs | transformed(std::cref(make_wavevector))
-	         | transformed(std::cref(make_epsilon_q))
-	    , std::back_inserter(epsilon_q) );
+	tcm::Matrix<_C> _temp{N, Q};
+	for (std::size_t k = 0; k < Q; ++k)
+		std::copy( plane_waves.cbegin_column(k), plane_waves.cend_column(k)
+		         , _temp.begin_column(k) );
+	tcm::lapack::getrs(epsilon, ipiv, _temp);
+
+	std::vector<_C> epsilon_q(Q);
+	for (std::size_t k = 0; k < Q; ++k) {
+		epsilon_q[k] = tcm::import::dot( N, plane_waves.data(0, k), 1
+		                               , _temp.data(0, k), 1 );
+	}
 	return epsilon_q;
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Builds the wavevectors and plane waves of the whole sweep.
+
+/// Either a list of directions with common |q|s, or a 2D map over
+/// \f$ (q_x, q_y, 0) \f$ where each row of the map is a line
+/// \f$ (0, q_y, 0) + q_x\hat{x} \f$.
+///////////////////////////////////////////////////////////////////////////////
+template <class _R>
+auto make_sweep( boost::program_options::variables_map const& vm
+               , std::vector<std::array<_R, 3>> const& positions )
+{
+	using _C = std::complex<_R>;
+	std::vector<std::array<_R, 3>> wavevectors;
+	std::vector<tcm::Matrix<_C>>   blocks;
+
+	auto const add_line = [&]( std::array<_R, 3> const& offset
+	                         , std::array<_R, 3> const& direction
+	                         , std::vector<_R> const& qs ) {
+		for (auto const q : qs) {
+			wavevectors.push_back({ offset[0] + q * direction[0]
+			                      , offset[1] + q * direction[1]
+			                      , offset[2] + q * direction[2] });
+		}
+		blocks.push_back(tcm::make_momentum_matrix( offset, direction
+		                                          , qs, positions ));
+	};
+
+	if (vm.count("map.qx") or vm.count("map.qy")) {
+		if (not (vm.count("map.qx") and vm.count("map.qy"))) {
+			throw std::invalid_argument{ "Both --map.qx and --map.qy are "
+			                             "required for a 2D map." };
+		}
+		auto const qxs = parse_qs<_R>(vm["map.qx"].as<std::string>());
+		for (auto const qy : parse_qs<_R>(vm["map.qy"].as<std::string>()))
+			add_line({0, qy, 0}, {1, 0, 0}, qxs);
+	}
+	else {
+		if (not (vm.count("q") and vm.count("direction"))) {
+			throw std::invalid_argument{ "Either --q and --direction, or "
+			                             "--map.qx and --map.qy are required." };
+		}
+		auto const qs = parse_qs<_R>(vm["q"].as<std::string>());
+		for (auto const& d : vm["direction"].as<std::vector<std::string>>())
+			add_line({0, 0, 0}, parse_direction<_R>(d), qs);
+	}
+
+	auto const N = positions.size();
+	tcm::Matrix<_C> plane_waves{N, wavevectors.size()};
+	std::size_t k = 0;
+	for (auto const& block : blocks) {
+		for (std::size_t j = 0; j < block.width(); ++j, ++k)
+			std::copy( block.cbegin_column(j), block.cend_column(j)
+			         , plane_waves.begin_column(k) );
+	}
+	return std::make_pair(std::move(wavevectors), std::move(plane_waves));
+}
+
+
 template <class _C>
 auto run(boost::program_options::variables_map const& vm) -> void
 {
-	using namespace boost;
 	using _R = typename _C::value_type;
+	boost::log::sources::severity_logger<tcm::severity_level> lg;
 
-	auto const direction = 
-		parse_direction<_R>(vm["direction"].as<std::string>());
-	auto const qs =
-		parse_qs<_R>(vm["q"].as<std::string>());
+	auto const format = vm["format"].as<std::string>();
+	if (format != "text" and format != "bin") {
+		throw std::invalid_argument{"Invalid output format `" + format + "`."};
+	}
+	auto const files = tcm::expand_files(vm["epsilon"].as<std::vector<std::string>>());
 	auto const positions = 
 		read_positions<_R>(vm["positions"].as<std::string>());
-	auto const epsilon = 
-		load_matrix<_C>(vm["epsilon"].as<std::string>());
-
-	auto const epsilon_q = loss_function( direction, qs
-	                                    , epsilon
-	                                    , positions );
-
-	auto const print = [](auto const& t) {
-		std::cout << tuples::get<0>(t) << '\t' 
-		          << std::real(tuples::get<1>(t)) << '\t' 
-		          << std::imag(tuples::get<1>(t)) << '\n';
+	auto const sweep = make_sweep<_R>(vm, positions);
+	auto const& wavevectors = sweep.first;
+	auto const& plane_waves = sweep.second;
+
+	std::vector<std::pair<_R, std::string>> jobs;
+	for (auto const& f : files)
+		jobs.emplace_back(tcm::parse_frequency<_R>(f), f);
+	std::sort( std::begin(jobs), std::end(jobs)
+	         , [](auto const& x, auto const& y) { return x.first < y.first; } );
+
+	LOG(lg, info) << "Processing " << jobs.size() << " frequencies and "
+	              << wavevectors.size() << " wavevectors...";
+
+	auto const inverse = vm.count("inverse") != 0;
+	if (inverse) LOG(lg, info) << "Using LU factorisation to get eps^-1.";
+
+	// Each worker keeps at most one epsilon in memory.
+	std::vector<std::vector<_C>> results(jobs.size());
+	std::atomic<std::size_t>     next{0};
+	std::exception_ptr           error;
+	std::mutex                   error_mutex;
+	auto const worker = [&]() {
+		try {
+			for (auto i = next++; i < jobs.size(); i = next++) {
+				auto epsilon = load_matrix<_C>(jobs[i].second);
+				if (epsilon.height() != positions.size()) {
+					throw std::invalid_argument{ "Dimensions of `"
+						+ jobs[i].second + "` and positions do not match." };
+				}
+				results[i] = inverse
+					? inverse_loss_function(epsilon, plane_waves)
+					: loss_function(epsilon, plane_waves);
+			}
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock{error_mutex};
+			if (not error) error = std::current_exception();
+			next = jobs.size();
+		}
 	};
 
+	auto const number_jobs = std::max<std::size_t>(1,
+		std::min(vm["jobs"].as<std::size_t>(), jobs.size()));
+	std::vector<std::thread> workers;
+	for (std::size_t i = 1; i < number_jobs; ++i)
+		workers.emplace_back(worker);
+	worker();
+	for (auto& t : workers) t.join();
+	if (error) std::rethrow_exception(error);
+
+	// -Im[1 / eps] or -Im[eps^-1]
+	auto const loss = [inverse](auto const z) {
+		return inverse ? -std::imag(z) : std::imag(z) / std::norm(z); };
+
+	if (format == "bin") {
+		tcm::Matrix<_R> table{jobs.size() * wavevectors.size(), 7};
+		std::size_t row = 0;
+		for (std::size_t i = 0; i < jobs.size(); ++i) {
+			for (std::size_t k = 0; k < wavevectors.size(); ++k, ++row) {
+				table(row, 0) = jobs[i].first;
+				table(row, 1) = wavevectors[k][0];
+				table(row, 2) = wavevectors[k][1];
+				table(row, 3) = wavevectors[k][2];
+				table(row, 4) = std::real(results[i][k]);
+				table(row, 5) = std::imag(results[i][k]);
+				table(row, 6) = loss(results[i][k]);
+			}
+		}
+		boost::archive::binary_oarchive output_archive{std::cout};
+		output_archive << table;
+		return;
+	}
+
 	std::cout << std::scientific << std::setprecision(15);
-	for_each(combine(qs, epsilon_q), std::cref(print));
+	for (std::size_t i = 0; i < jobs.size(); ++i) {
+		for (std::size_t k = 0; k < wavevectors.size(); ++k) {
+			std::cout << jobs[i].first << '\t'
+			          << wavevectors[k][0] << '\t'
+			          << wavevectors[k][1] << '\t'
+			          << wavevectors[k][2] << '\t'
+			          << std::real(results[i][k]) << '\t'
+			          << std::imag(results[i][k]) << '\t'
+			          << loss(results[i][k]) << '\n';
+		}
+	}
 }
 
 
 auto dispatch(boost::program_options::variables_map const& vm) -> void
 {
 	auto const type = element_type(vm["type"].as<std::string>());
+	tcm::setup_console_logging();
 	if (type == typeid(std::complex<float>)) {
 		run<std::complex<float>>(vm);
 	} 
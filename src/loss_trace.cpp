@@ -0,0 +1,297 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cmath>
+#include <random>
+#include <typeinfo>
+#include <typeindex>
+#include <unordered_map>
+
+#include <boost/program_options.hpp>
+#include <boost/log/sources/logger.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <benchmark.hpp>
+#include <logging.hpp>
+#include <file_names.hpp>
+
+#include <constants.hpp>
+#include <matrix_serialization.hpp>
+#include <krylov.hpp>
+
+
+
+namespace po = boost::program_options;
+
+auto init_options() -> po::options_description
+{
+	po::options_description description;
+	description.add_options()
+		( "help", "Produce the help message." )
+		( "type"
+		, po::value<std::string>()->required()
+		, "Type of an element of the eigenstates matrix (or of the epsilon "
+		  "matrices if --epsilon is used). It may be either double or "
+		  "cdouble." )
+		( "energies"
+		, po::value<std::string>()
+		, "File to where the eigenenergies were saved to (by solve_system)." )
+		( "states"
+		, po::value<std::string>()
+		, "File to where the eigenstates were saved to (by solve_system)." )
+		( "potential"
+		, po::value<std::string>()
+		, "File to where the Coulomb potential was saved to (by potential)." )
+		( "frequency.start"
+		, po::value<double>()
+		, "Starting frequency in eV." )
+		( "frequency.stop"
+		, po::value<double>()
+		, "Stopping frequency in eV." )
+		( "frequency.step"
+		, po::value<double>()
+		, "Step in frequency in eV." )
+		( "epsilon"
+		, po::value<std::vector<std::string>>()->multitoken()
+		, "Instead of applying epsilon matrix-free from --energies, "
+		  "--states and --potential, use precomputed epsilon matrices "
+		  "'<base>.<frequency>.matrix.bin'. Glob patterns are expanded." )
+		( "solver"
+		, po::value<std::string>()->default_value("gmres")
+		, "Krylov solver: gmres or bicgstab." )
+		( "solver.tol"
+		, po::value<double>()->default_value(1E-8)
+		, "Relative residual at which the Krylov solver stops." )
+		( "solver.restart"
+		, po::value<std::size_t>()->default_value(50)
+		, "Restart length of GMRES." )
+		( "solver.max-iter"
+		, po::value<std::size_t>()->default_value(1000)
+		, "Maximal number of epsilon applications per solve." )
+		( "probes.min"
+		, po::value<std::size_t>()->default_value(10)
+		, "Minimal number of random probe vectors per frequency." )
+		( "probes.max"
+		, po::value<std::size_t>()->default_value(200)
+		, "Maximal number of random probe vectors per frequency." )
+		( "probes.error"
+		, po::value<double>()->default_value(0.01)
+		, "Stop adding probes once the half-width of the 95% confidence "
+		  "interval is below this fraction of the estimate." )
+		( "seed"
+		, po::value<unsigned>()->default_value(42)
+		, "Seed of the random number generator." );
+	description.add(tcm::init_constants_options<double>());
+	return description;
+}
+
+
+auto element_type(std::string input) -> std::type_index
+{
+	using namespace std::string_literals;
+	static std::unordered_map<std::string, std::type_index> const types =
+		{ { "double"s,  std::type_index(typeid(double))               }
+		, { "cdouble"s, std::type_index(typeid(std::complex<double>)) }
+		};
+
+	boost::to_lower(input);
+	try {
+		return types.at(input);
+	} catch(std::out_of_range & e) {
+		std::cerr << "Invalid element type `" + input + "`!\n";
+		throw;
+	}
+}
+
+
+template<class _Help, class _Run>
+auto process_command_line( int argc, char** argv
+                         , _Help&& help
+						 , _Run&& run ) -> void
+{
+	auto const description = init_options();
+	po::variables_map vm;
+
+	po::store( po::command_line_parser(argc, argv)
+	              .options(description)
+	              .run()
+	         , vm );
+
+	if (vm.count("help")) {
+		help(description);
+		return;
+	}
+
+	po::notify(vm);
+	run(vm);
+}
+
+
+template<class _T>
+auto load_matrix(std::string const& file_name) -> tcm::Matrix<_T>
+{
+	std::ifstream in_stream{file_name};
+	if (not in_stream)
+		throw std::runtime_error{"Failed to open `" + file_name + "`."};
+	boost::archive::binary_iarchive in_archive{in_stream};
+
+	tcm::Matrix<_T> A;
+	in_archive >> A;
+	return A;
+}
+
+
+template <class _R>
+auto load_options(po::variables_map const& vm) -> tcm::krylov::TraceOptions<_R>
+{
+	auto const solver = boost::to_lower_copy(vm["solver"].as<std::string>());
+	if (solver != "gmres" and solver != "bicgstab") {
+		throw std::invalid_argument{"Invalid solver `" + solver + "`."};
+	}
+
+	tcm::krylov::TraceOptions<_R> opts;
+	opts.min_probes = vm["probes.min"].as<std::size_t>();
+	opts.max_probes = vm["probes.max"].as<std::size_t>();
+	opts.rel_error  = vm["probes.error"].as<double>();
+	opts.solver_tol = vm["solver.tol"].as<double>();
+	opts.restart    = vm["solver.restart"].as<std::size_t>();
+	opts.max_iter   = vm["solver.max-iter"].as<std::size_t>();
+	opts.use_gmres  = solver == "gmres";
+	if (opts.min_probes < 2 or opts.min_probes > opts.max_probes) {
+		throw std::invalid_argument{ "Need 2 <= --probes.min <= "
+		                             "--probes.max." };
+	}
+	return opts;
+}
+
+
+template <class _R>
+auto print( _R const frequency, std::size_t const N
+          , tcm::krylov::TraceEstimate<_R> const& estimate ) -> void
+{
+	std::cout << frequency << '\t'
+	          << estimate.value << '\t'
+	          << estimate.error << '\t'
+	          << estimate.value / static_cast<_R>(N) << '\t'
+	          << estimate.probes << '\t'
+	          << estimate.iterations << '\n';
+}
+
+
+// Returns start, start + step, ..., stop as given by --frequency.*. Includes
+// stop even if it is a few ulps short of the grid.
+auto frequencies(po::variables_map const& vm) -> std::vector<double>
+{
+	auto const start = vm["frequency.start"].as<double>();
+	auto const stop  = vm["frequency.stop"].as<double>();
+	auto const step  = vm["frequency.step"].as<double>();
+	if (not (step > 0)) {
+		throw std::invalid_argument{"--frequency.step must be positive."};
+	}
+	if (not std::isfinite(start) or not std::isfinite(stop)) {
+		throw std::invalid_argument{ "--frequency.start and --frequency.stop "
+		                             "must be finite." };
+	}
+
+	std::vector<double> ws;
+	if (stop < start) return ws;
+	auto const last = std::floor((stop - start) / step + 1E-6);
+	if (not (last < 1E9)) {
+		throw std::invalid_argument{ "--frequency.step is too small for the "
+		                             "given range." };
+	}
+	auto const count = static_cast<std::size_t>(last) + 1;
+	ws.reserve(count);
+	for (std::size_t i = 0; i < count; ++i)
+		ws.push_back(start + i * step);
+	return ws;
+}
+
+
+template <class _T>
+auto run(po::variables_map const& vm) -> void
+{
+	using _R = tcm::utils::Base<_T>;
+	using _C = std::complex<_R>;
+	boost::log::sources::severity_logger<tcm::severity_level> lg;
+
+	auto const opts = load_options<_R>(vm);
+	std::mt19937 gen{vm["seed"].as<unsigned>()};
+	std::cout << std::scientific << std::setprecision(15);
+
+	if (vm.count("epsilon")) {
+		std::vector<std::pair<_R, std::string>> jobs;
+		for (auto const& f : tcm::expand_files(
+				vm["epsilon"].as<std::vector<std::string>>()))
+			jobs.emplace_back(tcm::parse_frequency<_R>(f), f);
+		std::sort( std::begin(jobs), std::end(jobs)
+		         , [](auto const& x, auto const& y)
+		           { return x.first < y.first; } );
+
+		for (auto const& job : jobs) {
+			LOG(lg, info) << "Estimating loss for omega = " << job.first
+			              << "...";
+			auto const epsilon = load_matrix<_C>(job.second);
+			auto const estimate = tcm::krylov::estimate_loss
+				(tcm::krylov::DenseOperator<_C>{epsilon}, opts, gen, lg);
+			print(job.first, epsilon.height(), estimate);
+		}
+		return;
+	}
+
+	for (auto const* option : { "energies", "states", "potential"
+	                          , "frequency.start", "frequency.stop"
+	                          , "frequency.step" }) {
+		if (not vm.count(option)) {
+			throw std::invalid_argument{ "--" + std::string{option}
+			                           + " is required unless --epsilon "
+			                             "is given." };
+		}
+	}
+
+	auto const ws  = frequencies(vm);
+	auto const E   = load_matrix<_R>(vm["energies"].as<std::string>());
+	auto const Psi = load_matrix<_T>(vm["states"].as<std::string>());
+	auto const V   = load_matrix<_C>(vm["potential"].as<std::string>());
+	auto const cs  =
+		tcm::load_constants<_R, double, std::map<std::string, _R>>(vm);
+
+	if (Psi.width() != E.height() or V.height() != Psi.height()) {
+		throw std::invalid_argument{ "Dimensions of energies, states and "
+		                             "potential do not match." };
+	}
+
+	for (auto const x : ws) {
+		auto const w = static_cast<_R>(x);
+		LOG(lg, info) << "Estimating loss for omega = " << w << "...";
+		tcm::krylov::EpsilonOperator<_C> const epsilon
+			{_C{w, cs.at("tau")}, E, Psi, V, cs, lg};
+		print(w, Psi.height(), tcm::krylov::estimate_loss(epsilon, opts, gen, lg));
+	}
+}
+
+
+auto dispatch(po::variables_map const& vm) -> void
+{
+	std::unordered_map< std::type_index,
+		void (*)(po::variables_map const&)> const callbacks =
+			{ { typeid(double), &run<double> }
+			, { typeid(std::complex<double>), &run<std::complex<double>> }
+			};
+
+	tcm::setup_console_logging();
+	callbacks.at(element_type(vm["type"].as<std::string>()))(vm);
+}
+
+
+int main(int argc, char** argv)
+{
+	process_command_line
+		( argc, argv
+		, [](auto desc) { std::cout << desc << '\n'; }
+		, &dispatch
+		);
+	return EXIT_SUCCESS;
+}
@@ -8,6 +8,9 @@
 #include <cassert>
 #include <unordered_map>
 #include <functional>
+#include <cstdlib>
+#include <thread>
+#include <tuple>
 
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
@@ -18,6 +21,11 @@
 #include <matrix_serialization.hpp>
 #include <lapack.hpp>
 
+#ifdef USING_SCALAPACK
+#	include <boost/mpi/environment.hpp>
+#	include <scalapack.hpp>
+#endif
+
 
 
 namespace po = boost::program_options;
@@ -36,12 +44,142 @@ auto init_options() -> po::options_description
 		( "energies", po::value<std::string>()->required()
 		, "Name of the file where to save the eigenenergies of the system." )
 		( "states", po::value<std::string>()->required()
-		, "Name of the file where to save the eigenestates of the system." );
+		, "Name of the file where to save the eigenestates of the system." )
+		( "solver", po::value<std::string>()->default_value("auto")
+		, "Eigensolver used when all eigenstates are computed: heevr (MRRR), "
+		  "heevd (divide-and-conquer), heevr-2stage, heevd-2stage (only if "
+		  "LAPACK >= 3.7 was configured) or auto, which picks one based on "
+		  "the size of the system and the number of threads." )
+		( "backend", po::value<std::string>()
+		, "BLAS/LAPACK library to use: openblas, reference, mkl, atlas, "
+		  "flexiblas or a path to a shared library. Only available if built "
+		  "with USING_RUNTIME_BACKEND. Defaults to $TCM_BLAS_BACKEND." )
+		( "window.min", po::value<double>()
+		, "Together with --window.max: only compute the eigenstates with "
+		  "energies in (window.min, window.max] (in eV), e.g. a window "
+		  "around the chemical potential. The saved eigenstates matrix is "
+		  "then N x M with M the number of states in the window." )
+		( "window.max", po::value<double>()
+		, "See --window.min." )
+		( "window.first", po::value<std::size_t>()
+		, "Together with --window.last: only compute the eigenstates number "
+		  "window.first through window.last (0-based, inclusive, in "
+		  "ascending order of energy). Unlike the energy window, this also "
+		  "avoids the N x N workspace." )
+		( "window.last", po::value<std::size_t>()
+		, "See --window.first." )
+		( "real.tolerance", po::value<double>()->default_value(1E-12)
+		, "For complex types: if all imaginary parts of the hamiltonian are "
+		  "below real.tolerance times its largest element, the real "
+		  "eigensolver is used (at about a quarter of the cost). The "
+		  "eigenstates are still saved as complex. A negative value "
+		  "disables the check." )
+#ifdef USING_SCALAPACK
+		( "distributed"
+		, "Distribute the hamiltonian block-cyclically over all MPI "
+		  "processes and diagonalize it with ScaLAPACK (P?HEEVD). Run with "
+		  "mpirun. The hamiltonian is read from --hamiltonian, and every "
+		  "process reads and writes only its own blocks. Windows are not "
+		  "supported." )
+		( "hamiltonian", po::value<std::string>()
+		, "Name of the file with the hamiltonian. Required with "
+		  "--distributed, where it replaces the standard input." )
+		( "block-size", po::value<std::size_t>()->default_value(64)
+		, "Size of the blocks of the block-cyclic distribution." )
+#endif
+		;
 	
 	return desc;
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Which eigenstates to compute and how.
+///////////////////////////////////////////////////////////////////////////////
+struct SolveOptions {
+	enum class Window { All, Energy, Index };
+
+	Window                   window = Window::All;
+	double                   min    = 0;
+	double                   max    = 0;
+	std::size_t              first  = 0;
+	std::size_t              last   = 0;
+	tcm::lapack::Eigensolver solver = tcm::lapack::Eigensolver::Auto;
+	double                   real_tolerance = 1E-12;
+	bool                     distributed = false;
+	std::string              hamiltonian;
+	std::size_t              block_size = 64;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Number of threads BLAS/LAPACK will use: MKL_NUM_THREADS or
+/// OMP_NUM_THREADS if set, the number of cores otherwise.
+///////////////////////////////////////////////////////////////////////////////
+auto available_threads() -> std::size_t
+{
+	for (auto const* name : {"MKL_NUM_THREADS", "OMP_NUM_THREADS"}) {
+		if (auto const* value = std::getenv(name)) {
+			try {
+				return std::max(1, std::stoi(value));
+			} catch (std::exception&) {
+			}
+		}
+	}
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+auto load_options(po::variables_map const& vm) -> SolveOptions
+{
+	auto const energy = vm.count("window.min") + vm.count("window.max");
+	auto const index  = vm.count("window.first") + vm.count("window.last");
+	if (energy == 1 or index == 1 or (energy != 0 and index != 0)) {
+		throw std::invalid_argument{ "Specify either both --window.min and "
+		                             "--window.max, or both --window.first "
+		                             "and --window.last." };
+	}
+
+	SolveOptions opts;
+	opts.solver = tcm::lapack::parse_eigensolver(
+		boost::to_lower_copy(vm["solver"].as<std::string>()));
+	opts.real_tolerance = vm["real.tolerance"].as<double>();
+	if (energy != 0) {
+		opts.window = SolveOptions::Window::Energy;
+		opts.min = vm["window.min"].as<double>();
+		opts.max = vm["window.max"].as<double>();
+		if (not (opts.min < opts.max)) {
+			throw std::invalid_argument{"Need --window.min < --window.max."};
+		}
+	}
+	else if (index != 0) {
+		opts.window = SolveOptions::Window::Index;
+		opts.first = vm["window.first"].as<std::size_t>();
+		opts.last  = vm["window.last"].as<std::size_t>();
+		if (opts.first > opts.last) {
+			throw std::invalid_argument{ "Need --window.first <= "
+			                             "--window.last." };
+		}
+	}
+#ifdef USING_SCALAPACK
+	if (vm.count("distributed")) {
+		if (opts.window != SolveOptions::Window::All) {
+			throw std::invalid_argument{ "Windows are not supported with "
+			                             "--distributed." };
+		}
+		if (not vm.count("hamiltonian")) {
+			throw std::invalid_argument{ "--distributed needs "
+			                             "--hamiltonian." };
+		}
+		opts.distributed = true;
+		opts.hamiltonian = vm["hamiltonian"].as<std::string>();
+		opts.block_size  = vm["block-size"].as<std::size_t>();
+	}
+#endif
+	return opts;
+}
+
+
 auto element_type(std::string input) -> std::type_index
 {
 	using namespace std::string_literals;
@@ -80,19 +218,78 @@ auto process_command_line( int argc, char** argv
 	}
 
 	po::notify(vm);
+	if (vm.count("backend")) {
+		tcm::backend::load(vm["backend"].as<std::string>());
+	}
 
 	run( element_type(vm["type"].as<std::string>()) 
 	   , vm["energies"].as<std::string>()
 	   , vm["states"].as<std::string>()
+	   , load_options(vm)
 	   );
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Computes the eigenstates of \p H selected by \p opts. \p H is
+/// destroyed.
+///////////////////////////////////////////////////////////////////////////////
+template<class _T, class _Logger>
+auto diagonalize( tcm::Matrix<_T>& H
+                , SolveOptions const& opts
+                , _Logger & lg )
+	-> std::tuple<tcm::Matrix<tcm::utils::Base<_T>>, tcm::Matrix<_T>>
+{
+	auto const N = H.height();
+	tcm::Matrix<tcm::utils::Base<_T>> E;
+	tcm::Matrix<_T>                   Psi;
+
+	LOG(lg, info) << "Diagonalizing using " << tcm::backend::name() << "...";
+	switch (opts.window) {
+	case SolveOptions::Window::All:
+	{
+		E   = tcm::Matrix<tcm::utils::Base<_T>>{N, 1};
+		Psi = tcm::Matrix<_T>{N, N};
+		auto const threads = available_threads();
+		if (opts.solver == tcm::lapack::Eigensolver::Auto) {
+			LOG(lg, info) << "Automatically choosing eigensolver for N = "
+			              << N << " and " << threads << " threads...";
+		}
+		auto const used = tcm::lapack::diagonalize
+			(H, E, Psi, opts.solver, threads);
+		LOG(lg, info) << "Used eigensolver: " << tcm::lapack::to_string(used);
+		break;
+	}
+	case SolveOptions::Window::Energy:
+		tcm::lapack::heevr_interval
+			( H
+			, static_cast<tcm::utils::Base<_T>>(opts.min)
+			, static_cast<tcm::utils::Base<_T>>(opts.max)
+			, E, Psi );
+		break;
+	case SolveOptions::Window::Index:
+		if (opts.last >= N) {
+			throw std::invalid_argument{ "--window.last must be smaller "
+			                             "than the number of sites." };
+		}
+		E   = tcm::Matrix<tcm::utils::Base<_T>>{opts.last - opts.first + 1, 1};
+		Psi = tcm::Matrix<_T>{N, opts.last - opts.first + 1};
+		tcm::lapack::heevr_index(H, opts.first, opts.last, E, Psi);
+		break;
+	}
+	LOG(lg, info) << "Computed " << Psi.width() << " of " << N
+	              << " eigenstates.";
+	return std::make_tuple(std::move(E), std::move(Psi));
+}
+
+
 template<class _T, class _IStream, class _OStream1, class _OStream2>
 auto solve( _IStream & input
           , _OStream1 & energies_output
-		  , _OStream2 & states_output ) -> void
+		  , _OStream2 & states_output
+		  , SolveOptions const& opts ) -> void
 {
+	using _R = tcm::utils::Base<_T>;
 	boost::log::sources::severity_logger<tcm::severity_level> lg;
 
 	LOG(lg, info) << "Reading Hamiltonian...";
@@ -100,11 +297,29 @@ auto solve( _IStream & input
 	boost::archive::binary_iarchive input_archive{input};
 	input_archive >> H;
 
-	tcm::Matrix<tcm::utils::Base<_T>>   E{H.height(), 1};
-	tcm::Matrix<_T>                   Psi{H.height(), H.height()};
-
-	LOG(lg, info) << "Diagonalizing...";
-	tcm::lapack::heevr(H, E, Psi);
+	tcm::Matrix<_R> E;
+	tcm::Matrix<_T> Psi;
+	if ( not std::is_same<_T, _R>::value and opts.real_tolerance >= 0
+	     and tcm::is_real(H, static_cast<_R>(opts.real_tolerance)) ) {
+		LOG(lg, info) << "Hamiltonian is real within a relative tolerance "
+		              << "of " << opts.real_tolerance << ": using the real "
+		              << "eigensolver.";
+		auto H_real = tcm::real_part(H);
+		H = tcm::Matrix<_T>{};
+
+		tcm::Matrix<_R> Psi_real;
+		std::tie(E, Psi_real) = diagonalize(H_real, opts, lg);
+		Psi = tcm::build_matrix( Psi_real.height(), Psi_real.width()
+		                       , [&Psi_real](auto i, auto j)
+		                         { return _T{Psi_real(i, j)}; } );
+	}
+	else {
+		if (not std::is_same<_T, _R>::value) {
+			LOG(lg, info) << "Hamiltonian is complex: using the complex "
+			              << "eigensolver.";
+		}
+		std::tie(E, Psi) = diagonalize(H, opts, lg);
+	}
 
 	LOG(lg, info) << "Saving results...";
 	boost::archive::binary_oarchive energies_archive{energies_output};
@@ -116,10 +331,115 @@ auto solve( _IStream & input
 }
 
 
+#ifdef USING_SCALAPACK
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Distributed version of solve(): all processes of the world
+/// communicator take part.
+///////////////////////////////////////////////////////////////////////////////
+template<class _T>
+auto solve_distributed( std::string const& energies_filename
+                      , std::string const& states_filename
+                      , SolveOptions const& opts ) -> void
+{
+	using _R = tcm::utils::Base<_T>;
+	namespace sl = tcm::scalapack;
+	boost::log::sources::severity_logger<tcm::severity_level> lg;
+	boost::mpi::communicator world;
+
+	sl::Grid const grid{world};
+	LOG(lg, info) << "Using a " << grid.nprow() << " x " << grid.npcol()
+	              << " process grid with blocks of " << opts.block_size
+	              << ".";
+
+	LOG(lg, info) << "Reading Hamiltonian...";
+	auto H = sl::read<_T>(grid, opts.hamiltonian, opts.block_size);
+	if (H.height() != H.width()) {
+		throw std::runtime_error{"Hamiltonian must be a square matrix."};
+	}
+	auto const N = H.height();
+
+	tcm::Matrix<_R> E;
+	auto Psi = [&]() {
+		LOG(lg, info) << "Diagonalizing using ScaLAPACK...";
+		if ( not std::is_same<_T, _R>::value and opts.real_tolerance >= 0
+		     and sl::is_real(H, static_cast<_R>(opts.real_tolerance)) ) {
+			LOG(lg, info) << "Hamiltonian is real within a relative "
+			              << "tolerance of " << opts.real_tolerance
+			              << ": using the real eigensolver.";
+			auto H_real = sl::transform<_R>( H
+			                               , [](auto x) { return std::real(x); } );
+			H = sl::DistributedMatrix<_T>{grid, 0, 0, opts.block_size};
+
+			sl::DistributedMatrix<_R> Psi_real{grid, N, N, opts.block_size};
+			sl::heevd(H_real, E, Psi_real);
+			return sl::transform<_T>( Psi_real
+			                        , [](auto x) { return _T{x}; } );
+		}
+		if (not std::is_same<_T, _R>::value) {
+			LOG(lg, info) << "Hamiltonian is complex: using the complex "
+			              << "eigensolver.";
+		}
+		sl::DistributedMatrix<_T> Psi{grid, N, N, opts.block_size};
+		sl::heevd(H, E, Psi);
+		return Psi;
+	}();
+	LOG(lg, info) << "Computed " << N << " of " << N << " eigenstates.";
+
+	LOG(lg, info) << "Saving results...";
+	if (world.rank() == 0) {
+		std::ofstream energies_file{energies_filename};
+		if(not energies_file) {
+			throw std::runtime_error{ "Could not open `" + energies_filename
+			                        + "` for writing." };
+		}
+		boost::archive::binary_oarchive energies_archive{energies_file};
+		energies_archive << E;
+	}
+	sl::write(Psi, states_filename);
+
+	LOG(lg, info) << "Done!";
+}
+
+
+auto run_distributed( std::type_index type
+                    , std::string const& energies_filename
+                    , std::string const& states_filename
+                    , SolveOptions const& opts ) -> void
+{
+	using solve_function_t = std::function<void()>;
+	std::unordered_map<std::type_index, solve_function_t> const 
+	dispatch = {
+		{ std::type_index(typeid(float))
+		, [&]() {solve_distributed<float>(energies_filename, states_filename, opts); } },
+		{ std::type_index(typeid(double))
+		, [&]() {solve_distributed<double>(energies_filename, states_filename, opts); } },
+		{ std::type_index(typeid(std::complex<float>))
+		, [&]() {solve_distributed<std::complex<float>>(energies_filename, states_filename, opts); } },
+		{ std::type_index(typeid(std::complex<double>))
+		, [&]() {solve_distributed<std::complex<double>>(energies_filename, states_filename, opts); } }
+	};
+
+	// Only the root process talks.
+	if (boost::mpi::communicator{}.rank() != 0) {
+		boost::log::core::get()->set_logging_enabled(false);
+	}
+	tcm::setup_console_logging();
+	dispatch.at(type)();
+}
+#endif
+
+
 auto run( std::type_index type
         , std::string const& energies_filename
-		, std::string const& states_filename ) -> void
+		, std::string const& states_filename
+		, SolveOptions const& opts ) -> void
 {
+#ifdef USING_SCALAPACK
+	if (opts.distributed) {
+		run_distributed(type, energies_filename, states_filename, opts);
+		return;
+	}
+#endif
 	std::ofstream energies_file{energies_filename};
 	if(not energies_file) {
 		throw std::runtime_error{ "Could not open `" + energies_filename
@@ -132,20 +452,20 @@ auto run( std::type_index type
 	}
 
 	using solve_function_t = std::function<void()>;
-	static std::unordered_map<std::type_index, solve_function_t> const 
+	std::unordered_map<std::type_index, solve_function_t> const 
 	dispatch = {
 		{ std::type_index(typeid(float))
-		, [&energies_file, &states_file]() 
-		  {solve<float>(std::cin, energies_file, states_file); } },
+		, [&energies_file, &states_file, &opts]() 
+		  {solve<float>(std::cin, energies_file, states_file, opts); } },
 		{ std::type_index(typeid(double))
-		, [&energies_file, &states_file]()
-		  {solve<double>(std::cin, energies_file, states_file); } },
+		, [&energies_file, &states_file, &opts]()
+		  {solve<double>(std::cin, energies_file, states_file, opts); } },
 		{ std::type_index(typeid(std::complex<float>))
-		, [&energies_file, &states_file]()
-		  {solve<std::complex<float>>(std::cin, energies_file, states_file); } },
+		, [&energies_file, &states_file, &opts]()
+		  {solve<std::complex<float>>(std::cin, energies_file, states_file, opts); } },
 		{ std::type_index(typeid(std::complex<double>))
-		, [&energies_file, &states_file]() 
-		  {solve<std::complex<double>>(std::cin, energies_file, states_file);} }
+		, [&energies_file, &states_file, &opts]() 
+		  {solve<std::complex<double>>(std::cin, energies_file, states_file, opts);} }
 	};
 
 	tcm::setup_console_logging();
@@ -156,6 +476,9 @@ auto run( std::type_index type
 
 int main(int argc, char** argv)
 {
+#ifdef USING_SCALAPACK
+	boost::mpi::environment env{argc, argv};
+#endif
 	process_command_line
 		( argc, argv
 		, [](auto desc) { std::cout << desc << '\n'; }
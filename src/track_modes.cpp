@@ -0,0 +1,384 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cmath>
+#include <tuple>
+#include <numeric>
+#include <typeinfo>
+#include <typeindex>
+#include <unordered_map>
+
+#include <boost/program_options.hpp>
+#include <boost/log/sources/logger.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <benchmark.hpp>
+#include <logging.hpp>
+#include <file_names.hpp>
+
+#include <constants.hpp>
+#include <matrix_serialization.hpp>
+#include <krylov.hpp>
+
+
+
+namespace po = boost::program_options;
+
+auto init_options() -> po::options_description
+{
+	po::options_description description;
+	description.add_options()
+		( "help", "Produce the help message." )
+		( "type"
+		, po::value<std::string>()->required()
+		, "Type of an element of the eigenstates matrix (or of the epsilon "
+		  "matrices if --epsilon is used). It may be either double or "
+		  "cdouble." )
+		( "epsilon"
+		, po::value<std::vector<std::string>>()->multitoken()
+		, "Precomputed epsilon matrices '<base>.<frequency>.matrix.bin'. "
+		  "Glob patterns are expanded. They are processed in order of "
+		  "increasing frequency." )
+		( "energies"
+		, po::value<std::string>()
+		, "Instead of --epsilon, apply epsilon matrix-free. File to where "
+		  "the eigenenergies were saved to (by solve_system)." )
+		( "states"
+		, po::value<std::string>()
+		, "File to where the eigenstates were saved to (by solve_system)." )
+		( "potential"
+		, po::value<std::string>()
+		, "File to where the Coulomb potential was saved to (by potential)." )
+		( "frequency.start"
+		, po::value<double>()
+		, "Starting frequency in eV." )
+		( "frequency.stop"
+		, po::value<double>()
+		, "Stopping frequency in eV." )
+		( "frequency.step"
+		, po::value<double>()
+		, "Step in frequency in eV." )
+		( "count"
+		, po::value<std::size_t>()->default_value(2)
+		, "Number of modes with the largest loss to track." )
+		( "extra"
+		, po::value<std::size_t>()->default_value(2)
+		, "Number of extra Ritz vectors kept when restarting Davidson." )
+		( "shift"
+		, po::value<double>()->default_value(0)
+		, "Shift sigma of the shift-invert transformation." )
+		( "tol"
+		, po::value<double>()->default_value(1E-10)
+		, "Relative accuracy of the computed eigenpairs." )
+		( "max-iter"
+		, po::value<std::size_t>()->default_value(300)
+		, "Maximal number of Davidson iterations before falling back to "
+		  "Arnoldi." )
+		( "overlap"
+		, po::value<double>()->default_value(0.5)
+		, "Minimal overlap |<z_old|z_new>| for two eigenvectors at "
+		  "adjacent frequencies to be considered the same mode." )
+		( "save"
+		, po::value<std::string>()
+		, "If given, eigenvalues and eigenstates are also saved to "
+		  "'<save>.<frequency>.{eigenvalues,eigenstates}.bin' with columns "
+		  "in order of the printed modes." );
+	description.add(tcm::init_constants_options<double>());
+	return description;
+}
+
+
+auto element_type(std::string input) -> std::type_index
+{
+	using namespace std::string_literals;
+	static std::unordered_map<std::string, std::type_index> const types =
+		{ { "double"s,  std::type_index(typeid(double))               }
+		, { "cdouble"s, std::type_index(typeid(std::complex<double>)) }
+		};
+
+	boost::to_lower(input);
+	try {
+		return types.at(input);
+	} catch(std::out_of_range & e) {
+		std::cerr << "Invalid element type `" + input + "`!\n";
+		throw;
+	}
+}
+
+
+template<class _Help, class _Run>
+auto process_command_line( int argc, char** argv
+                         , _Help&& help
+						 , _Run&& run ) -> void
+{
+	auto const description = init_options();
+	po::variables_map vm;
+
+	po::store( po::command_line_parser(argc, argv)
+	              .options(description)
+	              .run()
+	         , vm );
+
+	if (vm.count("help")) {
+		help(description);
+		return;
+	}
+
+	po::notify(vm);
+	run(vm);
+}
+
+
+template<class _T>
+auto load_matrix(std::string const& file_name) -> tcm::Matrix<_T>
+{
+	std::ifstream in_stream{file_name};
+	if (not in_stream)
+		throw std::runtime_error{"Failed to open `" + file_name + "`."};
+	boost::archive::binary_iarchive in_archive{in_stream};
+
+	tcm::Matrix<_T> A;
+	in_archive >> A;
+	return A;
+}
+
+
+template<class _T>
+auto save_matrix(tcm::Matrix<_T> const& A, std::string const& file_name) -> void
+{
+	std::ofstream out_stream{file_name};
+	if (not out_stream)
+		throw std::runtime_error{"Failed to open `" + file_name + "`."};
+	boost::archive::binary_oarchive out_archive{out_stream};
+	out_archive << A;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Assigns mode labels to the columns of \p Z given the labelled
+/// eigenvectors \p Z_old at the previous frequency.
+
+/// Pairs are matched greedily in order of decreasing overlap
+/// \f$ |\langle z^\text{old}_i|z_j\rangle| \f$. Columns without a partner
+/// above \p threshold are new modes and get a fresh label.
+///
+/// \return Labels and overlaps of the columns of \p Z.
+///////////////////////////////////////////////////////////////////////////////
+template <class _C>
+auto match_modes( tcm::Matrix<_C> const& Z_old
+                , std::vector<std::size_t> const& labels_old
+                , tcm::Matrix<_C> const& Z
+                , tcm::utils::Base<_C> const threshold
+                , std::size_t& next_label )
+	-> std::pair<std::vector<std::size_t>, std::vector<tcm::utils::Base<_C>>>
+{
+	using _R = tcm::utils::Base<_C>;
+	auto const k_old = Z_old.width();
+	auto const k     = Z.width();
+
+	tcm::Matrix<_C> O{k_old, k};
+	tcm::blas::gemm( tcm::blas::Operator::H, tcm::blas::Operator::None
+	               , _C{1}, Z_old, Z, _C{0}, O );
+
+	std::vector<std::tuple<_R, std::size_t, std::size_t>> pairs;
+	for (std::size_t j = 0; j < k; ++j)
+		for (std::size_t i = 0; i < k_old; ++i)
+			pairs.emplace_back(std::abs(O(i, j)), i, j);
+	std::sort( std::begin(pairs), std::end(pairs)
+	         , [](auto const& x, auto const& y)
+	           { return std::get<0>(x) > std::get<0>(y); } );
+
+	auto const none = std::numeric_limits<std::size_t>::max();
+	std::vector<std::size_t> labels(k, none);
+	std::vector<_R>          overlaps(k, _R{0});
+	std::vector<bool>        taken(k_old, false);
+	for (auto const& x : pairs) {
+		auto const i = std::get<1>(x);
+		auto const j = std::get<2>(x);
+		if (std::get<0>(x) < threshold) break;
+		if (taken[i] or labels[j] != none) continue;
+		taken[i]    = true;
+		labels[j]   = labels_old[i];
+		overlaps[j] = std::get<0>(x);
+	}
+	for (auto& label : labels)
+		if (label == none) label = next_label++;
+	return {labels, overlaps};
+}
+
+
+// Returns start, start + step, ..., stop as given by --frequency.*. Includes
+// stop even if it is a few ulps short of the grid.
+auto frequencies(po::variables_map const& vm) -> std::vector<double>
+{
+	auto const start = vm["frequency.start"].as<double>();
+	auto const stop  = vm["frequency.stop"].as<double>();
+	auto const step  = vm["frequency.step"].as<double>();
+	if (not (step > 0)) {
+		throw std::invalid_argument{"--frequency.step must be positive."};
+	}
+	if (not std::isfinite(start) or not std::isfinite(stop)) {
+		throw std::invalid_argument{ "--frequency.start and --frequency.stop "
+		                             "must be finite." };
+	}
+
+	std::vector<double> ws;
+	if (stop < start) return ws;
+	auto const last = std::floor((stop - start) / step + 1E-6);
+	if (not (last < 1E9)) {
+		throw std::invalid_argument{ "--frequency.step is too small for the "
+		                             "given range." };
+	}
+	auto const count = static_cast<std::size_t>(last) + 1;
+	ws.reserve(count);
+	for (std::size_t i = 0; i < count; ++i)
+		ws.push_back(start + i * step);
+	return ws;
+}
+
+
+template <class _T>
+auto run(po::variables_map const& vm) -> void
+{
+	using _R = tcm::utils::Base<_T>;
+	using _C = std::complex<_R>;
+	boost::log::sources::severity_logger<tcm::severity_level> lg;
+
+	auto const sigma = _C{static_cast<_R>(vm["shift"].as<double>())};
+	auto const threshold = static_cast<_R>(vm["overlap"].as<double>());
+
+	tcm::krylov::ArnoldiOptions<_R> arnoldi_opts;
+	arnoldi_opts.count = vm["count"].as<std::size_t>();
+	arnoldi_opts.tol   = vm["tol"].as<double>();
+	tcm::krylov::DavidsonOptions<_R> davidson_opts;
+	davidson_opts.count    = arnoldi_opts.count;
+	davidson_opts.extra    = vm["extra"].as<std::size_t>();
+	davidson_opts.tol      = arnoldi_opts.tol;
+	davidson_opts.max_iter = vm["max-iter"].as<std::size_t>();
+
+	tcm::Matrix<_C>          Z_old;
+	std::vector<std::size_t> labels_old;
+	std::size_t              next_label = 0;
+	std::cout << std::scientific << std::setprecision(15);
+
+	// Solves at one frequency, warm-started from the previous one.
+	auto const process = [&](_R const frequency, auto const& inverse) {
+		LOG(lg, info) << "Tracking modes at omega = " << frequency << "...";
+		auto modes = labels_old.empty()
+			? tcm::krylov::loss_eigenpairs(inverse, sigma, arnoldi_opts, lg)
+			: tcm::krylov::loss_eigenpairs( inverse, sigma, Z_old
+			                              , davidson_opts, lg );
+		if (not modes.converged and not labels_old.empty()) {
+			LOG(lg, info) << "Falling back to Arnoldi at omega = "
+			              << frequency << ".";
+			modes = tcm::krylov::loss_eigenpairs
+				(inverse, sigma, arnoldi_opts, lg);
+		}
+
+		std::vector<std::size_t> labels(modes.vectors.width());
+		std::vector<_R>          overlaps(modes.vectors.width(), _R{0});
+		if (labels_old.empty()) {
+			std::iota(std::begin(labels), std::end(labels), 0);
+			next_label = labels.size();
+		}
+		else {
+			std::tie(labels, overlaps) = match_modes
+				(Z_old, labels_old, modes.vectors, threshold, next_label);
+		}
+
+		for (std::size_t j = 0; j < labels.size(); ++j) {
+			auto const lambda = modes.values(j, 0);
+			std::cout << frequency << '\t'
+			          << labels[j] << '\t'
+			          << std::real(lambda) << '\t'
+			          << std::imag(lambda) << '\t'
+			          << -std::imag(_C{1} / lambda) << '\t'
+			          << overlaps[j] << '\n';
+		}
+
+		if (vm.count("save")) {
+			auto const base = vm["save"].as<std::string>() + "."
+				+ std::to_string(frequency);
+			save_matrix(modes.values, base + ".eigenvalues.bin");
+			save_matrix(modes.vectors, base + ".eigenstates.bin");
+		}
+
+		Z_old      = std::move(modes.vectors);
+		labels_old = std::move(labels);
+	};
+
+	if (vm.count("epsilon")) {
+		std::vector<std::pair<_R, std::string>> jobs;
+		for (auto const& f : tcm::expand_files(
+				vm["epsilon"].as<std::vector<std::string>>()))
+			jobs.emplace_back(tcm::parse_frequency<_R>(f), f);
+		std::sort( std::begin(jobs), std::end(jobs)
+		         , [](auto const& x, auto const& y)
+		           { return x.first < y.first; } );
+
+		for (auto const& job : jobs) {
+			tcm::krylov::ShiftInvertLU<_C> const inverse
+				{load_matrix<_C>(job.second), sigma};
+			process(job.first, inverse);
+		}
+		return;
+	}
+
+	for (auto const* option : { "energies", "states", "potential"
+	                          , "frequency.start", "frequency.stop"
+	                          , "frequency.step" }) {
+		if (not vm.count(option)) {
+			throw std::invalid_argument{ "--" + std::string{option}
+			                           + " is required unless --epsilon "
+			                             "is given." };
+		}
+	}
+
+	auto const ws  = frequencies(vm);
+	auto const E   = load_matrix<_R>(vm["energies"].as<std::string>());
+	auto const Psi = load_matrix<_T>(vm["states"].as<std::string>());
+	auto const V   = load_matrix<_C>(vm["potential"].as<std::string>());
+	auto const cs  =
+		tcm::load_constants<_R, double, std::map<std::string, _R>>(vm);
+
+	if (Psi.width() != E.height() or V.height() != Psi.height()) {
+		throw std::invalid_argument{ "Dimensions of energies, states and "
+		                             "potential do not match." };
+	}
+
+	for (auto const x : ws) {
+		auto const w = static_cast<_R>(x);
+		tcm::krylov::EpsilonOperator<_C> const epsilon
+			{_C{w, cs.at("tau")}, E, Psi, V, cs, lg};
+		tcm::krylov::ShiftInvertKrylov<decltype(epsilon), _C> const inverse
+			{epsilon, sigma};
+		process(w, inverse);
+	}
+}
+
+
+auto dispatch(po::variables_map const& vm) -> void
+{
+	std::unordered_map< std::type_index,
+		void (*)(po::variables_map const&)> const callbacks =
+			{ { typeid(double), &run<double> }
+			, { typeid(std::complex<double>), &run<std::complex<double>> }
+			};
+
+	tcm::setup_console_logging();
+	callbacks.at(element_type(vm["type"].as<std::string>()))(vm);
+}
+
+
+int main(int argc, char** argv)
+{
+	process_command_line
+		( argc, argv
+		, [](auto desc) { std::cout << desc << '\n'; }
+		, &dispatch
+		);
+	return EXIT_SUCCESS;
+}
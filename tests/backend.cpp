@@ -0,0 +1,66 @@
+#include <iostream>
+#include <cassert>
+#include <map>
+#include <stdexcept>
+
+#define DO_MEASURE
+
+#include <matrix.hpp>
+#include <lapack.hpp>
+
+using namespace tcm;
+
+
+// Loads a backend which does not provide LAPACK (e.g. libm.so.6) and checks
+// that a failed symbol lookup in lapack::diagonalize reaches the caller as
+// std::runtime_error for both ?HEEVR and ?HEEVD.
+template<class T>
+auto apply_backend(std::string const& library) -> int
+{
+	try {
+		backend::load(library);
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "skipped: " << e.what() << '\n';
+		return 0;
+	}
+
+	auto failed = 0;
+	for (auto const solver : { lapack::Eigensolver::MRRR
+	                         , lapack::Eigensolver::DivideAndConquer }) {
+		Matrix<T> A{2, 2};
+		Matrix<utils::Base<T>> W{2, 1};
+		Matrix<T> Z{2, 2};
+		A(0, 0) = T{1}; A(0, 1) = T{0};
+		A(1, 0) = T{0}; A(1, 1) = T{2};
+
+		std::cout << lapack::to_string(solver) << ": ";
+		try {
+			lapack::diagonalize(A, W, Z, solver);
+			std::cout << "no exception\n";
+			failed = 1;
+		}
+		catch (std::runtime_error& e) {
+			std::cout << e.what() << '\n';
+		}
+	}
+	return failed;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::map< std::string
+	        , int (*)(std::string const&) > func_map;
+
+	func_map["float"]          = &apply_backend<float>;
+	func_map["double"]         = &apply_backend<double>;
+	func_map["complex-float"]  = &apply_backend<std::complex<float>>;
+	func_map["complex-double"] = &apply_backend<std::complex<double>>;
+
+	assert(argc == 3);
+	auto const status = func_map.at(argv[1])(argv[2]);
+
+	timing::report(std::cerr);
+	return status;
+}
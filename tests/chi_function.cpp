@@ -0,0 +1,72 @@
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cmath>
+#include <map>
+
+#define DO_MEASURE
+
+#include <matrix.hpp>
+#include <constants.hpp>
+#include <dielectric_function_v2.hpp>
+
+
+using namespace tcm;
+
+
+// Reads E (M x 1) and Psi (N x M) from stdin and prints the largest
+// difference between chi built with G in blocks of g_tile columns and chi
+// built with the full G, relative to the largest element of the latter.
+template<class T>
+auto apply_chi_function( std::size_t const N, std::size_t const M
+                       , std::size_t const g_tile ) -> int
+{
+	using R = utils::Base<T>;
+	using C = std::complex<R>;
+	boost::log::sources::severity_logger<tcm::severity_level> lg;
+	auto const cs = default_constants<R>();
+	auto const omega = C{1, cs.at("tau")};
+
+	Matrix<R> E{M, 1};
+	Matrix<T> Psi{N, M};
+	std::cin >> E >> Psi;
+
+	auto const full  = chi_function::make(omega, E, Psi, cs, lg);
+	auto const tiled = chi_function::make(omega, E, Psi, cs, lg, g_tile);
+	assert(full.height() == N and tiled.height() == N);
+
+	R diff = 0;
+	R norm = 0;
+	for (std::size_t j = 0; j < N; ++j) {
+		for (std::size_t i = 0; i < N; ++i) {
+			diff = std::max(diff, std::abs(tiled(i, j) - full(i, j)));
+			norm = std::max(norm, std::abs(full(i, j)));
+		}
+	}
+	std::cout << std::setprecision(5) << diff / norm << '\n';
+	// A zero chi or a NaN anywhere must not pass as agreement.
+	if (not std::isfinite(diff) or not std::isfinite(norm) or norm == 0)
+		return 1;
+	return diff <= R{1E-10} * norm ? 0 : 1;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::map< std::string
+	        , int (*)( std::size_t const, std::size_t const
+	                 , std::size_t const ) > func_map;
+
+	func_map["double"]         = &apply_chi_function<double>;
+	func_map["complex-double"] = &apply_chi_function<std::complex<double>>;
+
+	assert(argc == 5);
+	const auto N      = static_cast<std::size_t>(std::stoi(argv[2]));
+	const auto M      = static_cast<std::size_t>(std::stoi(argv[3]));
+	const auto g_tile = static_cast<std::size_t>(std::stoi(argv[4]));
+
+	auto const status = func_map.at(argv[1])(N, M, g_tile);
+
+	timing::report(std::cerr);
+	return status;
+}
@@ -0,0 +1,45 @@
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <map>
+
+#define DO_MEASURE
+
+#include <matrix.hpp>
+#include <complex_symmetric.hpp>
+
+
+using namespace tcm;
+
+
+template<class T>
+auto apply_complex_symmetric(std::size_t const N) -> void
+{
+	Matrix<T> A{N, N};
+	Matrix<T> W{N, 1};
+	Matrix<T> Z{N, N};
+	
+	std::cin >> A;
+
+	auto AP = complex_symmetric::pack_lower(A);
+	complex_symmetric::eigen(N, AP, W, Z);
+	std::cout << std::setprecision(20) << W << '\n' << Z << '\n';
+}
+
+
+int main(int argc, char** argv)
+{
+	std::map< std::string
+	        , void (*)(std::size_t const) > func_map;
+
+	func_map["complex-float"]  = &apply_complex_symmetric<std::complex<float>>;
+	func_map["complex-double"] = &apply_complex_symmetric<std::complex<double>>;
+
+	assert(argc == 3);
+	const auto N = static_cast<std::size_t>(std::stoi(argv[2]));
+
+	func_map.at(argv[1])(N);
+
+	timing::report(std::cerr);
+	return 0;
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <map>
+
+#define DO_MEASURE
+
+#include <matrix.hpp>
+#include <lapack.hpp>
+
+
+using namespace tcm;
+
+
+template<class T>
+auto apply_geev_selected(std::size_t const N, std::size_t const k) -> void
+{
+	Matrix<T, 64> A{N, N};
+	Matrix<T, 64> W{N, 1};
+	Matrix<T, 64> Z{N, k};
+	
+	std::cin >> A;
+
+	// Select the eigenvalues with the largest loss -Im[1/lambda].
+	auto const order = lapack::geev_selected
+		( A, W
+		, [](auto const x) { return -std::imag(utils::Base<T>{1} / x); }
+		, Z );
+
+	Matrix<T, 64> selected{k, 1};
+	for (std::size_t i = 0; i < k; ++i)
+		selected(i, 0) = W(order[i], 0);
+	std::cout << std::setprecision(20) << selected << '\n' << Z << '\n';
+}
+
+
+int main(int argc, char** argv)
+{
+	std::map< std::string
+	        , void (*)(std::size_t const, std::size_t const) > func_map;
+
+	func_map["complex-float"]  = &apply_geev_selected<std::complex<float>>;
+	func_map["complex-double"] = &apply_geev_selected<std::complex<double>>;
+
+	assert(argc == 4);
+	const auto N = static_cast<std::size_t>(std::stoi(argv[2]));
+	const auto k = static_cast<std::size_t>(std::stoi(argv[3]));
+
+	func_map.at(argv[1])(N, k);
+
+	timing::report(std::cerr);
+	return 0;
+}
@@ -0,0 +1,49 @@
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <map>
+#include <vector>
+
+#define DO_MEASURE
+
+#include <matrix.hpp>
+#include <lapack.hpp>
+
+using namespace tcm;
+
+
+template<class T>
+auto apply_getrs(std::size_t const N) -> void
+{
+	Matrix<T, 64> A{N, N};
+	Matrix<T, 64> B{N, 1};
+	std::vector<lapack::lapack_int> ipiv;
+	
+	std::cin >> A >> B;
+
+	lapack::getrf(A, ipiv);
+	lapack::getrs(A, ipiv, B);
+
+	std::cout << std::setprecision(20) << B << '\n';
+}
+
+
+int main(int argc, char** argv)
+{
+	std::map< std::string
+	        , void (*)(std::size_t const) > func_map;
+
+	func_map["float"]          = &apply_getrs<float>;
+	func_map["double"]         = &apply_getrs<double>;
+	func_map["complex-float"]  = &apply_getrs<std::complex<float>>;
+	func_map["complex-double"] = &apply_getrs<std::complex<double>>;
+
+
+	assert(argc == 3);
+	const auto N = static_cast<std::size_t>(std::stoi(argv[2]));
+
+	func_map.at(argv[1])(N);
+
+	timing::report(std::cerr);
+	return 0;
+}
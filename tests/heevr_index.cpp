@@ -0,0 +1,51 @@
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <map>
+
+#define DO_MEASURE
+
+#include <matrix.hpp>
+#include <lapack.hpp>
+
+using namespace tcm;
+
+
+template<class T>
+auto apply_heevr_index( std::size_t const N
+                      , std::size_t const il, std::size_t const iu ) -> void
+{
+	Matrix<T, 64> A{N, N};
+	Matrix<utils::Base<T>, 64> W{iu - il + 1, 1};
+	Matrix<T, 64> Z{N, iu - il + 1};
+	
+	std::cin >> A;
+
+	lapack::heevr_index(A, il, iu, W, Z);
+
+	std::cout << std::setprecision(20) << W << '\n';
+}
+
+
+int main(int argc, char** argv)
+{
+	std::map< std::string
+	        , void (*)( std::size_t const
+	                  , std::size_t const, std::size_t const ) > func_map;
+
+	func_map["float"]          = &apply_heevr_index<float>;
+	func_map["double"]         = &apply_heevr_index<double>;
+	func_map["complex-float"]  = &apply_heevr_index<std::complex<float>>;
+	func_map["complex-double"] = &apply_heevr_index<std::complex<double>>;
+
+
+	assert(argc == 5);
+	const auto N  = static_cast<std::size_t>(std::stoi(argv[2]));
+	const auto il = static_cast<std::size_t>(std::stoi(argv[3]));
+	const auto iu = static_cast<std::size_t>(std::stoi(argv[4]));
+
+	func_map.at(argv[1])(N, il, iu);
+
+	timing::report(std::cerr);
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <map>
+
+#define DO_MEASURE
+
+#include <matrix.hpp>
+#include <constants.hpp>
+#include <dielectric_function_v2.hpp>
+#include <out_of_core.hpp>
+
+
+using namespace tcm;
+
+
+template<class T>
+auto max_difference(Matrix<T> const& A, Matrix<T> const& B)
+{
+	assert(A.height() == B.height() and A.width() == B.width());
+	utils::Base<T> diff = 0;
+	utils::Base<T> norm = 0;
+	for (std::size_t j = 0; j < A.width(); ++j) {
+		for (std::size_t i = 0; i < A.height(); ++i) {
+			diff = std::max(diff, std::abs(A(i, j) - B(i, j)));
+			norm = std::max(norm, std::abs(B(i, j)));
+		}
+	}
+	// A zero reference or a NaN anywhere must not pass as agreement.
+	if (not std::isfinite(diff) or not std::isfinite(norm) or norm == 0)
+		return std::numeric_limits<utils::Base<T>>::quiet_NaN();
+	return diff / norm;
+}
+
+
+template<class T>
+auto read_all(out_of_core::TiledMatrix<T> const& A) -> Matrix<T>
+{
+	Matrix<T> X{A.size(), A.size()};
+	for (std::size_t J = 0; J < A.tiles(); ++J)
+		for (std::size_t I = 0; I < A.tiles(); ++I)
+			A.read(I, J, X.data(I * A.tile(), J * A.tile()), X.ldim());
+	return X;
+}
+
+
+// Reads E (M x 1), Psi (N x M) and V (N x N, complex) from stdin and
+// prints the relative differences between the out-of-core and the in-core
+// results for a TiledMatrix round trip, chi, chi with G in blocks, epsilon
+// and Operator.
+template<class T>
+auto apply_out_of_core( std::size_t const N, std::size_t const M
+                      , std::size_t const tile, std::string const& path ) -> int
+{
+	using R = utils::Base<T>;
+	using C = std::complex<R>;
+	boost::log::sources::severity_logger<tcm::severity_level> lg;
+	auto const cs = default_constants<R>();
+	auto const omega = C{1, cs.at("tau")};
+
+	Matrix<R> E{M, 1};
+	Matrix<T> Psi{N, M};
+	Matrix<C> V{N, N};
+	std::cin >> E >> Psi >> V;
+
+	std::map<std::string, R> differences;
+	{
+		out_of_core::TiledMatrix<C> A{path, N, tile};
+		for (std::size_t J = 0; J < A.tiles(); ++J) {
+			Matrix<C> panel{N, A.rows(J)};
+			for (std::size_t j = 0; j < panel.width(); ++j)
+				for (std::size_t i = 0; i < N; ++i)
+					panel(i, j) = V(i, J * tile + j);
+			A.write_panel(J, panel);
+		}
+		differences["round trip"] = max_difference(read_all(A), V);
+	}
+
+	auto const chi = chi_function::make(omega, E, Psi, cs, lg);
+	auto tiled = out_of_core::chi(omega, E, Psi, cs, path, tile, lg);
+	differences["chi"] = max_difference(read_all(tiled), chi);
+	differences["chi (G in blocks)"] = max_difference(read_all(
+		out_of_core::chi(omega, E, Psi, cs, path, tile, lg, (M + 1) / 2)), chi);
+
+	auto const epsilon = dielectric_function::make(chi, V, lg);
+	tiled = out_of_core::epsilon(std::move(tiled), V, lg);
+	differences["epsilon"] = max_difference(read_all(tiled), epsilon);
+
+	Matrix<C> x{N, 1};
+	Matrix<C> y{N, 1};
+	Matrix<C> expected{N, 1};
+	for (std::size_t i = 0; i < N; ++i) x(i, 0) = C{R{1} / (i + 1), R{1}};
+	out_of_core::Operator<C> const op{tiled};
+	op(x.data(), y.data());
+	blas::gemv(blas::Operator::None, C{1}, epsilon, x, C{0}, expected);
+	differences["Operator"] = max_difference(y, expected);
+
+	auto failed = 0;
+	for (auto const& x : differences) {
+		std::cout << std::setprecision(5) << x.first << ": " << x.second << '\n';
+		if (not (x.second <= R{1E-10})) failed = 1;
+	}
+	return failed;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::map< std::string
+	        , int (*)( std::size_t const, std::size_t const
+	                 , std::size_t const, std::string const& ) > func_map;
+
+	func_map["double"]         = &apply_out_of_core<double>;
+	func_map["complex-double"] = &apply_out_of_core<std::complex<double>>;
+
+	assert(argc == 5 or argc == 6);
+	const auto N    = static_cast<std::size_t>(std::stoi(argv[2]));
+	const auto M    = static_cast<std::size_t>(std::stoi(argv[3]));
+	const auto tile = static_cast<std::size_t>(std::stoi(argv[4]));
+
+	auto const status = func_map.at(argv[1])
+		(N, M, tile, argc == 6 ? argv[5] : "out_of_core.tiles");
+
+	timing::report(std::cerr);
+	return status;
+}